@@ -16,6 +16,11 @@ if [[ "${TESTING:-0}" == "1" ]]; then
   CFLAGS+=(-DTESTING)
 fi
 
+# Frame pointers, so the sampling profiler can walk call stacks
+if [[ "${PROFILE:-0}" == "1" ]]; then
+  CFLAGS+=(-fno-omit-frame-pointer)
+fi
+
 LDFLAGS=(-T src/linker.ld -ffreestanding -O2 -nostdlib)
 
 echo "[1/6] Assemble boot.s"
@@ -38,6 +43,20 @@ if [ -f src/isr.s ]; then
   objs+=(build/isr.o)
 fi
 
+# AP startup trampoline (copied below 1 MiB at run time)
+if [ -f src/ap_boot.s ]; then
+  echo "    AS ap_boot.s"
+  i686-elf-as src/ap_boot.s -o build/ap_boot.o
+  objs+=(build/ap_boot.o)
+fi
+
+# Context switch for the cooperative scheduler
+if [ -f src/context.s ]; then
+  echo "    AS context.s"
+  i686-elf-as src/context.s -o build/context.o
+  objs+=(build/context.o)
+fi
+
 if [[ "${TESTING:-0}" == "1" ]]; then
   echo "[2b/6] Compile kernel test sources"
   for c in tests/kernel/*.c; do
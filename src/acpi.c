@@ -0,0 +1,126 @@
+#include "acpi.h"
+#include "string.h"
+
+#define EBDA_SEGMENT_PTR 0x40E
+#define BIOS_ROM_START   0xE0000
+#define BIOS_ROM_END     0x100000
+
+#define MADT_LOCAL_APIC  0
+#define MADT_CPU_ENABLED 0x1
+
+typedef struct {
+    char     signature[8];        // "RSD PTR "
+    uint8_t  checksum;            // first 20 bytes sum to 0
+    char     oem_id[6];
+    uint8_t  revision;
+    uint32_t rsdt_address;
+} __attribute__((packed)) rsdp_t;
+
+typedef struct {
+    char     signature[4];
+    uint32_t length;              // whole table, header included
+    uint8_t  revision;
+    uint8_t  checksum;
+    char     oem_id[6];
+    char     oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed)) sdt_header_t;
+
+typedef struct {
+    sdt_header_t h;
+    uint32_t lapic_address;
+    uint32_t flags;
+    uint8_t  entries[];           // {type, length, ...} records
+} __attribute__((packed)) madt_t;
+
+static uint8_t cpu_apic_ids[MAX_CPUS];
+static uint32_t cpu_count = 0;
+static uint32_t lapic_base = 0;
+
+static bool checksum_ok(const void* p, uint32_t len) {
+    const uint8_t* b = (const uint8_t*)p;
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < len; i++) sum += b[i];
+    return sum == 0;
+}
+
+/* The RSDP sits on a 16-byte boundary in the first KiB of the EBDA or in
+   the BIOS ROM area. */
+static const rsdp_t* scan(uint32_t start, uint32_t end) {
+    for (uint32_t a = start; a + sizeof(rsdp_t) <= end; a += 16) {
+        const rsdp_t* r = (const rsdp_t*)a;
+        if (memcmp(r->signature, "RSD PTR ", 8) == 0 &&
+            checksum_ok(r, sizeof(rsdp_t))) {
+            return r;
+        }
+    }
+    return 0;
+}
+
+/* A plain dereference of a page-0 constant trips -Warray-bounds. */
+static uint16_t bda_read16(uint32_t addr) {
+    uint16_t v;
+    __asm__ volatile ("movw (%1), %0" : "=r"(v) : "r"(addr));
+    return v;
+}
+
+static const rsdp_t* find_rsdp(void) {
+    uint32_t ebda = (uint32_t)bda_read16(EBDA_SEGMENT_PTR) << 4;
+    const rsdp_t* r = ebda ? scan(ebda, ebda + 1024) : 0;
+    return r ? r : scan(BIOS_ROM_START, BIOS_ROM_END);
+}
+
+static const madt_t* find_madt(const sdt_header_t* rsdt) {
+    uint32_t n = (rsdt->length - sizeof(sdt_header_t)) / 4;
+    const uint32_t* tables = (const uint32_t*)(rsdt + 1);
+    for (uint32_t i = 0; i < n; i++) {
+        const sdt_header_t* t = (const sdt_header_t*)tables[i];
+        if (memcmp(t->signature, "APIC", 4) == 0 &&
+            checksum_ok(t, t->length)) {
+            return (const madt_t*)t;
+        }
+    }
+    return 0;
+}
+
+bool acpi_init(void) {
+    cpu_count = 0;
+    lapic_base = 0;
+
+    const rsdp_t* rsdp = find_rsdp();
+    if (!rsdp) return false;
+    const sdt_header_t* rsdt = (const sdt_header_t*)rsdp->rsdt_address;
+    if (memcmp(rsdt->signature, "RSDT", 4) != 0 ||
+        !checksum_ok(rsdt, rsdt->length)) {
+        return false;
+    }
+    const madt_t* madt = find_madt(rsdt);
+    if (!madt) return false;
+
+    lapic_base = madt->lapic_address;
+    const uint8_t* p = madt->entries;
+    const uint8_t* end = (const uint8_t*)madt + madt->h.length;
+    while (p + 2 <= end && p[1] >= 2 && p + p[1] <= end) {
+        // Local APIC: {0, 8, ACPI processor ID, APIC ID, flags (u32)}
+        if (p[0] == MADT_LOCAL_APIC && p[1] >= 8 &&
+            (p[4] & MADT_CPU_ENABLED) && cpu_count < MAX_CPUS) {
+            cpu_apic_ids[cpu_count++] = p[3];
+        }
+        p += p[1];
+    }
+    return cpu_count > 0;
+}
+
+uint32_t acpi_cpu_count(void) {
+    return cpu_count;
+}
+
+uint8_t acpi_cpu_apic_id(uint32_t index) {
+    return index < cpu_count ? cpu_apic_ids[index] : 0;
+}
+
+uint32_t acpi_lapic_base(void) {
+    return lapic_base;
+}
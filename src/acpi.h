@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "cpu.h"
+
+/*
+ * acpi.h — Just enough ACPI to find the processors: the RSDP in the BIOS
+ * areas, the RSDT, and the local APIC entries of the MADT.
+ *
+ * The tables are read in place (identity mapped) and nothing is kept but
+ * the list of enabled local APIC IDs and the local APIC base.
+ */
+
+/* Find and parse the MADT. Returns false when there is no RSDP, no MADT
+   or a bad checksum; the system is then treated as uniprocessor. */
+bool acpi_init(void);
+
+/* Enabled processors listed in the MADT (at most MAX_CPUS). */
+uint32_t acpi_cpu_count(void);
+uint8_t acpi_cpu_apic_id(uint32_t index);
+
+/* Physical address of the local APIC from the MADT, or 0. */
+uint32_t acpi_lapic_base(void);
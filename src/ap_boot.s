@@ -0,0 +1,62 @@
+/* AP startup trampoline.
+
+   smp_init() copies ap_trampoline_start..ap_trampoline_end to
+   AP_TRAMPOLINE (page 8, below 1 MiB) and points each STARTUP IPI there.
+   The AP wakes in real mode at 0800:0000, loads the small flat GDT below,
+   enters protected mode and calls ap_main(cpu) on the stack smp_init()
+   left in the parameter slots. Everything is addressed as AP_TRAMPOLINE +
+   (label - ap_trampoline_start) because the code does not run where it
+   was linked. */
+
+.set AP_TRAMPOLINE, 0x8000
+.set AP_CS, 0x08
+.set AP_DS, 0x10
+
+.section .text
+.code16
+.global ap_trampoline_start
+ap_trampoline_start:
+    cli
+    cld
+    xor %ax, %ax
+    mov %ax, %ds
+    lgdtl AP_TRAMPOLINE + (ap_gdt_ptr - ap_trampoline_start)
+    mov %cr0, %eax
+    or $1, %eax                 /* PE */
+    mov %eax, %cr0
+    ljmpl $AP_CS, $(AP_TRAMPOLINE + (ap_pm - ap_trampoline_start))
+
+.code32
+ap_pm:
+    mov $AP_DS, %ax
+    mov %ax, %ds
+    mov %ax, %es
+    mov %ax, %fs
+    mov %ax, %gs
+    mov %ax, %ss
+    mov AP_TRAMPOLINE + (ap_param_stack - ap_trampoline_start), %esp
+    mov AP_TRAMPOLINE + (ap_param_entry - ap_trampoline_start), %eax
+    pushl AP_TRAMPOLINE + (ap_param_cpu - ap_trampoline_start)
+    call *%eax
+1:  cli
+    hlt
+    jmp 1b
+
+.align 8
+ap_gdt:
+    .quad 0
+    .quad 0x00CF9A000000FFFF    /* flat 4 GiB code, ring 0 */
+    .quad 0x00CF92000000FFFF    /* flat 4 GiB data, ring 0 */
+ap_gdt_ptr:
+    .word ap_gdt_ptr - ap_gdt - 1
+    .long AP_TRAMPOLINE + (ap_gdt - ap_trampoline_start)
+
+/* Filled in by smp_init() in the copy, once per AP. */
+.align 4
+.global ap_param_stack, ap_param_entry, ap_param_cpu
+ap_param_stack: .long 0
+ap_param_entry: .long 0
+ap_param_cpu:   .long 0
+
+.global ap_trampoline_end
+ap_trampoline_end:
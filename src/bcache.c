@@ -0,0 +1,319 @@
+#include "bcache.h"
+#include "pmm.h"
+#include "serial.h"
+#include "string.h"
+#include "exo_abi.h"
+
+#define HASH_BUCKETS 256           // power of 2
+#define NONE         (-1)
+
+_Static_assert(BLOCK_SIZE == PAGE_SIZE, "one buffer per page");
+_Static_assert(BCACHE_MAX_RUN <= BCACHE_BUFFERS / 2, "run must not wrap the LRU");
+_Static_assert(HASH_BUCKETS == 256, "bucket_of keeps 8 bits");
+
+typedef struct {
+    uint32_t block;
+    uint8_t* data;
+    int16_t prev;                  // LRU list, head = most recently used
+    int16_t next;
+    int16_t hash_next;
+    bool valid;
+    bool dirty;
+    bool ahead;                    // read ahead, not yet used
+} buf_t;
+
+static blkdev_t* dev = 0;
+static uint8_t* pool = 0;          // BCACHE_BUFFERS pages, allocated once
+static buf_t bufs[BCACHE_BUFFERS];
+static int16_t buckets[HASH_BUCKETS];
+static int16_t lru_head = NONE;
+static int16_t lru_tail = NONE;
+static uint32_t dirty_count = 0;
+static blk_seg_t segs[BCACHE_BUFFERS];
+static bcache_stats_t stats;
+
+/* Fibonacci hashing: the top 8 bits of the product pick one of 256. */
+static uint32_t bucket_of(uint32_t block) {
+    return (block * 0x9E3779B1u) >> 24;
+}
+
+static int16_t lookup(uint32_t block) {
+    for (int16_t i = buckets[bucket_of(block)]; i != NONE; i = bufs[i].hash_next) {
+        if (bufs[i].block == block) return i;
+    }
+    return NONE;
+}
+
+static void hash_insert(int16_t i) {
+    uint32_t b = bucket_of(bufs[i].block);
+    bufs[i].hash_next = buckets[b];
+    buckets[b] = i;
+}
+
+static void hash_remove(int16_t i) {
+    int16_t* link = &buckets[bucket_of(bufs[i].block)];
+    while (*link != i) link = &bufs[*link].hash_next;
+    *link = bufs[i].hash_next;
+}
+
+static void lru_unlink(int16_t i) {
+    if (bufs[i].prev != NONE) bufs[bufs[i].prev].next = bufs[i].next;
+    else lru_head = bufs[i].next;
+    if (bufs[i].next != NONE) bufs[bufs[i].next].prev = bufs[i].prev;
+    else lru_tail = bufs[i].prev;
+}
+
+static void lru_push_head(int16_t i) {
+    bufs[i].prev = NONE;
+    bufs[i].next = lru_head;
+    if (lru_head != NONE) bufs[lru_head].prev = i;
+    else lru_tail = i;
+    lru_head = i;
+}
+
+static void lru_push_tail(int16_t i) {
+    bufs[i].next = NONE;
+    bufs[i].prev = lru_tail;
+    if (lru_tail != NONE) bufs[lru_tail].next = i;
+    else lru_head = i;
+    lru_tail = i;
+}
+
+static void touch(int16_t i) {
+    lru_unlink(i);
+    lru_push_head(i);
+}
+
+/* Take the least recently used buffer for `block`. It comes back invalid,
+   unhashed and at the head of the LRU list. */
+static int32_t take(uint32_t block, int16_t* out) {
+    int16_t i = lru_tail;
+    if (bufs[i].dirty) {
+        int32_t err = bcache_flush();
+        if (err) return err;
+    }
+    if (bufs[i].valid) {
+        hash_remove(i);
+        stats.evictions++;
+    }
+    bufs[i].block = block;
+    bufs[i].valid = false;
+    bufs[i].ahead = false;
+    touch(i);
+    *out = i;
+    return 0;
+}
+
+static void discard(int16_t i) {
+    lru_unlink(i);
+    lru_push_tail(i);
+}
+
+/* Read the uncached run starting at `block`: up to `want` blocks the caller
+   asked for, plus read-ahead, stopping at the first cached block. */
+static int32_t fetch(uint32_t block, uint32_t want) {
+    static blk_seg_t run[BCACHE_MAX_RUN];
+    static int16_t run_buf[BCACHE_MAX_RUN];
+
+    uint32_t limit = want + BCACHE_READAHEAD;
+    if (limit > BCACHE_MAX_RUN) limit = BCACHE_MAX_RUN;
+    if (limit > dev->blocks - block) limit = dev->blocks - block;
+
+    uint32_t n = 0;
+    int32_t err = 0;
+    while (n < limit && (n == 0 || lookup(block + n) == NONE)) {
+        err = take(block + n, &run_buf[n]);
+        if (err) break;
+        run[n].block = block + n;
+        run[n].buf = bufs[run_buf[n]].data;
+        n++;
+    }
+
+    if (!err) {
+        stats.dev_reads++;
+        err = dev->submit(dev, false, run, n);
+    }
+    for (uint32_t k = 0; k < n; k++) {
+        int16_t i = run_buf[k];
+        if (err) {
+            discard(i);
+            continue;
+        }
+        bufs[i].valid = true;
+        bufs[i].ahead = k >= want;
+        if (bufs[i].ahead) stats.readahead++;
+        hash_insert(i);
+    }
+    return err;
+}
+
+/* Buffer holding `block`, reading it (and what follows) on a miss. */
+static int32_t get(uint32_t block, uint32_t want, int16_t* out) {
+    int16_t i = lookup(block);
+    if (i == NONE) {
+        stats.misses++;
+        int32_t err = fetch(block, want);
+        if (err) return err;
+        i = lookup(block);
+    } else {
+        stats.hits++;
+        if (bufs[i].ahead) {
+            bufs[i].ahead = false;
+            stats.readahead_hits++;
+        }
+        touch(i);
+    }
+    *out = i;
+    return 0;
+}
+
+static int32_t check_range(uint32_t block, uint32_t len) {
+    if (!dev) return -EXO_ENODEV;
+    uint32_t count = (len + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (block > dev->blocks || count > dev->blocks - block) return -EXO_EINVAL;
+    return 0;
+}
+
+void bcache_init(blkdev_t* d) {
+    dev = d;
+    stats = (bcache_stats_t){0};
+    dirty_count = 0;
+    lru_head = lru_tail = NONE;
+    for (uint32_t b = 0; b < HASH_BUCKETS; b++) {
+        buckets[b] = NONE;
+    }
+    if (!dev) return;
+
+    if (!pool) pool = alloc_pages(BCACHE_BUFFERS);
+    if (!pool) {
+        serial_print("bcache: no memory for buffers\n");
+        dev = 0;
+        return;
+    }
+    for (int16_t i = 0; i < BCACHE_BUFFERS; i++) {
+        bufs[i] = (buf_t){ .data = pool + (uint32_t)i * BLOCK_SIZE };
+        lru_push_tail(i);
+    }
+}
+
+blkdev_t* bcache_dev(void) {
+    return dev;
+}
+
+int32_t bcache_read(uint32_t block, void* dst, uint32_t len) {
+    int32_t err = check_range(block, len);
+    if (err) return err;
+
+    uint8_t* out = dst;
+    uint32_t remaining = len;
+    while (remaining) {
+        uint32_t chunk = remaining < BLOCK_SIZE ? remaining : BLOCK_SIZE;
+        int16_t i;
+        err = get(block, (remaining + BLOCK_SIZE - 1) / BLOCK_SIZE, &i);
+        if (err) return err;
+        memcpy(out, bufs[i].data, chunk);
+        out += chunk;
+        remaining -= chunk;
+        block++;
+    }
+    return (int32_t)len;
+}
+
+int32_t bcache_write(uint32_t block, const void* src, uint32_t len) {
+    int32_t err = check_range(block, len);
+    if (err) return err;
+    if (dev->read_only) return -EXO_EROFS;
+
+    const uint8_t* in = src;
+    uint32_t remaining = len;
+    while (remaining) {
+        uint32_t chunk = remaining < BLOCK_SIZE ? remaining : BLOCK_SIZE;
+        int16_t i = lookup(block);
+        if (i == NONE) {
+            err = take(block, &i);
+            if (err) return err;
+            bufs[i].valid = true;
+            hash_insert(i);
+        } else {
+            bufs[i].ahead = false;
+            touch(i);
+        }
+        memcpy(bufs[i].data, in, chunk);
+        if (chunk < BLOCK_SIZE) memset(bufs[i].data + chunk, 0, BLOCK_SIZE - chunk);
+        if (!bufs[i].dirty) {
+            bufs[i].dirty = true;
+            dirty_count++;
+        }
+        in += chunk;
+        remaining -= chunk;
+        block++;
+    }
+    return (int32_t)len;
+}
+
+int32_t bcache_flush(void) {
+    if (!dev || dirty_count == 0) return 0;
+
+    // Collect the dirty blocks in block order (insertion sort; the driver
+    // merges neighbours into single requests).
+    uint32_t n = 0;
+    for (int16_t i = 0; i < BCACHE_BUFFERS; i++) {
+        if (!bufs[i].dirty) continue;
+        uint32_t k = n++;
+        while (k > 0 && segs[k - 1].block > bufs[i].block) {
+            segs[k] = segs[k - 1];
+            k--;
+        }
+        segs[k].block = bufs[i].block;
+        segs[k].buf = bufs[i].data;
+    }
+
+    int32_t err = dev->submit(dev, true, segs, n);
+    if (err) return err;
+
+    for (int16_t i = 0; i < BCACHE_BUFFERS; i++) {
+        bufs[i].dirty = false;
+    }
+    dirty_count = 0;
+    stats.flushes++;
+    stats.writebacks += n;
+    return 0;
+}
+
+uint32_t bcache_dirty(void) {
+    return dirty_count;
+}
+
+const bcache_stats_t* bcache_stats(void) {
+    return &stats;
+}
+
+void bcache_dump(void) {
+    serial_print("bcache: ");
+    if (!dev) {
+        serial_print("no device\n");
+        return;
+    }
+    serial_print(dev->name);
+    serial_print(", ");
+    serial_print_u32(BCACHE_BUFFERS);
+    serial_print(" buffers, ");
+    serial_print_u32(dirty_count);
+    serial_print(" dirty\n  hits=");
+    serial_print_u32(stats.hits);
+    serial_print(" misses=");
+    serial_print_u32(stats.misses);
+    serial_print(" readahead=");
+    serial_print_u32(stats.readahead);
+    serial_print(" (used ");
+    serial_print_u32(stats.readahead_hits);
+    serial_print(") evictions=");
+    serial_print_u32(stats.evictions);
+    serial_print("\n  dev_reads=");
+    serial_print_u32(stats.dev_reads);
+    serial_print(" flushes=");
+    serial_print_u32(stats.flushes);
+    serial_print(" writebacks=");
+    serial_print_u32(stats.writebacks);
+    serial_print("\n");
+}
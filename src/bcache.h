@@ -0,0 +1,60 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "blkdev.h"
+
+/*
+ * bcache.h — Write-back LRU block cache over one block device.
+ *
+ * Writes only dirty the cached block; bcache_flush() sorts every dirty
+ * block and hands them to the driver in one submit, which becomes a few
+ * merged requests behind a single notify.  A read miss fetches the whole
+ * missing run in one submit and keeps reading ahead up to
+ * BCACHE_READAHEAD blocks, since files are laid out contiguously.
+ *
+ * When the least recently used buffer is dirty, every dirty buffer is
+ * flushed in one batch rather than writing the victim alone.
+ *
+ * All entry points return 0 (or a byte count) or -EXO_E*.
+ */
+
+#define BCACHE_BUFFERS   128       // 512 KiB of cached blocks
+#define BCACHE_READAHEAD 8         // blocks fetched past a miss
+#define BCACHE_MAX_RUN   32        // blocks fetched by one miss
+
+typedef struct {
+    uint32_t hits;                 // block lookups served from the cache
+    uint32_t misses;               // lookups that started a device read
+    uint32_t readahead;            // blocks read before they were asked for
+    uint32_t readahead_hits;       // ... and later used
+    uint32_t evictions;            // valid blocks dropped for reuse
+    uint32_t flushes;              // flushes that wrote something
+    uint32_t writebacks;           // blocks written by those flushes
+    uint32_t dev_reads;            // read submits to the device
+} bcache_stats_t;
+
+/* Attach the cache to `dev` (NULL detaches), dropping every cached block
+   without writing it. Flush first to keep dirty data. */
+void bcache_init(blkdev_t* dev);
+
+/* The attached device, or NULL. */
+blkdev_t* bcache_dev(void);
+
+/* Copy `len` bytes starting at the beginning of `block` (and running into
+   the following blocks) into `dst`. */
+int32_t bcache_read(uint32_t block, void* dst, uint32_t len);
+
+/* Overwrite `len` bytes starting at the beginning of `block`. The rest of
+   a partially written last block is zeroed, so no block is read first. */
+int32_t bcache_write(uint32_t block, const void* src, uint32_t len);
+
+/* Write every dirty block back in one batch. */
+int32_t bcache_flush(void);
+
+/* Blocks currently dirty. */
+uint32_t bcache_dirty(void);
+
+const bcache_stats_t* bcache_stats(void);
+
+/* Print the counters over serial. */
+void bcache_dump(void);
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * blkdev.h — Block device interface under the block cache.
+ *
+ * Blocks are 4 KiB, one page, whatever the device's sector size.  A
+ * request is a list of (block, buffer) segments; the driver merges
+ * consecutive blocks into as few device requests as it can and issues
+ * them together, so callers should pass segments sorted by block.
+ */
+
+#define BLOCK_SIZE 4096
+
+typedef struct {
+    uint32_t block;
+    void*    buf;                 // BLOCK_SIZE bytes
+} blk_seg_t;
+
+typedef struct blkdev {
+    const char* name;
+    uint32_t blocks;              // device size in BLOCK_SIZE units
+    bool read_only;
+    /* Transfer every segment. Returns 0 or -EXO_E*. */
+    int32_t (*submit)(struct blkdev* dev, bool write, const blk_seg_t* segs,
+                      uint32_t n);
+    void* ctx;                    // driver data
+} blkdev_t;
@@ -0,0 +1,58 @@
+/* Context switch for the cooperative scheduler (sched.c).
+
+   Every switch is a plain function call, so only the callee-saved
+   registers (EBP EBX ESI EDI) and ESP need saving; EIP is the return
+   address already on the stack, and EFLAGS is restored by the caller. */
+
+.set USER_CS, 0x1B                 /* GDT_USER_CS */
+.set USER_DS, 0x23                 /* GDT_USER_DS */
+
+/* context_switch(uint32_t* save_esp, uint32_t new_esp) */
+.global context_switch
+context_switch:
+    mov 4(%esp), %eax       /* save_esp */
+    mov 8(%esp), %edx       /* new_esp */
+    push %ebp
+    push %ebx
+    push %esi
+    push %edi
+    mov %esp, (%eax)
+    mov %edx, %esp
+    pop %edi
+    pop %esi
+    pop %ebx
+    pop %ebp
+    ret
+
+/* First return of a new context. sched_spawn leaves the entry point in
+   EBX and its argument in ESI; ESP is 16-byte aligned here. Returning
+   from the entry exits the context. */
+.global context_start
+.extern sched_first_run
+.extern sched_exit
+context_start:
+    call sched_first_run
+    sub $12, %esp
+    push %esi
+    call *%ebx
+    add $16, %esp
+    call sched_exit
+
+/* sched_enter_user(uint32_t eip, uint32_t esp): iret to ring 3 with
+   IF set. GS gets the user segment too; the entry stubs reload the
+   per-CPU one. */
+.global sched_enter_user
+sched_enter_user:
+    mov 4(%esp), %eax       /* eip */
+    mov 8(%esp), %edx       /* esp */
+    mov $USER_DS, %cx
+    mov %cx, %ds
+    mov %cx, %es
+    mov %cx, %fs
+    mov %cx, %gs
+    push $USER_DS           /* ss */
+    push %edx
+    push $0x202             /* EFLAGS: IF */
+    push $USER_CS
+    push %eax
+    iret
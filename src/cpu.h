@@ -0,0 +1,117 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * cpu.h — Bare-metal x86 CPU control primitives.
+ *
+ * Companion to io.h: interrupt-flag save/restore and compiler barriers
+ * shared by the interrupt-time code paths (IRQ top halves, deferred work).
+ */
+
+#define EFLAGS_IF (1u << 9)
+
+/* Upper bound on CPUs the per-CPU tables are sized for. */
+#define MAX_CPUS 8
+
+/* Offset of the CPU index in the per-CPU block GS points at (smp.h). */
+#define PERCPU_ID_OFFSET 4
+
+/*
+ * cpu_barrier — Compiler-only memory barrier.
+ *
+ * x86 does not reorder stores with other stores or loads with other loads,
+ * so on a single core a compiler barrier is all that is needed to publish
+ * data to an interrupt handler (or read data published by one).
+ */
+static inline void cpu_barrier(void) {
+    __asm__ volatile ("" : : : "memory");
+}
+
+/*
+ * irq_save — Disable interrupts and return the previous EFLAGS so the
+ *            caller can restore the exact prior state (nesting-safe).
+ */
+static inline uint32_t irq_save(void) {
+    uint32_t flags;
+    __asm__ volatile ("pushf\n\tpop %0\n\tcli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        __asm__ volatile ("sti" : : : "memory");
+    }
+}
+
+/* Read the time-stamp counter (cycles since reset). */
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void cpuid(uint32_t leaf, uint32_t* a, uint32_t* b,
+                         uint32_t* c, uint32_t* d) {
+    __asm__ volatile ("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d)
+                              : "a"(leaf), "c"(0));
+}
+
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t lo, hi;
+    __asm__ volatile ("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t value) {
+    __asm__ volatile ("wrmsr" : : "c"(msr), "a"((uint32_t)value),
+                                  "d"((uint32_t)(value >> 32)));
+}
+
+/* Index of the executing CPU: 0 on the BSP, 1.. on the APs in start
+   order. Read from the per-CPU block, so only valid after gdt_init(). */
+static inline uint32_t cpu_id(void) {
+    uint32_t id;
+    __asm__ volatile ("mov %%gs:%c1, %0" : "=r"(id) : "i"(PERCPU_ID_OFFSET));
+    return id;
+}
+
+/* Spin-wait hint: lets the sibling hyperthread run and avoids the memory
+   order flush when the awaited store arrives. */
+static inline void cpu_pause(void) {
+    __asm__ volatile ("pause" : : : "memory");
+}
+
+#define CPUID_EDX_FXSR (1u << 24)
+#define CPUID_EDX_SSE2 (1u << 26)
+#define CR0_MP         (1u << 1)
+#define CR0_EM         (1u << 2)
+#define CR4_OSFXSR     (1u << 9)
+#define CR4_OSXMMEXCPT (1u << 10)
+
+/*
+ * cpu_enable_sse — Turn on SSE/SSE2 (FPU emulation off, FXSAVE-aware OS)
+ *                  if CPUID reports SSE2 and FXSR. Returns false, and
+ *                  changes nothing, on CPUs without them.
+ *
+ * Called through fpu_init() on the BSP; kernel code that then uses SSE
+ * must do so inside kernel_fpu_begin()/kernel_fpu_end() (fpu.h).
+ */
+static inline bool cpu_enable_sse(void) {
+    uint32_t a, b, c, d;
+    cpuid(1, &a, &b, &c, &d);
+    if ((d & (CPUID_EDX_SSE2 | CPUID_EDX_FXSR)) !=
+        (CPUID_EDX_SSE2 | CPUID_EDX_FXSR)) {
+        return false;
+    }
+
+    uint32_t cr0, cr4;
+    __asm__ volatile ("mov %%cr0, %0" : "=r"(cr0));
+    __asm__ volatile ("mov %%cr4, %0" : "=r"(cr4));
+    cr0 = (cr0 & ~CR0_EM) | CR0_MP;
+    cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+    __asm__ volatile ("mov %0, %%cr0" : : "r"(cr0));
+    __asm__ volatile ("mov %0, %%cr4" : : "r"(cr4));
+    __asm__ volatile ("fninit");
+    return true;
+}
@@ -0,0 +1,107 @@
+#include "defer.h"
+#include "cpu.h"
+
+#define DEFER_QUEUE_MASK (DEFER_QUEUE_SIZE - 1)
+
+typedef struct {
+    defer_fn_t fn;
+    uint32_t arg;
+} defer_item_t;
+
+typedef struct {
+    defer_item_t items[DEFER_QUEUE_SIZE];
+    volatile uint32_t head;      // next slot to fill; advanced by producers
+    volatile uint32_t tail;      // next slot to run; advanced by the consumer
+    volatile uint8_t running;    // a drain is in progress on this CPU
+    uint32_t dropped;
+    uint32_t high_watermark;
+} defer_queue_t;
+
+static defer_queue_t defer_queues[MAX_CPUS];
+
+static inline defer_queue_t* this_queue(void) {
+    return &defer_queues[cpu_id()];
+}
+
+bool defer_post(defer_fn_t fn, uint32_t arg) {
+    defer_queue_t* q = this_queue();
+
+    // Producers on this CPU are serialised by the interrupt flag: top halves
+    // already run with IF=0, task-context callers get it cleared here.
+    uint32_t flags = irq_save();
+
+    uint32_t head = q->head;
+    uint32_t depth = head - q->tail;
+    if (depth >= DEFER_QUEUE_SIZE) {
+        q->dropped++;
+        irq_restore(flags);
+        return false;
+    }
+
+    q->items[head & DEFER_QUEUE_MASK].fn = fn;
+    q->items[head & DEFER_QUEUE_MASK].arg = arg;
+    cpu_barrier();
+    q->head = head + 1;
+
+    if (depth + 1 > q->high_watermark) {
+        q->high_watermark = depth + 1;
+    }
+
+    irq_restore(flags);
+    return true;
+}
+
+/* Become the single consumer for this CPU's queue, if there is work and
+   nobody else is already draining it. */
+static bool defer_claim(defer_queue_t* q) {
+    uint32_t flags = irq_save();
+    bool claimed = !q->running && q->tail != q->head;
+    if (claimed) {
+        q->running = 1;
+    }
+    irq_restore(flags);
+    return claimed;
+}
+
+void defer_run(void) {
+    defer_queue_t* q = this_queue();
+
+    while (defer_claim(q)) {
+        while (q->tail != q->head) {
+            defer_item_t item = q->items[q->tail & DEFER_QUEUE_MASK];
+            cpu_barrier();
+            q->tail = q->tail + 1;
+            item.fn(item.arg);
+        }
+
+        q->running = 0;
+        cpu_barrier();
+        // Loop again if something was posted between the last check and
+        // releasing the queue; otherwise it would wait for the next drain.
+    }
+}
+
+void defer_irq_exit(void) {
+    defer_queue_t* q = this_queue();
+
+    if (q->running || q->tail == q->head) return;
+
+    // EOI has already been sent: let the PIC deliver new IRQs (notably IRQ0)
+    // while the bottom halves run, then restore IF=0 for the stub's iret.
+    __asm__ volatile ("sti" : : : "memory");
+    defer_run();
+    __asm__ volatile ("cli" : : : "memory");
+}
+
+uint32_t defer_pending(void) {
+    defer_queue_t* q = this_queue();
+    return q->head - q->tail;
+}
+
+uint32_t defer_dropped(void) {
+    return this_queue()->dropped;
+}
+
+uint32_t defer_high_watermark(void) {
+    return this_queue()->high_watermark;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * defer.h — Deferred work (bottom-half) queue.
+ *
+ * IRQ top halves do only the hardware-critical part (read the device,
+ * update driver state, EOI) and post everything slow — serial logging,
+ * reports — here.  Posted work runs in FIFO order with interrupts enabled,
+ * either right after the IRQ returns (defer_irq_exit) or from the idle loop
+ * (defer_run), so a slow bottom half can never hold off IRQ0.
+ *
+ * Each CPU has its own queue; producers and the consumer are always on the
+ * same CPU, so no locks are needed — only interrupt-flag discipline and
+ * compiler barriers.
+ */
+
+#define DEFER_QUEUE_SIZE 128   // must be a power of 2
+
+typedef void (*defer_fn_t)(uint32_t arg);
+
+/* Queue fn(arg) on this CPU. Safe from IRQ and task context.
+   Returns false (and counts a drop) if the queue is full. */
+bool defer_post(defer_fn_t fn, uint32_t arg);
+
+/* Run every pending item on this CPU, including items posted meanwhile. */
+void defer_run(void);
+
+/* Called by the IRQ stubs after the C handler has sent EOI. Drains the
+   queue with interrupts enabled unless a drain is already in progress. */
+void defer_irq_exit(void);
+
+/* Diagnostics */
+uint32_t defer_pending(void);
+uint32_t defer_dropped(void);
+uint32_t defer_high_watermark(void);
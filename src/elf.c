@@ -0,0 +1,130 @@
+#include "elf.h"
+#include "exo_abi.h"
+#include "cpu.h"
+#include "pmm.h"
+#include "serial.h"
+#include "string.h"
+#include "tsc.h"
+#include "vmm.h"
+
+#define ELF_CLASS32   1
+#define ELF_DATA2LSB  1
+#define ELF_ET_EXEC   2
+#define ELF_EM_386    3
+
+#define PAGE_MASK     (PAGE_SIZE - 1)
+
+static bool header_ok(const elf32_ehdr_t* eh, uint32_t size) {
+    if (size < sizeof(*eh)) return false;
+    if (eh->ident[0] != 0x7F || eh->ident[1] != 'E' ||
+        eh->ident[2] != 'L' || eh->ident[3] != 'F') {
+        return false;
+    }
+    if (eh->ident[4] != ELF_CLASS32 || eh->ident[5] != ELF_DATA2LSB ||
+        eh->type != ELF_ET_EXEC || eh->machine != ELF_EM_386) {
+        return false;
+    }
+    if (eh->phentsize != sizeof(elf32_phdr_t) || eh->phnum == 0) return false;
+    return eh->phoff <= size &&
+           (size - eh->phoff) / sizeof(elf32_phdr_t) >= eh->phnum;
+}
+
+static bool segment_ok(const elf32_phdr_t* ph, uint32_t size) {
+    return ph->filesz <= ph->memsz && ph->memsz != 0 &&
+           ph->offset <= size && ph->filesz <= size - ph->offset &&
+           ph->vaddr + ph->memsz > ph->vaddr &&
+           ph->vaddr + ph->memsz <= 0xFFFFF000u;
+}
+
+/* Map the pages of one PT_LOAD segment; see elf.h for the four cases. */
+static int32_t map_segment(const uint8_t* file, const elf32_phdr_t* ph,
+                           elf_image_t* img) {
+    bool writable = ph->flags & ELF_PF_W;
+    uint32_t file_end = ph->vaddr + ph->filesz;
+    uint32_t mem_end = ph->vaddr + ph->memsz;
+
+    for (uint32_t va = ph->vaddr & ~PAGE_MASK; va < mem_end; va += PAGE_SIZE) {
+        if (vmm_translate(va)) return -EXO_EINVAL;   // shared with a segment
+
+        uint32_t lo = va > ph->vaddr ? va : ph->vaddr;
+        uint32_t hi = va + PAGE_SIZE < file_end ? va + PAGE_SIZE : file_end;
+        if (hi <= lo) continue;                      // .bss: demand-zero
+
+        const uint8_t* src = file + ph->offset + (lo - ph->vaddr);
+        int32_t err;
+        if (lo == va && hi == va + PAGE_SIZE && !((uint32_t)src & PAGE_MASK)) {
+            err = vmm_map(va, (uint32_t)src,
+                          writable ? VMM_MAP_COW : VMM_MAP_BORROW);
+            if (writable) img->cow_bytes += PAGE_SIZE;
+            else img->mapped_bytes += PAGE_SIZE;
+        } else {
+            uint8_t* page = alloc_zeroed_page();
+            if (!page) return -EXO_ENOMEM;
+            memcpy(page + (lo - va), src, hi - lo);
+            err = vmm_map(va, (uint32_t)page, writable ? VMM_MAP_WRITE : 0);
+            if (err) free_page(page);
+            img->copied_bytes += hi - lo;
+        }
+        if (err) return err;
+    }
+    img->zero_bytes += ph->memsz - ph->filesz;
+    return 0;
+}
+
+int32_t elf_load(const void* file, uint32_t size, elf_image_t* out) {
+    uint64_t start = rdtsc();
+    const elf32_ehdr_t* eh = file;
+    if (!header_ok(eh, size)) return -EXO_EINVAL;
+    const elf32_phdr_t* ph = (const elf32_phdr_t*)((const uint8_t*)file + eh->phoff);
+
+    // The image spans every PT_LOAD segment, rounded out to pages.
+    uint32_t lo = 0xFFFFFFFFu, hi = 0;
+    elf_image_t img = { .entry = eh->entry };
+    for (uint32_t i = 0; i < eh->phnum; i++) {
+        if (ph[i].type != ELF_PT_LOAD) continue;
+        if (!segment_ok(&ph[i], size)) return -EXO_EINVAL;
+        uint32_t seg_lo = ph[i].vaddr & ~PAGE_MASK;
+        uint32_t seg_hi = (ph[i].vaddr + ph[i].memsz + PAGE_MASK) & ~PAGE_MASK;
+        if (seg_lo < lo) lo = seg_lo;
+        if (seg_hi > hi) hi = seg_hi;
+        img.segments++;
+    }
+    if (!img.segments || eh->entry < lo || eh->entry >= hi) return -EXO_EINVAL;
+
+    int32_t err = vmm_reserve_at(lo, hi - lo);
+    if (err) return err;
+    img.base = lo;
+    img.size = hi - lo;
+
+    for (uint32_t i = 0; i < eh->phnum && !err; i++) {
+        if (ph[i].type == ELF_PT_LOAD) err = map_segment(file, &ph[i], &img);
+    }
+    if (err) {
+        vmm_release(lo);
+        return err;
+    }
+
+    img.load_cycles = rdtsc() - start;
+    *out = img;
+    return 0;
+}
+
+void elf_dump(const elf_image_t* img) {
+    serial_print("ELF: entry=0x");
+    serial_print_hex(img->entry);
+    serial_print(" at 0x");
+    serial_print_hex(img->base);
+    serial_print(", ");
+    serial_print_u32(img->segments);
+    serial_print(" segments: mapped=");
+    serial_print_u32(img->mapped_bytes / 1024);
+    serial_print("K cow=");
+    serial_print_u32(img->cow_bytes / 1024);
+    serial_print("K copied=");
+    serial_print_u32(img->copied_bytes);
+    serial_print("B bss=");
+    serial_print_u32(img->zero_bytes / 1024);
+    serial_print("K in ");
+    serial_print_u32(tsc_cycles_to_us(img->load_cycles));
+    serial_print(" us\n");
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * elf.h — Load an ELF32 LibOS image in place (docs/memory.md §7).
+ *
+ * The image stays where GRUB put it, like the WAD.  Its PT_LOAD segments
+ * are mapped into the vmm window at their link addresses, page by page:
+ *
+ *   - a page wholly covered by a read-only segment's file bytes is the
+ *     module's own page, mapped read-only;
+ *   - a page wholly covered by a writable segment's file bytes is the
+ *     module's page mapped copy-on-write: copied on its first write only;
+ *   - a page only partly covered by file bytes (a segment edge) is copied
+ *     into a private page and zero-filled;
+ *   - a page with no file bytes (.bss) is left to the demand-zero fault.
+ *
+ * Borrowing needs the file offset and the link address to agree modulo the
+ * page size, which is how ld lays out ELF executables, and a page-aligned
+ * module, which the multiboot header asks GRUB for.  A multi-megabyte
+ * image therefore loads in page-table writes, not memcpy.
+ *
+ * The image must be linked inside VMM_WINDOW, and its segments must not
+ * share a page.
+ */
+
+#define ELF_PT_LOAD   1
+#define ELF_PF_W      (1u << 1)
+
+typedef struct {
+    uint8_t  ident[16];       // 0x7F 'E' 'L' 'F', class, data, version
+    uint16_t type;
+    uint16_t machine;
+    uint32_t version;
+    uint32_t entry;
+    uint32_t phoff;
+    uint32_t shoff;
+    uint32_t flags;
+    uint16_t ehsize;
+    uint16_t phentsize;
+    uint16_t phnum;
+    uint16_t shentsize;
+    uint16_t shnum;
+    uint16_t shstrndx;
+} __attribute__((packed)) elf32_ehdr_t;
+
+typedef struct {
+    uint32_t type;
+    uint32_t offset;
+    uint32_t vaddr;
+    uint32_t paddr;
+    uint32_t filesz;
+    uint32_t memsz;
+    uint32_t flags;
+    uint32_t align;
+} __attribute__((packed)) elf32_phdr_t;
+
+typedef struct {
+    uint32_t entry;
+    uint32_t base;            // vmm region holding the image
+    uint32_t size;
+    uint32_t segments;        // PT_LOAD headers
+    uint32_t mapped_bytes;    // module pages mapped read-only
+    uint32_t cow_bytes;       // module pages mapped copy-on-write
+    uint32_t copied_bytes;    // file bytes copied at segment edges
+    uint32_t zero_bytes;      // memsz beyond filesz (.bss)
+    uint64_t load_cycles;
+} elf_image_t;
+
+/* Validate the ELF32 i386 executable at [file, file + size) and map it.
+   Returns 0 and fills *out, or -EXO_EINVAL (bad header, segment outside
+   the file or the window, overlapping segments), -EXO_EBUSY (its
+   addresses are taken), -EXO_ENOMEM or -EXO_ENODEV (no paging). On error
+   nothing stays mapped. vmm_release(out->base) unloads it. */
+int32_t elf_load(const void* file, uint32_t size, elf_image_t* out);
+
+/* Print entry point, mapped / copy-on-write / copied bytes and load time
+   over serial. */
+void elf_dump(const elf_image_t* img);
@@ -0,0 +1,136 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * exo_abi.h — Kernel/LibOS system call ABI (docs/syscall_spec.md §3).
+ *
+ * Shared by both sides: syscall numbers, error codes and the LibOS-side
+ * entry stubs.  Nothing here depends on kernel internals.
+ *
+ *   int 0x80   EAX = number, EBX ECX EDX ESI EDI = arguments 1-5,
+ *              result in EAX (negative = -EXO_E*). All other registers kept.
+ *   sysenter   Same registers, except that arguments 2 and 3 (ECX, EDX) are
+ *              passed on the user stack, because SYSEXIT takes the return
+ *              ESP from ECX and the return EIP from EDX.  The kernel
+ *              programs the SYSENTER MSRs whenever CPUID reports SEP, so
+ *              the LibOS can make the same CPUID check to pick a stub.
+ */
+
+enum {
+    EXO_SYS_PAGE_ALLOC   = 0,
+    EXO_SYS_PAGE_FREE    = 1,
+    EXO_SYS_PAGE_MAP     = 2,
+    EXO_SYS_PAGE_UNMAP   = 3,
+    EXO_SYS_FB_ACQUIRE   = 4,
+    EXO_SYS_GET_TICKS    = 5,
+    EXO_SYS_KBD_POLL     = 6,
+    EXO_SYS_MOUSE_POLL   = 7,
+    EXO_SYS_SERIAL_WRITE = 8,
+    EXO_SYS_FILE_OPEN    = 9,
+    EXO_SYS_FILE_CLOSE   = 10,
+    EXO_SYS_FILE_READ    = 11,
+    EXO_SYS_FILE_WRITE   = 12,
+    EXO_SYS_FILE_SEEK    = 13,
+    EXO_SYS_FILE_STAT    = 14,
+    EXO_SYS_FILE_REMOVE  = 15,
+    EXO_SYS_FILE_RENAME  = 16,
+    EXO_SYS_SOUND_TONE   = 17,
+    EXO_SYS_SOUND_STOP   = 18,
+    EXO_SYS_YIELD        = 19,
+    EXO_SYS_EXIT         = 20,
+    EXO_SYS_VDATA        = 21,
+    EXO_SYS_RING_SETUP   = 22,
+    EXO_SYS_SUBMIT       = 23,
+    EXO_SYS_WAD_MAP      = 24,
+    EXO_SYS_PCM_PLAY     = 25,
+    EXO_SYS_PCM_UPDATE   = 26,
+    EXO_SYS_PCM_STOP     = 27,
+    EXO_SYS_MEM_RESERVE  = 28,
+    EXO_SYS_MEM_RELEASE  = 29,
+    EXO_SYS_TRACE        = 30,
+    EXO_SYS_COUNT
+};
+
+/* Error codes, returned negated. Values follow Linux so a LibOS libc can
+   pass them straight through as errno. */
+#define EXO_ENOENT  2
+#define EXO_EIO     5
+#define EXO_EBADF   9
+#define EXO_ENOMEM  12
+#define EXO_EFAULT  14
+#define EXO_EBUSY   16
+#define EXO_ENODEV  19
+#define EXO_EINVAL  22
+#define EXO_EMFILE  24
+#define EXO_ENOSPC  28
+#define EXO_EROFS   30
+#define EXO_ENAMETOOLONG 36
+#define EXO_ENOSYS  38
+
+/* exo_file_open modes and exo_file_seek origins. */
+#define EXO_O_READ   0     // existing file, read only
+#define EXO_O_WRITE  1     // create or truncate, write only
+#define EXO_O_RDWR   2     // existing file, read and write
+#define EXO_SEEK_SET 0
+#define EXO_SEEK_CUR 1
+#define EXO_SEEK_END 2
+
+/* exo_trace kinds (syscall 30). */
+#define EXO_TRACE_FRAME_BEGIN 0
+#define EXO_TRACE_FRAME_END   1
+#define EXO_TRACE_MARK        2
+
+/* ── LibOS-side stubs ── */
+
+static inline int32_t exo_syscall0(uint32_t num) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80" : "=a"(ret) : "a"(num) : "memory");
+    return ret;
+}
+
+static inline int32_t exo_syscall1(uint32_t num, uint32_t a1) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80" : "=a"(ret) : "a"(num), "b"(a1) : "memory");
+    return ret;
+}
+
+static inline int32_t exo_syscall2(uint32_t num, uint32_t a1, uint32_t a2) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80" : "=a"(ret) : "a"(num), "b"(a1), "c"(a2)
+                      : "memory");
+    return ret;
+}
+
+static inline int32_t exo_syscall3(uint32_t num, uint32_t a1, uint32_t a2,
+                                   uint32_t a3) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80" : "=a"(ret) : "a"(num), "b"(a1), "c"(a2),
+                      "d"(a3) : "memory");
+    return ret;
+}
+
+static inline int32_t exo_syscall5(uint32_t num, uint32_t a1, uint32_t a2,
+                                   uint32_t a3, uint32_t a4, uint32_t a5) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80" : "=a"(ret) : "a"(num), "b"(a1), "c"(a2),
+                      "d"(a3), "S"(a4), "D"(a5) : "memory");
+    return ret;
+}
+
+/* Fast path: up to three arguments through SYSENTER. */
+static inline int32_t exo_sysenter3(uint32_t num, uint32_t a1, uint32_t a2,
+                                    uint32_t a3) {
+    int32_t ret;
+    __asm__ volatile (
+        "push %[a2]\n\t"
+        "push %[a3]\n\t"
+        "mov %%esp, %%ecx\n\t"       // SYSEXIT restores ESP from ECX
+        "mov $1f, %%edx\n\t"          // ... and EIP from EDX
+        "sysenter\n"
+        "1:\n\t"
+        "add $8, %%esp"
+        : "=a"(ret)
+        : "a"(num), "b"(a1), [a2] "r"(a2), [a3] "r"(a3)
+        : "ecx", "edx", "memory");
+    return ret;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+#include "exo_abi.h"
+
+/*
+ * exo_mem.h — Demand-zero memory for the LibOS (docs/syscall_spec.md,
+ * syscalls 28-29; docs/memory.md §7).
+ *
+ * A reservation costs address space only.  Each page is backed by a zeroed
+ * physical page the first time it is touched, so a large zone the game
+ * mostly leaves alone stays mostly unallocated.
+ */
+
+/* Reserve `size` bytes (rounded up to pages) and store the base in *base.
+   Returns 0, -EXO_EINVAL, -EXO_ENOMEM or -EXO_ENODEV (paging is off). */
+static inline int32_t exo_mem_reserve(uint32_t size, void** base) {
+    return exo_syscall2(EXO_SYS_MEM_RESERVE, size, (uint32_t)base);
+}
+
+/* Give back a whole reservation and every page it touched. */
+static inline int32_t exo_mem_release(void* base) {
+    return exo_syscall1(EXO_SYS_MEM_RELEASE, (uint32_t)base);
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "exo_abi.h"
+
+/*
+ * exo_ring.h — Batched syscall submission ring shared by a LibOS and the
+ * kernel (docs/syscall_spec.md §3.4).
+ *
+ * The LibOS owns the memory.  It registers the ring once with
+ * exo_ring_setup(), then queues requests into the submission queue (SQ)
+ * and rings the doorbell with exo_submit(n).  The kernel runs up to `n`
+ * queued requests in order, each through the normal syscall table, and
+ * posts one completion per request to the completion queue (CQ).
+ *
+ *   SQ: LibOS writes entries and advances sq_tail; kernel advances sq_head.
+ *   CQ: kernel writes entries and advances cq_tail; LibOS advances cq_head.
+ *
+ * Indices are free-running and masked with EXO_RING_ENTRIES - 1.  If the CQ
+ * fills, the kernel stops consuming SQ entries, so no completion is lost.
+ */
+
+#define EXO_RING_ENTRIES 64
+
+_Static_assert((EXO_RING_ENTRIES & (EXO_RING_ENTRIES - 1)) == 0,
+               "EXO_RING_ENTRIES must be a power of 2");
+
+typedef struct {
+    uint32_t op;          // EXO_SYS_* number
+    uint32_t args[5];     // same meaning as the register arguments
+    uint32_t user_data;   // copied to the completion untouched
+    uint32_t reserved;
+} exo_sqe_t;
+
+typedef struct {
+    uint32_t user_data;
+    int32_t  result;      // what the syscall would have returned
+} exo_cqe_t;
+
+typedef struct {
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    exo_sqe_t sq[EXO_RING_ENTRIES];
+    exo_cqe_t cq[EXO_RING_ENTRIES];
+} exo_ring_t;
+
+/* ── LibOS-side helpers ── */
+
+static inline int32_t exo_ring_setup(exo_ring_t* ring) {
+    return exo_syscall1(EXO_SYS_RING_SETUP, (uint32_t)ring);
+}
+
+/* Doorbell: run up to `n` queued requests. Returns how many were consumed. */
+static inline int32_t exo_submit(uint32_t n) {
+    return exo_syscall1(EXO_SYS_SUBMIT, n);
+}
+
+/* Queue one request. Returns false if the SQ is full. */
+static inline bool exo_ring_queue(exo_ring_t* ring, uint32_t op, uint32_t a1,
+                                  uint32_t a2, uint32_t a3,
+                                  uint32_t user_data) {
+    uint32_t tail = ring->sq_tail;
+    if (tail - ring->sq_head >= EXO_RING_ENTRIES) return false;
+
+    exo_sqe_t* sqe = &ring->sq[tail & (EXO_RING_ENTRIES - 1)];
+    sqe->op = op;
+    sqe->args[0] = a1;
+    sqe->args[1] = a2;
+    sqe->args[2] = a3;
+    sqe->args[3] = 0;
+    sqe->args[4] = 0;
+    sqe->user_data = user_data;
+    __asm__ volatile ("" : : : "memory");   // entry before the index
+    ring->sq_tail = tail + 1;
+    return true;
+}
+
+/* Entries queued but not yet consumed by the kernel. */
+static inline uint32_t exo_ring_pending(const exo_ring_t* ring) {
+    return ring->sq_tail - ring->sq_head;
+}
+
+/* Take the oldest completion. Returns false if the CQ is empty. */
+static inline bool exo_ring_reap(exo_ring_t* ring, exo_cqe_t* out) {
+    uint32_t head = ring->cq_head;
+    if (head == ring->cq_tail) return false;
+    __asm__ volatile ("" : : : "memory");   // index before the entry
+    *out = ring->cq[head & (EXO_RING_ENTRIES - 1)];
+    ring->cq_head = head + 1;
+    return true;
+}
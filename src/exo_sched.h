@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+#include "exo_abi.h"
+
+/*
+ * exo_sched.h — Cooperative scheduling calls for the LibOS
+ * (docs/syscall_spec.md, syscall 19; docs/sched.md).
+ *
+ * All go through int 0x80, which lands on the calling context's own kernel
+ * stack, where its state can wait while others run.  The shared SYSENTER
+ * stack cannot hold it: through SYSENTER, or from kmain, they fail with
+ * -EXO_EBUSY.
+ */
+
+/* Let every other runnable context run once, then return. */
+static inline int32_t exo_yield(void) {
+    return exo_syscall1(EXO_SYS_YIELD, 0);
+}
+
+/* Sleep for at least `ms` milliseconds without using the CPU. DG_SleepMs
+   maps straight onto this. */
+static inline int32_t exo_sleep_ms(uint32_t ms) {
+    return exo_syscall1(EXO_SYS_YIELD, ms);
+}
+
+/* End the calling context (syscall 20). Returns -EXO_EBUSY only when it
+   cannot: from kmain or through SYSENTER. */
+static inline int32_t exo_exit(uint32_t code) {
+    return exo_syscall1(EXO_SYS_EXIT, code);
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <stdint.h>
+#include "exo_abi.h"
+
+/*
+ * exo_sound.h — PC speaker tone queues and PCM voices shared with the LibOS
+ * (docs/syscall_spec.md §6).
+ *
+ * The speaker plays one square wave at a time, but the kernel keeps
+ * EXO_SOUND_CHANNELS logical channels, one per Doom sound channel.  Each
+ * channel plays its queued tones back to back in real time.  At any moment
+ * the speaker sounds the current tone of the channel with the highest
+ * priority; on a tie, the tone that started last wins.  A tone that is
+ * outranked keeps running silently, so every channel stays on schedule.
+ *
+ * Both calls return at once; the timer interrupt advances the queues.
+ */
+
+#define EXO_SOUND_CHANNELS 8
+#define EXO_SOUND_QUEUE    16          // tones queued per channel
+#define EXO_SOUND_ALL      0xFFFFFFFFu // exo_sound_stop_channel: every channel
+
+/* Frequency limits: the PIT divisor is 16 bits. */
+#define EXO_SOUND_MIN_HZ   19
+#define EXO_SOUND_MAX_HZ   20000
+
+/* Doom's PC speaker lumps (DP*) store one byte per 1/140 s; a non-zero
+   byte n selects step n of a quarter-tone scale.  Pass EXO_SOUND_NOTE(n)
+   as the frequency to use the kernel's precomputed divisor for that step. */
+#define EXO_SOUND_NOTE(n)  (0x80000000u | (uint32_t)(n))
+#define EXO_SOUND_NOTES    128
+#define EXO_SOUND_DP_RATE  140
+
+/* Queue `freq` Hz (0 = rest) for `dur_ms` on `channel` at `priority`
+   (higher wins). Returns 0, -EXO_EINVAL or -EXO_EBUSY (queue full). */
+static inline int32_t exo_sound_tone_on(uint32_t channel, uint32_t priority,
+                                        uint32_t freq, uint32_t dur_ms) {
+    return exo_syscall3(EXO_SYS_SOUND_TONE, freq, dur_ms,
+                        (channel & 0xFF) | (priority & 0xFF) << 8);
+}
+
+/* Channel 0, priority 0. */
+static inline int32_t exo_sound_tone(uint32_t freq, uint32_t dur_ms) {
+    return exo_sound_tone_on(0, 0, freq, dur_ms);
+}
+
+/* Drop the current and queued tones of `channel` (or EXO_SOUND_ALL). */
+static inline int32_t exo_sound_stop_channel(uint32_t channel) {
+    return exo_syscall1(EXO_SYS_SOUND_STOP, channel);
+}
+
+/* Silence the speaker and drop every queued tone. */
+static inline int32_t exo_sound_stop(void) {
+    return exo_sound_stop_channel(EXO_SOUND_ALL);
+}
+
+/*
+ * PCM voices (Sound Blaster 16).  The kernel mixes EXO_PCM_CHANNELS
+ * voices of unsigned 8-bit mono samples into the card's stereo stream,
+ * resampling each from its own rate.  Samples are read in place, so they
+ * must stay mapped until the voice ends.  All calls fail with
+ * -EXO_ENODEV when no card was found.
+ */
+#define EXO_PCM_CHANNELS   8
+#define EXO_PCM_MAX_VOL    127
+#define EXO_PCM_SEP_CENTER 128         // 0 = hard left, 254 = hard right
+
+/* Play `len` samples at `rate` Hz on `channel`, cutting off whatever it
+   was playing. Returns 0, -EXO_EINVAL, -EXO_EFAULT or -EXO_ENODEV. */
+static inline int32_t exo_pcm_play(uint32_t channel, const void* data,
+                                   uint32_t len, uint32_t rate, uint32_t vol,
+                                   uint32_t sep) {
+    return exo_syscall5(EXO_SYS_PCM_PLAY, channel, (uint32_t)data, len, rate,
+                        (vol & 0xFF) | (sep & 0xFF) << 8);
+}
+
+/* Doom SFX lump (DS*): a 3-word header (format 3, rate, sample count)
+   and samples padded with 16 bytes at each end, which are skipped. */
+static inline int32_t exo_pcm_play_lump(uint32_t channel, const void* lump,
+                                        uint32_t size, uint32_t vol,
+                                        uint32_t sep) {
+    const uint8_t* p = (const uint8_t*)lump;
+    if (size < 8 || (p[0] | p[1] << 8) != 3) return -EXO_EINVAL;
+    uint32_t rate = p[2] | p[3] << 8;
+    uint32_t len = p[4] | p[5] << 8 | (uint32_t)p[6] << 16 |
+                   (uint32_t)p[7] << 24;
+    if (len > size - 8) len = size - 8;
+    if (len <= 32) return -EXO_EINVAL;
+    return exo_pcm_play(channel, p + 8 + 16, len - 32, rate, vol, sep);
+}
+
+/* New volume and panning for a playing voice. Returns 1 while it plays
+   and 0 once it has finished, so it doubles as "is this still playing". */
+static inline int32_t exo_pcm_update(uint32_t channel, uint32_t vol,
+                                     uint32_t sep) {
+    return exo_syscall2(EXO_SYS_PCM_UPDATE, channel,
+                        (vol & 0xFF) | (sep & 0xFF) << 8);
+}
+
+/* Silence `channel`, or every voice with EXO_SOUND_ALL. */
+static inline int32_t exo_pcm_stop(uint32_t channel) {
+    return exo_syscall1(EXO_SYS_PCM_STOP, channel);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+#include "exo_abi.h"
+
+/*
+ * exo_trace.h — LibOS tracepoints (docs/syscall_spec.md, syscall 30;
+ * docs/debugging.md "Tracepoints").
+ *
+ * The kernel cannot see where a Doom frame starts and ends, so the LibOS
+ * says so.  Each call costs one syscall and records nothing unless the
+ * matching event was enabled with trace-start on the console.
+ */
+
+/* Around one frame: `frame` numbers it so overlapping frames pair up.
+   The first frame end also stops the kernel's boot-to-first-frame clock
+   (the `boot` console command). */
+static inline int32_t exo_trace_frame_begin(uint32_t frame) {
+    return exo_syscall2(EXO_SYS_TRACE, EXO_TRACE_FRAME_BEGIN, frame);
+}
+
+static inline int32_t exo_trace_frame_end(uint32_t frame) {
+    return exo_syscall2(EXO_SYS_TRACE, EXO_TRACE_FRAME_END, frame);
+}
+
+/* An instant with two values; `a` keeps its low 16 bits. */
+static inline int32_t exo_trace_mark(uint32_t a, uint32_t b) {
+    return exo_syscall3(EXO_SYS_TRACE, EXO_TRACE_MARK, a, b);
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "exo_abi.h"
+
+/*
+ * exo_vdata.h — Read-only kernel data page shared with every LibOS.
+ *
+ * The kernel publishes state that is cheap to read but would otherwise cost
+ * a syscall per query: the PIT clock, the TSC calibration and the keyboard
+ * modifier mask.  The LibOS reads it with plain loads.
+ *
+ * Consistency uses a sequence counter.  The kernel makes `seq` odd, updates
+ * the fields, then makes it even again.  A reader samples `seq`, copies what
+ * it needs, and retries if `seq` was odd or has moved:
+ *
+ *     const exo_vdata_t* vd = exo_vdata_get();
+ *     uint32_t seq, ms;
+ *     do {
+ *         seq = exo_vdata_begin(vd);
+ *         ms = vd->ms;
+ *     } while (exo_vdata_retry(vd, seq));
+ *
+ * exo_vdata_ms() and exo_vdata_ns() wrap that loop.
+ */
+
+#define EXO_VDATA_VERSION 1
+
+typedef struct {
+    volatile uint32_t seq;    // odd while the kernel is mid-update
+    uint32_t version;         // EXO_VDATA_VERSION
+    uint32_t tick_hz;         // PIT channel 0 rate
+    uint32_t tsc_khz;         // TSC cycles per millisecond, 0 if uncalibrated
+    uint32_t ticks;           // PIT ticks since boot
+    uint32_t ms;              // `ticks` in milliseconds
+    uint64_t tick_tsc;        // TSC sampled at the last tick
+    uint8_t  kbd_modifiers;   // MOD_* mask (src/ps2.h)
+    uint8_t  reserved[7];
+} exo_vdata_t;
+
+/* Address of the page, fetched once with a syscall and cached. */
+static inline const exo_vdata_t* exo_vdata_get(void) {
+    static const exo_vdata_t* vd;
+    if (!vd) {
+        vd = (const exo_vdata_t*)exo_syscall0(EXO_SYS_VDATA);
+    }
+    return vd;
+}
+
+static inline uint32_t exo_vdata_begin(const exo_vdata_t* vd) {
+    uint32_t seq;
+    while ((seq = vd->seq) & 1) {
+        __asm__ volatile ("pause");
+    }
+    __asm__ volatile ("" : : : "memory");
+    return seq;
+}
+
+static inline bool exo_vdata_retry(const exo_vdata_t* vd, uint32_t seq) {
+    __asm__ volatile ("" : : : "memory");
+    return vd->seq != seq;
+}
+
+/* Milliseconds since boot; same value exo_get_ticks() returns. */
+static inline uint32_t exo_vdata_ms(const exo_vdata_t* vd) {
+    uint32_t seq, ms;
+    do {
+        seq = exo_vdata_begin(vd);
+        ms = vd->ms;
+    } while (exo_vdata_retry(vd, seq));
+    return ms;
+}
+
+/*
+ * Nanoseconds since boot: the tick clock plus the TSC cycles elapsed since
+ * the last tick.  The TSC part is capped at one tick period so the result
+ * never runs ahead of the next tick.  Falls back to tick resolution when
+ * the TSC is uncalibrated.
+ */
+static inline uint64_t exo_vdata_ns(const exo_vdata_t* vd) {
+    uint32_t seq, ms, khz, hz;
+    uint64_t tick_tsc;
+    do {
+        seq = exo_vdata_begin(vd);
+        ms = vd->ms;
+        khz = vd->tsc_khz;
+        hz = vd->tick_hz;
+        tick_tsc = vd->tick_tsc;
+    } while (exo_vdata_retry(vd, seq));
+
+    uint64_t ns = (uint64_t)ms * 1000000;
+    if (khz == 0 || hz == 0) return ns;
+
+    uint32_t lo, hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    uint64_t delta = (((uint64_t)hi << 32) | lo) - tick_tsc;
+    uint64_t extra = delta * 1000000 / khz;
+    uint64_t period = 1000000000u / hz;
+    return ns + (extra < period ? extra : period);
+}
+
+static inline uint8_t exo_vdata_kbd_modifiers(const exo_vdata_t* vd) {
+    return vd->kbd_modifiers;
+}
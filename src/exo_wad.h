@@ -0,0 +1,85 @@
+#pragma once
+#include <stdint.h>
+#include "exo_abi.h"
+
+/*
+ * exo_wad.h — WAD module and lump index shared with the LibOS.
+ *
+ * The kernel validates the WAD that GRUB loaded as a module and builds an
+ * open-addressed hash from the 8-byte uppercase lump name to the lump
+ * number.  exo_wad_map() hands the LibOS the module, its lump directory and
+ * that index in place, with no copy.  Lookups are then a hash and a probe
+ * or two, where Doom's W_CheckNumForName scans every lump.
+ *
+ * Like W_CheckNumForName, a name that occurs more than once resolves to
+ * the last lump with that name, so PWAD-style overrides work.
+ */
+
+typedef struct {
+    char     id[4];        // "IWAD" or "PWAD"
+    int32_t  numlumps;
+    int32_t  infotableofs; // byte offset of the lump directory
+} exo_wad_header_t;
+
+typedef struct {
+    int32_t  filepos;      // byte offset of the lump data
+    int32_t  size;
+    char     name[8];      // NUL-padded, not necessarily terminated
+} exo_wad_lump_t;
+
+/* One index slot: the name as two little-endian words, and its lump. */
+typedef struct {
+    uint32_t key[2];
+    int32_t  lump;         // -1: empty slot
+} exo_wad_slot_t;
+
+typedef struct {
+    uint32_t base;         // address of the WAD (header at offset 0)
+    uint32_t size;         // bytes
+    uint32_t numlumps;
+    uint32_t directory;    // address of exo_wad_lump_t[numlumps]
+    uint32_t index;        // address of exo_wad_slot_t[index_mask + 1]
+    uint32_t index_mask;   // slot count - 1 (power of 2)
+} exo_wad_info_t;
+
+/* Pack a lump name into its key: at most 8 characters, uppercased,
+   zero-padded. */
+static inline void exo_wad_key(const char* name, uint32_t key[2]) {
+    uint8_t b[8] = { 0 };
+    for (int i = 0; i < 8 && name[i]; i++) {
+        char c = name[i];
+        b[i] = (uint8_t)(c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c);
+    }
+    key[0] = b[0] | b[1] << 8 | b[2] << 16 | (uint32_t)b[3] << 24;
+    key[1] = b[4] | b[5] << 8 | b[6] << 16 | (uint32_t)b[7] << 24;
+}
+
+/* Lump names share long prefixes ("E1M1", "E1M2"), so every key bit is
+   mixed into the low bits the index mask keeps (murmur3 finalizer). */
+static inline uint32_t exo_wad_hash(const uint32_t key[2]) {
+    uint32_t h = key[0] * 0x9E3779B1u + key[1];
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    return h ^ (h >> 16);
+}
+
+/* Lump number for `name`, or -1. Linear probing over the index. */
+static inline int32_t exo_wad_find(const exo_wad_info_t* wad,
+                                   const char* name) {
+    const exo_wad_slot_t* slots = (const exo_wad_slot_t*)wad->index;
+    uint32_t key[2];
+    exo_wad_key(name, key);
+
+    for (uint32_t i = exo_wad_hash(key);; i++) {
+        const exo_wad_slot_t* s = &slots[i & wad->index_mask];
+        if (s->lump < 0) return -1;
+        if (s->key[0] == key[0] && s->key[1] == key[1]) return s->lump;
+    }
+}
+
+/* LibOS side: map the kernel's WAD module. Returns 0 or -EXO_ENOENT. */
+static inline int32_t exo_wad_map(exo_wad_info_t* info_out) {
+    return exo_syscall1(EXO_SYS_WAD_MAP, (uint32_t)info_out);
+}
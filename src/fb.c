@@ -1,4 +1,10 @@
 #include "fb.h"
+#include "jobs.h"
+#include "string.h"
+#include "trace.h"
+
+// Rows per parallel chunk: big enough that a chunk outweighs the queueing.
+#define FB_ROWS_PER_JOB 32
 
 static inline uint32_t pack_bgrx8888(uint8_t r, uint8_t g, uint8_t b) {
     // memory: [BB][GG][RR][XX] on little-endian
@@ -22,16 +28,53 @@ bool fb_init_bgrx8888(framebuffer_t* fb, uintptr_t addr, uint32_t pitch, uint32_
     return true;
 }
 
+typedef struct {
+    const framebuffer_t* fb;
+    uint32_t px;
+} clear_job_t;
+
+static void clear_rows(void* arg, uint32_t y0, uint32_t y1) {
+    const clear_job_t* job = arg;
+    for (uint32_t y = y0; y < y1; y++) {
+        uint32_t* row = (uint32_t*)(job->fb->addr + y * job->fb->pitch);
+        for (uint32_t x = 0; x < job->fb->width; x++) row[x] = job->px;
+    }
+}
+
 void fb_clear(framebuffer_t* fb, uint8_t r, uint8_t g, uint8_t b) {
     if (!fb || fb->fmt != FB_PIXFMT_BGRX8888) return;
 
-    uint32_t px = pack_bgrx8888(r,g,b);
-    for (uint32_t y = 0; y < fb->height; y++) {
-        uint32_t* row = (uint32_t*)(fb->addr + y * fb->pitch);
-        for (uint32_t x = 0; x < fb->width; x++) row[x] = px;
+    clear_job_t job = { fb, pack_bgrx8888(r,g,b) };
+    jobs_parallel_for(clear_rows, &job, fb->height, FB_ROWS_PER_JOB);
+}
+
+typedef struct {
+    const framebuffer_t* fb;
+    uint32_t x, y, w;
+    const uint8_t* src;
+    uint32_t src_pitch;
+} blit_job_t;
+
+static void blit_rows(void* arg, uint32_t r0, uint32_t r1) {
+    const blit_job_t* job = arg;
+    for (uint32_t r = r0; r < r1; r++) {
+        memcpy(job->fb->addr + (job->y + r) * job->fb->pitch + job->x * 4,
+               job->src + r * job->src_pitch, job->w * 4);
     }
 }
 
+void fb_blit(framebuffer_t* fb, uint32_t x, uint32_t y, const uint32_t* src,
+             uint32_t src_pitch, uint32_t w, uint32_t h) {
+    if (!fb || fb->fmt != FB_PIXFMT_BGRX8888 || !src) return;
+    if (x >= fb->width || y >= fb->height) return;
+
+    if (x + w > fb->width)  w = fb->width  - x;
+    if (y + h > fb->height) h = fb->height - y;
+
+    blit_job_t job = { fb, x, y, w, (const uint8_t*)src, src_pitch };
+    jobs_parallel_for(blit_rows, &job, h, FB_ROWS_PER_JOB);
+}
+
 void fb_fill_rect(framebuffer_t* fb, uint32_t x0, uint32_t y0, uint32_t w, uint32_t h, uint8_t r, uint8_t g, uint8_t b) {
     if (!fb || fb->fmt != FB_PIXFMT_BGRX8888) return;
     if (x0 >= fb->width || y0 >= fb->height) return;
@@ -41,10 +84,12 @@ void fb_fill_rect(framebuffer_t* fb, uint32_t x0, uint32_t y0, uint32_t w, uint3
 
     uint32_t px = pack_bgrx8888(r,g,b);
 
+    TRACE(FB_FILL_BEGIN, w, h);
     for (uint32_t y = 0; y < h; y++) {
         uint32_t* row = (uint32_t*)(fb->addr + (y0 + y) * fb->pitch + x0 * 4);
         for (uint32_t x = 0; x < w; x++) row[x] = px;
     }
+    TRACE(FB_FILL_END, 0, 0);
 }
 
 void fb_test_byte_lane_probe(framebuffer_t* fb) {
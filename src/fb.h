@@ -20,10 +20,16 @@ typedef struct {
 // Returns false if unsupported (e.g., not 32bpp)
 bool fb_init_bgrx8888(framebuffer_t* fb, uintptr_t addr, uint32_t pitch, uint32_t w, uint32_t h, uint8_t bpp);
 
-// Basic drawing
+// Basic drawing. fb_clear and fb_blit split the rows across the online
+// CPUs (jobs.h); the others run on the caller.
 void fb_clear(framebuffer_t* fb, uint8_t r, uint8_t g, uint8_t b);
 void fb_fill_rect(framebuffer_t* fb, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint8_t r, uint8_t g, uint8_t b);
 
+// Copy a w x h block of 0x00RRGGBB pixels (src_pitch bytes per row) to
+// (x, y), clipped to the screen.
+void fb_blit(framebuffer_t* fb, uint32_t x, uint32_t y, const uint32_t* src,
+             uint32_t src_pitch, uint32_t w, uint32_t h);
+
 // Visual tests
 void fb_test_color_sanity(framebuffer_t* fb);
 
@@ -0,0 +1,135 @@
+#include "fpu.h"
+#include "cpu.h"
+#include "idt.h"
+#include "serial.h"
+
+#define CR0_TS     (1u << 3)
+#define VECTOR_NM  7
+
+extern void nm_stub(void);
+
+static bool sse = false;
+static bool lazy = false;
+static bool ts_set = false;           // our view of CR0.TS on the BSP
+static fpu_state_t* current = 0;      // state of the running context
+static fpu_state_t* owner = 0;        // state now in the registers
+static fpu_state_t clean;             // FNINIT + default MXCSR
+static fpu_stats_t stats;
+
+static inline void fxsave(fpu_state_t* s) {
+    __asm__ volatile ("fxsave (%0)" : : "r"(s->area) : "memory");
+}
+
+static inline void fxrstor(const fpu_state_t* s) {
+    __asm__ volatile ("fxrstor (%0)" : : "r"(s->area) : "memory");
+}
+
+static inline void clts(void) {
+    __asm__ volatile ("clts" : : : "memory");
+    ts_set = false;
+}
+
+static inline void stts(void) {
+    uint32_t cr0;
+    __asm__ volatile ("mov %%cr0, %0" : "=r"(cr0));
+    __asm__ volatile ("mov %0, %%cr0" : : "r"(cr0 | CR0_TS) : "memory");
+    ts_set = true;
+}
+
+bool fpu_init(void) {
+    sse = cpu_enable_sse();
+    if (sse) fxsave(&clean);
+    return sse;
+}
+
+void fpu_enable_lazy(void) {
+    if (!sse) return;
+    idt_set_gate(VECTOR_NM, (uint32_t)nm_stub);
+    lazy = true;
+}
+
+bool fpu_has_sse(void) {
+    return sse;
+}
+
+void fpu_switch(fpu_state_t* next) {
+    current = next;
+    if (!lazy) return;
+    if (next == owner) {
+        if (ts_set) clts();
+    } else if (!ts_set) {
+        stts();
+    }
+}
+
+void fpu_release(fpu_state_t* state) {
+    if (owner == state) owner = 0;
+    state->used = false;
+}
+
+/* #NM: the running context touched the FPU while another context's
+   registers are loaded. Interrupt gate, so IRQs are off. */
+void fpu_nm_handler(void) {
+    clts();
+    stats.nm_traps++;
+    if (!current || owner == current) return;
+
+    if (owner) {
+        fxsave(owner);
+        stats.lazy_saves++;
+    }
+    if (current->used) {
+        fxrstor(current);
+        stats.lazy_restores++;
+    } else {
+        fxrstor(&clean);
+        current->used = true;
+        stats.first_uses++;
+    }
+    owner = current;
+}
+
+uint32_t kernel_fpu_begin(void) {
+    uint32_t flags = irq_save();
+    stats.kernel_sections++;
+    // Contexts live on the BSP only; APs hold no one else's registers.
+    if (lazy && cpu_id() == 0) {
+        if (ts_set) clts();
+        if (owner) {
+            fxsave(owner);
+            owner = 0;
+            stats.kernel_saves++;
+        }
+    }
+    return flags;
+}
+
+void kernel_fpu_end(uint32_t flags) {
+    // The registers now hold kernel scratch: the next context to use
+    // them must trap and reload its own.
+    if (lazy && cpu_id() == 0) stts();
+    irq_restore(flags);
+}
+
+const fpu_stats_t* fpu_stats(void) {
+    return &stats;
+}
+
+void fpu_dump(void) {
+    serial_print("fpu: ");
+    serial_print(!sse ? "no SSE/FXSR\n" : lazy ? "SSE, lazy switching\n"
+                                               : "SSE, no lazy switching\n");
+    serial_print("  #NM=");
+    serial_print_u32(stats.nm_traps);
+    serial_print(" saves=");
+    serial_print_u32(stats.lazy_saves);
+    serial_print(" restores=");
+    serial_print_u32(stats.lazy_restores);
+    serial_print(" first_uses=");
+    serial_print_u32(stats.first_uses);
+    serial_print("\n  kernel sections=");
+    serial_print_u32(stats.kernel_sections);
+    serial_print(" saves=");
+    serial_print_u32(stats.kernel_saves);
+    serial_print("\n");
+}
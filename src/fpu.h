@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * fpu.h — FPU/SSE state: boot set-up, lazy switching between contexts and
+ * kernel SIMD sections (docs/sched.md §5).
+ *
+ * Each context has its own FXSAVE area, but the registers are not saved
+ * on a context switch.  The scheduler only sets CR0.TS when the incoming
+ * context does not own the registers.  That context's first FPU/SSE
+ * instruction raises #NM, which saves the owner's registers and loads the
+ * context's own.  A context that never uses SSE never pays for
+ * FXSAVE/FXRSTOR.
+ *
+ * Kernel code that uses SSE or x87 must do so inside
+ * kernel_fpu_begin()/kernel_fpu_end().  The section disables interrupts
+ * and moves any context state out of the registers first, so the section
+ * is safe both from IRQ handlers and from the code they interrupt.
+ */
+
+typedef struct {
+    uint8_t area[512];            // FXSAVE image
+    bool used;                    // area holds state; else start clean
+} __attribute__((aligned(16))) fpu_state_t;
+
+typedef struct {
+    uint32_t nm_traps;            // #NM taken
+    uint32_t lazy_saves;          // owner's registers saved by #NM
+    uint32_t lazy_restores;       // context state reloaded by #NM
+    uint32_t first_uses;          // contexts given the clean image
+    uint32_t kernel_sections;
+    uint32_t kernel_saves;        // sections that had to save an owner
+} fpu_stats_t;
+
+/* Enable SSE if the CPU has SSE2 and FXSR, and keep a clean FXSAVE image
+   for new contexts. Returns whether SSE is usable. */
+bool fpu_init(void);
+
+/* Install the #NM gate and start switching lazily. Call after idt_init().
+   Until then (and on CPUs without FXSR) nothing is saved: all contexts
+   share the registers, and a kernel section only disables interrupts, so
+   it clobbers whatever a context left in them. */
+void fpu_enable_lazy(void);
+
+bool fpu_has_sse(void);
+
+/* Scheduler hooks: `next` is about to run; `state` is going away. */
+void fpu_switch(fpu_state_t* next);
+void fpu_release(fpu_state_t* state);
+
+/* Bracket kernel SIMD code. Sections do not nest and must not sleep.
+   With lazy switching on, begin saves the owning context's registers;
+   before fpu_enable_lazy() it only disables interrupts. */
+uint32_t kernel_fpu_begin(void);
+void kernel_fpu_end(uint32_t flags);
+
+const fpu_stats_t* fpu_stats(void);
+
+/* Print the lazy-switch counters over serial. */
+void fpu_dump(void);
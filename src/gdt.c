@@ -0,0 +1,118 @@
+#include "gdt.h"
+#include "smp.h"
+
+struct gdt_entry {
+    uint16_t limit_low;
+    uint16_t base_low;
+    uint8_t  base_mid;
+    uint8_t  access;
+    uint8_t  granularity;    // flags (high nibble) | limit 16-19
+    uint8_t  base_high;
+} __attribute__((packed));
+
+struct gdt_ptr {
+    uint16_t limit;
+    uint32_t base;
+} __attribute__((packed));
+
+/* 32-bit TSS. Only ss0/esp0 (the ring-0 stack) and iomap_base are used:
+   hardware task switching is not. */
+struct tss {
+    uint32_t prev_task;
+    uint32_t esp0, ss0;
+    uint32_t esp1, ss1;
+    uint32_t esp2, ss2;
+    uint32_t cr3, eip, eflags;
+    uint32_t eax, ecx, edx, ebx, esp, ebp, esi, edi;
+    uint32_t es, cs, ss, ds, fs, gs;
+    uint32_t ldt;
+    uint16_t trap, iomap_base;
+} __attribute__((packed));
+
+// Access byte
+#define GDT_PRESENT   0x80
+#define GDT_RING3     0x60
+#define GDT_CODE_DATA 0x10    // S bit: code/data rather than system
+#define GDT_CODE      0x0A    // execute/read
+#define GDT_DATA      0x02    // read/write
+#define GDT_TSS_AVAIL 0x09    // 32-bit TSS, not busy
+
+// Granularity byte: 4 KiB pages, 32-bit
+#define GDT_FLAT_FLAGS 0xC0
+#define GDT_BYTE_FLAGS 0x40   // byte granular, 32-bit
+
+#define GDT_ENTRIES (5 + 2 * MAX_CPUS)
+
+#define KERNEL_ENTRY_STACK_SIZE 8192
+
+static struct gdt_entry gdt[GDT_ENTRIES];
+static struct gdt_ptr gdtp;
+static struct tss tss[MAX_CPUS];        // [0] is the BSP's, the only one used for entry
+
+// Ring-0 stack for SYSENTER, and for entries from ring 3 (int 0x80, IRQs)
+// until the scheduler switches TSS.esp0 to a context's own stack.
+static uint8_t kernel_entry_stack[KERNEL_ENTRY_STACK_SIZE] __attribute__((aligned(16)));
+
+extern void gdt_load(uint32_t gdtp_addr, uint32_t code_sel, uint32_t data_sel);
+
+_Static_assert(GDT_TSS_CPU(0) == GDT_TSS, "BSP TSS selector");
+// isr.s hard-codes this as PERCPU_FROM_TR.
+_Static_assert(GDT_PERCPU_FROM_TR == 0x40, "isr.s PERCPU_FROM_TR");
+// context.s hard-codes these for sched_enter_user.
+_Static_assert(GDT_USER_CS == 0x1B && GDT_USER_DS == 0x23, "context.s USER_CS/DS");
+
+static void gdt_set(int n, uint32_t base, uint32_t limit, uint8_t access, uint8_t flags) {
+    gdt[n].limit_low   = limit & 0xFFFF;
+    gdt[n].base_low    = base & 0xFFFF;
+    gdt[n].base_mid    = (base >> 16) & 0xFF;
+    gdt[n].access      = access;
+    gdt[n].granularity = flags | ((limit >> 16) & 0x0F);
+    gdt[n].base_high   = (base >> 24) & 0xFF;
+}
+
+void gdt_init(void) {
+    gdt_set(0, 0, 0, 0, 0);
+    gdt_set(1, 0, 0xFFFFF, GDT_PRESENT | GDT_CODE_DATA | GDT_CODE, GDT_FLAT_FLAGS);
+    gdt_set(2, 0, 0xFFFFF, GDT_PRESENT | GDT_CODE_DATA | GDT_DATA, GDT_FLAT_FLAGS);
+    gdt_set(3, 0, 0xFFFFF, GDT_PRESENT | GDT_RING3 | GDT_CODE_DATA | GDT_CODE, GDT_FLAT_FLAGS);
+    gdt_set(4, 0, 0xFFFFF, GDT_PRESENT | GDT_RING3 | GDT_CODE_DATA | GDT_DATA, GDT_FLAT_FLAGS);
+
+    tss[0].esp0 = (uint32_t)&kernel_entry_stack[KERNEL_ENTRY_STACK_SIZE];
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        tss[cpu].ss0 = GDT_KERNEL_DS;
+        tss[cpu].iomap_base = sizeof(struct tss);   // no I/O bitmap: ring 3 gets no ports
+        gdt_set(GDT_TSS_CPU(cpu) >> 3, (uint32_t)&tss[cpu], sizeof(struct tss) - 1,
+                GDT_PRESENT | GDT_TSS_AVAIL, 0);
+
+        percpu[cpu].self = &percpu[cpu];
+        percpu[cpu].id = cpu;
+        gdt_set(GDT_PERCPU(cpu) >> 3, (uint32_t)&percpu[cpu], sizeof(percpu_t) - 1,
+                GDT_PRESENT | GDT_CODE_DATA | GDT_DATA, GDT_BYTE_FLAGS);
+    }
+
+    gdtp.limit = sizeof(gdt) - 1;
+    gdtp.base = (uint32_t)&gdt;
+
+    gdt_load((uint32_t)&gdtp, GDT_KERNEL_CS, GDT_KERNEL_DS);
+    __asm__ volatile ("ltr %w0" : : "r"((uint16_t)GDT_TSS));
+    __asm__ volatile ("mov %w0, %%gs" : : "r"((uint16_t)GDT_PERCPU(0)));
+}
+
+void gdt_init_ap(uint32_t cpu) {
+    gdt_load((uint32_t)&gdtp, GDT_KERNEL_CS, GDT_KERNEL_DS);
+    __asm__ volatile ("ltr %w0" : : "r"((uint16_t)GDT_TSS_CPU(cpu)));
+    __asm__ volatile ("mov %w0, %%gs" : : "r"((uint16_t)GDT_PERCPU(cpu)));
+}
+
+void tss_set_kernel_stack(uint32_t esp0) {
+    tss[0].esp0 = esp0;
+}
+
+uint32_t tss_kernel_stack(void) {
+    return tss[0].esp0;
+}
+
+bool tss_on_entry_stack(uint32_t esp) {
+    uint32_t base = (uint32_t)kernel_entry_stack;
+    return esp >= base && esp <= base + KERNEL_ENTRY_STACK_SIZE;
+}
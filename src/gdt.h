@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "cpu.h"
+
+/*
+ * gdt.h — Flat GDT with ring 0 and ring 3 segments, and the TSS.
+ *
+ * GRUB leaves us a GDT of its own choosing; we install ours so the selector
+ * values are known.  The order is fixed by SYSENTER/SYSEXIT, which derive
+ * every selector from IA32_SYSENTER_CS: kernel CS, kernel SS = CS+8,
+ * user CS = CS+16, user SS = CS+24.
+ */
+
+#define GDT_KERNEL_CS 0x08
+#define GDT_KERNEL_DS 0x10
+#define GDT_USER_CS   (0x18 | 3)
+#define GDT_USER_DS   (0x20 | 3)
+#define GDT_TSS       0x28               // the BSP's: GDT_TSS_CPU(0)
+
+/* One TSS per CPU, then one data segment per CPU based at its percpu_t
+   (smp.h) and loaded in GS.  The two runs are MAX_CPUS entries apart, so
+   an entry stub finds its CPU's GS selector from TR alone (STR, isr.s). */
+#define GDT_TSS_CPU(cpu)  ((5 + (cpu)) << 3)
+#define GDT_PERCPU(cpu)   ((5 + MAX_CPUS + (cpu)) << 3)
+#define GDT_PERCPU_FROM_TR (MAX_CPUS << 3)   // GDT_PERCPU(n) - GDT_TSS_CPU(n)
+
+/* Load the GDT and TSS, reload every segment register and point GS at
+   the BSP's per-CPU block. Must run before idt_init(), which snapshots
+   CS, and before anything calls cpu_id(). */
+void gdt_init(void);
+
+/* Load the same GDT on an AP, load its TSS and point its GS at
+   percpu[cpu]. APs never enter from ring 3; their TSS only tells the
+   entry stubs which CPU they are on. */
+void gdt_init_ap(uint32_t cpu);
+
+/* Stack the CPU switches to on int 0x80 / IRQs from ring 3 (TSS.esp0).
+   The scheduler points it at the running context's own stack. */
+void tss_set_kernel_stack(uint32_t esp0);
+uint32_t tss_kernel_stack(void);
+
+/* True if `esp` lies on the shared ring-0 entry stack, i.e. the caller came
+   in through SYSENTER, or from ring 3 while kmain ran, and has no stack of
+   its own. */
+bool tss_on_entry_stack(uint32_t esp);
@@ -0,0 +1,38 @@
+#include "hist.h"
+#include "serial.h"
+#include "string.h"
+
+void hist_reset(hist_t* h) {
+    memset(h, 0, sizeof(*h));
+}
+
+void hist_print(const hist_t* h, const char* label, const char* unit) {
+    serial_print(label);
+    serial_print(": n=");
+    serial_print_u32(h->count);
+    if (h->count == 0) {
+        serial_print("\n");
+        return;
+    }
+    serial_print(" avg=");
+    serial_print_u32((uint32_t)(h->sum / h->count));
+    serial_print(unit);
+    serial_print(" max=");
+    serial_print_u32(h->max);
+    serial_print(unit);
+    serial_print("\n");
+
+    for (uint32_t b = 0; b < HIST_BUCKETS; b++) {
+        if (h->buckets[b] == 0) continue;
+        serial_print("    <");
+        if (b == HIST_BUCKETS - 1) {
+            serial_print("inf");
+        } else {
+            serial_print_u32(1u << b);
+        }
+        serial_print(unit);
+        serial_print(": ");
+        serial_print_u32(h->buckets[b]);
+        serial_print("\n");
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * hist.h — Fixed-size log2 histograms for latency/duration counters.
+ *
+ * Bucket 0 counts zeros, bucket b counts values in [2^(b-1), 2^b).
+ * hist_add is cheap enough (one bsr, a few adds) for IRQ top halves.
+ */
+
+#define HIST_BUCKETS 32
+
+typedef struct {
+    uint32_t buckets[HIST_BUCKETS];
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+} hist_t;
+
+static inline uint32_t hist_bucket(uint32_t value) {
+    uint32_t b = value ? 32 - (uint32_t)__builtin_clz(value) : 0;
+    return b < HIST_BUCKETS ? b : HIST_BUCKETS - 1;
+}
+
+static inline void hist_add(hist_t* h, uint32_t value) {
+    h->buckets[hist_bucket(value)]++;
+    h->count++;
+    h->sum += value;
+    if (value > h->max) h->max = value;
+}
+
+void hist_reset(hist_t* h);
+
+/* Print count/avg/max and every non-empty bucket to serial. `unit` is a
+   suffix such as "cyc" or "us". */
+void hist_print(const hist_t* h, const char* label, const char* unit);
@@ -41,11 +41,19 @@ void idt_init() {
     idt_load((uint32_t)&idtp);
 }
 
+void idt_install(void) {
+    idt_load((uint32_t)&idtp);
+}
+
 
 void idt_set_gate(int n, uint32_t handler) {
+    idt_set_gate_flags(n, handler, IDT_GATE_INT);
+}
+
+void idt_set_gate_flags(int n, uint32_t handler, uint8_t flags) {
     idt[n].baseLow = handler & 0xFFFF;
     idt[n].baseHigh = (handler >> 16) & 0xFFFF;
     idt[n].sel = kernel_cs;
     idt[n].always0 = 0;
-    idt[n].flags = 0x8E;
+    idt[n].flags = flags;
 }
@@ -1,6 +1,22 @@
 #pragma once
 #include <stdint.h>
 
+/* Gate type/attribute bytes */
+#define IDT_GATE_INT       0x8E   // present, DPL0, 32-bit interrupt gate (IF cleared)
+#define IDT_GATE_TRAP_USER 0xEF   // present, DPL3, 32-bit trap gate (IF kept)
+
+/* What an IRQ stub (isr.s) hands its C handler: the PUSHA block, then
+   what the CPU pushed for a same-ring interrupt. `esp` is the value before
+   PUSHA, i.e. the address of `eip`. */
+typedef struct {
+    uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax;
+    uint32_t eip, cs, eflags;
+} irq_frame_t;
+
 void idt_init();
+
+/* Load the table on the calling CPU; the APs share the BSP's. */
+void idt_install(void);
 void idt_set_gate(int n, uint32_t handler);
+void idt_set_gate_flags(int n, uint32_t handler, uint8_t flags);
 
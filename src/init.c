@@ -0,0 +1,143 @@
+#include "init.h"
+#include "cpu.h"
+#include "serial.h"
+#include "tsc.h"
+
+static const init_stage_t* stages = 0;
+static uint32_t stage_count = 0;
+static init_record_t records[INIT_MAX_STAGES];
+static uint32_t ran = 0;                  // stages run so far
+static uint64_t marks[INIT_MARK_COUNT];
+
+static const char* const mark_names[INIT_MARK_COUNT] = {
+    "entry", "sti", "idle", "late done", "first frame",
+};
+
+void init_mark(init_mark_t m) {
+    if (m < INIT_MARK_COUNT && !marks[m]) marks[m] = rdtsc();
+}
+
+uint64_t init_mark_tsc(init_mark_t m) {
+    return m < INIT_MARK_COUNT ? marks[m] : 0;
+}
+
+void init_begin(const init_stage_t* list, uint32_t count) {
+    stages = list;
+    stage_count = count < INIT_MAX_STAGES ? count : INIT_MAX_STAGES;
+    for (uint32_t i = 0; i < INIT_MAX_STAGES; i++) records[i] = (init_record_t){0};
+    ran = 0;
+}
+
+/* Every stage `i` needs has run (or been skipped). */
+static bool ready(uint32_t i) {
+    for (uint32_t d = 0; d < stage_count; d++) {
+        if ((stages[i].after & INIT_BIT(d)) && records[d].state == INIT_PENDING) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void run_stage(uint32_t i) {
+    init_record_t* r = &records[i];
+    r->order = ran++;
+    r->start_tsc = rdtsc();
+
+    bool missing = false;
+    for (uint32_t d = 0; d < stage_count; d++) {
+        if ((stages[i].after & INIT_BIT(d)) && records[d].state != INIT_DONE) {
+            missing = true;
+        }
+    }
+    if (missing) {
+        r->state = INIT_SKIPPED;
+    } else {
+        r->state = stages[i].run() ? INIT_DONE : INIT_ABSENT;
+    }
+    r->end_tsc = rdtsc();
+}
+
+/* The first pending early (or late) stage whose needs are met, or -1.
+   Searching from the top after each run keeps table order. */
+static int32_t next_ready(bool late) {
+    for (uint32_t i = 0; i < stage_count; i++) {
+        if (records[i].state != INIT_PENDING) continue;
+        if (((stages[i].flags & INIT_LATE) != 0) != late) continue;
+        if (ready(i)) return (int32_t)i;
+    }
+    return -1;
+}
+
+bool init_run_early(void) {
+    int32_t i;
+    while ((i = next_ready(false)) >= 0) run_stage((uint32_t)i);
+
+    bool ok = true;
+    for (uint32_t s = 0; s < stage_count; s++) {
+        if (records[s].state != INIT_PENDING || (stages[s].flags & INIT_LATE)) continue;
+        serial_print("init: ");
+        serial_print(stages[s].name);
+        serial_print(" can never run (needs a late stage, or a cycle)\n");
+        ok = false;
+    }
+    return ok;
+}
+
+bool init_run_late(void) {
+    int32_t i = next_ready(true);
+    if (i < 0) return false;
+    run_stage((uint32_t)i);
+    if (next_ready(true) < 0) init_mark(INIT_MARK_LATE_DONE);
+    return true;
+}
+
+const init_record_t* init_record(uint32_t stage) {
+    return stage < stage_count ? &records[stage] : 0;
+}
+
+static uint32_t since_entry_us(uint64_t tsc) {
+    return tsc_cycles_to_us(tsc - marks[INIT_MARK_ENTRY]);
+}
+
+void init_dump(void) {
+    serial_print("boot: kernel entry ");
+    serial_print_u32(tsc_cycles_to_us(marks[INIT_MARK_ENTRY]) / 1000);
+    serial_print(" ms after reset; times in us from entry\n");
+
+    for (uint32_t n = 0; n < ran; n++) {
+        for (uint32_t i = 0; i < stage_count; i++) {
+            const init_record_t* r = &records[i];
+            if (r->state == INIT_PENDING || r->order != n) continue;
+            serial_print("  ");
+            serial_print(stages[i].name);
+            serial_print(" +");
+            serial_print_u32(since_entry_us(r->start_tsc));
+            serial_print(" ");
+            serial_print_u32(tsc_cycles_to_us(r->end_tsc - r->start_tsc));
+            serial_print("us");
+            if (stages[i].flags & INIT_LATE) serial_print(" late");
+            if (r->state == INIT_ABSENT) serial_print(" absent");
+            if (r->state == INIT_SKIPPED) serial_print(" skipped");
+            serial_print("\n");
+        }
+    }
+    for (uint32_t i = 0; i < stage_count; i++) {
+        if (records[i].state != INIT_PENDING) continue;
+        serial_print("  ");
+        serial_print(stages[i].name);
+        serial_print(" pending\n");
+    }
+
+    serial_print("boot:");
+    for (uint32_t m = INIT_MARK_STI; m < INIT_MARK_COUNT; m++) {
+        serial_print(" ");
+        serial_print(mark_names[m]);
+        if (marks[m]) {
+            serial_print(" +");
+            serial_print_u32(since_entry_us(marks[m]));
+        } else {
+            serial_print(" -");
+        }
+    }
+    serial_print("\n");
+}
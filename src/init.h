@@ -0,0 +1,82 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * init.h — Boot stages, their dependencies and the boot timeline
+ * (docs/boot.md).
+ *
+ * kernel_main describes boot as a table of stages.  Each stage lists the
+ * stages it needs in `after`.  init_run_early() runs a stage as soon as
+ * all of those have run, and otherwise keeps table order.  A stage
+ * returns false when its device is absent or it failed.  Every stage that
+ * needs it is then skipped instead of run.
+ *
+ * INIT_LATE stages are the ones the LibOS can start without: diagnostic
+ * dumps, self-tests and optional devices.  They wait for the idle loop,
+ * which runs one per pass with init_run_late(), after the contexts have
+ * had the CPU.
+ *
+ * Every stage is timed with rdtsc, and init_mark() records milestones
+ * such as the first LibOS frame.  The TSC counts from reset, so the
+ * timeline also shows how long firmware and GRUB took.
+ */
+
+#define INIT_MAX_STAGES 64
+#define INIT_BIT(stage) (1ull << (stage))
+
+/* init_stage_t flags */
+#define INIT_LATE (1u << 0)       // run from the idle loop, after boot
+
+typedef struct {
+    const char* name;
+    bool (*run)(void);            // false: absent or failed
+    uint64_t after;               // INIT_BIT()s of the stages it needs
+    uint32_t flags;
+} init_stage_t;
+
+typedef enum {
+    INIT_PENDING = 0,
+    INIT_DONE,
+    INIT_ABSENT,                  // run() returned false
+    INIT_SKIPPED,                 // a stage it needs is absent or skipped
+} init_state_t;
+
+typedef struct {
+    init_state_t state;
+    uint32_t order;               // 0 = first stage run
+    uint64_t start_tsc;
+    uint64_t end_tsc;
+} init_record_t;
+
+typedef enum {
+    INIT_MARK_ENTRY = 0,          // kernel_main
+    INIT_MARK_STI,                // interrupts on
+    INIT_MARK_IDLE,               // idle loop reached
+    INIT_MARK_LATE_DONE,          // last late stage finished
+    INIT_MARK_FIRST_FRAME,        // the LibOS ended its first frame
+    INIT_MARK_COUNT
+} init_mark_t;
+
+/* Record milestone `m`, the first time only. */
+void init_mark(init_mark_t m);
+
+/* TSC at milestone `m`, or 0 if it has not been reached. */
+uint64_t init_mark_tsc(init_mark_t m);
+
+/* Use `stages` (at most INIT_MAX_STAGES, kept by pointer) from now on and
+   forget any earlier run. */
+void init_begin(const init_stage_t* stages, uint32_t count);
+
+/* Run every early stage. Returns false, naming them, if some can never
+   run: they need a late stage or are part of a cycle. */
+bool init_run_early(void);
+
+/* Run the first late stage that is ready. Returns false if none was. */
+bool init_run_late(void);
+
+const init_record_t* init_record(uint32_t stage);
+
+/* Print the boot timeline over serial: each stage's start and duration
+   relative to kernel entry, then the milestones. */
+void init_dump(void);
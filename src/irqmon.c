@@ -0,0 +1,160 @@
+#include "irqmon.h"
+#include "cpu.h"
+#include "defer.h"
+#include "serial.h"
+#include "string.h"
+#include "trace.h"
+#include "tsc.h"
+
+#define NO_CULPRIT 0xFF
+
+static irqmon_line_stats_t lines[IRQMON_LINES];
+static uint64_t handler_start[IRQMON_LINES];
+static irqmon_tick_stats_t tick_stats;
+
+static uint32_t period = 0;
+static uint64_t expected_tsc = 0;
+static uint64_t prev_entry_tsc = 0;
+static uint8_t anchored = 0;
+
+// Longest handler since the previous IRQ0 entry: the usual reason a tick
+// is late is that some other top half kept IF=0 for too long.
+static uint8_t window_irq = NO_CULPRIT;
+static uint32_t window_cycles = 0;
+
+void irqmon_init(uint32_t cycles_per_tick) {
+    memset(lines, 0, sizeof(lines));
+    memset(&tick_stats, 0, sizeof(tick_stats));
+    tick_stats.last_culprit_irq = NO_CULPRIT;
+    period = cycles_per_tick;
+    anchored = 0;
+    window_irq = NO_CULPRIT;
+    window_cycles = 0;
+}
+
+/* Bottom half: report a loss recorded by irqmon_tick. */
+static void irqmon_lost_bh(uint32_t count) {
+    serial_print("irqmon: lost ");
+    serial_print_u32(count);
+    serial_print(" tick(s) at tick ");
+    serial_print_u32(tick_stats.last_lost_at);
+    serial_print(", gap ");
+    serial_print_u32(tsc_cycles_to_us(tick_stats.last_lost_gap));
+    serial_print("us, ");
+    if (tick_stats.last_culprit_irq == NO_CULPRIT
+        || tick_stats.last_culprit_cycles < period) {
+        serial_print("interrupts masked outside any handler\n");
+    } else {
+        serial_print("longest handler IRQ");
+        serial_print_u32(tick_stats.last_culprit_irq);
+        serial_print(" ");
+        serial_print_u32(tsc_cycles_to_us(tick_stats.last_culprit_cycles));
+        serial_print("us\n");
+    }
+}
+
+void irqmon_tick(uint64_t entry_tsc) {
+    if (period == 0) return;
+
+    tick_stats.ticks++;
+    uint64_t gap = entry_tsc - prev_entry_tsc;
+    prev_entry_tsc = entry_tsc;
+
+    if (!anchored) {
+        anchored = 1;
+        expected_tsc = entry_tsc + period;
+    } else {
+        int64_t lateness = (int64_t)(entry_tsc - expected_tsc);
+
+        if (lateness < (int64_t)(period / 4)) {
+            // On time: re-anchor on this edge so calibration error in
+            // `period` can never accumulate into phantom losses.
+            hist_add(&tick_stats.lateness, lateness > 0 ? (uint32_t)lateness : 0);
+            expected_tsc = entry_tsc + period;
+        } else {
+            uint32_t late = lateness > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)lateness;
+            uint32_t missed = late / period;
+
+            hist_add(&tick_stats.lateness, late);
+            tick_stats.late_ticks++;
+            expected_tsc += (uint64_t)(missed + 1) * period;
+
+            if (missed) {
+                tick_stats.lost_ticks += missed;
+                tick_stats.last_lost_at = tick_stats.ticks;
+                tick_stats.last_lost_count = missed;
+                tick_stats.last_lost_gap = gap > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)gap;
+                tick_stats.last_culprit_irq = window_irq;
+                tick_stats.last_culprit_cycles = window_cycles;
+                defer_post(irqmon_lost_bh, missed);
+            }
+        }
+    }
+
+    window_irq = NO_CULPRIT;
+    window_cycles = 0;
+}
+
+void irqmon_enter(uint32_t irq, uint64_t entry_tsc) {
+    uint64_t now = rdtsc();
+    irqmon_line_stats_t* line = &lines[irq & (IRQMON_LINES - 1)];
+
+    line->count++;
+    hist_add(&line->latency, (uint32_t)(now - entry_tsc));
+    TRACE(IRQ_ENTER, irq, (uint32_t)(now - entry_tsc));
+
+    if (irq == 0) {
+        irqmon_tick(entry_tsc);
+    }
+
+    handler_start[irq & (IRQMON_LINES - 1)] = rdtsc();
+}
+
+void irqmon_exit(uint32_t irq) {
+    irq &= IRQMON_LINES - 1;
+    uint32_t cycles = (uint32_t)(rdtsc() - handler_start[irq]);
+
+    hist_add(&lines[irq].duration, cycles);
+    TRACE(IRQ_EXIT, irq, 0);
+
+    if (cycles > window_cycles) {
+        window_cycles = cycles;
+        window_irq = (uint8_t)irq;
+    }
+}
+
+const irqmon_line_stats_t* irqmon_line_stats(uint32_t irq) {
+    return &lines[irq & (IRQMON_LINES - 1)];
+}
+
+const irqmon_tick_stats_t* irqmon_tick_stats(void) {
+    return &tick_stats;
+}
+
+uint32_t irqmon_lost_ticks(void) {
+    return tick_stats.lost_ticks;
+}
+
+void irqmon_dump(void) {
+    serial_print("irqmon: period=");
+    serial_print_u32(period);
+    serial_print("cyc ticks=");
+    serial_print_u32(tick_stats.ticks);
+    serial_print(" late=");
+    serial_print_u32(tick_stats.late_ticks);
+    serial_print(" lost=");
+    serial_print_u32(tick_stats.lost_ticks);
+    serial_print("\n");
+    hist_print(&tick_stats.lateness, "  irq0 lateness", "cyc");
+
+    for (uint32_t irq = 0; irq < IRQMON_LINES; irq++) {
+        if (lines[irq].count == 0) continue;
+        serial_print("  IRQ");
+        serial_print_u32(irq);
+        serial_print(" count=");
+        serial_print_u32(lines[irq].count);
+        serial_print("\n");
+        hist_print(&lines[irq].latency, "    entry->handler", "cyc");
+        hist_print(&lines[irq].duration, "    handler", "cyc");
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <stdint.h>
+#include "hist.h"
+
+/*
+ * irqmon.h — Interrupt latency and lost-tick monitor.
+ *
+ * Every IRQ stub timestamps its entry with rdtsc and brackets the C handler
+ * with irqmon_enter/irqmon_exit.  Per line we keep entry-to-handler latency
+ * and handler duration histograms (in TSC cycles).  For IRQ0 the entry time
+ * is also compared against the expected PIT edge: ticks serviced late are
+ * counted, and ticks that never arrived (the PIC only latches one pending
+ * edge) are reported as lost together with the handler that ran longest
+ * in the gap.
+ */
+
+#define IRQMON_LINES 16
+
+typedef struct {
+    uint32_t count;
+    hist_t latency;      // stub entry -> C handler start
+    hist_t duration;     // C handler start -> return
+} irqmon_line_stats_t;
+
+typedef struct {
+    uint32_t ticks;              // IRQ0 entries analysed
+    uint32_t late_ticks;         // serviced >= 1/4 period after the edge
+    uint32_t lost_ticks;         // edges that were never serviced
+    hist_t lateness;             // expected edge -> stub entry
+
+    // Most recent loss, for the log.
+    uint32_t last_lost_at;       // value of `ticks` when detected
+    uint32_t last_lost_count;
+    uint32_t last_lost_gap;      // cycles since the previous tick entry
+    uint8_t  last_culprit_irq;   // longest handler in the gap (0xFF: none)
+    uint32_t last_culprit_cycles;
+} irqmon_tick_stats_t;
+
+/* Arm the monitor with the PIT period expressed in TSC cycles. Resets all
+   counters. A period of 0 disables tick analysis. */
+void irqmon_init(uint32_t cycles_per_tick);
+
+/* Called from the IRQ stubs (src/isr.s). */
+void irqmon_enter(uint32_t irq, uint64_t entry_tsc);
+void irqmon_exit(uint32_t irq);
+
+/* Tick analysis on an IRQ0 entry timestamp. Called by irqmon_enter for
+   IRQ0; exposed so the test harness can feed synthetic timestamps. */
+void irqmon_tick(uint64_t entry_tsc);
+
+const irqmon_line_stats_t* irqmon_line_stats(uint32_t irq);
+const irqmon_tick_stats_t* irqmon_tick_stats(void);
+uint32_t irqmon_lost_ticks(void);
+
+/* Print all counters and histograms to serial. */
+void irqmon_dump(void);
@@ -4,6 +4,37 @@ idt_load:
     lidt (%eax)
     ret
 
+/* gdt_load(gdtp, code_sel, data_sel) — lgdt, reload the data segment
+   registers, then far-return to reload CS. */
+.global gdt_load
+gdt_load:
+    mov 4(%esp), %eax
+    lgdt (%eax)
+    mov 12(%esp), %eax
+    mov %ax, %ds
+    mov %ax, %es
+    mov %ax, %fs
+    mov %ax, %gs
+    mov %ax, %ss
+    mov 8(%esp), %eax
+    push %eax
+    push $1f
+    lret
+1:  ret
+
+/* Per-CPU GS on entry. The kernel's C code reads its CPU through GS
+   (cpu_id(), this_cpu()), but an entry from ring 3 arrives with the
+   caller's GS. Every CPU has its own TSS, MAX_CPUS GDT entries below its
+   per-CPU segment (gdt.h), so STR gives the selector without touching
+   memory. Callers save GS first and pop it back on exit. */
+.set PERCPU_FROM_TR, 0x40          /* GDT_PERCPU_FROM_TR, checked in gdt.c */
+
+.macro LOAD_PERCPU_GS reg
+    str \reg
+    add $PERCPU_FROM_TR, \reg
+    mov \reg, %gs
+.endm
+
 /* Default handler for unregistered vectors — just return silently.
    No EOI is sent here; this stub covers CPU exception vectors (0-31)
    where EOI is not appropriate. Hardware IRQs should have dedicated stubs. */
@@ -11,20 +42,159 @@ idt_load:
 default_stub:
     iret
 
-.global irq0_stub
-.extern irq0_handler
+/* IRQ stubs. Each one:
+     0. saves GS and loads this CPU's per-CPU selector,
+     1. timestamps its entry with rdtsc and reports it to irqmon_enter,
+     2. runs the C top half (which sends EOI), passing it the saved
+        registers (irq_frame_t, idt.h),
+     3. closes the irqmon measurement,
+     4. gives pending deferred work a chance to run with interrupts
+        re-enabled before returning to the interrupted context. */
+.extern irqmon_enter
+.extern irqmon_exit
+.extern defer_irq_exit
 
-irq0_stub:
+.macro IRQ_STUB irq, handler
+.global irq\irq\()_stub
+.extern \handler
+irq\irq\()_stub:
     pusha
-    call irq0_handler
+    push %gs
+    LOAD_PERCPU_GS %ax
+    rdtsc
+    push %edx
+    push %eax
+    push $\irq
+    call irqmon_enter
+    add $12, %esp
+    lea 4(%esp), %eax           /* irq_frame_t: the pusha block above GS */
+    push %eax
+    call \handler
+    add $4, %esp
+    push $\irq
+    call irqmon_exit
+    add $4, %esp
+    call defer_irq_exit
+    pop %gs
     popa
     iret
+.endm
 
-.global irq1_stub
-.extern irq1_handler
+IRQ_STUB 0, irq0_handler
+IRQ_STUB 1, irq1_handler
+IRQ_STUB 5, irq5_handler
+IRQ_STUB 12, irq12_handler
 
-irq1_stub:
+/* Wake IPI from another CPU (local APIC, not the PIC): the interrupt
+   itself ends the target's HLT; the handler only counts it and sends the
+   local APIC EOI. */
+.global ipi_wake_stub
+.extern ipi_wake_handler
+ipi_wake_stub:
     pusha
-    call irq1_handler
+    push %gs
+    LOAD_PERCPU_GS %ax
+    call ipi_wake_handler
+    pop %gs
     popa
-    iret
\ No newline at end of file
+    iret
+
+/* System call entry stubs. Both call
+     syscall_dispatch(eax, ebx, ecx, edx, esi, edi)
+   with the kernel data segments and this CPU's GS loaded and interrupts
+   enabled, and return
+   its result in EAX. Every other register is preserved for the caller. */
+.extern syscall_dispatch
+.set KERNEL_DS, 0x10
+
+/* int 0x80 — DPL3 trap gate, so IF stays as the caller had it. */
+.global syscall_int80_stub
+syscall_int80_stub:
+    push %ds
+    push %es
+    push %gs
+    push %ecx
+    push %edx
+    push %edi               /* a5 */
+    push %esi               /* a4 */
+    push %edx               /* a3 */
+    push %ecx               /* a2 */
+    push %ebx               /* a1 */
+    push %eax               /* number */
+    mov $KERNEL_DS, %cx
+    mov %cx, %ds
+    mov %cx, %es
+    LOAD_PERCPU_GS %cx
+    call syscall_dispatch
+    add $24, %esp
+    pop %edx
+    pop %ecx
+    pop %gs
+    pop %es
+    pop %ds
+    iret
+
+/* #NM (vector 7, no error code): the first FPU/SSE instruction after the
+   scheduler set CR0.TS. fpu_nm_handler loads the running context's state
+   and clears TS, and the instruction is retried. */
+.global nm_stub
+.extern fpu_nm_handler
+nm_stub:
+    pusha
+    push %gs
+    LOAD_PERCPU_GS %ax
+    call fpu_nm_handler
+    pop %gs
+    popa
+    iret
+
+/* #PF (vector 14) pushes an error code below EIP; the faulting address
+   is in CR2. page_fault_handler(cr2, err, eip) returns only if it mapped
+   the page, and the iret retries the access. */
+.global pf_stub
+.extern page_fault_handler
+pf_stub:
+    pusha
+    push %gs
+    LOAD_PERCPU_GS %ax
+    mov %cr2, %eax
+    pushl 40(%esp)              /* eip */
+    pushl 40(%esp)              /* error code */
+    push %eax
+    call page_fault_handler
+    add $12, %esp
+    pop %gs
+    popa
+    add $4, %esp                /* drop the error code */
+    iret
+
+/* SYSENTER — CS/SS/ESP/EIP come from the MSRs and IF is cleared. The
+   caller passes its ESP in ECX and its resume EIP in EDX (what SYSEXIT
+   restores), so arguments 2 and 3 are read from its stack: a3 at 0(ECX),
+   a2 at 4(ECX). */
+.global syscall_sysenter_stub
+syscall_sysenter_stub:
+    push %ecx               /* user ESP for sysexit */
+    push %edx               /* user EIP for sysexit */
+    push %ds
+    push %es
+    push %gs
+    push %edi               /* a5 */
+    push %esi               /* a4 */
+    pushl 0(%ecx)           /* a3 */
+    pushl 4(%ecx)           /* a2 */
+    push %ebx               /* a1 */
+    push %eax               /* number */
+    mov $KERNEL_DS, %cx
+    mov %cx, %ds
+    mov %cx, %es
+    LOAD_PERCPU_GS %cx
+    sti
+    call syscall_dispatch
+    add $24, %esp
+    pop %gs
+    pop %es
+    pop %ds
+    pop %edx
+    pop %ecx
+    sysexit
@@ -0,0 +1,165 @@
+#include "jobs.h"
+#include "smp.h"
+#include "spinlock.h"
+#include "serial.h"
+
+typedef struct {
+    volatile uint32_t pending;    // chunks not yet finished
+} job_group_t;
+
+typedef struct {
+    job_fn_t fn;
+    void* arg;
+    uint32_t begin, end;
+    job_group_t* group;
+} job_t;
+
+/* Owner pushes and pops at the tail; thieves take from the head. */
+typedef struct {
+    spinlock_t lock;
+    uint32_t head, tail;
+    job_t jobs[JOBS_QUEUE];
+} job_queue_t;
+
+static job_queue_t queues[MAX_CPUS];
+static volatile uint32_t pending = 0;
+static jobs_stats_t stats;
+
+static const char* const queue_names[MAX_CPUS] = {
+    "jobs0", "jobs1", "jobs2", "jobs3", "jobs4", "jobs5", "jobs6", "jobs7",
+};
+
+_Static_assert(MAX_CPUS == 8, "one queue name per CPU");
+
+static bool push(job_queue_t* q, const job_t* j) {
+    spin_lock(&q->lock);
+    bool ok = q->tail - q->head < JOBS_QUEUE;
+    if (ok) {
+        q->jobs[q->tail++ % JOBS_QUEUE] = *j;
+        __atomic_add_fetch(&pending, 1, __ATOMIC_RELAXED);
+    }
+    spin_unlock(&q->lock);
+    return ok;
+}
+
+static bool take(job_queue_t* q, job_t* out, bool from_head) {
+    // Unlocked peek: thieves skip empty queues without bouncing the lock.
+    if (__atomic_load_n(&q->tail, __ATOMIC_RELAXED) ==
+        __atomic_load_n(&q->head, __ATOMIC_RELAXED)) {
+        return false;
+    }
+
+    spin_lock(&q->lock);
+    bool ok = q->tail != q->head;
+    if (ok) {
+        *out = from_head ? q->jobs[q->head++ % JOBS_QUEUE]
+                         : q->jobs[--q->tail % JOBS_QUEUE];
+        __atomic_sub_fetch(&pending, 1, __ATOMIC_RELAXED);
+    }
+    spin_unlock(&q->lock);
+    return ok;
+}
+
+static void run(const job_t* j) {
+    j->fn(j->arg, j->begin, j->end);
+    __atomic_sub_fetch(&j->group->pending, 1, __ATOMIC_RELEASE);
+    this_cpu()->jobs_run++;
+}
+
+void jobs_init(void) {
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        spin_init(&queues[cpu].lock, queue_names[cpu]);
+        queues[cpu].head = queues[cpu].tail = 0;
+    }
+    pending = 0;
+    stats = (jobs_stats_t){ 0 };
+}
+
+bool jobs_run_one(void) {
+    uint32_t me = cpu_id();
+    job_t j;
+
+    if (take(&queues[me], &j, false)) {
+        run(&j);
+        return true;
+    }
+
+    uint32_t n = smp_cpu_count();
+    for (uint32_t k = 1; k < n; k++) {
+        if (take(&queues[(me + k) % n], &j, true)) {
+            this_cpu()->jobs_stolen++;
+            run(&j);
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t jobs_pending(void) {
+    return __atomic_load_n(&pending, __ATOMIC_RELAXED);
+}
+
+void jobs_parallel_for(job_fn_t fn, void* arg, uint32_t count, uint32_t grain) {
+    if (count == 0) return;
+    if (grain == 0) grain = 1;
+
+    uint32_t chunks = (count + grain - 1) / grain;
+    uint32_t limit = smp_cpu_count() * JOBS_PER_CPU;
+    if (chunks > limit) chunks = limit;
+    if (chunks <= 1) {
+        stats.inline_loops++;
+        fn(arg, 0, count);
+        return;
+    }
+
+    job_group_t group = { chunks };
+    job_queue_t* q = &queues[cpu_id()];
+    stats.loops++;
+
+    // Queue back to front: the owner pops from the tail, so it starts at
+    // the beginning of the range while thieves take the far end.
+    for (uint32_t c = chunks; c-- > 0;) {
+        job_t j = {
+            .fn = fn, .arg = arg, .group = &group,
+            .begin = (uint32_t)((uint64_t)count * c / chunks),
+            .end = (uint32_t)((uint64_t)count * (c + 1) / chunks),
+        };
+        if (push(q, &j)) {
+            stats.jobs++;
+        } else {
+            stats.overflows++;
+            run(&j);
+        }
+    }
+    smp_wake_all();
+
+    while (__atomic_load_n(&group.pending, __ATOMIC_ACQUIRE) != 0) {
+        if (!jobs_run_one()) cpu_pause();
+    }
+}
+
+const jobs_stats_t* jobs_stats(void) {
+    return &stats;
+}
+
+void jobs_dump(void) {
+    serial_print("jobs: loops=");
+    serial_print_u32(stats.loops);
+    serial_print(" inline=");
+    serial_print_u32(stats.inline_loops);
+    serial_print(" chunks=");
+    serial_print_u32(stats.jobs);
+    serial_print(" overflows=");
+    serial_print_u32(stats.overflows);
+    serial_print("\n");
+    for (uint32_t cpu = 0; cpu < smp_cpu_count(); cpu++) {
+        const spinlock_t* l = &queues[cpu].lock;
+        serial_print("  ");
+        serial_print(l->name);
+        serial_print(": locked=");
+        serial_print_u32(l->acquired);
+        serial_print(" contended=");
+        serial_print_u32(l->contended);
+        serial_print("\n");
+    }
+}
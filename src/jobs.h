@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * jobs.h — Fork-join parallel loops on a work-stealing job queue.
+ *
+ * jobs_parallel_for() cuts a range into chunks, queues them on the
+ * calling CPU's deque and wakes the APs.  Each CPU takes work from the
+ * tail of its own deque and, when that is empty, steals from the head of
+ * another CPU's, so a CPU that finishes early keeps busy and the last
+ * chunk is never stuck behind a slow one.  The caller works through the
+ * chunks too and returns once all of them have run.
+ *
+ * Jobs run on any CPU with interrupts enabled, so they may only touch
+ * the data they were given — nothing else in the kernel is SMP-safe.
+ * Call from task context only.
+ */
+
+#define JOBS_QUEUE       64        // chunks each CPU's deque can hold
+#define JOBS_PER_CPU     4         // chunks per online CPU per loop
+
+/* Process items [begin, end) of the loop. */
+typedef void (*job_fn_t)(void* arg, uint32_t begin, uint32_t end);
+
+typedef struct {
+    uint32_t loops;               // jobs_parallel_for() calls that split
+    uint32_t inline_loops;        // calls too small to split
+    uint32_t jobs;                // chunks queued
+    uint32_t overflows;           // chunks run by the caller: deque full
+} jobs_stats_t;
+
+/* Empty every deque. Call before smp_init(). */
+void jobs_init(void);
+
+/* Run fn over [0, count) in chunks of at least `grain` items. */
+void jobs_parallel_for(job_fn_t fn, void* arg, uint32_t count, uint32_t grain);
+
+/* Run one queued chunk, own deque first, then stealing. Returns false if
+   every deque was empty. */
+bool jobs_run_one(void);
+
+/* Chunks queued and not yet taken, on all CPUs. */
+uint32_t jobs_pending(void);
+
+const jobs_stats_t* jobs_stats(void);
+
+/* Print the loop counters and deque lock contention over serial. */
+void jobs_dump(void);
@@ -0,0 +1,211 @@
+#include "kcmd.h"
+#include "serial.h"
+#include "string.h"
+#include "irqmon.h"
+#include "ps2.h"
+#include "syscall.h"
+#include "submit.h"
+#include "wad.h"
+#include "pmm.h"
+#include "ramfs.h"
+#include "pci.h"
+#include "virtio_blk.h"
+#include "virtio_console.h"
+#include "speaker.h"
+#include "bcache.h"
+#include "sb16.h"
+#include "mixer.h"
+#include "exo_sound.h"
+#include "smp.h"
+#include "sched.h"
+#include "fpu.h"
+#include "vmm.h"
+#include "prof.h"
+#include "trace.h"
+#include "init.h"
+
+#define KCMD_LINE_MAX 64
+
+typedef struct {
+    const char* name;
+    const char* help;
+    void (*run)(void);
+} kcmd_t;
+
+static void cmd_help(void);
+
+static char args[KCMD_LINE_MAX];   // rest of the line after the command name
+
+static void cmd_kbdlat_reset(void) {
+    kbd_latency_reset();
+    serial_print("kbd latency histograms cleared\n");
+}
+
+static void cmd_sync(void) {
+    int32_t saved = ramfs_save();
+    if (saved < 0) {
+        serial_print(saved == -EXO_ENODEV ? "sync: no disk\n" : "sync: failed\n");
+        return;
+    }
+    serial_print("sync: ");
+    serial_print_u32((uint32_t)saved);
+    serial_print(" files saved\n");
+}
+
+static void cmd_prof_start(void) {
+    if (!prof_start(1)) {
+        serial_print("prof: no memory for the sample buffer\n");
+        return;
+    }
+    serial_print("prof: sampling every tick; 'prof' stops and dumps\n");
+}
+
+/* trace-start [event...]: the named events (TRACE_EVENTS ids), or all. */
+static void cmd_trace_start(void) {
+    uint32_t mask = 0;
+    const char* p = args;
+    while (*p) {
+        const char* word = p;
+        while (*p && *p != ' ') p++;
+        uint32_t len = (uint32_t)(p - word);
+        int32_t ev = trace_find(word, len);
+        if (len == 3 && memcmp(word, "all", 3) == 0) {
+            mask = TRACE_ALL;
+        } else if (ev >= 0) {
+            mask |= 1u << ev;
+        } else {
+            serial_print("trace: unknown event (see docs/debugging.md)\n");
+            return;
+        }
+        while (*p == ' ') p++;
+    }
+    if (!trace_start(mask ? mask : TRACE_ALL)) {
+        serial_print("trace: no memory for the ring\n");
+        return;
+    }
+    serial_print("trace: recording; 'trace' stops and dumps\n");
+}
+
+static void cmd_beep(void) {
+    speaker_tone(0, 0, 880, 120);
+    speaker_tone(0, 0, 0, 40);
+    speaker_tone(0, 0, 660, 120);
+}
+
+/* Play the pistol sound from the WAD, panned left then right. */
+static void cmd_pcm(void) {
+    if (!sb16_present()) {
+        serial_print("pcm: no SB16\n");
+        return;
+    }
+    int32_t lump = wad_find("DSPISTOL");
+    uint32_t size;
+    const uint8_t* p = lump >= 0 ? wad_lump_data(lump, &size) : 0;
+    if (!p || size <= 8 + 32 || (p[0] | p[1] << 8) != 3) {
+        serial_print("pcm: no DSPISTOL lump\n");
+        return;
+    }
+    uint32_t rate = p[2] | p[3] << 8;
+    uint32_t len = p[4] | p[5] << 8 | (uint32_t)p[6] << 16 | (uint32_t)p[7] << 24;
+    if (len > size - 8) len = size - 8;
+    mixer_play(0, p + 8 + 16, len - 32, rate, EXO_PCM_MAX_VOL, 32);
+    mixer_play(1, p + 8 + 16, len - 32, rate, EXO_PCM_MAX_VOL / 2, 222);
+}
+
+static const kcmd_t commands[] = {
+    { "help",        "list commands",                       cmd_help },
+    { "irq",         "IRQ latency and lost-tick report",    irqmon_dump },
+    { "kbdlat",      "keyboard IRQ->dequeue latency",       kbd_latency_dump },
+    { "kbdlat-reset", "clear the keyboard latency histograms", cmd_kbdlat_reset },
+    { "syscalls",    "per-syscall call counts and cycles",  syscall_dump },
+    { "submit",      "batched syscall ring stats",          submit_dump },
+    { "wad",         "WAD module and lump index",           wad_dump },
+    { "pmm",         "physical page allocator usage",       pmm_dump },
+    { "ramfs",       "RAM disk files and I/O counters",     ramfs_dump },
+    { "sync",        "save the RAM disk to the virtio disk", cmd_sync },
+    { "lspci",       "PCI functions found at boot",         pci_dump },
+    { "vblk",        "virtio-blk capacity and requests",    virtio_blk_dump },
+    { "bcache",      "block cache hits and write-backs",    bcache_dump },
+    { "speaker",     "PC speaker channels and tone counters", speaker_dump },
+    { "beep",        "queue a two-tone test chirp",         cmd_beep },
+    { "sb16",        "SB16 DMA state and mixer cost",       sb16_dump },
+    { "pcm",         "play DSPISTOL through the mixer",     cmd_pcm },
+    { "cpus",        "online CPUs, IPIs, jobs and queue contention", smp_dump },
+    { "ps",          "contexts, switches, sleeps and wait times", sched_dump },
+    { "fpu",         "lazy FPU/SSE switching and kernel SIMD sections", fpu_dump },
+    { "vmm",         "demand-zero regions, resident pages and page faults", vmm_dump },
+    { "prof-start",  "start the sampling profiler (1 kHz)",  cmd_prof_start },
+    { "prof",        "stop the profiler and dump its samples", prof_dump },
+    { "trace-start", "record tracepoints: all, or the events named", cmd_trace_start },
+    { "trace",       "stop tracing and dump the ring (binary)", trace_dump },
+    { "boot",        "boot timeline: stage times and milestones", init_dump },
+    { "vcon",        "log output sink and virtio-console stats", virtio_console_dump },
+};
+
+#define KCMD_COUNT (sizeof(commands) / sizeof(commands[0]))
+
+static char line[KCMD_LINE_MAX];
+static uint32_t line_len = 0;
+static bool last_was_cr = false;   // swallow the LF of a CRLF pair
+
+static void cmd_help(void) {
+    for (uint32_t i = 0; i < KCMD_COUNT; i++) {
+        serial_print("  ");
+        serial_print(commands[i].name);
+        serial_print(" - ");
+        serial_print(commands[i].help);
+        serial_print("\n");
+    }
+}
+
+bool kcmd_execute(const char* cmd) {
+    // Ignore leading and trailing blanks so "  irq \r" still matches.
+    while (*cmd == ' ') cmd++;
+    size_t len = strlen(cmd);
+    while (len > 0 && (cmd[len - 1] == ' ' || cmd[len - 1] == '\r')) len--;
+    if (len == 0) return true;
+
+    for (uint32_t i = 0; i < KCMD_COUNT; i++) {
+        size_t n = strlen(commands[i].name);
+        if (n <= len && memcmp(commands[i].name, cmd, n) == 0 &&
+            (n == len || cmd[n] == ' ')) {
+            // Keep what follows the name, minus the blanks around it.
+            while (n < len && cmd[n] == ' ') n++;
+            size_t arg_len = len - n < KCMD_LINE_MAX - 1 ? len - n : KCMD_LINE_MAX - 1;
+            memcpy(args, cmd + n, arg_len);
+            args[arg_len] = '\0';
+            commands[i].run();
+            return true;
+        }
+    }
+
+    serial_print("unknown command (try 'help')\n");
+    return false;
+}
+
+const char* kcmd_args(void) {
+    return args;
+}
+
+void kcmd_poll(void) {
+    int c;
+    while ((c = serial_try_getc()) >= 0) {
+        bool lf_after_cr = last_was_cr && c == '\n';
+        last_was_cr = c == '\r';
+        if (lf_after_cr) continue;
+
+        if (c == '\r' || c == '\n') {
+            serial_print("\n");
+            line[line_len] = '\0';
+            line_len = 0;
+            kcmd_execute(line);
+            serial_print("> ");
+        } else if ((c == '\b' || c == 0x7F) && line_len > 0) {
+            line_len--;
+            serial_print("\b \b");
+        } else if (c >= ' ' && c < 0x7F && line_len < KCMD_LINE_MAX - 1) {
+            line[line_len++] = (char)c;
+            serial_putc((char)c);
+        }
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <stdbool.h>
+
+/*
+ * kcmd.h — Kernel debug console on COM1.
+ *
+ * The idle loop calls kcmd_poll(), which reads whatever the host typed into
+ * the serial port (polled, no IRQ4), echoes it and runs a command when a line
+ * is complete.  Commands only print diagnostics; `help` lists them.  A
+ * command may be followed by arguments, separated by blanks; commands that
+ * take none ignore them.
+ */
+
+/* Consume pending serial input; runs at most one command per line. */
+void kcmd_poll(void);
+
+/* Run one command line. Returns false if the command is unknown. */
+bool kcmd_execute(const char* line);
+
+/* Arguments of the command being run: the rest of its line, trimmed. */
+const char* kcmd_args(void);
@@ -3,23 +3,55 @@
 #include "serial.h"
 #include "memory.h"
 #include "mmap.h"
+#include "module.h"
+#include "wad.h"
+#include "pmm.h"
+#include "ramfs.h"
+#include "pci.h"
+#include "virtio_blk.h"
+#include "virtio_console.h"
+#include "bcache.h"
+#include "speaker.h"
+#include "mixer.h"
+#include "sb16.h"
+#include "string.h"
+#include "smp.h"
+#include "jobs.h"
+#include "sched.h"
+#include "fpu.h"
+#include "vmm.h"
+#include "elf.h"
+#include "init.h"
 
 //IDT and Interrupt includes
+#include "gdt.h"
 #include "idt.h"
 #include "pic.h"
 #include "pit.h"
 #include "ps2.h"
+#include "ps2_mouse.h"
 #include "sleep.h"
+#include "defer.h"
+#include "tsc.h"
+#include "irqmon.h"
+#include "kcmd.h"
+#include "syscall.h"
+#include "vdata.h"
 #include "fb.h"
 #include "fb_console.h"
 
 // IRQ stubs from assembly
 extern void irq0_stub();
 extern void irq1_stub();
+extern void irq5_stub();
+extern void irq12_stub();
 
 // Keyboard driver
 extern void kbd_init();
 
+// Pages the idle loop zeroes per pass before it halts (~16 KiB)
+#define IDLE_PREZERO_PAGES 4
+
 #ifdef TESTING
 extern int run_tests(void);
 #endif
@@ -28,59 +60,417 @@ static inline void qemu_exit(uint32_t code) {
     __asm__ volatile ("outl %0, %1" : : "a"(code), "Nd"(0xF4));
 }
 
-void kernel_main(uint32_t mb_info_addr) {
-    serial_init();
+static struct multiboot_info* boot_mb;
 
-    struct multiboot_info* mb = (struct multiboot_info*)mb_info_addr;
+/* ---- Boot stages (init.h, docs/boot.md) ---- */
+
+static bool stage_serial(void) {
+    serial_init();
     serial_print("Kernel Booted\n");
+    return true;
+}
 
-    mmap_init(mb);
+// Our GDT first: it also points GS at the BSP's per-CPU block, which
+// cpu_id() reads from here on.
+static bool stage_gdt(void) {
+    gdt_init();
+    return true;
+}
+
+// Every vector starts at default_stub; exception handlers (#PF, #NM)
+// are installed by the stages that need them.
+static bool stage_idt(void) {
+    idt_init();
+    return true;
+}
+
+static bool stage_mmap(void) {
+    mmap_init(boot_mb);
+    return true;
+}
+
+static bool stage_modules(void) {
+    module_init(boot_mb);
+    return true;
+}
+
+static bool stage_memory(void) {
     memory_init();
+    return true;
+}
 
-#ifdef TESTING
-    serial_flush();
-    qemu_exit((uint32_t)run_tests());
-#else
-    serial_print("Memory subsystem initialized\n");
-    serial_print("Allocator base: ");
-    serial_print_hex(memory_base_address());
-    serial_print("\n");
-    serial_flush();
+static bool stage_pmm(void) {
+    pmm_init();
+    return true;
+}
 
-    idt_init();
+static bool stage_ramfs(void) {
+    ramfs_init();
+    return true;
+}
+
+static bool stage_jobs(void) {
+    jobs_init();
+    return true;
+}
+
+static bool stage_fpu(void) {
+    fpu_init();
+    return true;
+}
+
+// Without 4 MiB pages paging stays off; stages that need the window
+// check vmm_enabled() or get -EXO_ENODEV.
+static bool stage_vmm(void) {
+    vmm_init();
+    return true;
+}
+
+static bool stage_sched(void) {
+    sched_init();
+    return true;
+}
+
+#ifndef TESTING
+static bool stage_pci(void) {
+    pci_enumerate();
+    return true;
+}
+
+// Logs move to a virtio console when QEMU provides one. COM1 remains
+// the fallback, and console input is still read from it as well.
+static bool stage_vcon(void) {
+    if (!virtio_console_init()) return false;
+    serial_print("Serial: output continues on virtio-console\n");
+    serial_set_sink(virtio_console_sink());
+    serial_print("Kernel Booted (virtio-console)\n");
+    return true;
+}
+
+// Modules named "ramfs:<file>" in grub.cfg seed the RAM disk.
+static bool stage_seed(void) {
+    for (uint32_t i = 0; i < module_count(); i++) {
+        const module_t* m = module_get(i);
+        if (memcmp(m->name, "ramfs:", 6) != 0) continue;
+        ramfs_seed(m->name + 6, (const void*)m->start, m->end - m->start);
+    }
+    return true;
+}
+
+static bool stage_pic(void) {
     pic_remap();
+    return true;
+}
 
-    // IRQ0 vector 32 (timer)
-    idt_set_gate(32, (uint32_t)irq0_stub);
+// #NM gate: contexts get their FPU/SSE registers loaded on first use.
+static bool stage_lazy_fpu(void) {
+    fpu_enable_lazy();
+    serial_print(fpu_has_sse() ? "FPU: SSE, lazy context switching\n"
+                               : "FPU: no SSE/FXSR\n");
+    return true;
+}
 
-    // IRQ1 vector 33 (keyboard)
-    idt_set_gate(33, (uint32_t)irq1_stub);
+// int 0x80 gate (and SYSENTER MSRs when the CPU has them)
+static bool stage_syscall(void) {
+    syscall_init();
+    serial_print(syscall_has_sysenter() ? "Syscalls: int 0x80 + sysenter\n"
+                                        : "Syscalls: int 0x80\n");
+    return true;
+}
 
-    // Keyboard driver init for SCRUM-13/14 ring buffer + modifiers
+static bool stage_irq_gates(void) {
+    idt_set_gate(32, (uint32_t)irq0_stub);      // IRQ0: timer
+    idt_set_gate(33, (uint32_t)irq1_stub);      // IRQ1: keyboard
+    idt_set_gate(37, (uint32_t)irq5_stub);      // IRQ5: Sound Blaster 16
+    idt_set_gate(44, (uint32_t)irq12_stub);     // IRQ12: PS/2 mouse
+    return true;
+}
+
+// Keyboard driver init for SCRUM-13/14 ring buffer + modifiers
+static bool stage_kbd(void) {
     kbd_init();
+    return true;
+}
+
+// Mouse init polls the controller, so it runs before sti.
+static bool stage_mouse(void) {
+    if (!ps2_mouse_init()) {
+        serial_print("PS/2 mouse: not detected\n");
+        return false;
+    }
+    serial_print(ps2_mouse_has_wheel() ? "PS/2 mouse: IntelliMouse (wheel)\n"
+                                       : "PS/2 mouse: standard\n");
+    return true;
+}
+
+// Calibrate the TSC on PIT channel 2 before channel 0 starts ticking.
+static bool stage_tsc(void) {
+    tsc_calibrate();
+    serial_print("TSC: ");
+    serial_print_u32(tsc_khz());
+    serial_print(" kHz\n");
+    return true;
+}
+
+// Calibration borrowed PIT channel 2; hand it to the speaker, silent.
+static bool stage_speaker(void) {
+    speaker_init();
+    return true;
+}
 
-    pit_init(1000);   //1000hz
+// PCM output starts playing silence now; the first block-end IRQ is
+// taken after sti.
+static bool stage_sound(void) {
+    mixer_init();
+    if (!sb16_init()) {
+        serial_print("SB16: not detected, PCM voices disabled\n");
+        return false;
+    }
+    return true;
+}
+
+// The WAD stays where GRUB put it; only its lump index is allocated.
+static bool stage_wad(void) {
+    const module_t* wad_mod = module_find(".wad");
+    if (!wad_mod) return false;
+    if (!wad_init((const void*)wad_mod->start, wad_mod->end - wad_mod->start)) {
+        serial_print("WAD: invalid header or directory\n");
+        return false;
+    }
+    return true;
+}
+
+// A LibOS image is mapped, not copied: see elf.h.
+static elf_image_t libos_img;
+
+static bool stage_elf(void) {
+    const module_t* elf_mod = module_find(".elf");
+    if (!elf_mod) return false;
+    int32_t err = elf_load((const void*)elf_mod->start,
+                           elf_mod->end - elf_mod->start, &libos_img);
+    if (err != 0) {
+        serial_print("ELF: ");
+        serial_print(elf_mod->name);
+        serial_print(" not loaded, error ");
+        serial_print_u32((uint32_t)-err);
+        serial_print("\n");
+        return false;
+    }
+    return true;
+}
+
+// A virtio disk, if QEMU has one, persists the RAM disk. Files saved
+// there replace same-named seeds from the modules.
+static bool stage_disk(void) {
+    if (!virtio_blk_init()) return false;
+    bcache_init(virtio_blk_dev());
+    int32_t loaded = ramfs_load();
+    if (loaded >= 0) {
+        serial_print("ramfs: loaded ");
+        serial_print_u32((uint32_t)loaded);
+        serial_print(" files in ");
+        serial_print_u32(tsc_cycles_to_us(ramfs_stats()->load_cycles));
+        serial_print(" us\n");
+    } else {
+        serial_print("ramfs: no saved files on disk\n");
+    }
+    return true;
+}
+
+// Tell the IRQ monitor how many cycles one tick should take.
+static bool stage_timer(void) {
+    const uint32_t pit_hz = 1000;
+    pit_init(pit_hz);
+    irqmon_init((uint32_t)((uint64_t)tsc_khz() * 1000 / pit_hz));
+    vdata_init(pit_hz, tsc_khz());
     serial_print("Timer Initialized\n");
+    return true;
+}
 
-    __asm__ volatile ("sti");
+// The APs only speed up jobs, and starting each one waits 10 ms for
+// INIT, so they come up after boot. They need the TSC for those delays
+// and the IDT for wake IPIs.
+static bool stage_smp(void) {
+    uint32_t cpus = smp_init();
+    serial_print("SMP: ");
+    serial_print_u32(cpus);
+    serial_print(cpus == 1 ? " CPU online\n" : " CPUs online\n");
+    return true;
+}
 
-    serial_print("Interrupts Enabled\n");
+static bool stage_mem_report(void) {
+    mmap_dump();
+    serial_print("Allocator base: ");
+    serial_print_hex(memory_base_address());
+    serial_print("\n");
+    pmm_dump();
+    if (vmm_enabled()) {
+        serial_print("Paging: on, demand-zero window at ");
+        serial_print_hex(VMM_WINDOW_BASE);
+        serial_print("\n");
+    } else {
+        serial_print("Paging: off (no 4 MiB pages)\n");
+    }
+    return true;
+}
+
+static bool stage_sound_report(void) {
+    sb16_dump();
+    return true;
+}
+
+static bool stage_wad_report(void) {
+    wad_dump();
+    return true;
+}
+
+static bool stage_elf_report(void) {
+    elf_dump(&libos_img);
+    return true;
+}
 
-    //Sleep test case
+static bool stage_disk_report(void) {
+    virtio_blk_dump();
+    return true;
+}
+
+/* kernel_sleep_ms() in a context of its own, so nothing waits for it,
+   then the IRQ report for that second. */
+static void sleep_test(void* arg) {
+    (void)arg;
+    uint32_t start = kernel_get_ticks_ms();
     serial_print("Sleeping for 1 second...\n");
     kernel_sleep_ms(1000);
-    serial_print("Done sleeping!\n");
+    serial_print("Done sleeping! (");
+    serial_print_u32(kernel_get_ticks_ms() - start);
+    serial_print(" ms)\n");
+    irqmon_dump();
+}
+
+static bool stage_sleep_test(void) {
+    return sched_spawn("sleeptest", sleep_test, 0) >= 0;
+}
+
+static bool stage_boot_report(void) {
+    init_dump();
+    return true;
+}
+#endif
+
+enum {
+    STAGE_SERIAL, STAGE_GDT, STAGE_IDT, STAGE_MMAP, STAGE_MODULES,
+    STAGE_MEMORY, STAGE_PMM, STAGE_RAMFS, STAGE_JOBS, STAGE_FPU, STAGE_VMM,
+    STAGE_SCHED,
+#ifndef TESTING
+    STAGE_PCI, STAGE_VCON, STAGE_SEED, STAGE_PIC, STAGE_LAZY_FPU,
+    STAGE_SYSCALL, STAGE_IRQ_GATES, STAGE_KBD, STAGE_MOUSE, STAGE_TSC,
+    STAGE_SPEAKER, STAGE_SOUND, STAGE_WAD, STAGE_ELF, STAGE_DISK,
+    STAGE_TIMER,
+    // late
+    STAGE_SMP, STAGE_MEM_REPORT, STAGE_SOUND_REPORT, STAGE_WAD_REPORT,
+    STAGE_ELF_REPORT, STAGE_DISK_REPORT, STAGE_SLEEP_TEST,
+    STAGE_BOOT_REPORT,
+#endif
+    STAGE_COUNT
+};
+
+_Static_assert(STAGE_COUNT <= INIT_MAX_STAGES, "too many boot stages");
+
+#define B(stage) INIT_BIT(STAGE_##stage)
+
+/* Boot, in order unless a dependency says otherwise. Everything up to
+   the timer must be done before sti; the late stages run from the idle
+   loop once contexts can run. */
+static const init_stage_t boot_stages[STAGE_COUNT] = {
+    [STAGE_SERIAL]       = { "serial",      stage_serial,      0, 0 },
+    [STAGE_GDT]          = { "gdt",         stage_gdt,         0, 0 },
+    [STAGE_IDT]          = { "idt",         stage_idt,         B(GDT), 0 },
+    [STAGE_MMAP]         = { "mmap",        stage_mmap,        0, 0 },
+    [STAGE_MODULES]      = { "modules",     stage_modules,     B(MMAP), 0 },
+    [STAGE_MEMORY]       = { "memory",      stage_memory,      B(MODULES), 0 },
+    [STAGE_PMM]          = { "pmm",         stage_pmm,         B(MMAP) | B(MODULES) | B(MEMORY), 0 },
+    [STAGE_RAMFS]        = { "ramfs",       stage_ramfs,       B(PMM), 0 },
+    [STAGE_JOBS]         = { "jobs",        stage_jobs,        0, 0 },
+    [STAGE_FPU]          = { "fpu",         stage_fpu,         0, 0 },
+    [STAGE_VMM]          = { "vmm",         stage_vmm,         B(PMM) | B(IDT), 0 },
+    [STAGE_SCHED]        = { "sched",       stage_sched,       B(PMM) | B(FPU), 0 },
+#ifndef TESTING
+    [STAGE_PCI]          = { "pci",         stage_pci,         0, 0 },
+    [STAGE_VCON]         = { "vcon",        stage_vcon,        B(PCI) | B(SERIAL) | B(PMM), 0 },
+    [STAGE_SEED]         = { "ramfs-seed",  stage_seed,        B(RAMFS) | B(MODULES), 0 },
+    [STAGE_PIC]          = { "pic",         stage_pic,         0, 0 },
+    [STAGE_LAZY_FPU]     = { "lazy-fpu",    stage_lazy_fpu,    B(FPU) | B(IDT), 0 },
+    [STAGE_SYSCALL]      = { "syscall",     stage_syscall,     B(GDT) | B(IDT), 0 },
+    [STAGE_IRQ_GATES]    = { "irq-gates",   stage_irq_gates,   B(IDT) | B(PIC), 0 },
+    [STAGE_KBD]          = { "kbd",         stage_kbd,         B(IRQ_GATES), 0 },
+    [STAGE_MOUSE]        = { "mouse",       stage_mouse,       B(KBD), 0 },
+    [STAGE_TSC]          = { "tsc",         stage_tsc,         0, 0 },
+    [STAGE_SPEAKER]      = { "speaker",     stage_speaker,     B(TSC), 0 },
+    [STAGE_SOUND]        = { "sound",       stage_sound,       B(IRQ_GATES) | B(PMM) | B(TSC), 0 },
+    [STAGE_WAD]          = { "wad",         stage_wad,         B(MODULES) | B(PMM), 0 },
+    [STAGE_ELF]          = { "elf",         stage_elf,         B(MODULES) | B(VMM), 0 },
+    [STAGE_DISK]         = { "disk",        stage_disk,        B(PCI) | B(SEED) | B(TSC), 0 },
+    [STAGE_TIMER]        = { "timer",       stage_timer,       B(IRQ_GATES) | B(TSC) | B(SPEAKER), 0 },
+    [STAGE_SMP]          = { "smp",         stage_smp,         B(TSC) | B(IDT) | B(JOBS) | B(VMM), INIT_LATE },
+    [STAGE_MEM_REPORT]   = { "mem-report",  stage_mem_report,  B(PMM) | B(VMM), INIT_LATE },
+    [STAGE_SOUND_REPORT] = { "sound-report", stage_sound_report, B(SOUND), INIT_LATE },
+    [STAGE_WAD_REPORT]   = { "wad-report",  stage_wad_report,  B(WAD), INIT_LATE },
+    [STAGE_ELF_REPORT]   = { "elf-report",  stage_elf_report,  B(ELF), INIT_LATE },
+    [STAGE_DISK_REPORT]  = { "disk-report", stage_disk_report, B(DISK), INIT_LATE },
+    [STAGE_SLEEP_TEST]   = { "sleep-test",  stage_sleep_test,  B(TIMER) | B(SCHED), INIT_LATE },
+    // Needs nothing, so it runs even when a report above was skipped;
+    // late stages run in table order, so keep it last.
+    [STAGE_BOOT_REPORT]  = { "boot-report", stage_boot_report, 0, INIT_LATE },
+#endif
+};
 
-    //Print monotonic ms counter for 5 seconds then exit
-    uint32_t prints = 0;
+#undef B
+
+void kernel_main(uint32_t mb_info_addr) {
+    init_mark(INIT_MARK_ENTRY);
+    struct multiboot_info* mb = (struct multiboot_info*)mb_info_addr;
+    boot_mb = mb;
+
+    init_begin(boot_stages, STAGE_COUNT);
+    init_run_early();
+
+#ifdef TESTING
+    serial_flush();
+    qemu_exit((uint32_t)run_tests());
+#else
+    __asm__ volatile ("sti");
+    init_mark(INIT_MARK_STI);
+    serial_print("Interrupts Enabled\n");
+
+    init_mark(INIT_MARK_IDLE);
+    serial_print("Boot: idle after ");
+    serial_print_u32(tsc_cycles_to_us(init_mark_tsc(INIT_MARK_IDLE) -
+                                      init_mark_tsc(INIT_MARK_ENTRY)));
+    serial_print(" us; 'boot' prints the timeline\n");
+
+    // Idle loop: the PIT bottom half prints the ms counter once a second;
+    // anything the IRQ exits left behind is drained before halting. Serial
+    // input is polled here too (the next IRQ0 wakes us within 1 ms). File
+    // changes are written back to the disk at most once a second. Runnable
+    // contexts get the CPU before we halt.
+    serial_print("kcmd: type 'help' on the serial console\n> ");
+    uint32_t last_sync = kernel_get_ticks_ms();
     while (1) {
-        if (pit_take_print_pending()) {
-            serial_print("ms: ");
-            serial_print_u32(kernel_get_ticks_ms());
-            serial_print("\n");
-            prints++;
+        defer_run();
+        vmm_sync();
+        kcmd_poll();
+        if (bcache_dev() && kernel_get_ticks_ms() - last_sync >= 1000) {
+            last_sync = kernel_get_ticks_ms();
+            ramfs_sync();
+        }
+        // Contexts run first, then at most one deferred boot stage. With
+        // nothing left of either, zero a few pages for
+        // alloc_zeroed_page() before halting. Each batch is a few
+        // microseconds, so input and IRQs are still seen promptly.
+        bool ran = sched_yield();
+        if (!init_run_late() && !ran && !pmm_prezero(IDLE_PREZERO_PAGES)) {
+            __asm__ volatile ("hlt");
         }
-        __asm__ volatile ("hlt");
     }
     // qemu_exit(0); // keep running for keyboard tests
 
@@ -16,7 +16,7 @@
 
 /* ---- Capacity limits --------------------------------------------------- */
 /* Increase these if you hit the suite or per-suite test ceiling at link time. */
-#define KUNIT_MAX_SUITES          16
+#define KUNIT_MAX_SUITES          32
 #define KUNIT_MAX_TESTS_PER_SUITE 64
 #define KUNIT_NAME_LEN            64
 
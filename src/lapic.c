@@ -0,0 +1,87 @@
+#include "lapic.h"
+#include "cpu.h"
+#include "smp.h"
+
+#define MSR_APIC_BASE      0x1B
+#define APIC_BASE_ENABLE   (1u << 11)
+#define CPUID_EDX_APIC     (1u << 9)
+
+#define LAPIC_ID           0x020
+#define LAPIC_TPR          0x080
+#define LAPIC_EOI          0x0B0
+#define LAPIC_SVR          0x0F0
+#define LAPIC_ICR_LOW      0x300
+#define LAPIC_ICR_HIGH     0x310
+
+#define SVR_ENABLE         (1u << 8)
+#define ICR_FIXED          (0u << 8)
+#define ICR_INIT           (5u << 8)
+#define ICR_STARTUP        (6u << 8)
+#define ICR_PENDING        (1u << 12)
+#define ICR_ASSERT         (1u << 14)
+#define ICR_ALL_BUT_SELF   (3u << 18)
+
+static volatile uint32_t* base = 0;
+
+static inline uint32_t rd(uint32_t reg) {
+    return base[reg / 4];
+}
+
+static inline void wr(uint32_t reg, uint32_t v) {
+    base[reg / 4] = v;
+}
+
+static void icr_send(uint8_t apic_id, uint32_t low) {
+    while (rd(LAPIC_ICR_LOW) & ICR_PENDING) cpu_pause();
+    wr(LAPIC_ICR_HIGH, (uint32_t)apic_id << 24);
+    wr(LAPIC_ICR_LOW, low);
+    while (rd(LAPIC_ICR_LOW) & ICR_PENDING) cpu_pause();
+}
+
+bool lapic_init(void) {
+    uint32_t a, b, c, d;
+    cpuid(1, &a, &b, &c, &d);
+    if (!(d & CPUID_EDX_APIC)) return false;
+
+    // Identity mapped: the MSR's physical base is usable as is.
+    uint64_t msr = rdmsr(MSR_APIC_BASE);
+    wrmsr(MSR_APIC_BASE, msr | APIC_BASE_ENABLE);
+    base = (volatile uint32_t*)(uint32_t)(msr & 0xFFFFF000u);
+
+    wr(LAPIC_TPR, 0);
+    wr(LAPIC_SVR, SVR_ENABLE | LAPIC_SPURIOUS);
+    return true;
+}
+
+bool lapic_present(void) {
+    return base != 0;
+}
+
+uint8_t lapic_id(void) {
+    return (uint8_t)(rd(LAPIC_ID) >> 24);
+}
+
+void lapic_eoi(void) {
+    wr(LAPIC_EOI, 0);
+}
+
+void lapic_send_ipi(uint8_t apic_id, uint8_t vector) {
+    icr_send(apic_id, ICR_FIXED | ICR_ASSERT | vector);
+}
+
+void lapic_send_ipi_others(uint8_t vector) {
+    icr_send(0, ICR_FIXED | ICR_ASSERT | ICR_ALL_BUT_SELF | vector);
+}
+
+void lapic_send_init(uint8_t apic_id) {
+    icr_send(apic_id, ICR_INIT | ICR_ASSERT);
+}
+
+void lapic_send_startup(uint8_t apic_id, uint8_t vector) {
+    icr_send(apic_id, ICR_STARTUP | vector);
+}
+
+void ipi_wake_handler(void) {
+    this_cpu()->ipis++;
+    lapic_eoi();
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * lapic.h — Local APIC: identification, EOI and inter-processor
+ * interrupts.  Device IRQs still come through the 8259 PIC on the BSP;
+ * the local APIC is only used to start and wake the other CPUs.
+ */
+
+#define IPI_WAKE_VECTOR   0xF0     // wake an idle CPU to look for jobs
+#define LAPIC_SPURIOUS    0xFF
+
+/* Locate (IA32_APIC_BASE) and software-enable this CPU's local APIC.
+   Returns false if CPUID reports none. Run on every CPU. */
+bool lapic_init(void);
+
+bool lapic_present(void);
+
+/* This CPU's APIC ID. */
+uint8_t lapic_id(void);
+
+void lapic_eoi(void);
+
+/* Fixed-vector IPI to one CPU, or to every CPU but this one. */
+void lapic_send_ipi(uint8_t apic_id, uint8_t vector);
+void lapic_send_ipi_others(uint8_t vector);
+
+/* INIT, and STARTUP at physical page `vector` * 4 KiB, for AP bring-up. */
+void lapic_send_init(uint8_t apic_id);
+void lapic_send_startup(uint8_t apic_id, uint8_t vector);
+
+/* IPI_WAKE_VECTOR handler: count and acknowledge. */
+void ipi_wake_handler(void);
@@ -1,4 +1,5 @@
 #include "memory.h"
+#include "pmm.h"
 
 extern char _bss_end;
 
@@ -14,6 +15,11 @@ void memory_init(void) {
 }
 
 void* kmalloc(size_t size) {
+    // Once the page allocator owns free memory the bump pool is closed.
+    if (pmm_ready()) {
+        return alloc_pages((size + PAGE_SIZE - 1) / PAGE_SIZE);
+    }
+
     if (placement_address == 0) {
         memory_init();
     }
@@ -23,6 +29,15 @@ void* kmalloc(size_t size) {
     return (void*)addr;
 }
 
+void memory_reserve(uintptr_t end) {
+    if (placement_address == 0) {
+        memory_init();
+    }
+    if (end > placement_address) {
+        placement_address = align_up(end, 0x1000);
+    }
+}
+
 uint32_t memory_base_address(void) {
     return (uint32_t)placement_address;
 }
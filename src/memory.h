@@ -8,4 +8,8 @@ void memory_init(void);
 void* kmalloc(size_t size);
 uint32_t memory_base_address(void);
 
+/* Move the bump pointer past `end` (e.g. a multiboot module GRUB placed
+   after the kernel image) so kmalloc never hands it out. */
+void memory_reserve(uintptr_t end);
+
 #endif
@@ -0,0 +1,253 @@
+#include "mixer.h"
+#include "cpu.h"
+#include "fpu.h"
+#include "serial.h"
+#include "string.h"
+#include "tsc.h"
+
+_Static_assert(EXO_PCM_CHANNELS <= 32, "active mask is 32 bits");
+_Static_assert(MIXER_MAX_RATE < 65536, "rate << 16 must fit in 32 bits");
+
+typedef int16_t v8hi __attribute__((vector_size(16)));
+
+typedef struct {
+    const uint8_t* data;
+    uint32_t len;             // samples
+    uint32_t idx;             // current sample
+    uint32_t frac;            // 16-bit fraction between idx and idx + 1
+    uint32_t step;            // 16.16 source samples per output frame
+    uint32_t rate;
+    uint8_t  vol;
+    uint8_t  sep;
+    int32_t  gain_l;          // 0-254, applied as s * gain >> 8
+    int32_t  gain_r;
+} voice_t;
+
+static voice_t voices[EXO_PCM_CHANNELS];
+static uint32_t active = 0;
+static bool sse2 = false;
+static mixer_stats_t stats;
+
+static int16_t scratch[MIXER_MAX_FRAMES * 2] __attribute__((aligned(16)));
+
+/* Doom's panning law (addsfx in linuxdoom's i_sound.c): each side loses
+   volume with the square of its distance from `sep`, so a centred sound
+   plays at 3/4 volume on both sides. Doubled onto the 0-254 gain scale. */
+static void set_gains(voice_t* v, uint32_t vol, uint32_t sep) {
+    int32_t l = (int32_t)sep + 1;
+    int32_t r = l - 257;
+
+    v->vol = (uint8_t)vol;
+    v->sep = (uint8_t)sep;
+    v->gain_l = 2 * ((int32_t)vol - (((int32_t)vol * l * l) >> 16));
+    v->gain_r = 2 * ((int32_t)vol - (((int32_t)vol * r * r) >> 16));
+}
+
+/* Resample, pan and write one voice into `out`. The tail past the last
+   sample is zeroed. Returns false once the voice has run out. */
+static bool render_voice(voice_t* v, int16_t* out, uint32_t frames) {
+    const uint8_t* d = v->data;
+    uint32_t last = v->len - 1;
+    uint32_t idx = v->idx, frac = v->frac;
+    uint32_t i = 0;
+
+    for (; i < frames && idx <= last; i++) {
+        int32_t s0 = ((int32_t)d[idx] - 128) * 256;
+        int32_t s1 = idx < last ? ((int32_t)d[idx + 1] - 128) * 256 : s0;
+        int32_t s = s0 + (((s1 - s0) * (int32_t)(frac >> 1)) >> 15);
+        out[2 * i]     = (int16_t)((s * v->gain_l) >> 8);
+        out[2 * i + 1] = (int16_t)((s * v->gain_r) >> 8);
+
+        frac += v->step & 0xFFFF;
+        idx += (v->step >> 16) + (frac >> 16);
+        frac &= 0xFFFF;
+    }
+    if (i < frames) {
+        memset(out + 2 * i, 0, (frames - i) * 2 * sizeof(int16_t));
+    }
+
+    v->idx = idx;
+    v->frac = frac;
+    return idx <= last;
+}
+
+__attribute__((target("sse2"), noinline))
+static void add_sse2(int16_t* dst, const int16_t* src, uint32_t n) {
+    v8hi* d = (v8hi*)dst;
+    const v8hi* s = (const v8hi*)src;
+    for (uint32_t i = 0; i < n / 8; i++) {
+        d[i] = __builtin_ia32_paddsw128(d[i], s[i]);
+    }
+}
+
+static void add_scalar(int16_t* dst, const int16_t* src, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        int32_t s = dst[i] + src[i];
+        if (s > INT16_MAX) s = INT16_MAX;
+        if (s < INT16_MIN) s = INT16_MIN;
+        dst[i] = (int16_t)s;
+    }
+}
+
+void mixer_init(void) {
+    uint32_t flags = irq_save();
+    memset(voices, 0, sizeof(voices));
+    memset(&stats, 0, sizeof(stats));
+    active = 0;
+    irq_restore(flags);
+
+    sse2 = fpu_has_sse();
+}
+
+bool mixer_has_sse2(void) {
+    return sse2;
+}
+
+int32_t mixer_play(uint32_t channel, const uint8_t* data, uint32_t len,
+                   uint32_t rate, uint32_t vol, uint32_t sep) {
+    if (channel >= EXO_PCM_CHANNELS || !data || len == 0 || rate == 0 ||
+        rate > MIXER_MAX_RATE || vol > EXO_PCM_MAX_VOL || sep > 254) {
+        return -EXO_EINVAL;
+    }
+
+    uint32_t flags = irq_save();
+    voice_t* v = &voices[channel];
+    v->data = data;
+    v->len = len;
+    v->idx = 0;
+    v->frac = 0;
+    v->rate = rate;
+    v->step = (rate << 16) / MIXER_RATE;
+    set_gains(v, vol, sep);
+    active |= 1u << channel;
+    stats.started++;
+    irq_restore(flags);
+    return 0;
+}
+
+int32_t mixer_update(uint32_t channel, uint32_t vol, uint32_t sep) {
+    if (channel >= EXO_PCM_CHANNELS || vol > EXO_PCM_MAX_VOL || sep > 254) {
+        return -EXO_EINVAL;
+    }
+
+    uint32_t flags = irq_save();
+    int32_t playing = (active >> channel) & 1;
+    if (playing) set_gains(&voices[channel], vol, sep);
+    irq_restore(flags);
+    return playing;
+}
+
+int32_t mixer_stop(uint32_t channel) {
+    if (channel != EXO_SOUND_ALL && channel >= EXO_PCM_CHANNELS) {
+        return -EXO_EINVAL;
+    }
+
+    uint32_t flags = irq_save();
+    active &= channel == EXO_SOUND_ALL ? 0 : ~(1u << channel);
+    irq_restore(flags);
+    return 0;
+}
+
+void mixer_add_saturate(int16_t* dst, const int16_t* src, uint32_t n,
+                        bool simd) {
+    if (simd && sse2) {
+        uint32_t flags = kernel_fpu_begin();
+        add_sse2(dst, src, n);
+        kernel_fpu_end(flags);
+    } else {
+        add_scalar(dst, src, n);
+    }
+}
+
+void mixer_render(int16_t* out, uint32_t frames) {
+    if (frames > MIXER_MAX_FRAMES) frames = MIXER_MAX_FRAMES;
+    frames &= ~3u;                    // whole 16-byte vectors
+    uint32_t n = frames * 2;
+
+    uint32_t flags = sse2 ? kernel_fpu_begin() : irq_save();
+    uint64_t start = rdtsc();
+
+    memset(out, 0, n * sizeof(int16_t));
+    for (uint32_t ch = 0; ch < EXO_PCM_CHANNELS; ch++) {
+        if (!(active & (1u << ch))) continue;
+        if (!render_voice(&voices[ch], scratch, frames)) {
+            active &= ~(1u << ch);
+            stats.finished++;
+        }
+        if (sse2) {
+            add_sse2(out, scratch, n);
+        } else {
+            add_scalar(out, scratch, n);
+        }
+    }
+
+    uint32_t cycles = (uint32_t)(rdtsc() - start);
+    stats.renders++;
+    stats.frames += frames;
+    stats.cycles += cycles;
+    if (cycles > stats.max_cycles) stats.max_cycles = cycles;
+    if (sse2) kernel_fpu_end(flags);
+    else irq_restore(flags);
+}
+
+uint32_t mixer_active(void) {
+    return active;
+}
+
+const mixer_stats_t* mixer_stats(void) {
+    return &stats;
+}
+
+void mixer_dump(void) {
+    serial_print("mixer: ");
+    serial_print_u32(MIXER_RATE);
+    serial_print(" Hz stereo, ");
+    serial_print(sse2 ? "SSE2 adds\n" : "scalar adds\n");
+
+    for (uint32_t ch = 0; ch < EXO_PCM_CHANNELS; ch++) {
+        if (!(active & (1u << ch))) continue;
+        const voice_t* v = &voices[ch];
+        serial_print("  voice ");
+        serial_print_u32(ch);
+        serial_print(": ");
+        serial_print_u32(v->idx);
+        serial_print("/");
+        serial_print_u32(v->len);
+        serial_print(" @");
+        serial_print_u32(v->rate);
+        serial_print("Hz vol=");
+        serial_print_u32(v->vol);
+        serial_print(" sep=");
+        serial_print_u32(v->sep);
+        serial_print("\n");
+    }
+
+    serial_print("  started=");
+    serial_print_u32(stats.started);
+    serial_print(" finished=");
+    serial_print_u32(stats.finished);
+    serial_print(" renders=");
+    serial_print_u32(stats.renders);
+    serial_print("\n");
+    if (stats.renders == 0) return;
+
+    serial_print("  cost: avg=");
+    serial_print_u32((uint32_t)(stats.cycles / stats.renders));
+    serial_print("cyc max=");
+    serial_print_u32(stats.max_cycles);
+    serial_print("cyc per block");
+
+    // Mixing time as a share of the audio it produced, in 1/100 %.
+    uint64_t audio_us = stats.frames * 1000000 / MIXER_RATE;
+    uint32_t cost_us = tsc_cycles_to_us(stats.cycles);
+    if (audio_us != 0 && tsc_khz() != 0) {
+        uint32_t load = (uint32_t)((uint64_t)cost_us * 10000 / audio_us);
+        serial_print(", load=");
+        serial_print_u32(load / 100);
+        serial_print(".");
+        serial_putc((char)('0' + load / 10 % 10));
+        serial_putc((char)('0' + load % 10));
+        serial_print("%");
+    }
+    serial_print("\n");
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "exo_sound.h"
+
+/*
+ * mixer.h — Software PCM mixer behind the exo_pcm_* calls (exo_sound.h).
+ *
+ * EXO_PCM_CHANNELS voices play unsigned 8-bit mono samples (Doom's SFX
+ * lumps, normally 11025 Hz) at any rate.  mixer_render() resamples each
+ * voice to MIXER_RATE with linear interpolation, pans it into signed
+ * 16-bit stereo and adds it to the output block with saturating adds.
+ * When the CPU has SSE2 the adds run eight samples at a time (PADDSW),
+ * inside a kernel_fpu_begin() section; otherwise a scalar loop with the
+ * same clamping is used.
+ *
+ * Voices point at the caller's samples, which must stay put until the
+ * voice ends or is stopped.  The output driver calls mixer_render() from
+ * its interrupt; the play/update/stop calls disable interrupts around
+ * their updates.
+ */
+
+#define MIXER_RATE       22050      // output frames per second
+#define MIXER_MAX_FRAMES 1024       // largest mixer_render() block
+#define MIXER_MAX_RATE   48000      // highest voice sample rate
+
+typedef struct {
+    uint32_t started;         // voices started
+    uint32_t finished;        // voices that ran to their last sample
+    uint32_t renders;         // mixer_render() calls
+    uint64_t frames;          // frames rendered
+    uint64_t cycles;          // TSC cycles spent rendering
+    uint32_t max_cycles;      // slowest single render
+} mixer_stats_t;
+
+/* Stop every voice; use SSE2 if fpu_init() enabled it. */
+void mixer_init(void);
+
+/* True when mixer_render() uses the SSE2 path. */
+bool mixer_has_sse2(void);
+
+/* Start `len` samples at `rate` Hz on `channel`, replacing what it was
+   playing. `vol` is 0-127; `sep` pans from 0 (left) through 128 (centre)
+   to 254 (right). Returns 0 or -EXO_EINVAL. */
+int32_t mixer_play(uint32_t channel, const uint8_t* data, uint32_t len,
+                   uint32_t rate, uint32_t vol, uint32_t sep);
+
+/* Change the volume and panning of a playing voice. Returns 1 while the
+   voice is playing, 0 once it has finished, or -EXO_EINVAL. */
+int32_t mixer_update(uint32_t channel, uint32_t vol, uint32_t sep);
+
+/* Silence `channel`, or every channel with EXO_SOUND_ALL. */
+int32_t mixer_stop(uint32_t channel);
+
+/* Mix `frames` (a multiple of 4, at most MIXER_MAX_FRAMES) interleaved
+   stereo frames into `out`, which must be 16-byte aligned. Voices advance
+   by `frames`. The caller's XMM state is preserved. */
+void mixer_render(int16_t* out, uint32_t frames);
+
+/* dst[i] = clamp(dst[i] + src[i]) for `n` samples (a multiple of 8, both
+   16-byte aligned), using SSE2 when `simd` is set and the CPU allows.
+   This is the inner step of mixer_render(), exposed for tests. */
+void mixer_add_saturate(int16_t* dst, const int16_t* src, uint32_t n,
+                        bool simd);
+
+/* Bit n set while voice n is playing. */
+uint32_t mixer_active(void);
+
+const mixer_stats_t* mixer_stats(void);
+
+/* Print the voices and the render cost over serial. */
+void mixer_dump(void);
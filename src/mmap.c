@@ -19,13 +19,10 @@ static const char* region_type_name(uint32_t type) {
 
 void mmap_init(struct multiboot_info* mb) {
     if (!(mb->flags & MULTIBOOT_INFO_FLAG_MMAP)) {
-        serial_print("No multiboot mmap available\n");
         region_count = 0;
         return;
     }
 
-    serial_print("Multiboot memory map:\n");
-
     uintptr_t cur = (uintptr_t)mb->mmap_addr;
     uintptr_t end = cur + mb->mmap_length;
 
@@ -39,21 +36,31 @@ void mmap_init(struct multiboot_info* mb) {
         regions[region_count].length = entry->len;
         regions[region_count].type = entry->type;
 
+        region_count++;
+        cur += entry->size + sizeof(entry->size);
+    }
+}
+
+void mmap_dump(void) {
+    if (region_count == 0) {
+        serial_print("No multiboot mmap available\n");
+        return;
+    }
+
+    serial_print("Multiboot memory map:\n");
+    for (uint32_t i = 0; i < region_count; i++) {
         serial_print(" base=0x");
-        serial_print_hex64(entry->addr);
+        serial_print_hex64(regions[i].base);
 
         serial_print(" len=0x");
-        serial_print_hex64(entry->len);
+        serial_print_hex64(regions[i].length);
 
         serial_print(" type=");
-        serial_print_dec(entry->type);
+        serial_print_dec(regions[i].type);
 
         serial_print(" ");
-        serial_print(region_type_name(entry->type));
+        serial_print(region_type_name(regions[i].type));
         serial_print("\n");
-
-        region_count++;
-        cur += entry->size + sizeof(entry->size);
     }
 }
 
@@ -12,7 +12,10 @@ typedef struct {
     uint32_t type;
 } mmap_region_t;
 
+/* Record the multiboot memory map. Prints nothing: at 38400 baud the
+   listing costs milliseconds, so boot defers it to mmap_dump(). */
 void mmap_init(struct multiboot_info* mb);
+void mmap_dump(void);
 const mmap_region_t* mmap_get_regions(uint32_t* count);
 
 #endif
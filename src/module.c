@@ -0,0 +1,58 @@
+#include "module.h"
+#include "memory.h"
+#include "serial.h"
+#include "string.h"
+
+static module_t modules[MAX_MODULES];
+static uint32_t count = 0;
+
+void module_init(struct multiboot_info* mb) {
+    count = 0;
+    if (!(mb->flags & MULTIBOOT_INFO_FLAG_MODS)) return;
+
+    const struct multiboot_module* mods =
+        (const struct multiboot_module*)mb->mods_addr;
+
+    for (uint32_t i = 0; i < mb->mods_count && count < MAX_MODULES; i++) {
+        module_t* m = &modules[count++];
+        m->start = mods[i].mod_start;
+        m->end = mods[i].mod_end;
+
+        // The command line lives in GRUB-owned memory; keep a copy.
+        const char* cmdline = (const char*)mods[i].cmdline;
+        m->name[0] = '\0';
+        if (cmdline) {
+            strncpy(m->name, cmdline, MODULE_NAME_MAX - 1);
+            m->name[MODULE_NAME_MAX - 1] = '\0';
+        }
+
+        memory_reserve(m->end);
+
+        serial_print("Module ");
+        serial_print(m->name);
+        serial_print(" at 0x");
+        serial_print_hex(m->start);
+        serial_print(" size ");
+        serial_print_u32(m->end - m->start);
+        serial_print("\n");
+    }
+}
+
+uint32_t module_count(void) {
+    return count;
+}
+
+const module_t* module_get(uint32_t index) {
+    return index < count ? &modules[index] : 0;
+}
+
+const module_t* module_find(const char* suffix) {
+    size_t slen = strlen(suffix);
+    for (uint32_t i = 0; i < count; i++) {
+        size_t nlen = strlen(modules[i].name);
+        if (nlen >= slen && strcmp(modules[i].name + nlen - slen, suffix) == 0) {
+            return &modules[i];
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include "multiboot.h"
+
+/*
+ * module.h — Multiboot modules (files GRUB loaded next to the kernel).
+ *
+ * GRUB's `module` command places each file in physical memory before the
+ * kernel runs. module_init() records where, and reserves the ranges in the
+ * bump allocator so early allocations cannot land on top of them.
+ */
+
+#define MAX_MODULES 8
+#define MODULE_NAME_MAX 32
+
+typedef struct {
+    uint32_t start;                  // physical address of the first byte
+    uint32_t end;                    // one past the last byte
+    char name[MODULE_NAME_MAX];      // GRUB command line, truncated
+} module_t;
+
+/* Call after mmap_init() and before the first kmalloc(). */
+void module_init(struct multiboot_info* mb);
+
+uint32_t module_count(void);
+const module_t* module_get(uint32_t index);
+
+/* First module whose name ends in `suffix` (e.g. ".wad"), or NULL. */
+const module_t* module_find(const char* suffix);
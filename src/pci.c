@@ -0,0 +1,132 @@
+#include "pci.h"
+#include "io.h"
+#include "serial.h"
+
+#define PCI_CONFIG_ADDRESS 0xCF8
+#define PCI_CONFIG_DATA    0xCFC
+
+static pci_device_t devices[PCI_MAX_DEVICES];
+static uint32_t count = 0;
+
+static void select_reg(uint8_t bus, uint8_t dev, uint8_t func, uint8_t off) {
+    outl(PCI_CONFIG_ADDRESS, 0x80000000u | (uint32_t)bus << 16
+         | (uint32_t)(dev & 0x1F) << 11 | (uint32_t)(func & 7) << 8
+         | (off & 0xFC));
+}
+
+uint32_t pci_read32(uint8_t bus, uint8_t dev, uint8_t func, uint8_t off) {
+    select_reg(bus, dev, func, off);
+    return inl(PCI_CONFIG_DATA);
+}
+
+uint16_t pci_read16(uint8_t bus, uint8_t dev, uint8_t func, uint8_t off) {
+    select_reg(bus, dev, func, off);
+    return inw(PCI_CONFIG_DATA + (off & 2));
+}
+
+void pci_write32(uint8_t bus, uint8_t dev, uint8_t func, uint8_t off,
+                 uint32_t val) {
+    select_reg(bus, dev, func, off);
+    outl(PCI_CONFIG_DATA, val);
+}
+
+void pci_write16(uint8_t bus, uint8_t dev, uint8_t func, uint8_t off,
+                 uint16_t val) {
+    select_reg(bus, dev, func, off);
+    outw(PCI_CONFIG_DATA + (off & 2), val);
+}
+
+static void add_function(uint8_t bus, uint8_t dev, uint8_t func,
+                         uint32_t id) {
+    if (count == PCI_MAX_DEVICES) return;
+
+    pci_device_t* d = &devices[count++];
+    uint32_t class_reg = pci_read32(bus, dev, func, PCI_REG_CLASS);
+    d->bus = bus;
+    d->dev = dev;
+    d->func = func;
+    d->vendor = (uint16_t)id;
+    d->device = (uint16_t)(id >> 16);
+    d->subsystem = (uint16_t)(pci_read32(bus, dev, func, PCI_REG_SUBSYSTEM) >> 16);
+    d->class_code = (uint8_t)(class_reg >> 24);
+    d->subclass = (uint8_t)(class_reg >> 16);
+    d->prog_if = (uint8_t)(class_reg >> 8);
+    d->irq_line = (uint8_t)pci_read32(bus, dev, func, PCI_REG_IRQ_LINE);
+    for (uint8_t i = 0; i < 6; i++) {
+        d->bars[i] = pci_read32(bus, dev, func, PCI_REG_BAR0 + i * 4);
+    }
+}
+
+uint32_t pci_enumerate(void) {
+    count = 0;
+    // A brute-force scan is 8192 dword reads; cheap enough to do once at
+    // boot, and it also finds devices behind bridges the firmware set up.
+    for (uint32_t bus = 0; bus < 256; bus++) {
+        for (uint8_t dev = 0; dev < 32; dev++) {
+            uint32_t id = pci_read32((uint8_t)bus, dev, 0, PCI_REG_VENDOR);
+            if ((id & 0xFFFF) == 0xFFFF) continue;
+            add_function((uint8_t)bus, dev, 0, id);
+
+            uint32_t header = pci_read32((uint8_t)bus, dev, 0, PCI_REG_HEADER);
+            if (!(header & (1u << 23))) continue;
+            for (uint8_t func = 1; func < 8; func++) {
+                id = pci_read32((uint8_t)bus, dev, func, PCI_REG_VENDOR);
+                if ((id & 0xFFFF) != 0xFFFF) add_function((uint8_t)bus, dev, func, id);
+            }
+        }
+    }
+    return count;
+}
+
+uint32_t pci_count(void) {
+    return count;
+}
+
+const pci_device_t* pci_get(uint32_t index) {
+    return index < count ? &devices[index] : 0;
+}
+
+const pci_device_t* pci_find(uint16_t vendor, uint16_t device) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (devices[i].vendor == vendor && devices[i].device == device) {
+            return &devices[i];
+        }
+    }
+    return 0;
+}
+
+void pci_enable(const pci_device_t* d, uint16_t cmd_bits) {
+    uint16_t cmd = pci_read16(d->bus, d->dev, d->func, PCI_REG_COMMAND);
+    pci_write16(d->bus, d->dev, d->func, PCI_REG_COMMAND, cmd | cmd_bits);
+}
+
+uint16_t pci_bar_io(const pci_device_t* d, uint32_t bar) {
+    if (bar >= 6 || !(d->bars[bar] & PCI_BAR_IO)) return 0;
+    return (uint16_t)(d->bars[bar] & ~3u);
+}
+
+void pci_dump(void) {
+    serial_print("PCI: ");
+    serial_print_u32(count);
+    serial_print(" functions\n");
+    for (uint32_t i = 0; i < count; i++) {
+        const pci_device_t* d = &devices[i];
+        serial_print("  ");
+        serial_print_u32(d->bus);
+        serial_print(":");
+        serial_print_u32(d->dev);
+        serial_print(".");
+        serial_print_u32(d->func);
+        serial_print(" id=");
+        serial_print_hex(d->vendor);
+        serial_print(":");
+        serial_print_hex(d->device);
+        serial_print(" class=");
+        serial_print_hex(d->class_code);
+        serial_print("/");
+        serial_print_hex(d->subclass);
+        serial_print(" irq=");
+        serial_print_u32(d->irq_line);
+        serial_print("\n");
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * pci.h — PCI configuration space (mechanism #1, ports 0xCF8/0xCFC).
+ *
+ * pci_enumerate() walks every bus/device/function once at boot and keeps
+ * a small table of what it found.  Drivers look their device up by vendor
+ * and device ID instead of probing configuration space themselves.
+ */
+
+#define PCI_MAX_DEVICES 32
+
+#define PCI_REG_VENDOR     0x00
+#define PCI_REG_COMMAND    0x04
+#define PCI_REG_CLASS      0x08   // revision, prog_if, subclass, class
+#define PCI_REG_HEADER     0x0C   // bit 23 of the dword: multifunction
+#define PCI_REG_BAR0       0x10
+#define PCI_REG_SUBSYSTEM  0x2C
+#define PCI_REG_IRQ_LINE   0x3C
+
+#define PCI_CMD_IO         (1u << 0)
+#define PCI_CMD_MEMORY     (1u << 1)
+#define PCI_CMD_BUS_MASTER (1u << 2)
+
+#define PCI_BAR_IO         1u     // bit 0 of a BAR: I/O space
+
+typedef struct {
+    uint8_t  bus;
+    uint8_t  dev;
+    uint8_t  func;
+    uint8_t  irq_line;
+    uint16_t vendor;
+    uint16_t device;
+    uint16_t subsystem;           // subsystem ID (virtio: device type)
+    uint8_t  class_code;
+    uint8_t  subclass;
+    uint8_t  prog_if;
+    uint32_t bars[6];             // raw BAR values
+} pci_device_t;
+
+uint32_t pci_read32(uint8_t bus, uint8_t dev, uint8_t func, uint8_t off);
+uint16_t pci_read16(uint8_t bus, uint8_t dev, uint8_t func, uint8_t off);
+void pci_write32(uint8_t bus, uint8_t dev, uint8_t func, uint8_t off,
+                 uint32_t val);
+void pci_write16(uint8_t bus, uint8_t dev, uint8_t func, uint8_t off,
+                 uint16_t val);
+
+/* Scan every bus and fill the device table. Returns the device count. */
+uint32_t pci_enumerate(void);
+
+uint32_t pci_count(void);
+const pci_device_t* pci_get(uint32_t index);
+
+/* First device with this vendor and device ID, or NULL. */
+const pci_device_t* pci_find(uint16_t vendor, uint16_t device);
+
+/* Set bits in the command register (e.g. PCI_CMD_IO | PCI_CMD_BUS_MASTER). */
+void pci_enable(const pci_device_t* d, uint16_t cmd_bits);
+
+/* I/O port base of BAR `bar`, or 0 if it is not an I/O BAR. */
+uint16_t pci_bar_io(const pci_device_t* d, uint32_t bar);
+
+/* Print the device table over serial (console: lspci). */
+void pci_dump(void);
@@ -44,3 +44,19 @@ void pic_send_EOI(unsigned char irq) {
 
     outb(PIC1_COMMAND, 0x20);
 }
+
+void pic_unmask(uint8_t irq) {
+    if (irq >= 8) {
+        outb(PIC2_DATA, inb(PIC2_DATA) & ~(1 << (irq - 8)));
+        irq = 2;    // slave IRQs also need the cascade line open
+    }
+    outb(PIC1_DATA, inb(PIC1_DATA) & ~(1 << irq));
+}
+
+void pic_mask(uint8_t irq) {
+    if (irq >= 8) {
+        outb(PIC2_DATA, inb(PIC2_DATA) | (1 << (irq - 8)));
+    } else {
+        outb(PIC1_DATA, inb(PIC1_DATA) | (1 << irq));
+    }
+}
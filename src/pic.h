@@ -3,3 +3,8 @@
 
 void pic_remap();
 void pic_send_EOI(unsigned char irq);
+
+/* Allow / suppress one IRQ line (0-15). Unmasking a slave IRQ also unmasks
+   the cascade (IRQ2) on the master. */
+void pic_unmask(uint8_t irq);
+void pic_mask(uint8_t irq);
@@ -1,10 +1,16 @@
 #include "pit.h"
 #include "io.h"
 #include "pic.h"
+#include "defer.h"
+#include "serial.h"
+#include "cpu.h"
+#include "vdata.h"
+#include "speaker.h"
+#include "sched.h"
+#include "prof.h"
 
 static volatile uint32_t ticks = 0;
 static uint32_t frequency = 1000;
-static volatile uint8_t print_pending = 0;
 
 void pit_init(uint32_t hz) {
     frequency = hz;
@@ -20,19 +26,24 @@ uint32_t kernel_get_ticks_ms() {
     return (uint64_t)ticks * 1000 / frequency;
 }
 
-void irq0_handler() {
+/* Bottom half: once-per-second uptime report. */
+static void pit_second_bh(uint32_t tick) {
+    serial_print("ms: ");
+    serial_print_u32((uint64_t)tick * 1000 / frequency);
+    serial_print("\n");
+}
+
+void irq0_handler(const irq_frame_t* frame) {
     ticks++;
-    
+    prof_tick(frame);
+    uint32_t ms = kernel_get_ticks_ms();
+    vdata_tick(ticks, ms, rdtsc());
+    speaker_tick(ms);
+    sched_tick(ms);
+
     if (ticks % frequency == 0) {
-        print_pending = 1;
+        defer_post(pit_second_bh, ticks);
     }
 
     pic_send_EOI(0);
 }
-
-uint8_t pit_take_print_pending() {
-    if (!print_pending) return 0;
-
-    print_pending = 0;
-    return 1;
-}
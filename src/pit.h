@@ -3,5 +3,4 @@
 
 void pit_init(uint32_t hz);
 uint32_t kernel_get_ticks_ms();
-uint8_t pit_take_print_pending();
 
@@ -0,0 +1,291 @@
+#include "pmm.h"
+#include "mmap.h"
+#include "memory.h"
+#include "serial.h"
+#include "string.h"
+#include "cpu.h"
+#include "spinlock.h"
+
+#define LOW_MEMORY_END 0x100000
+
+extern char _load_start;
+
+static uint32_t* bitmap = 0;
+static uint32_t bitmap_words = 0;
+static uint32_t next_hint = 0;     // lowest page that might be free
+static pmm_stats_t stats;
+static uint32_t clean[PMM_CLEAN_MAX];  // stack of zeroed page numbers
+static bool nt_stores = false;         // MOVNTI (SSE2) available
+
+// Bitmap, clean stack and stats. AP jobs allocate too (vmm faults), so
+// disabling interrupts alone is not enough.
+static spinlock_t lock = SPINLOCK_INIT("pmm");
+
+static inline bool page_used(uint32_t page) {
+    return bitmap[page >> 5] & (1u << (page & 31));
+}
+
+static inline void mark_used(uint32_t page) {
+    bitmap[page >> 5] |= 1u << (page & 31);
+}
+
+static inline void mark_free(uint32_t page) {
+    bitmap[page >> 5] &= ~(1u << (page & 31));
+}
+
+static void set_range(uint64_t base, uint64_t end, bool used) {
+    // Free only whole pages; reserve every page the range touches.
+    uint64_t first = used ? base / PAGE_SIZE : (base + PAGE_SIZE - 1) / PAGE_SIZE;
+    uint64_t last = used ? (end + PAGE_SIZE - 1) / PAGE_SIZE : end / PAGE_SIZE;
+    if (last > stats.total_pages) last = stats.total_pages;
+
+    for (uint64_t p = first; p < last; p++) {
+        if (used && !page_used((uint32_t)p)) {
+            mark_used((uint32_t)p);
+            stats.free_pages--;
+        } else if (!used && page_used((uint32_t)p)) {
+            mark_free((uint32_t)p);
+            stats.free_pages++;
+        }
+    }
+}
+
+void pmm_init(void) {
+    uint32_t count;
+    const mmap_region_t* regions = mmap_get_regions(&count);
+
+    // Size the bitmap to the top of usable RAM below 4G.
+    uint64_t top = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (regions[i].type != MULTIBOOT_MMAP_AVAILABLE) continue;
+        uint64_t end = regions[i].base + regions[i].length;
+        if (end > 0x100000000ULL) end = 0x100000000ULL;
+        if (end > top) top = end;
+    }
+
+    stats = (pmm_stats_t){0};
+    stats.total_pages = (uint32_t)(top / PAGE_SIZE);
+    bitmap_words = (stats.total_pages + 31) / 32;
+    bitmap = kmalloc(bitmap_words * sizeof(uint32_t));
+    memset(bitmap, 0xFF, bitmap_words * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (regions[i].type != MULTIBOOT_MMAP_AVAILABLE) continue;
+        set_range(regions[i].base, regions[i].base + regions[i].length, false);
+    }
+
+    // The bump pool ends past the kernel, the modules and the bitmap itself.
+    set_range(0, LOW_MEMORY_END, true);
+    set_range((uintptr_t)&_load_start, memory_base_address(), true);
+    next_hint = 0;
+
+    uint32_t a, b, c, d;
+    cpuid(1, &a, &b, &c, &d);
+    nt_stores = (d & CPUID_EDX_SSE2) != 0;
+}
+
+void pmm_reserve(uint64_t base, uint64_t end) {
+    uint32_t flags = spin_lock_irqsave(&lock);
+    set_range(base, end, true);
+    spin_unlock_irqrestore(&lock, flags);
+}
+
+bool pmm_ready(void) {
+    return bitmap != 0;
+}
+
+/* First run of `count` free pages at or after `start`, or total_pages. */
+static uint32_t find_run(uint32_t start, uint32_t count) {
+    uint32_t run = 0;
+    for (uint32_t p = start; p < stats.total_pages; p++) {
+        // Skip fully used words 32 pages at a time.
+        if (run == 0 && (p & 31) == 0 && bitmap[p >> 5] == 0xFFFFFFFFu) {
+            p += 31;
+            continue;
+        }
+        if (page_used(p)) {
+            run = 0;
+            continue;
+        }
+        if (++run == count) return p + 1 - count;
+    }
+    return stats.total_pages;
+}
+
+/* Give every clean page back to the bitmap. They were counted free all
+   along. Caller holds the lock. */
+static void return_clean_pages(void) {
+    while (stats.clean_pages) {
+        uint32_t page = clean[--stats.clean_pages];
+        mark_free(page);
+        if (page < next_hint) next_hint = page;
+    }
+}
+
+void* alloc_pages(uint32_t count) {
+    if (!bitmap || count == 0) return 0;
+
+    uint32_t flags = spin_lock_irqsave(&lock);
+    uint32_t first = find_run(next_hint, count);
+    if (first == stats.total_pages && count > 1 && stats.clean_pages) {
+        // The pool may hold the pages that would complete a run.
+        // alloc_page() takes single pages from it directly instead.
+        return_clean_pages();
+        first = find_run(next_hint, count);
+    }
+    if (first == stats.total_pages) {
+        stats.failed++;
+        spin_unlock_irqrestore(&lock, flags);
+        return 0;
+    }
+
+    for (uint32_t p = first; p < first + count; p++) {
+        mark_used(p);
+    }
+    stats.free_pages -= count;
+    stats.allocs++;
+    if (first == next_hint) next_hint = first + count;
+    spin_unlock_irqrestore(&lock, flags);
+
+    return (void*)(first * PAGE_SIZE);
+}
+
+void* alloc_page(void) {
+    void* page = alloc_pages(1);
+    if (page || stats.clean_pages == 0) return page;
+
+    // The bitmap is exhausted; clean pages are free memory too.
+    uint32_t flags = spin_lock_irqsave(&lock);
+    if (stats.clean_pages) {
+        page = (void*)(clean[--stats.clean_pages] * PAGE_SIZE);
+        stats.free_pages--;
+        stats.allocs++;
+    }
+    spin_unlock_irqrestore(&lock, flags);
+    return page;
+}
+
+/* Zero a page without pulling it into the cache: nobody reads it until
+   it is handed out, possibly much later. */
+static void zero_page(void* page) {
+    if (!nt_stores) {
+        memset(page, 0, PAGE_SIZE);
+        return;
+    }
+    uint32_t* p = page;
+    for (uint32_t i = 0; i < PAGE_SIZE / 4; i += 4) {
+        __asm__ volatile ("movnti %1, 0(%0)\n\t"
+                          "movnti %1, 4(%0)\n\t"
+                          "movnti %1, 8(%0)\n\t"
+                          "movnti %1, 12(%0)"
+                          : : "r"(p + i), "r"(0) : "memory");
+    }
+    __asm__ volatile ("sfence" : : : "memory");
+}
+
+void* alloc_zeroed_page(void) {
+    uint32_t flags = spin_lock_irqsave(&lock);
+    if (stats.clean_pages) {
+        void* page = (void*)(clean[--stats.clean_pages] * PAGE_SIZE);
+        stats.free_pages--;
+        stats.allocs++;
+        stats.zero_hits++;
+        spin_unlock_irqrestore(&lock, flags);
+        return page;
+    }
+    stats.zero_misses++;
+    spin_unlock_irqrestore(&lock, flags);
+
+    void* page = alloc_pages(1);
+    if (page) memset(page, 0, PAGE_SIZE);
+    return page;
+}
+
+bool pmm_prezero(uint32_t max) {
+    if (!bitmap) return false;
+
+    bool worked = false;
+    for (uint32_t n = 0; n < max; n++) {
+        // Take a page off the bitmap but keep counting it as free.
+        uint32_t flags = spin_lock_irqsave(&lock);
+        uint32_t page = stats.clean_pages < PMM_CLEAN_MAX
+                      ? find_run(next_hint, 1) : stats.total_pages;
+        if (page == stats.total_pages) {
+            spin_unlock_irqrestore(&lock, flags);
+            break;
+        }
+        mark_used(page);
+        if (page == next_hint) next_hint = page + 1;
+        spin_unlock_irqrestore(&lock, flags);
+
+        uint64_t start = rdtsc();
+        zero_page((void*)(page * PAGE_SIZE));
+        uint64_t cycles = rdtsc() - start;
+
+        flags = spin_lock_irqsave(&lock);
+        clean[stats.clean_pages++] = page;
+        stats.prezeroed++;
+        stats.prezero_cycles += cycles;
+        spin_unlock_irqrestore(&lock, flags);
+        worked = true;
+    }
+    return worked;
+}
+
+void free_pages(void* phys_addr, uint32_t count) {
+    uint32_t first = (uintptr_t)phys_addr / PAGE_SIZE;
+
+    uint32_t flags = spin_lock_irqsave(&lock);
+    for (uint32_t p = first; p < first + count && p < stats.total_pages; p++) {
+        if (!page_used(p)) {
+            // Leave the bitmap alone: the page may already belong to
+            // someone else again.
+            stats.double_frees++;
+            serial_print("pmm: double free of page 0x");
+            serial_print_hex(p * PAGE_SIZE);
+            serial_print("\n");
+            continue;
+        }
+        mark_free(p);
+        stats.free_pages++;
+    }
+    if (first < next_hint) next_hint = first;
+    spin_unlock_irqrestore(&lock, flags);
+}
+
+void free_page(void* phys_addr) {
+    free_pages(phys_addr, 1);
+}
+
+const pmm_stats_t* pmm_stats(void) {
+    return &stats;
+}
+
+void pmm_dump(void) {
+    serial_print("pmm: ");
+    serial_print_u32(stats.free_pages);
+    serial_print(" / ");
+    serial_print_u32(stats.total_pages);
+    serial_print(" pages free, allocs=");
+    serial_print_u32(stats.allocs);
+    serial_print(" failed=");
+    serial_print_u32(stats.failed);
+    serial_print(" double_frees=");
+    serial_print_u32(stats.double_frees);
+    serial_print(" lock contended=");
+    serial_print_u32(lock.contended);
+    serial_print("\n  clean=");
+    serial_print_u32(stats.clean_pages);
+    serial_print(" zeroed hits=");
+    serial_print_u32(stats.zero_hits);
+    serial_print(" misses=");
+    serial_print_u32(stats.zero_misses);
+    serial_print(" prezeroed=");
+    serial_print_u32(stats.prezeroed);
+    if (stats.prezeroed) {
+        serial_print(" (avg ");
+        serial_print_u32((uint32_t)(stats.prezero_cycles / stats.prezeroed));
+        serial_print(" cyc/page)");
+    }
+    serial_print("\n");
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * pmm.h — Physical page allocator (docs/memory.md §6).
+ *
+ * One bit per 4K page (1 = used), stored in bump-allocated memory.  Every
+ * page starts out used; pmm_init() frees the usable multiboot regions, then
+ * re-reserves the low 1M and everything from the kernel image up to the end
+ * of the bump pool (which already covers the multiboot modules).
+ *
+ * Memory is identity mapped, so the returned physical addresses are also
+ * valid kernel pointers.
+ *
+ * Free pages can also sit in the clean pool: already zeroed, marked used in
+ * the bitmap, but still counted as free.  pmm_prezero() fills the pool from
+ * the idle loop with non-temporal stores, and alloc_zeroed_page() takes from
+ * it first, so the common case skips the 4 KiB memset.
+ */
+
+#define PAGE_SIZE 4096
+#define PMM_CLEAN_MAX 512            // clean pool capacity: 2 MiB
+
+typedef struct {
+    uint32_t total_pages;     // pages covered by the bitmap
+    uint32_t free_pages;
+    uint32_t allocs;          // successful alloc_page/alloc_pages calls
+    uint32_t failed;          // allocation requests that found no room
+    uint32_t double_frees;
+    uint32_t clean_pages;     // zeroed pages waiting in the pool
+    uint32_t zero_hits;       // alloc_zeroed_page served from the pool
+    uint32_t zero_misses;     // alloc_zeroed_page that had to memset
+    uint32_t prezeroed;       // pages zeroed by pmm_prezero
+    uint64_t prezero_cycles;
+} pmm_stats_t;
+
+/* Call after mmap_init(), module_init() and memory_init(). From then on
+   kmalloc() allocates from here as well. */
+void pmm_init(void);
+
+bool pmm_ready(void);
+
+/* One page, or NULL when memory is exhausted. */
+void* alloc_page(void);
+void free_page(void* phys_addr);
+
+/* One zero-filled page, or NULL. Takes a clean page if there is one. */
+void* alloc_zeroed_page(void);
+
+/* Zero up to `max` free pages into the clean pool. For idle time: returns
+   false when there was nothing to do (pool full or memory exhausted). */
+bool pmm_prezero(uint32_t max);
+
+/* `count` physically contiguous pages, or NULL. */
+void* alloc_pages(uint32_t count);
+void free_pages(void* phys_addr, uint32_t count);
+
+/* Mark [base, end) used so it is never handed out (e.g. RAM hidden
+   behind a paging window). Pages already allocated stay allocated. */
+void pmm_reserve(uint64_t base, uint64_t end);
+
+const pmm_stats_t* pmm_stats(void);
+
+/* Print page totals and counters over serial. */
+void pmm_dump(void);
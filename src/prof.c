@@ -0,0 +1,129 @@
+#include "prof.h"
+#include "cpu.h"
+#include "pmm.h"
+#include "serial.h"
+#include "vmm.h"
+
+#define BUFFER_PAGES \
+    ((PROF_MAX_SAMPLES * sizeof(prof_sample_t) + PAGE_SIZE - 1) / PAGE_SIZE)
+
+static prof_sample_t* buffer = 0;     // allocated once, kept
+static volatile bool running = false;
+static uint32_t countdown;
+static uint32_t ram_top;
+static prof_stats_t stats;
+
+bool prof_start(uint32_t every) {
+    if (!buffer) buffer = alloc_pages(BUFFER_PAGES);
+    if (!buffer || every == 0) return false;
+
+    uint32_t flags = irq_save();
+    stats = (prof_stats_t){ .every = every };
+    countdown = every;
+    ram_top = pmm_stats()->total_pages * PAGE_SIZE;
+    running = true;
+    irq_restore(flags);
+    return true;
+}
+
+void prof_stop(void) {
+    running = false;
+}
+
+bool prof_running(void) {
+    return running;
+}
+
+/* Can the walk read the two words at `fp`? Only RAM and present window
+   pages: a stray EBP must not touch MMIO or fault. */
+static bool readable(uint32_t fp) {
+    if (fp < PAGE_SIZE || (fp & 3)) return false;
+    if (fp >= VMM_WINDOW_BASE && fp - VMM_WINDOW_BASE < VMM_WINDOW_SIZE) {
+        return (fp & (PAGE_SIZE - 1)) <= PAGE_SIZE - 8 && vmm_translate(fp);
+    }
+    return fp <= ram_top - 8;
+}
+
+void prof_tick(const irq_frame_t* frame) {
+    if (!running || --countdown) return;
+    countdown = stats.every;
+
+    if (stats.samples == PROF_MAX_SAMPLES) {
+        stats.dropped++;
+        return;
+    }
+    uint64_t start = rdtsc();
+
+    prof_sample_t* s = &buffer[stats.samples++];
+    s->pc[0] = frame->eip;
+    s->depth = 1;
+
+    // Same ring, so the interrupted stack continues just above our frame.
+    uint32_t low = frame->esp + 12;
+    uint32_t fp = frame->ebp;
+    while (s->depth < PROF_DEPTH && fp >= low && fp - low <= PROF_MAX_FRAME &&
+           readable(fp)) {
+        const uint32_t* f = (const uint32_t*)fp;
+        if (f[1] == 0) break;
+        s->pc[s->depth++] = f[1];
+        low = fp + 8;
+        fp = f[0];
+    }
+
+    uint32_t cycles = (uint32_t)(rdtsc() - start);
+    stats.cycles += cycles;
+    if (cycles > stats.max_cycles) stats.max_cycles = cycles;
+}
+
+const prof_sample_t* prof_samples(uint32_t* count) {
+    *count = stats.samples;
+    return buffer;
+}
+
+const prof_stats_t* prof_stats(void) {
+    return &stats;
+}
+
+static bool same_stack(const prof_sample_t* a, const prof_sample_t* b) {
+    if (a->depth != b->depth) return false;
+    for (uint32_t i = 0; i < a->depth; i++) {
+        if (a->pc[i] != b->pc[i]) return false;
+    }
+    return true;
+}
+
+void prof_dump(void) {
+    prof_stop();
+    serial_print("prof: begin samples=");
+    serial_print_u32(stats.samples);
+    serial_print(" dropped=");
+    serial_print_u32(stats.dropped);
+    serial_print(" every=");
+    serial_print_u32(stats.every);
+    if (stats.samples) {
+        serial_print(" avg=");
+        serial_print_u32((uint32_t)(stats.cycles / stats.samples));
+        serial_print("cyc max=");
+        serial_print_u32(stats.max_cycles);
+        serial_print("cyc");
+    }
+    serial_print("\n");
+
+    // One line per run of identical stacks: count, EIP, callers.
+    for (uint32_t i = 0; i < stats.samples; ) {
+        uint32_t run = 1;
+        while (i + run < stats.samples &&
+               same_stack(&buffer[i], &buffer[i + run])) {
+            run++;
+        }
+        serial_print("prof: ");
+        serial_print_u32(run);
+        for (uint32_t d = 0; d < buffer[i].depth; d++) {
+            serial_print(" ");
+            serial_print_hex(buffer[i].pc[d]);
+        }
+        serial_print("\n");
+        i += run;
+    }
+    serial_print("prof: end\n");
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "idt.h"
+
+/*
+ * prof.h — Sampling profiler on the PIT tick (docs/debugging.md).
+ *
+ * While running, every Nth timer interrupt records the interrupted EIP and
+ * up to PROF_DEPTH - 1 return addresses found by walking the EBP chain.
+ * Samples go into a buffer allocated by prof_start(); once it is full,
+ * further samples are counted as dropped.  Nothing is allocated or printed
+ * from the interrupt.
+ *
+ * prof_dump() prints the samples over serial, merging runs of identical
+ * stacks, between "prof: begin" and "prof: end" lines.
+ * tools/prof_fold.py symbolizes them against build/exodoom and prints
+ * folded stacks for flamegraph.pl.
+ *
+ * Return addresses need frame pointers: build with PROFILE=1
+ * (-fno-omit-frame-pointer) or DEBUG=1.  Without them, most samples are
+ * the EIP alone.
+ */
+
+#define PROF_DEPTH        8          // EIP + 7 return addresses
+#define PROF_MAX_SAMPLES  8192       // 8 s at 1 kHz
+#define PROF_MAX_FRAME    0x10000    // larger frame gaps end the walk
+
+typedef struct {
+    uint32_t pc[PROF_DEPTH];  // pc[0] = interrupted EIP, then callers
+    uint32_t depth;
+} prof_sample_t;
+
+typedef struct {
+    uint32_t samples;
+    uint32_t dropped;         // buffer full
+    uint32_t every;           // ticks per sample
+    uint64_t cycles;          // time spent sampling, summed
+    uint32_t max_cycles;
+} prof_stats_t;
+
+/* Clear the buffer and sample every `every` ticks (1 = each tick).
+   Returns false if the buffer cannot be allocated. */
+bool prof_start(uint32_t every);
+void prof_stop(void);
+bool prof_running(void);
+
+/* Called by irq0_handler with the interrupted registers. */
+void prof_tick(const irq_frame_t* frame);
+
+const prof_sample_t* prof_samples(uint32_t* count);
+const prof_stats_t* prof_stats(void);
+
+/* Stop sampling and print the buffer for tools/prof_fold.py. */
+void prof_dump(void);
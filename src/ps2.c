@@ -2,28 +2,33 @@
 #include "io.h"
 #include "serial.h"
 #include "pic.h"
+#include "defer.h"
+#include "cpu.h"
+#include "pit.h"
+#include "ring.h"
+#include "hist.h"
+#include "tsc.h"
+#include "trace.h"
+#include "vdata.h"
 
 #define PS2_DATA_PORT 0x60
 #define PS2_STATUS_PORT 0x64
 
-static bool ps2_shift = false;
-static bool ps2_ctrl = false;
-static bool ps2_alt = false;
-static bool ps2_extended = false;
-static bool ps2_break = false;
+// Decoder state carried between bytes of a multi-byte sequence.
+static uint8_t ps2_set = 1;
+static uint8_t ps2_prefix = 0;           // 0x80 after an 0xE0 prefix
+static bool ps2_break = false;           // set 2: 0xF0 seen
+static uint8_t ps2_pause_left = 0;       // bytes of a Pause sequence to swallow
+static bool ps2_verbose = true;
 
 #define KBD_BUFFER_SIZE 64
-static kbd_event_t kbd_buffer[KBD_BUFFER_SIZE];
-static volatile uint8_t kbd_head = 0;
-static volatile uint8_t kbd_tail = 0;
+RING_DEFINE(kbd_ring, kbd_event_t, KBD_BUFFER_SIZE)
+static kbd_ring_t kbd_events;
+static kbd_latency_stats_t kbd_latency;
 static volatile uint8_t modifier_state = 0;
 
-#define MOD_LSHIFT (1 << 0)
-#define MOD_RSHIFT (1 << 1)
-#define MOD_LCTRL  (1 << 2)
-#define MOD_RCTRL  (1 << 3)
-#define MOD_LALT   (1 << 4)
-#define MOD_RALT   (1 << 5)
+// Pressed-key bitmap indexed by ps2_key_t, updated in the IRQ1 top half.
+static volatile uint32_t key_bitmap[KBD_STATE_WORDS];
 
 uint8_t ps2_read_scancode(void) {
     while (!(inb(PS2_STATUS_PORT) & 0x01)) {
@@ -61,133 +66,164 @@ void ps2_print_scancode(uint8_t scancode) {
     serial_print(buffer);
 }
 
-static ps2_key_t ps2_translate_scancode(uint8_t scancode) {
-    if (ps2_extended) {
-        switch (scancode) {
-            case 0x48: return KEY_UP;
-            case 0x50: return KEY_DOWN;
-            case 0x4B: return KEY_LEFT;
-            case 0x4D: return KEY_RIGHT;
-            case 0x1D: return KEY_CTRL;
-            case 0x38: return KEY_ALT;
-            default:   return KEY_UNKNOWN;
-        }
-    }
-
-    switch (scancode) {
-        case 0x1E: return KEY_A;
-        case 0x30: return KEY_B;
-        case 0x2E: return KEY_C;
-        case 0x20: return KEY_D;
-        case 0x12: return KEY_E;
-        case 0x21: return KEY_F;
-        case 0x22: return KEY_G;
-        case 0x23: return KEY_H;
-        case 0x17: return KEY_I;
-        case 0x24: return KEY_J;
-        case 0x25: return KEY_K;
-        case 0x26: return KEY_L;
-        case 0x32: return KEY_M;
-        case 0x31: return KEY_N;
-        case 0x18: return KEY_O;
-        case 0x19: return KEY_P;
-        case 0x10: return KEY_Q;
-        case 0x13: return KEY_R;
-        case 0x1F: return KEY_S;
-        case 0x14: return KEY_T;
-        case 0x16: return KEY_U;
-        case 0x2F: return KEY_V;
-        case 0x11: return KEY_W;
-        case 0x2D: return KEY_X;
-        case 0x15: return KEY_Y;
-        case 0x2C: return KEY_Z;
-        case 0x2A: return KEY_SHIFT_LEFT;
-        case 0x36: return KEY_SHIFT_RIGHT;
-        case 0x1D: return KEY_CTRL;
-        case 0x38: return KEY_ALT;
-        case 0x39: return KEY_SPACE;
-        case 0x0E: return KEY_BACKSPACE;
-        case 0x0F: return KEY_TAB;
-        case 0x1C: return KEY_ENTER;
-        case 0x01: return KEY_ESC;
-        case 0x3B: return KEY_F1;
-        case 0x3C: return KEY_F2;
-        case 0x3D: return KEY_F3;
-        case 0x3E: return KEY_F4;
-        case 0x3F: return KEY_F5;
-        case 0x40: return KEY_F6;
-        case 0x41: return KEY_F7;
-        case 0x42: return KEY_F8;
-        case 0x43: return KEY_F9;
-        case 0x44: return KEY_F10;
-        case 0x57: return KEY_F11;
-        case 0x58: return KEY_F12;
-        default:    return KEY_UNKNOWN;
-    }
-}
+/*
+ * Scan code tables. Index = 7-bit code | 0x80 for 0xE0-prefixed keys, so a
+ * byte decodes with one load whatever key it is. Unlisted codes (including
+ * the fake shifts Print Screen wraps itself in) stay KEY_UNKNOWN.
+ */
+#define E0(code) (0x80 | (code))
+
+static const uint8_t set1_keys[256] = {
+    [0x01] = KEY_ESC,
+    [0x02] = KEY_1, [0x03] = KEY_2, [0x04] = KEY_3, [0x05] = KEY_4,
+    [0x06] = KEY_5, [0x07] = KEY_6, [0x08] = KEY_7, [0x09] = KEY_8,
+    [0x0A] = KEY_9, [0x0B] = KEY_0,
+    [0x0C] = KEY_MINUS, [0x0D] = KEY_EQUALS,
+    [0x0E] = KEY_BACKSPACE, [0x0F] = KEY_TAB,
+    [0x10] = KEY_Q, [0x11] = KEY_W, [0x12] = KEY_E, [0x13] = KEY_R,
+    [0x14] = KEY_T, [0x15] = KEY_Y, [0x16] = KEY_U, [0x17] = KEY_I,
+    [0x18] = KEY_O, [0x19] = KEY_P,
+    [0x1A] = KEY_LBRACKET, [0x1B] = KEY_RBRACKET,
+    [0x1C] = KEY_ENTER, [0x1D] = KEY_CTRL,
+    [0x1E] = KEY_A, [0x1F] = KEY_S, [0x20] = KEY_D, [0x21] = KEY_F,
+    [0x22] = KEY_G, [0x23] = KEY_H, [0x24] = KEY_J, [0x25] = KEY_K,
+    [0x26] = KEY_L,
+    [0x27] = KEY_SEMICOLON, [0x28] = KEY_APOSTROPHE, [0x29] = KEY_GRAVE,
+    [0x2A] = KEY_SHIFT_LEFT, [0x2B] = KEY_BACKSLASH,
+    [0x2C] = KEY_Z, [0x2D] = KEY_X, [0x2E] = KEY_C, [0x2F] = KEY_V,
+    [0x30] = KEY_B, [0x31] = KEY_N, [0x32] = KEY_M,
+    [0x33] = KEY_COMMA, [0x34] = KEY_PERIOD, [0x35] = KEY_SLASH,
+    [0x36] = KEY_SHIFT_RIGHT, [0x37] = KEY_KP_MULTIPLY,
+    [0x38] = KEY_ALT, [0x39] = KEY_SPACE, [0x3A] = KEY_CAPS_LOCK,
+    [0x3B] = KEY_F1, [0x3C] = KEY_F2, [0x3D] = KEY_F3, [0x3E] = KEY_F4,
+    [0x3F] = KEY_F5, [0x40] = KEY_F6, [0x41] = KEY_F7, [0x42] = KEY_F8,
+    [0x43] = KEY_F9, [0x44] = KEY_F10,
+    [0x45] = KEY_NUM_LOCK, [0x46] = KEY_SCROLL_LOCK,
+    [0x47] = KEY_KP_7, [0x48] = KEY_KP_8, [0x49] = KEY_KP_9,
+    [0x4A] = KEY_KP_MINUS,
+    [0x4B] = KEY_KP_4, [0x4C] = KEY_KP_5, [0x4D] = KEY_KP_6,
+    [0x4E] = KEY_KP_PLUS,
+    [0x4F] = KEY_KP_1, [0x50] = KEY_KP_2, [0x51] = KEY_KP_3,
+    [0x52] = KEY_KP_0, [0x53] = KEY_KP_PERIOD,
+    [0x57] = KEY_F11, [0x58] = KEY_F12,
+
+    [E0(0x1C)] = KEY_KP_ENTER,    [E0(0x1D)] = KEY_CTRL_RIGHT,
+    [E0(0x35)] = KEY_KP_DIVIDE,   [E0(0x37)] = KEY_PRINT_SCREEN,
+    [E0(0x38)] = KEY_ALT_RIGHT,   [E0(0x46)] = KEY_PAUSE,   // Ctrl+Break
+    [E0(0x47)] = KEY_HOME,        [E0(0x48)] = KEY_UP,
+    [E0(0x49)] = KEY_PAGE_UP,     [E0(0x4B)] = KEY_LEFT,
+    [E0(0x4D)] = KEY_RIGHT,       [E0(0x4F)] = KEY_END,
+    [E0(0x50)] = KEY_DOWN,        [E0(0x51)] = KEY_PAGE_DOWN,
+    [E0(0x52)] = KEY_INSERT,      [E0(0x53)] = KEY_DELETE,
+    [E0(0x5B)] = KEY_GUI_LEFT,    [E0(0x5C)] = KEY_GUI_RIGHT,
+    [E0(0x5D)] = KEY_MENU,
+};
+
+/* Set 2: F7 is the only make code above 0x7F (0x83); it is folded onto the
+   unused 0x02 slot before the lookup. */
+#define SET2_F7      0x83
+#define SET2_F7_SLOT 0x02
+
+static const uint8_t set2_keys[256] = {
+    [0x01] = KEY_F9,  [SET2_F7_SLOT] = KEY_F7,
+    [0x03] = KEY_F5,  [0x04] = KEY_F3,  [0x05] = KEY_F1,  [0x06] = KEY_F2,
+    [0x07] = KEY_F12, [0x09] = KEY_F10, [0x0A] = KEY_F8,  [0x0B] = KEY_F6,
+    [0x0C] = KEY_F4,  [0x0D] = KEY_TAB, [0x0E] = KEY_GRAVE,
+    [0x11] = KEY_ALT, [0x12] = KEY_SHIFT_LEFT, [0x14] = KEY_CTRL,
+    [0x15] = KEY_Q,   [0x16] = KEY_1,
+    [0x1A] = KEY_Z,   [0x1B] = KEY_S,   [0x1C] = KEY_A,   [0x1D] = KEY_W,
+    [0x1E] = KEY_2,
+    [0x21] = KEY_C,   [0x22] = KEY_X,   [0x23] = KEY_D,   [0x24] = KEY_E,
+    [0x25] = KEY_4,   [0x26] = KEY_3,
+    [0x29] = KEY_SPACE, [0x2A] = KEY_V, [0x2B] = KEY_F,   [0x2C] = KEY_T,
+    [0x2D] = KEY_R,   [0x2E] = KEY_5,
+    [0x31] = KEY_N,   [0x32] = KEY_B,   [0x33] = KEY_H,   [0x34] = KEY_G,
+    [0x35] = KEY_Y,   [0x36] = KEY_6,
+    [0x3A] = KEY_M,   [0x3B] = KEY_J,   [0x3C] = KEY_U,   [0x3D] = KEY_7,
+    [0x3E] = KEY_8,
+    [0x41] = KEY_COMMA, [0x42] = KEY_K, [0x43] = KEY_I,   [0x44] = KEY_O,
+    [0x45] = KEY_0,   [0x46] = KEY_9,
+    [0x49] = KEY_PERIOD, [0x4A] = KEY_SLASH, [0x4B] = KEY_L,
+    [0x4C] = KEY_SEMICOLON, [0x4D] = KEY_P, [0x4E] = KEY_MINUS,
+    [0x52] = KEY_APOSTROPHE, [0x54] = KEY_LBRACKET, [0x55] = KEY_EQUALS,
+    [0x58] = KEY_CAPS_LOCK, [0x59] = KEY_SHIFT_RIGHT, [0x5A] = KEY_ENTER,
+    [0x5B] = KEY_RBRACKET, [0x5D] = KEY_BACKSLASH,
+    [0x66] = KEY_BACKSPACE,
+    [0x69] = KEY_KP_1, [0x6B] = KEY_KP_4, [0x6C] = KEY_KP_7,
+    [0x70] = KEY_KP_0, [0x71] = KEY_KP_PERIOD, [0x72] = KEY_KP_2,
+    [0x73] = KEY_KP_5, [0x74] = KEY_KP_6, [0x75] = KEY_KP_8,
+    [0x76] = KEY_ESC,  [0x77] = KEY_NUM_LOCK, [0x78] = KEY_F11,
+    [0x79] = KEY_KP_PLUS, [0x7A] = KEY_KP_3, [0x7B] = KEY_KP_MINUS,
+    [0x7C] = KEY_KP_MULTIPLY, [0x7D] = KEY_KP_9, [0x7E] = KEY_SCROLL_LOCK,
+
+    [E0(0x11)] = KEY_ALT_RIGHT,   [E0(0x14)] = KEY_CTRL_RIGHT,
+    [E0(0x1F)] = KEY_GUI_LEFT,    [E0(0x27)] = KEY_GUI_RIGHT,
+    [E0(0x2F)] = KEY_MENU,        [E0(0x4A)] = KEY_KP_DIVIDE,
+    [E0(0x5A)] = KEY_KP_ENTER,    [E0(0x69)] = KEY_END,
+    [E0(0x6B)] = KEY_LEFT,        [E0(0x6C)] = KEY_HOME,
+    [E0(0x70)] = KEY_INSERT,      [E0(0x71)] = KEY_DELETE,
+    [E0(0x72)] = KEY_DOWN,        [E0(0x74)] = KEY_RIGHT,
+    [E0(0x75)] = KEY_UP,          [E0(0x7A)] = KEY_PAGE_DOWN,
+    [E0(0x7C)] = KEY_PRINT_SCREEN, [E0(0x7D)] = KEY_PAGE_UP,
+    [E0(0x7E)] = KEY_PAUSE,       // Ctrl+Break
+};
+
+/* Pause has no break code: E1 followed by 5 (set 1) or 7 (set 2) bytes. */
+#define SET1_PAUSE_TAIL 5
+#define SET2_PAUSE_TAIL 7
+
+static const uint8_t key_modifier[KEY_COUNT] = {
+    [KEY_SHIFT_LEFT]  = MOD_LSHIFT,
+    [KEY_SHIFT_RIGHT] = MOD_RSHIFT,
+    [KEY_CTRL]        = MOD_LCTRL,
+    [KEY_CTRL_RIGHT]  = MOD_RCTRL,
+    [KEY_ALT]         = MOD_LALT,
+    [KEY_ALT_RIGHT]   = MOD_RALT,
+};
+
+#define KEY_NAME(k) [k] = #k
+
+static const char* const key_names[KEY_COUNT] = {
+    KEY_NAME(KEY_A), KEY_NAME(KEY_B), KEY_NAME(KEY_C), KEY_NAME(KEY_D),
+    KEY_NAME(KEY_E), KEY_NAME(KEY_F), KEY_NAME(KEY_G), KEY_NAME(KEY_H),
+    KEY_NAME(KEY_I), KEY_NAME(KEY_J), KEY_NAME(KEY_K), KEY_NAME(KEY_L),
+    KEY_NAME(KEY_M), KEY_NAME(KEY_N), KEY_NAME(KEY_O), KEY_NAME(KEY_P),
+    KEY_NAME(KEY_Q), KEY_NAME(KEY_R), KEY_NAME(KEY_S), KEY_NAME(KEY_T),
+    KEY_NAME(KEY_U), KEY_NAME(KEY_V), KEY_NAME(KEY_W), KEY_NAME(KEY_X),
+    KEY_NAME(KEY_Y), KEY_NAME(KEY_Z),
+    KEY_NAME(KEY_SHIFT_LEFT), KEY_NAME(KEY_SHIFT_RIGHT),
+    KEY_NAME(KEY_CTRL), KEY_NAME(KEY_ALT),
+    KEY_NAME(KEY_UP), KEY_NAME(KEY_DOWN), KEY_NAME(KEY_LEFT), KEY_NAME(KEY_RIGHT),
+    KEY_NAME(KEY_ENTER), KEY_NAME(KEY_SPACE), KEY_NAME(KEY_BACKSPACE),
+    KEY_NAME(KEY_TAB), KEY_NAME(KEY_ESC),
+    KEY_NAME(KEY_F1), KEY_NAME(KEY_F2), KEY_NAME(KEY_F3), KEY_NAME(KEY_F4),
+    KEY_NAME(KEY_F5), KEY_NAME(KEY_F6), KEY_NAME(KEY_F7), KEY_NAME(KEY_F8),
+    KEY_NAME(KEY_F9), KEY_NAME(KEY_F10), KEY_NAME(KEY_F11), KEY_NAME(KEY_F12),
+    KEY_NAME(KEY_0), KEY_NAME(KEY_1), KEY_NAME(KEY_2), KEY_NAME(KEY_3),
+    KEY_NAME(KEY_4), KEY_NAME(KEY_5), KEY_NAME(KEY_6), KEY_NAME(KEY_7),
+    KEY_NAME(KEY_8), KEY_NAME(KEY_9),
+    KEY_NAME(KEY_MINUS), KEY_NAME(KEY_EQUALS),
+    KEY_NAME(KEY_LBRACKET), KEY_NAME(KEY_RBRACKET), KEY_NAME(KEY_BACKSLASH),
+    KEY_NAME(KEY_SEMICOLON), KEY_NAME(KEY_APOSTROPHE), KEY_NAME(KEY_GRAVE),
+    KEY_NAME(KEY_COMMA), KEY_NAME(KEY_PERIOD), KEY_NAME(KEY_SLASH),
+    KEY_NAME(KEY_CAPS_LOCK), KEY_NAME(KEY_NUM_LOCK), KEY_NAME(KEY_SCROLL_LOCK),
+    KEY_NAME(KEY_KP_0), KEY_NAME(KEY_KP_1), KEY_NAME(KEY_KP_2), KEY_NAME(KEY_KP_3),
+    KEY_NAME(KEY_KP_4), KEY_NAME(KEY_KP_5), KEY_NAME(KEY_KP_6), KEY_NAME(KEY_KP_7),
+    KEY_NAME(KEY_KP_8), KEY_NAME(KEY_KP_9),
+    KEY_NAME(KEY_KP_PERIOD), KEY_NAME(KEY_KP_PLUS), KEY_NAME(KEY_KP_MINUS),
+    KEY_NAME(KEY_KP_MULTIPLY), KEY_NAME(KEY_KP_DIVIDE), KEY_NAME(KEY_KP_ENTER),
+    KEY_NAME(KEY_CTRL_RIGHT), KEY_NAME(KEY_ALT_RIGHT),
+    KEY_NAME(KEY_GUI_LEFT), KEY_NAME(KEY_GUI_RIGHT), KEY_NAME(KEY_MENU),
+    KEY_NAME(KEY_INSERT), KEY_NAME(KEY_DELETE), KEY_NAME(KEY_HOME),
+    KEY_NAME(KEY_END), KEY_NAME(KEY_PAGE_UP), KEY_NAME(KEY_PAGE_DOWN),
+    KEY_NAME(KEY_PRINT_SCREEN), KEY_NAME(KEY_PAUSE),
+};
+
+static const uint8_t* ps2_keys = set1_keys;
 
 static const char* ps2_key_name(ps2_key_t key) {
-    switch (key) {
-        case KEY_A: return "KEY_A";
-        case KEY_B: return "KEY_B";
-        case KEY_C: return "KEY_C";
-        case KEY_D: return "KEY_D";
-        case KEY_E: return "KEY_E";
-        case KEY_F: return "KEY_F";
-        case KEY_G: return "KEY_G";
-        case KEY_H: return "KEY_H";
-        case KEY_I: return "KEY_I";
-        case KEY_J: return "KEY_J";
-        case KEY_K: return "KEY_K";
-        case KEY_L: return "KEY_L";
-        case KEY_M: return "KEY_M";
-        case KEY_N: return "KEY_N";
-        case KEY_O: return "KEY_O";
-        case KEY_P: return "KEY_P";
-        case KEY_Q: return "KEY_Q";
-        case KEY_R: return "KEY_R";
-        case KEY_S: return "KEY_S";
-        case KEY_T: return "KEY_T";
-        case KEY_U: return "KEY_U";
-        case KEY_V: return "KEY_V";
-        case KEY_W: return "KEY_W";
-        case KEY_X: return "KEY_X";
-        case KEY_Y: return "KEY_Y";
-        case KEY_Z: return "KEY_Z";
-        case KEY_SHIFT_LEFT:  return "KEY_SHIFT_LEFT";
-        case KEY_SHIFT_RIGHT: return "KEY_SHIFT_RIGHT";
-        case KEY_CTRL:        return "KEY_CTRL";
-        case KEY_ALT:         return "KEY_ALT";
-        case KEY_UP:          return "KEY_UP";
-        case KEY_DOWN:        return "KEY_DOWN";
-        case KEY_LEFT:        return "KEY_LEFT";
-        case KEY_RIGHT:       return "KEY_RIGHT";
-        case KEY_ENTER:       return "KEY_ENTER";
-        case KEY_SPACE:       return "KEY_SPACE";
-        case KEY_BACKSPACE:   return "KEY_BACKSPACE";
-        case KEY_TAB:         return "KEY_TAB";
-        case KEY_ESC:         return "KEY_ESC";
-        default:              return "KEY_UNKNOWN";
-    }
-}
-
-static void update_modifier_state(ps2_key_t key, bool pressed) {
-    switch (key) {
-        case KEY_SHIFT_LEFT:
-            modifier_state = pressed ? modifier_state | MOD_LSHIFT : modifier_state & ~MOD_LSHIFT;
-            break;
-        case KEY_SHIFT_RIGHT:
-            modifier_state = pressed ? modifier_state | MOD_RSHIFT : modifier_state & ~MOD_RSHIFT;
-            break;
-        case KEY_CTRL:
-            modifier_state = pressed ? modifier_state | MOD_LCTRL : modifier_state & ~MOD_LCTRL;
-            break;
-        case KEY_ALT:
-            modifier_state = pressed ? modifier_state | MOD_LALT : modifier_state & ~MOD_LALT;
-            break;
-        default:
-            break;
-    }
+    const char* name = key < KEY_COUNT ? key_names[key] : 0;
+    return name ? name : "KEY_UNKNOWN";
 }
 
 void kbd_init(void) {
@@ -195,23 +231,24 @@ void kbd_init(void) {
 }
 
 void kbd_enqueue(kbd_event_t event) {
-    uint8_t next_head = (kbd_head + 1) & (KBD_BUFFER_SIZE - 1);
-    if (next_head == kbd_tail) {
-        return;
-    }
-
+    // IRQ1 is the only producer; a full ring counts the event as dropped.
     event.modifiers = modifier_state;
-    kbd_buffer[kbd_head] = event;
-    kbd_head = next_head;
+    event.time_ms = kernel_get_ticks_ms();
+    if (event.tsc == 0) {
+        event.tsc = rdtsc();
+    }
+    hist_add(&kbd_latency.depth, kbd_ring_count(&kbd_events));
+    kbd_ring_push(&kbd_events, &event);
 }
 
 int kbd_dequeue(kbd_event_t *out) {
-    if (kbd_head == kbd_tail) {
+    if (!kbd_ring_pop(&kbd_events, out)) {
         return 0;
     }
 
-    *out = kbd_buffer[kbd_tail];
-    kbd_tail = (kbd_tail + 1) & (KBD_BUFFER_SIZE - 1);
+    uint64_t residency = rdtsc() - out->tsc;
+    hist_add(&kbd_latency.residency,
+             residency > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)residency);
     return 1;
 }
 
@@ -220,83 +257,208 @@ int exo_kbd_poll(kbd_event_t *event_out) {
     return kbd_dequeue(event_out);
 }
 
+int exo_kbd_state(kbd_state_t *state_out) {
+    if (!state_out) return 0;
+
+    // 40 bytes: cheaper to copy with IRQ1 held off than to retry on a torn
+    // read, and the copy is consistent with the modifier byte.
+    uint32_t flags = irq_save();
+    for (int i = 0; i < KBD_STATE_WORDS; i++) {
+        state_out->keys[i] = key_bitmap[i];
+    }
+    state_out->modifiers = modifier_state;
+    state_out->dropped = kbd_events.overflows;
+    irq_restore(flags);
+
+    return 1;
+}
+
+uint32_t kbd_dropped_events(void) {
+    return kbd_events.overflows;
+}
+
+uint32_t kbd_queue_high_watermark(void) {
+    return kbd_events.high_watermark;
+}
+
+const kbd_latency_stats_t* kbd_latency_stats(void) {
+    return &kbd_latency;
+}
+
+void kbd_latency_reset(void) {
+    uint32_t flags = irq_save();
+    hist_reset(&kbd_latency.isr);
+    hist_reset(&kbd_latency.residency);
+    hist_reset(&kbd_latency.depth);
+    irq_restore(flags);
+}
+
+void kbd_latency_dump(void) {
+    serial_print("kbd latency: TSC ");
+    serial_print_u32(tsc_khz());
+    serial_print(" kHz\n");
+    hist_print(&kbd_latency.isr, "  irq1 isr", "cyc");
+    hist_print(&kbd_latency.residency, "  irq->dequeue", "cyc");
+    hist_print(&kbd_latency.depth, "  depth at enqueue", "");
+}
+
 uint8_t ps2_get_modifier_state(void) {
     return modifier_state;
 }
 
-static void ps2_report_key(ps2_key_t key, bool pressed) {
-    if (key == KEY_UNKNOWN) return;
+void ps2_set_verbose(bool verbose) {
+    ps2_verbose = verbose;
+}
 
-    update_modifier_state(key, pressed);
+static void ps2_report_key(ps2_key_t key, bool pressed) {
+    uint32_t down = pressed ? ~0u : 0u;
 
-    if (key == KEY_SHIFT_LEFT || key == KEY_SHIFT_RIGHT) {
-        ps2_shift = pressed;
-    } else if (key == KEY_CTRL) {
-        ps2_ctrl = pressed;
-    } else if (key == KEY_ALT) {
-        ps2_alt = pressed;
+    uint8_t mod = key_modifier[key];
+    if (mod) {
+        modifier_state = (modifier_state & ~mod) | (mod & down);
+        vdata_set_kbd_modifiers(modifier_state);
     }
 
-    const char* name = ps2_key_name(key);
-    serial_print(name);
-    serial_print(pressed ? " DOWN" : " UP");
+    uint32_t bit = 1u << (key & 31);
+    key_bitmap[key >> 5] = (key_bitmap[key >> 5] & ~bit) | (bit & down);
+}
+
+/*
+ * Bottom-half logging. The top half packs everything the report needs into
+ * the deferred-work argument so the serial output reflects the state at the
+ * time of the interrupt, not at the time the bottom half runs:
+ *   bits 0-7 scancode, 8-15 key, 16 pressed, 17 shift, 18 ctrl, 19 alt
+ */
+#define PS2_LOG_PRESSED (1u << 16)
+#define PS2_LOG_SHIFT   (1u << 17)
+#define PS2_LOG_CTRL    (1u << 18)
+#define PS2_LOG_ALT     (1u << 19)
+
+static void ps2_log_bh(uint32_t packed) {
+    uint8_t scancode = packed & 0xFF;
+    ps2_key_t key = (ps2_key_t)((packed >> 8) & 0xFF);
+
+    ps2_print_scancode(scancode);
+
+    if (key == KEY_UNKNOWN) return;
+
+    serial_print(ps2_key_name(key));
+    serial_print((packed & PS2_LOG_PRESSED) ? " DOWN" : " UP");
     serial_print(" (shift=");
-    serial_print(ps2_shift ? "1" : "0");
+    serial_print((packed & PS2_LOG_SHIFT) ? "1" : "0");
     serial_print(" ctrl=");
-    serial_print(ps2_ctrl ? "1" : "0");
+    serial_print((packed & PS2_LOG_CTRL) ? "1" : "0");
     serial_print(" alt=");
-    serial_print(ps2_alt ? "1" : "0");
+    serial_print((packed & PS2_LOG_ALT) ? "1" : "0");
     serial_print(")\n");
 }
 
-void ps2_process_scancode(uint8_t scancode) {
-    if (scancode == 0xE0) {
-        ps2_extended = true;
+static void ps2_emit(ps2_key_t key, bool pressed, uint64_t tsc) {
+    ps2_report_key(key, pressed);
+    kbd_event_t ev = { .pressed = pressed ? 1 : 0, .key = (uint8_t)key, .tsc = tsc };
+    kbd_enqueue(ev);
+}
+
+static void ps2_log(uint8_t scancode, ps2_key_t key, bool pressed) {
+    if (!ps2_verbose) return;
+
+    defer_post(ps2_log_bh, (uint32_t)scancode
+                           | ((uint32_t)key << 8)
+                           | (pressed          ? PS2_LOG_PRESSED : 0)
+                           | (ps2_shift_active() ? PS2_LOG_SHIFT : 0)
+                           | (ps2_ctrl_active()  ? PS2_LOG_CTRL : 0)
+                           | (ps2_alt_active()   ? PS2_LOG_ALT : 0));
+}
+
+/* `tsc` is when the byte arrived: IRQ1 entry, or "now" for direct callers. */
+static void ps2_decode(uint8_t scancode, uint64_t tsc) {
+    // Prefix bytes only update the decoder state.
+    if (ps2_pause_left) {
+        if (--ps2_pause_left == 0) {
+            ps2_emit(KEY_PAUSE, true, tsc);
+            ps2_emit(KEY_PAUSE, false, tsc);
+            ps2_log(scancode, KEY_PAUSE, true);
+        }
         return;
     }
-
-    if (scancode == 0xF0) {
-        ps2_break = true;
+    if (scancode == 0xE1) {
+        ps2_pause_left = ps2_set == 2 ? SET2_PAUSE_TAIL : SET1_PAUSE_TAIL;
+        return;
+    }
+    if (scancode == 0xE0) {
+        ps2_prefix = 0x80;
         return;
     }
 
-    bool release = false;
+    bool release;
     uint8_t code = scancode;
 
-    if (!ps2_extended && (scancode & 0x80)) {
-        release = true;
-        code = scancode & 0x7F;
+    if (ps2_set == 2) {
+        if (scancode == 0xF0) {
+            ps2_break = true;
+            return;
+        }
+        // Anything else above 0x7F is a controller reply (ACK, BAT, ...).
+        code = scancode == SET2_F7 ? SET2_F7_SLOT : scancode;
+        if (code & 0x80) {
+            ps2_prefix = 0;
+            ps2_break = false;
+            return;
+        }
+        release = ps2_break;
+    } else {
+        release = scancode >> 7;
     }
 
-    if (ps2_break) {
-        release = true;
-        ps2_break = false;
+    // Constant-cost decode: one table load for every key, extended or not.
+    ps2_key_t key = (ps2_key_t)ps2_keys[(code & 0x7F) | ps2_prefix];
+    bool pressed = !release;
+    ps2_prefix = 0;
+    ps2_break = false;
+
+    if (key != KEY_UNKNOWN) {
+        ps2_emit(key, pressed, tsc);
     }
 
-    ps2_print_scancode(scancode);
+    ps2_log(scancode, key, pressed);
+}
 
-    ps2_key_t key = ps2_translate_scancode(code);
+void ps2_process_scancode(uint8_t scancode) {
+    TRACE(SCANCODE, scancode, 0);
+    ps2_decode(scancode, rdtsc());
+}
 
-    if (key != KEY_UNKNOWN) {
-        bool pressed = !release;
-        ps2_report_key(key, pressed);
-        kbd_event_t ev = { .pressed = pressed ? 1 : 0, .key = (uint8_t)key, .modifiers = modifier_state };
-        kbd_enqueue(ev);
-    }
+bool ps2_set_scancode_set(uint8_t set) {
+    if (set != 1 && set != 2) return false;
+
+    uint32_t flags = irq_save();
+    ps2_set = set;
+    ps2_keys = set == 2 ? set2_keys : set1_keys;
+    ps2_prefix = 0;
+    ps2_break = false;
+    ps2_pause_left = 0;
+    irq_restore(flags);
+    return true;
+}
 
-    ps2_extended = false;
+uint8_t ps2_get_scancode_set(void) {
+    return ps2_set;
 }
 
+/* Top half: only the port read, decode and enqueue happen with IF=0;
+   serial logging is handed to ps2_log_bh. */
 void ps2_irq1_handler(void) {
+    uint64_t entry = rdtsc();
     uint8_t scancode = ps2_read_scancode();
-    ps2_process_scancode(scancode);
+    ps2_decode(scancode, entry);
     pic_send_EOI(1);
+    hist_add(&kbd_latency.isr, (uint32_t)(rdtsc() - entry));
 }
 
 void irq1_handler(void) {
     ps2_irq1_handler();
 }
 
-bool ps2_shift_active(void) { return ps2_shift; }
-bool ps2_ctrl_active(void)  { return ps2_ctrl; }
-bool ps2_alt_active(void)   { return ps2_alt; }
+bool ps2_shift_active(void) { return modifier_state & (MOD_LSHIFT | MOD_RSHIFT); }
+bool ps2_ctrl_active(void)  { return modifier_state & (MOD_LCTRL | MOD_RCTRL); }
+bool ps2_alt_active(void)   { return modifier_state & (MOD_LALT | MOD_RALT); }
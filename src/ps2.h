@@ -1,11 +1,17 @@
 #pragma once
 #include <stdint.h>
 #include <stdbool.h>
+#include "hist.h"
 
 /*
  * ps2.h — PS/2 keyboard driver for IRQ1 handler.
  *
- * Reads scancodes from port 0x60 and prints them to serial.
+ * Reads scancodes from port 0x60, decodes and queues them in the IRQ top
+ * half, and logs them to serial from a deferred bottom half.
+ *
+ * Decoding is table driven: one 256-entry table per scan code set, indexed
+ * by the 7-bit code with bit 7 set for 0xE0-prefixed keys.  Set 1 is the
+ * default (what the i8042 delivers with translation enabled).
  */
 
 /* Read a single scancode from the PS/2 keyboard port */
@@ -67,14 +73,107 @@ typedef enum {
     KEY_F10,
     KEY_F11,
     KEY_F12,
+    KEY_0,
+    KEY_1,
+    KEY_2,
+    KEY_3,
+    KEY_4,
+    KEY_5,
+    KEY_6,
+    KEY_7,
+    KEY_8,
+    KEY_9,
+    KEY_MINUS,
+    KEY_EQUALS,
+    KEY_LBRACKET,
+    KEY_RBRACKET,
+    KEY_BACKSLASH,
+    KEY_SEMICOLON,
+    KEY_APOSTROPHE,
+    KEY_GRAVE,
+    KEY_COMMA,
+    KEY_PERIOD,
+    KEY_SLASH,
+    KEY_CAPS_LOCK,
+    KEY_NUM_LOCK,
+    KEY_SCROLL_LOCK,
+    KEY_KP_0,
+    KEY_KP_1,
+    KEY_KP_2,
+    KEY_KP_3,
+    KEY_KP_4,
+    KEY_KP_5,
+    KEY_KP_6,
+    KEY_KP_7,
+    KEY_KP_8,
+    KEY_KP_9,
+    KEY_KP_PERIOD,
+    KEY_KP_PLUS,
+    KEY_KP_MINUS,
+    KEY_KP_MULTIPLY,
+    KEY_KP_DIVIDE,
+    KEY_KP_ENTER,
+    KEY_CTRL_RIGHT,
+    KEY_ALT_RIGHT,
+    KEY_GUI_LEFT,
+    KEY_GUI_RIGHT,
+    KEY_MENU,
+    KEY_INSERT,
+    KEY_DELETE,
+    KEY_HOME,
+    KEY_END,
+    KEY_PAGE_UP,
+    KEY_PAGE_DOWN,
+    KEY_PRINT_SCREEN,
+    KEY_PAUSE,
+    KEY_COUNT
 } ps2_key_t;
 
+/* Modifier bits in kbd_event_t.modifiers / kbd_state_t.modifiers */
+#define MOD_LSHIFT (1 << 0)
+#define MOD_RSHIFT (1 << 1)
+#define MOD_LCTRL  (1 << 2)
+#define MOD_RCTRL  (1 << 3)
+#define MOD_LALT   (1 << 4)
+#define MOD_RALT   (1 << 5)
+
 typedef struct {
     uint8_t pressed;           // 1=key down, 0=key up
     uint8_t key;               // ps2_key_t
     uint8_t modifiers;         // MOD_* mask
+    uint32_t time_ms;          // kernel_get_ticks_ms() at enqueue
+    uint64_t tsc;              // rdtsc() at IRQ1 entry
 } kbd_event_t;
 
+/* End-to-end input latency, all in TSC cycles except depth. */
+typedef struct {
+    hist_t isr;                // IRQ1 top-half duration
+    hist_t residency;          // IRQ1 entry -> kbd_dequeue
+    hist_t depth;              // events already queued at enqueue
+} kbd_latency_stats_t;
+
+/* Snapshot of every key currently held, for O(1) per-frame polling. */
+#define KBD_STATE_WORDS 8      // 256 bits, one per ps2_key_t value
+
+typedef struct {
+    uint32_t keys[KBD_STATE_WORDS];  // bit (k & 31) of keys[k >> 5]: key k held
+    uint8_t modifiers;               // MOD_* mask
+    uint32_t dropped;                // events lost to a full queue since boot
+} kbd_state_t;
+
+static inline bool kbd_state_key_down(const kbd_state_t *state, ps2_key_t key) {
+    return (state->keys[key >> 5] >> (key & 31)) & 1;
+}
+
+/* Decode one scancode byte: updates key/modifier state and enqueues events */
+void ps2_process_scancode(uint8_t scancode);
+
+/* Select the scan code set (1 or 2) ps2_process_scancode decodes. Only the
+   decoder changes; the controller/keyboard must already be sending that set.
+   Returns false for any other value. */
+bool ps2_set_scancode_set(uint8_t set);
+uint8_t ps2_get_scancode_set(void);
+
 /* IRQ1 handler — reads scancode and enqueues it */
 void ps2_irq1_handler(void);
 
@@ -86,8 +185,17 @@ void kbd_init(void);
 void kbd_enqueue(kbd_event_t event);
 int kbd_dequeue(kbd_event_t *out);
 int exo_kbd_poll(kbd_event_t *event_out);
+int exo_kbd_state(kbd_state_t *state_out);
+uint32_t kbd_dropped_events(void);
+uint32_t kbd_queue_high_watermark(void);
+const kbd_latency_stats_t* kbd_latency_stats(void);
+void kbd_latency_reset(void);
+void kbd_latency_dump(void);
 uint8_t ps2_get_modifier_state(void);
 
+/* Enable/disable per-key serial logging (on by default) */
+void ps2_set_verbose(bool verbose);
+
 /* Access modifier state */
 bool ps2_shift_active(void);
 bool ps2_ctrl_active(void);
@@ -0,0 +1,257 @@
+#include "ps2_mouse.h"
+#include "io.h"
+#include "pic.h"
+#include "cpu.h"
+#include "pit.h"
+
+#define PS2_DATA_PORT    0x60
+#define PS2_STATUS_PORT  0x64
+#define PS2_COMMAND_PORT 0x64
+
+#define PS2_STATUS_OUTPUT_FULL (1 << 0)   // a byte is waiting at 0x60
+#define PS2_STATUS_INPUT_FULL  (1 << 1)   // controller has not taken our last write
+
+// i8042 controller commands (port 0x64)
+#define CTRL_READ_CONFIG  0x20
+#define CTRL_WRITE_CONFIG 0x60
+#define CTRL_ENABLE_AUX   0xA8
+#define CTRL_WRITE_AUX    0xD4   // next byte written to 0x60 goes to the mouse
+
+#define CONFIG_AUX_IRQ       (1 << 1)
+#define CONFIG_AUX_CLOCK_OFF (1 << 5)
+
+// Mouse commands (sent through CTRL_WRITE_AUX)
+#define MOUSE_GET_ID         0xF2
+#define MOUSE_SET_RATE       0xF3
+#define MOUSE_ENABLE_STREAM  0xF4
+#define MOUSE_DISABLE_STREAM 0xF5
+#define MOUSE_SET_DEFAULTS   0xF6
+
+#define MOUSE_ACK    0xFA
+#define MOUSE_RESEND 0xFE
+#define MOUSE_ERROR  0xFC
+
+#define MOUSE_ID_WHEEL      3
+#define MOUSE_DEFAULT_RATE  100
+
+#define PS2_TIMEOUT 100000    // status polls before giving up on the controller
+#define MOUSE_REPLY_SKIP 8    // stale packet bytes tolerated before an ACK
+
+// Packet byte 0
+#define PKT_BUTTONS    0x07
+#define PKT_ALWAYS1    0x08
+#define PKT_X_OVERFLOW 0x40
+#define PKT_Y_OVERFLOW 0x80
+
+// A gap this long inside a packet means bytes were lost; start over.
+#define MOUSE_RESYNC_MS 20
+
+static uint8_t packet[4];
+static uint8_t packet_index = 0;
+static uint8_t packet_size = 3;
+static uint32_t last_byte_ms = 0;
+static bool has_wheel = false;
+
+// Accumulated in the IRQ12 top half, consumed by exo_mouse_poll.
+static volatile int32_t acc_dx = 0;
+static volatile int32_t acc_dy = 0;
+static volatile int32_t acc_wheel = 0;
+static volatile uint8_t acc_buttons = 0;
+
+static uint32_t packets = 0;
+static uint32_t resyncs = 0;
+
+void ps2_mouse_process_byte(uint8_t data) {
+    uint32_t now = kernel_get_ticks_ms();
+    if (packet_index != 0 && now - last_byte_ms > MOUSE_RESYNC_MS) {
+        resyncs++;
+        packet_index = 0;
+    }
+    last_byte_ms = now;
+
+    // Bit 3 of the first byte is always set. Anything else means we are
+    // mid-packet: drop bytes until a plausible first byte turns up.
+    if (packet_index == 0 && !(data & PKT_ALWAYS1)) {
+        resyncs++;
+        return;
+    }
+
+    packet[packet_index++] = data;
+    if (packet_index < packet_size) return;
+    packet_index = 0;
+
+    // The IntelliMouse Z byte is a sign-extended 4-bit value (-8..7).
+    int8_t wheel = (int8_t)packet[3];
+    if (packet_size == 4 && (wheel < -8 || wheel > 7)) {
+        resyncs++;
+        return;
+    }
+
+    uint8_t flags = packet[0];
+    packets++;
+    acc_buttons = flags & PKT_BUTTONS;
+
+    // Overflowed motion is meaningless; keep the buttons, drop the deltas.
+    if (flags & (PKT_X_OVERFLOW | PKT_Y_OVERFLOW)) return;
+
+    // 9-bit two's complement: sign bits are flags bit 4 (X) and bit 5 (Y).
+    acc_dx += (int32_t)packet[1] - ((flags << 4) & 0x100);
+    acc_dy += (int32_t)packet[2] - ((flags << 3) & 0x100);
+    if (packet_size == 4) {
+        acc_wheel += wheel;
+    }
+}
+
+bool ps2_mouse_set_packet_size(uint8_t bytes) {
+    if (bytes != 3 && bytes != 4) return false;
+
+    uint32_t flags = irq_save();
+    packet_size = bytes;
+    packet_index = 0;
+    irq_restore(flags);
+    return true;
+}
+
+static int32_t clamp(int32_t v, int32_t lo, int32_t hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+int exo_mouse_poll(mouse_state_t *state_out) {
+    if (!state_out) return 0;
+
+    // Hand out at most what fits and keep the remainder, so a long gap
+    // between polls delays motion but never loses it.
+    uint32_t flags = irq_save();
+    int32_t dx = clamp(acc_dx, -32768, 32767);
+    int32_t dy = clamp(acc_dy, -32768, 32767);
+    int32_t wheel = clamp(acc_wheel, -128, 127);
+    acc_dx -= dx;
+    acc_dy -= dy;
+    acc_wheel -= wheel;
+    state_out->buttons = acc_buttons;
+    irq_restore(flags);
+
+    state_out->dx = (int16_t)dx;
+    state_out->dy = (int16_t)dy;
+    state_out->wheel = (int8_t)wheel;
+    return 1;
+}
+
+/* ── i8042 / device I/O (init-time and configuration only) ── */
+
+static bool ps2_wait_write(void) {
+    for (uint32_t i = 0; i < PS2_TIMEOUT; i++) {
+        if (!(inb(PS2_STATUS_PORT) & PS2_STATUS_INPUT_FULL)) return true;
+    }
+    return false;
+}
+
+static bool ps2_wait_read(void) {
+    for (uint32_t i = 0; i < PS2_TIMEOUT; i++) {
+        if (inb(PS2_STATUS_PORT) & PS2_STATUS_OUTPUT_FULL) return true;
+    }
+    return false;
+}
+
+static bool ctrl_command(uint8_t cmd) {
+    if (!ps2_wait_write()) return false;
+    outb(PS2_COMMAND_PORT, cmd);
+    return true;
+}
+
+static bool ctrl_write_data(uint8_t data) {
+    if (!ps2_wait_write()) return false;
+    outb(PS2_DATA_PORT, data);
+    return true;
+}
+
+static bool ctrl_read_data(uint8_t *out) {
+    if (!ps2_wait_read()) return false;
+    *out = inb(PS2_DATA_PORT);
+    return true;
+}
+
+/* Send one byte to the mouse and wait for its ACK, skipping any packet bytes
+   that were already in flight. */
+static bool mouse_write(uint8_t byte) {
+    if (!ctrl_command(CTRL_WRITE_AUX) || !ctrl_write_data(byte)) return false;
+
+    for (int i = 0; i < MOUSE_REPLY_SKIP; i++) {
+        uint8_t reply;
+        if (!ctrl_read_data(&reply)) return false;
+        if (reply == MOUSE_ACK) return true;
+        if (reply == MOUSE_RESEND || reply == MOUSE_ERROR) return false;
+    }
+    return false;
+}
+
+static bool mouse_write_rate(uint8_t hz) {
+    return mouse_write(MOUSE_SET_RATE) && mouse_write(hz);
+}
+
+bool mouse_set_sample_rate(uint8_t hz) {
+    static const uint8_t valid[] = { 10, 20, 40, 60, 80, 100, 200 };
+    bool ok = false;
+    for (uint32_t i = 0; i < sizeof(valid); i++) {
+        ok |= valid[i] == hz;
+    }
+    if (!ok) return false;
+
+    // Stop streaming and keep IRQ12 from eating the ACKs while we talk to
+    // the device; the half-assembled packet is discarded.
+    uint32_t flags = irq_save();
+    pic_mask(12);
+    ok = mouse_write(MOUSE_DISABLE_STREAM)
+      && mouse_write_rate(hz)
+      && mouse_write(MOUSE_ENABLE_STREAM);
+    packet_index = 0;
+    pic_unmask(12);
+    irq_restore(flags);
+
+    return ok;
+}
+
+bool ps2_mouse_init(void) {
+    uint8_t config;
+    uint8_t id = 0;
+
+    pic_mask(12);
+
+    if (!ctrl_command(CTRL_ENABLE_AUX)) return false;
+
+    // Route aux data to IRQ12 and make sure the aux clock is running.
+    if (!ctrl_command(CTRL_READ_CONFIG) || !ctrl_read_data(&config)) return false;
+    config |= CONFIG_AUX_IRQ;
+    config &= ~CONFIG_AUX_CLOCK_OFF;
+    if (!ctrl_command(CTRL_WRITE_CONFIG) || !ctrl_write_data(config)) return false;
+
+    if (!mouse_write(MOUSE_SET_DEFAULTS)) return false;
+
+    // IntelliMouse knock: rates 200, 100, 80 switch a wheel mouse to ID 3
+    // and 4-byte packets. Plain mice ignore it and keep reporting ID 0.
+    has_wheel = mouse_write_rate(200)
+             && mouse_write_rate(100)
+             && mouse_write_rate(80)
+             && mouse_write(MOUSE_GET_ID)
+             && ctrl_read_data(&id)
+             && id == MOUSE_ID_WHEEL;
+    ps2_mouse_set_packet_size(has_wheel ? 4 : 3);
+
+    if (!mouse_write_rate(MOUSE_DEFAULT_RATE)) return false;
+    if (!mouse_write(MOUSE_ENABLE_STREAM)) return false;
+
+    pic_unmask(12);
+    return true;
+}
+
+/* Top half: one byte per interrupt, decoded and accumulated with IF=0. */
+void irq12_handler(void) {
+    if (inb(PS2_STATUS_PORT) & PS2_STATUS_OUTPUT_FULL) {
+        ps2_mouse_process_byte(inb(PS2_DATA_PORT));
+    }
+    pic_send_EOI(12);
+}
+
+bool ps2_mouse_has_wheel(void) { return has_wheel; }
+uint32_t ps2_mouse_packets(void) { return packets; }
+uint32_t ps2_mouse_resyncs(void) { return resyncs; }
@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * ps2_mouse.h — PS/2 auxiliary-device (mouse) driver on IRQ12.
+ *
+ * The IRQ12 top half assembles 3-byte (standard) or 4-byte (IntelliMouse
+ * wheel) packets and adds the motion straight into accumulators, so
+ * exo_mouse_poll is O(1) and no motion is lost however rarely it is called.
+ * Deltas use the PS/2 convention: +dx is right, +dy is up.
+ */
+
+#define MOUSE_BUTTON_LEFT   (1 << 0)
+#define MOUSE_BUTTON_RIGHT  (1 << 1)
+#define MOUSE_BUTTON_MIDDLE (1 << 2)
+
+typedef struct {
+    int16_t dx;          // motion since the last poll, clamped
+    int16_t dy;
+    uint8_t buttons;     // MOUSE_BUTTON_* held at the latest packet
+    int8_t  wheel;       // wheel clicks since the last poll (4-byte mode)
+} mouse_state_t;
+
+/* Enable the aux port, detect an IntelliMouse, set the default packet rate
+   and start streaming on IRQ12. Returns false if the device does not ACK. */
+bool ps2_mouse_init(void);
+
+/* Feed one packet byte to the decoder (IRQ12 top half; used by tests). */
+void ps2_mouse_process_byte(uint8_t data);
+
+/* Select 3- or 4-byte packets and restart assembly at byte 0. */
+bool ps2_mouse_set_packet_size(uint8_t bytes);
+
+/* Packets per second: 10, 20, 40, 60, 80, 100 or 200. Higher rates reduce
+   aiming latency. Returns false for other values or if the mouse NAKs. */
+bool mouse_set_sample_rate(uint8_t hz);
+
+/* Copy accumulated motion/buttons into *state_out and reset the motion.
+   Returns 0 if state_out is NULL, 1 otherwise. */
+int exo_mouse_poll(mouse_state_t *state_out);
+
+/* Diagnostics */
+bool ps2_mouse_has_wheel(void);
+uint32_t ps2_mouse_packets(void);
+uint32_t ps2_mouse_resyncs(void);
+
+/* IRQ12 handler symbol used by IRQ stub */
+void irq12_handler(void);
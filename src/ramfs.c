@@ -0,0 +1,503 @@
+#include "ramfs.h"
+#include "pmm.h"
+#include "bcache.h"
+#include "cpu.h"
+#include "tsc.h"
+#include "serial.h"
+#include "string.h"
+
+#define INDEX_SLOTS 128            // power of 2, twice RAMFS_MAX_FILES
+#define SLOT_EMPTY  (-1)
+#define SLOT_DEAD   (-2)           // tombstone left by remove/rename
+
+#define DISK_MAGIC   0x53464D52u   // "RMFS"
+#define DISK_VERSION 1
+
+_Static_assert(INDEX_SLOTS >= 2 * RAMFS_MAX_FILES, "index too small");
+
+typedef struct {
+    char name[RAMFS_NAME_MAX];
+    uint8_t* data;                 // extent base (identity mapped)
+    uint32_t size;
+    uint32_t pages;                // extent length
+    uint16_t refs;                 // open descriptors
+    bool used;
+    bool linked;                   // reachable through the index
+} ramfs_file_t;
+
+typedef struct {
+    int16_t file;                  // -1: free
+    uint8_t mode;
+    uint32_t pos;
+} ramfs_fd_t;
+
+static ramfs_file_t files[RAMFS_MAX_FILES];
+static ramfs_fd_t fds[RAMFS_MAX_FDS];
+static int16_t name_index[INDEX_SLOTS];
+static uint32_t dead_slots = 0;
+static ramfs_stats_t stats;
+static bool dirty = false;         // changed since the last save or load
+
+/* On-disk directory in block 0. */
+typedef struct {
+    char name[RAMFS_NAME_MAX];
+    uint32_t first_block;
+    uint32_t size;
+} disk_entry_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t blocks;               // end of the file data
+    disk_entry_t entries[RAMFS_MAX_FILES];
+} disk_dir_t;
+
+_Static_assert(sizeof(disk_dir_t) <= BLOCK_SIZE, "directory must fit block 0");
+
+static disk_dir_t dir;
+
+/* Blocks [disk_lo, disk_hi) hold the data the on-disk directory points at.
+   A save never writes there, so a save cut short leaves the old copy whole. */
+static uint32_t disk_lo = 1, disk_hi = 1;
+
+/* FNV-1a over the name bytes. */
+static uint32_t name_hash(const char* name) {
+    uint32_t h = 2166136261u;
+    while (*name) {
+        h = (h ^ (uint8_t)*name++) * 16777619u;
+    }
+    return h;
+}
+
+static int32_t check_name(const char* name) {
+    size_t len = strlen(name);
+    if (len == 0) return -EXO_EINVAL;
+    if (len >= RAMFS_NAME_MAX) return -EXO_ENAMETOOLONG;
+    return 0;
+}
+
+/* Index slot holding `name`, or -1. */
+static int32_t index_lookup(const char* name) {
+    stats.lookups++;
+    uint32_t h = name_hash(name);
+    for (uint32_t i = 0; i < INDEX_SLOTS; i++) {
+        uint32_t slot = (h + i) & (INDEX_SLOTS - 1);
+        stats.probes++;
+        if (name_index[slot] == SLOT_EMPTY) return -1;
+        if (name_index[slot] >= 0 && strcmp(files[name_index[slot]].name, name) == 0) {
+            return (int32_t)slot;
+        }
+    }
+    return -1;
+}
+
+static void index_insert(const char* name, int16_t file) {
+    uint32_t h = name_hash(name);
+    for (uint32_t i = 0;; i++) {
+        uint32_t slot = (h + i) & (INDEX_SLOTS - 1);
+        if (name_index[slot] < 0) {
+            if (name_index[slot] == SLOT_DEAD) dead_slots--;
+            name_index[slot] = file;
+            return;
+        }
+    }
+}
+
+static int32_t lookup_file(const char* name) {
+    int32_t slot = index_lookup(name);
+    return slot < 0 ? -1 : name_index[slot];
+}
+
+static void release_if_unused(ramfs_file_t* f) {
+    if (f->linked || f->refs) return;
+    if (f->data) free_pages(f->data, f->pages);
+    *f = (ramfs_file_t){0};
+}
+
+static void kill_slot(int32_t slot) {
+    name_index[slot] = SLOT_DEAD;
+    dead_slots++;
+}
+
+/* Tombstones lengthen every miss; rehash the live names once too many
+   pile up. */
+static void index_compact(void) {
+    if (dead_slots <= INDEX_SLOTS / 4) return;
+
+    for (uint32_t i = 0; i < INDEX_SLOTS; i++) {
+        name_index[i] = SLOT_EMPTY;
+    }
+    for (int16_t i = 0; i < RAMFS_MAX_FILES; i++) {
+        if (files[i].used && files[i].linked) index_insert(files[i].name, i);
+    }
+    dead_slots = 0;
+}
+
+static void unlink_slot(int32_t slot) {
+    ramfs_file_t* f = &files[name_index[slot]];
+    f->linked = false;
+    kill_slot(slot);
+    release_if_unused(f);
+}
+
+static int32_t create_file(const char* name) {
+    for (int16_t i = 0; i < RAMFS_MAX_FILES; i++) {
+        if (files[i].used) continue;
+        files[i] = (ramfs_file_t){0};
+        strncpy(files[i].name, name, RAMFS_NAME_MAX - 1);
+        files[i].used = true;
+        files[i].linked = true;
+        index_insert(name, i);
+        return i;
+    }
+    return -EXO_ENOSPC;
+}
+
+/* Make room for `need` bytes, at least doubling the extent when it grows. */
+static int32_t reserve(ramfs_file_t* f, uint32_t need) {
+    if (need <= f->pages * PAGE_SIZE) return 0;
+
+    uint32_t min_pages = (need + PAGE_SIZE - 1) / PAGE_SIZE;
+    uint32_t want = f->pages * 2 > min_pages ? f->pages * 2 : min_pages;
+    uint8_t* extent = alloc_pages(want);
+    if (!extent && want > min_pages) {
+        want = min_pages;
+        extent = alloc_pages(want);
+    }
+    if (!extent) return -EXO_ENOMEM;
+
+    if (f->data) {
+        memcpy(extent, f->data, f->size);
+        free_pages(f->data, f->pages);
+        stats.grows++;
+        stats.bytes_moved += f->size;
+    }
+    f->data = extent;
+    f->pages = want;
+    return 0;
+}
+
+static ramfs_fd_t* get_fd(int32_t fd) {
+    if (fd < 0 || fd >= RAMFS_MAX_FDS || fds[fd].file < 0) return 0;
+    return &fds[fd];
+}
+
+void ramfs_init(void) {
+    for (uint32_t i = 0; i < RAMFS_MAX_FILES; i++) {
+        if (files[i].used && files[i].data) {
+            free_pages(files[i].data, files[i].pages);
+        }
+        files[i] = (ramfs_file_t){0};
+    }
+    for (uint32_t i = 0; i < RAMFS_MAX_FDS; i++) {
+        fds[i].file = -1;
+    }
+    for (uint32_t i = 0; i < INDEX_SLOTS; i++) {
+        name_index[i] = SLOT_EMPTY;
+    }
+    dead_slots = 0;
+    dirty = false;
+    disk_lo = disk_hi = 1;
+    stats = (ramfs_stats_t){0};
+}
+
+int32_t ramfs_open(const char* name, uint32_t mode) {
+    int32_t err = check_name(name);
+    if (err) return err;
+    if (mode > EXO_O_RDWR) return -EXO_EINVAL;
+
+    int32_t fd = 0;
+    while (fd < RAMFS_MAX_FDS && fds[fd].file >= 0) fd++;
+    if (fd == RAMFS_MAX_FDS) return -EXO_EMFILE;
+
+    int32_t file = lookup_file(name);
+    if (file < 0) {
+        if (mode != EXO_O_WRITE) return -EXO_ENOENT;
+        file = create_file(name);
+        if (file < 0) return file;
+    } else if (mode == EXO_O_WRITE) {
+        files[file].size = 0;     // truncate, keep the extent
+        dirty = true;
+    }
+
+    files[file].refs++;
+    fds[fd].file = (int16_t)file;
+    fds[fd].mode = (uint8_t)mode;
+    fds[fd].pos = 0;
+    stats.opens++;
+    return fd;
+}
+
+int32_t ramfs_close(int32_t fd) {
+    ramfs_fd_t* d = get_fd(fd);
+    if (!d) return -EXO_EBADF;
+
+    ramfs_file_t* f = &files[d->file];
+    d->file = -1;
+    f->refs--;
+    release_if_unused(f);
+    return 0;
+}
+
+int32_t ramfs_read(int32_t fd, void* buf, uint32_t count) {
+    ramfs_fd_t* d = get_fd(fd);
+    if (!d || d->mode == EXO_O_WRITE) return -EXO_EBADF;
+
+    ramfs_file_t* f = &files[d->file];
+    if (d->pos >= f->size) return 0;
+    if (count > f->size - d->pos) count = f->size - d->pos;
+
+    memcpy(buf, f->data + d->pos, count);
+    d->pos += count;
+    stats.reads++;
+    stats.bytes_read += count;
+    return (int32_t)count;
+}
+
+int32_t ramfs_write(int32_t fd, const void* buf, uint32_t count) {
+    ramfs_fd_t* d = get_fd(fd);
+    if (!d || d->mode == EXO_O_READ) return -EXO_EBADF;
+    if (count > 0x7FFFFFFFu - d->pos) return -EXO_EINVAL;
+
+    ramfs_file_t* f = &files[d->file];
+    uint32_t end = d->pos + count;
+    int32_t err = reserve(f, end);
+    if (err) return err;
+
+    // Writing past EOF leaves a zero-filled gap, as with lseek + write.
+    if (d->pos > f->size) {
+        memset(f->data + f->size, 0, d->pos - f->size);
+    }
+    memcpy(f->data + d->pos, buf, count);
+    d->pos = end;
+    if (end > f->size) f->size = end;
+    dirty = true;
+
+    stats.writes++;
+    stats.bytes_written += count;
+    return (int32_t)count;
+}
+
+int32_t ramfs_seek(int32_t fd, int32_t offset, uint32_t whence) {
+    ramfs_fd_t* d = get_fd(fd);
+    if (!d) return -EXO_EBADF;
+
+    int64_t base;
+    switch (whence) {
+        case EXO_SEEK_SET: base = 0; break;
+        case EXO_SEEK_CUR: base = d->pos; break;
+        case EXO_SEEK_END: base = files[d->file].size; break;
+        default: return -EXO_EINVAL;
+    }
+    int64_t pos = base + offset;
+    if (pos < 0 || pos > 0x7FFFFFFF) return -EXO_EINVAL;
+
+    d->pos = (uint32_t)pos;
+    return (int32_t)pos;
+}
+
+int32_t ramfs_stat(const char* name, uint32_t* size_out) {
+    int32_t err = check_name(name);
+    if (err) return err;
+
+    int32_t file = lookup_file(name);
+    if (file < 0) return -EXO_ENOENT;
+    *size_out = files[file].size;
+    return 0;
+}
+
+int32_t ramfs_remove(const char* name) {
+    int32_t err = check_name(name);
+    if (err) return err;
+
+    int32_t slot = index_lookup(name);
+    if (slot < 0) return -EXO_ENOENT;
+    unlink_slot(slot);
+    index_compact();
+    dirty = true;
+    return 0;
+}
+
+int32_t ramfs_rename(const char* old_name, const char* new_name) {
+    int32_t err = check_name(old_name);
+    if (!err) err = check_name(new_name);
+    if (err) return err;
+
+    int32_t old_slot = index_lookup(old_name);
+    if (old_slot < 0) return -EXO_ENOENT;
+    if (strcmp(old_name, new_name) == 0) return 0;
+
+    // Syscalls run one at a time, so nothing observes the steps between
+    // dropping the target and re-keying the source.
+    int32_t new_slot = index_lookup(new_name);
+    if (new_slot >= 0) unlink_slot(new_slot);
+
+    int16_t file = name_index[old_slot];
+    kill_slot(old_slot);
+    strncpy(files[file].name, new_name, RAMFS_NAME_MAX - 1);
+    files[file].name[RAMFS_NAME_MAX - 1] = '\0';
+    index_insert(new_name, file);
+    index_compact();
+    dirty = true;
+    return 0;
+}
+
+int32_t ramfs_seed(const char* name, const void* data, uint32_t size) {
+    int32_t fd = ramfs_open(name, EXO_O_WRITE);
+    if (fd < 0) return fd;
+
+    int32_t written = ramfs_write(fd, data, size);
+    ramfs_close(fd);
+    return written;
+}
+
+int32_t ramfs_save(void) {
+    if (!bcache_dev()) return -EXO_ENODEV;
+    uint64_t start = rdtsc();
+
+    // Lay the files out back to back, first as offsets into the data.
+    dir = (disk_dir_t){ .magic = DISK_MAGIC, .version = DISK_VERSION };
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < RAMFS_MAX_FILES; i++) {
+        if (!files[i].used || !files[i].linked) continue;
+        disk_entry_t* e = &dir.entries[dir.count++];
+        memcpy(e->name, files[i].name, RAMFS_NAME_MAX);
+        e->first_block = used;
+        e->size = files[i].size;
+        used += (files[i].size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    }
+
+    // Place the data clear of what the current directory references: after
+    // it if there is room, otherwise in the gap before it.
+    uint32_t first;
+    uint32_t blocks = bcache_dev()->blocks;
+    if (disk_hi <= blocks && used <= blocks - disk_hi) first = disk_hi;
+    else if (used <= disk_lo - 1) first = 1;
+    else return -EXO_ENOSPC;
+    dir.blocks = first + used;
+
+    // Data first, directory last: block 0 switches to the new copy only
+    // once all of it is on the disk.
+    int32_t err = 0;
+    for (uint32_t i = 0, e = 0; err >= 0 && i < RAMFS_MAX_FILES; i++) {
+        if (!files[i].used || !files[i].linked) continue;
+        dir.entries[e].first_block += first;
+        err = bcache_write(dir.entries[e++].first_block, files[i].data,
+                           files[i].size);
+    }
+    if (err >= 0) err = bcache_flush();
+    if (err >= 0) err = bcache_write(0, &dir, sizeof(dir));
+    if (err >= 0) err = bcache_flush();
+    if (err < 0) return err;
+
+    disk_lo = first;
+    disk_hi = dir.blocks;
+    dirty = false;
+    stats.saves++;
+    stats.save_cycles = rdtsc() - start;
+    return (int32_t)dir.count;
+}
+
+int32_t ramfs_load(void) {
+    if (!bcache_dev()) return -EXO_ENODEV;
+    uint64_t start = rdtsc();
+
+    int32_t err = bcache_read(0, &dir, sizeof(dir));
+    if (err < 0) return err;
+    if (dir.magic != DISK_MAGIC || dir.version != DISK_VERSION
+        || dir.count > RAMFS_MAX_FILES || dir.blocks == 0
+        || dir.blocks > bcache_dev()->blocks) {
+        return -EXO_ENOENT;
+    }
+
+    uint32_t loaded = 0;
+    disk_lo = disk_hi = dir.blocks;
+    for (uint32_t e = 0; e < dir.count; e++) {
+        disk_entry_t* d = &dir.entries[e];
+        d->name[RAMFS_NAME_MAX - 1] = '\0';
+        uint32_t blocks = (d->size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        if (check_name(d->name) || d->size > 0x7FFFFFFFu
+            || d->first_block == 0 || d->first_block > dir.blocks
+            || blocks > dir.blocks - d->first_block) {
+            continue;                 // skip a corrupt entry
+        }
+        if (blocks && d->first_block < disk_lo) disk_lo = d->first_block;
+
+        int32_t file = lookup_file(d->name);
+        if (file < 0) file = create_file(d->name);
+        if (file < 0) return file;
+
+        ramfs_file_t* f = &files[file];
+        f->size = 0;
+        err = reserve(f, d->size);
+        if (!err) err = bcache_read(d->first_block, f->data, d->size);
+        if (err < 0) return err;
+        f->size = d->size;
+        loaded++;
+    }
+
+    dirty = false;
+    stats.loads++;
+    stats.load_cycles = rdtsc() - start;
+    return (int32_t)loaded;
+}
+
+int32_t ramfs_sync(void) {
+    if (!dirty) return 0;
+    int32_t saved = ramfs_save();
+    return saved < 0 ? saved : 0;
+}
+
+bool ramfs_dirty(void) {
+    return dirty;
+}
+
+const ramfs_stats_t* ramfs_stats(void) {
+    return &stats;
+}
+
+void ramfs_dump(void) {
+    serial_print("ramfs:\n");
+    for (uint32_t i = 0; i < RAMFS_MAX_FILES; i++) {
+        if (!files[i].used) continue;
+        serial_print("  ");
+        serial_print(files[i].name);
+        serial_print(files[i].linked ? " " : " (removed) ");
+        serial_print_u32(files[i].size);
+        serial_print(" bytes, ");
+        serial_print_u32(files[i].pages);
+        serial_print(" pages, ");
+        serial_print_u32(files[i].refs);
+        serial_print(" open\n");
+    }
+    serial_print("  opens=");
+    serial_print_u32(stats.opens);
+    serial_print(" reads=");
+    serial_print_u32(stats.reads);
+    serial_print(" writes=");
+    serial_print_u32(stats.writes);
+    serial_print(" read=");
+    serial_print_u32((uint32_t)stats.bytes_read);
+    serial_print("B written=");
+    serial_print_u32((uint32_t)stats.bytes_written);
+    serial_print("B\n  grows=");
+    serial_print_u32(stats.grows);
+    serial_print(" moved=");
+    serial_print_u32((uint32_t)stats.bytes_moved);
+    serial_print("B lookups=");
+    serial_print_u32(stats.lookups);
+    serial_print(" probes=");
+    serial_print_u32(stats.probes);
+    serial_print("\n");
+    if (!bcache_dev()) return;
+    serial_print("  saves=");
+    serial_print_u32(stats.saves);
+    serial_print(" last=");
+    serial_print_u32(tsc_cycles_to_us(stats.save_cycles));
+    serial_print("us loads=");
+    serial_print_u32(stats.loads);
+    serial_print(" last=");
+    serial_print_u32(tsc_cycles_to_us(stats.load_cycles));
+    serial_print(dirty ? "us, unsaved changes\n" : "us\n");
+}
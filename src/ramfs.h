@@ -0,0 +1,86 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "exo_abi.h"
+
+/*
+ * ramfs.h — Flat-namespace RAM disk behind the exo_file_* syscalls
+ * (docs/syscall_spec.md §4).
+ *
+ * Each file is one physically contiguous extent from the page allocator.
+ * When a write outgrows it, the extent is replaced by one at least twice
+ * its size, so a save game written in many small fwrite() calls is copied
+ * O(log n) times, not once per call.  Names are looked up through an
+ * open-addressed hash; seek is a position update.
+ *
+ * With a block device attached to the block cache, ramfs_save() writes
+ * the whole namespace to disk and ramfs_load() reads it back: block 0
+ * holds a directory of names, sizes and first blocks, and each file's
+ * data follows in consecutive blocks, so both directions are a handful
+ * of batched device requests.
+ *
+ * All entry points return a non-negative result or -EXO_E*.
+ */
+
+#define RAMFS_MAX_FILES   64
+#define RAMFS_MAX_FDS     16
+#define RAMFS_NAME_MAX    32     // including the terminating NUL
+
+typedef struct {
+    uint32_t opens;
+    uint32_t reads;
+    uint32_t writes;
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint32_t grows;          // extent reallocations
+    uint64_t bytes_moved;    // bytes copied by those reallocations
+    uint32_t lookups;
+    uint32_t probes;         // index slots visited by those lookups
+    uint32_t saves;
+    uint32_t loads;
+    uint64_t save_cycles;    // TSC cycles of the last save
+    uint64_t load_cycles;    // TSC cycles of the last load
+} ramfs_stats_t;
+
+/* Drop every file and descriptor and reset the counters. */
+void ramfs_init(void);
+
+int32_t ramfs_open(const char* name, uint32_t mode);   // EXO_O_*; returns fd
+int32_t ramfs_close(int32_t fd);
+int32_t ramfs_read(int32_t fd, void* buf, uint32_t count);
+int32_t ramfs_write(int32_t fd, const void* buf, uint32_t count);
+int32_t ramfs_seek(int32_t fd, int32_t offset, uint32_t whence);  // EXO_SEEK_*
+int32_t ramfs_stat(const char* name, uint32_t* size_out);
+
+/* Open descriptors keep a removed (or replaced) file readable until they
+   are closed. */
+int32_t ramfs_remove(const char* name);
+
+/* Replace `new_name` (if it exists) with `old_name` in one step, so a
+   reader sees either the old or the new file under `new_name`, never
+   neither. */
+int32_t ramfs_rename(const char* old_name, const char* new_name);
+
+/* Create or overwrite `name` with a copy of `data` (e.g. a multiboot
+   module). Returns the size written. */
+int32_t ramfs_seed(const char* name, const void* data, uint32_t size);
+
+/* Write every file to the block cache's device and flush it. Returns the
+   number of files saved, -EXO_ENODEV without a device, or -EXO_ENOSPC if
+   the files do not fit beside the copy already on the disk. */
+int32_t ramfs_save(void);
+
+/* Read the files saved on the device, replacing any with the same name.
+   Returns the number loaded, or -EXO_ENOENT if the disk holds no ramfs. */
+int32_t ramfs_load(void);
+
+/* Save if anything changed since the last save or load. */
+int32_t ramfs_sync(void);
+
+/* Whether files changed since the last save or load. */
+bool ramfs_dirty(void);
+
+const ramfs_stats_t* ramfs_stats(void);
+
+/* List files and print the counters over serial. */
+void ramfs_dump(void);
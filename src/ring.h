@@ -0,0 +1,88 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "cpu.h"
+
+/*
+ * ring.h — Type-specialised single-producer/single-consumer ring buffers.
+ *
+ * For the IRQ-producer / task-consumer pattern used by the drivers: the top
+ * half pushes, a bottom half or the LibOS pops.  RING_DEFINE(name, type, size)
+ * generates `name_t` and a set of static inline operations on it:
+ *
+ *   name_init(r)            empty the ring and clear the counters
+ *   name_push(r, &item)     false (and counts an overflow) if full
+ *   name_push_n(r, items, n)  push as many as fit, return how many
+ *   name_pop(r, &item)      false if empty
+ *   name_pop_n(r, items, n) pop up to n, return how many
+ *   name_count(r)           items currently queued
+ *
+ * head and tail are free-running uint32_t counters masked on access, so all
+ * `size` slots are usable and wrap-around needs no special case.  Only the
+ * producer writes head and only the consumer writes tail; the slot is written
+ * before head is published (and read before tail is released) with a compiler
+ * barrier in between, which is all x86 needs on one core.  More than one
+ * producer (or consumer) must serialise itself, e.g. with irq_save().
+ */
+
+#define RING_DEFINE(name, type, size)                                          \
+    _Static_assert((size) > 0 && ((size) & ((size) - 1)) == 0,                 \
+                   #name ": size must be a power of 2");                       \
+                                                                               \
+    typedef struct {                                                           \
+        type items[size];                                                      \
+        volatile uint32_t head;     /* next slot to fill; producer only */    \
+        volatile uint32_t tail;     /* next slot to read; consumer only */    \
+        uint32_t high_watermark;    /* deepest the ring has been */           \
+        uint32_t overflows;         /* items refused because it was full */   \
+    } name##_t;                                                                \
+                                                                               \
+    static inline void name##_init(name##_t* r) {                              \
+        r->head = 0;                                                           \
+        r->tail = 0;                                                           \
+        r->high_watermark = 0;                                                 \
+        r->overflows = 0;                                                      \
+    }                                                                          \
+                                                                               \
+    static inline uint32_t name##_count(const name##_t* r) {                   \
+        return r->head - r->tail;                                              \
+    }                                                                          \
+                                                                               \
+    static inline uint32_t name##_push_n(name##_t* r, const type* src,         \
+                                         uint32_t n) {                         \
+        uint32_t head = r->head;                                               \
+        uint32_t room = (size) - (head - r->tail);                             \
+        uint32_t take = n < room ? n : room;                                   \
+        for (uint32_t i = 0; i < take; i++) {                                  \
+            r->items[(head + i) & ((size) - 1)] = src[i];                      \
+        }                                                                      \
+        cpu_barrier();                                                         \
+        r->head = head + take;                                                 \
+        r->overflows += n - take;                                              \
+        uint32_t depth = (size) - room + take;                                 \
+        if (depth > r->high_watermark) {                                       \
+            r->high_watermark = depth;                                         \
+        }                                                                      \
+        return take;                                                           \
+    }                                                                          \
+                                                                               \
+    static inline bool name##_push(name##_t* r, const type* item) {            \
+        return name##_push_n(r, item, 1) == 1;                                 \
+    }                                                                          \
+                                                                               \
+    static inline uint32_t name##_pop_n(name##_t* r, type* dst, uint32_t n) {  \
+        uint32_t tail = r->tail;                                               \
+        uint32_t avail = r->head - tail;                                       \
+        uint32_t take = n < avail ? n : avail;                                 \
+        cpu_barrier();                                                         \
+        for (uint32_t i = 0; i < take; i++) {                                  \
+            dst[i] = r->items[(tail + i) & ((size) - 1)];                      \
+        }                                                                      \
+        cpu_barrier();                                                         \
+        r->tail = tail + take;                                                 \
+        return take;                                                           \
+    }                                                                          \
+                                                                               \
+    static inline bool name##_pop(name##_t* r, type* item) {                   \
+        return name##_pop_n(r, item, 1) == 1;                                  \
+    }
@@ -0,0 +1,188 @@
+#include "sb16.h"
+#include "mixer.h"
+#include "io.h"
+#include "pic.h"
+#include "serial.h"
+
+#define SB16_BASE        0x220
+#define SB16_MIXER_ADDR  (SB16_BASE + 0x4)
+#define SB16_MIXER_DATA  (SB16_BASE + 0x5)
+#define SB16_DSP_RESET   (SB16_BASE + 0x6)
+#define SB16_DSP_READ    (SB16_BASE + 0xA)
+#define SB16_DSP_WRITE   (SB16_BASE + 0xC)  // bit 7 of a read: busy
+#define SB16_DSP_STATUS  (SB16_BASE + 0xE)  // bit 7: data ready; read acks 8-bit IRQ
+#define SB16_DSP_ACK16   (SB16_BASE + 0xF)  // read acks 16-bit IRQ
+
+#define SB16_IRQ         5
+#define SB16_HDMA        5
+
+#define DSP_SET_RATE     0x41               // output rate, hi then lo byte
+#define DSP_PLAY16_AUTO  0xB6               // 16-bit, D/A, auto-init, FIFO
+#define DSP_MODE_STEREO_SIGNED 0x30
+#define DSP_SPEAKER_ON   0xD1
+#define DSP_VERSION      0xE1
+
+#define MIXER_IRQ_SELECT 0x80
+#define MIXER_DMA_SELECT 0x81
+#define MIXER_IRQ5       0x02
+#define MIXER_DMA1_HDMA5 0x22
+
+/* Second (16-bit) ISA DMA controller, channel 5. Addresses and counts are
+   in words; the page register holds physical address bits 23-17. */
+#define DMA2_CH5_ADDR    0xC4
+#define DMA2_CH5_COUNT   0xC6
+#define DMA2_MASK        0xD4
+#define DMA2_MODE        0xD6
+#define DMA2_FLIPFLOP    0xD8
+#define DMA_CH5_PAGE     0x8B
+#define DMA_MODE_READ_AUTO 0x58             // single, auto-init, memory -> device
+
+#define DSP_TIMEOUT      100000
+#define ISA_DMA_LIMIT    0x1000000          // ISA DMA reaches the low 16 MiB
+
+#define BLOCK_SAMPLES    (SB16_BLOCK_FRAMES * 2)
+
+/* Two halves. 4 KiB alignment keeps the buffer inside one 128 KiB DMA
+   page, which 16-bit transfers may not cross. */
+static int16_t dma_buf[2 * BLOCK_SAMPLES] __attribute__((aligned(4096)));
+
+static bool present = false;
+static uint32_t fill = 0;             // half the next IRQ refills
+static sb16_stats_t stats;
+
+static bool dsp_write(uint8_t v) {
+    for (uint32_t i = 0; i < DSP_TIMEOUT; i++) {
+        if (!(inb(SB16_DSP_WRITE) & 0x80)) {
+            outb(SB16_DSP_WRITE, v);
+            return true;
+        }
+    }
+    return false;
+}
+
+static int dsp_read(void) {
+    for (uint32_t i = 0; i < DSP_TIMEOUT; i++) {
+        if (inb(SB16_DSP_STATUS) & 0x80) return inb(SB16_DSP_READ);
+    }
+    return -1;
+}
+
+/* Pulse the reset line (at least 3 us) and wait for the 0xAA greeting. */
+static bool dsp_reset(void) {
+    outb(SB16_DSP_RESET, 1);
+    for (int i = 0; i < 4; i++) io_wait();
+    outb(SB16_DSP_RESET, 0);
+    return dsp_read() == 0xAA;
+}
+
+static void mixer_reg_write(uint8_t reg, uint8_t v) {
+    outb(SB16_MIXER_ADDR, reg);
+    outb(SB16_MIXER_DATA, v);
+}
+
+static void dma_program(uint32_t phys, uint32_t bytes) {
+    uint32_t words = bytes / 2;
+    outb(DMA2_MASK, 0x04 | (SB16_HDMA & 3));
+    outb(DMA2_FLIPFLOP, 0);
+    outb(DMA2_MODE, DMA_MODE_READ_AUTO | (SB16_HDMA & 3));
+    outb(DMA2_CH5_ADDR, (phys >> 1) & 0xFF);
+    outb(DMA2_CH5_ADDR, (phys >> 9) & 0xFF);
+    outb(DMA_CH5_PAGE, (phys >> 16) & 0xFE);
+    outb(DMA2_CH5_COUNT, (words - 1) & 0xFF);
+    outb(DMA2_CH5_COUNT, ((words - 1) >> 8) & 0xFF);
+    outb(DMA2_MASK, SB16_HDMA & 3);
+}
+
+/* Frame the DMA engine is reading, from its remaining word count. */
+static uint32_t dma_frame(void) {
+    outb(DMA2_FLIPFLOP, 0);
+    uint32_t lo = inb(DMA2_CH5_COUNT);
+    uint32_t hi = inb(DMA2_CH5_COUNT);
+    uint32_t left = ((hi << 8 | lo) + 1) & 0xFFFF;
+    uint32_t done = (2 * BLOCK_SAMPLES - left) % (2 * BLOCK_SAMPLES);
+    return done / 2;
+}
+
+bool sb16_init(void) {
+    present = false;
+    if (!dsp_reset()) return false;
+    if (!dsp_write(DSP_VERSION)) return false;
+    int major = dsp_read();
+    int minor = dsp_read();
+    if (major < 4) return false;          // pre-SB16: no 16-bit DMA
+    stats.dsp_major = (uint8_t)major;
+    stats.dsp_minor = (uint8_t)(minor < 0 ? 0 : minor);
+
+    uint32_t phys = (uint32_t)dma_buf;
+    if (phys + sizeof(dma_buf) > ISA_DMA_LIMIT) {
+        serial_print("sb16: DMA buffer above 16 MiB\n");
+        return false;
+    }
+
+    mixer_reg_write(MIXER_IRQ_SELECT, MIXER_IRQ5);
+    mixer_reg_write(MIXER_DMA_SELECT, MIXER_DMA1_HDMA5);
+
+    // Both halves start with whatever is queued (normally silence).
+    mixer_render(dma_buf, SB16_BLOCK_FRAMES);
+    mixer_render(dma_buf + BLOCK_SAMPLES, SB16_BLOCK_FRAMES);
+    fill = 0;
+    dma_program(phys, sizeof(dma_buf));
+
+    dsp_write(DSP_SPEAKER_ON);
+    dsp_write(DSP_SET_RATE);
+    dsp_write(MIXER_RATE >> 8);
+    dsp_write(MIXER_RATE & 0xFF);
+
+    // The block length (in samples, minus one) sets the IRQ period: once
+    // per half buffer.
+    dsp_write(DSP_PLAY16_AUTO);
+    dsp_write(DSP_MODE_STEREO_SIGNED);
+    dsp_write((BLOCK_SAMPLES - 1) & 0xFF);
+    dsp_write(((BLOCK_SAMPLES - 1) >> 8) & 0xFF);
+
+    present = true;
+    pic_unmask(SB16_IRQ);
+    return true;
+}
+
+bool sb16_present(void) {
+    return present;
+}
+
+void irq5_handler(void) {
+    inb(SB16_DSP_ACK16);
+
+    if (present) {
+        stats.irqs++;
+        if (dma_frame() / SB16_BLOCK_FRAMES == fill) stats.late++;
+        mixer_render(dma_buf + fill * BLOCK_SAMPLES, SB16_BLOCK_FRAMES);
+        fill ^= 1;
+    }
+
+    pic_send_EOI(SB16_IRQ);
+}
+
+const sb16_stats_t* sb16_stats(void) {
+    return &stats;
+}
+
+void sb16_dump(void) {
+    if (!present) {
+        serial_print("sb16: not present\n");
+        return;
+    }
+    serial_print("sb16: DSP ");
+    serial_print_u32(stats.dsp_major);
+    serial_print(".");
+    serial_print_u32(stats.dsp_minor);
+    serial_print(", IRQ5 DMA5, 2x");
+    serial_print_u32(SB16_BLOCK_FRAMES);
+    serial_print(" frames at 0x");
+    serial_print_hex((uint32_t)dma_buf);
+    serial_print("\n  irqs=");
+    serial_print_u32(stats.irqs);
+    serial_print(" late=");
+    serial_print_u32(stats.late);
+    serial_print("\n");
+    mixer_dump();
+}
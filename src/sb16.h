@@ -0,0 +1,39 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * sb16.h — Sound Blaster 16 PCM output (docs/drivers/sb16.md).
+ *
+ * Plays the mixer's 16-bit stereo stream at MIXER_RATE through the
+ * 16-bit ISA DMA channel in auto-init mode.  The DMA buffer holds two
+ * halves; the DSP raises its IRQ at the end of each half, and the handler
+ * mixes the next block into the half that just finished while the other
+ * one plays.  Only the defaults QEMU and most cards use are supported:
+ * base 0x220, IRQ 5, 16-bit DMA channel 5.
+ */
+
+#define SB16_BLOCK_FRAMES 512       // frames per half buffer (~23 ms)
+
+typedef struct {
+    uint8_t  dsp_major;       // DSP version, 4.x for an SB16
+    uint8_t  dsp_minor;
+    uint32_t irqs;            // block-end interrupts
+    uint32_t late;            // refills that found the DMA already in the half
+} sb16_stats_t;
+
+/* Reset the DSP, program DMA channel 5 and start playback of silence.
+   Returns false, leaving the hardware untouched beyond the reset, when
+   no SB16 answers. Call with interrupts disabled, after pic_remap() and
+   after the IRQ5 gate is installed. */
+bool sb16_init(void);
+
+bool sb16_present(void);
+
+/* IRQ5 top half: acknowledge the DSP and refill the finished half. */
+void irq5_handler(void);
+
+const sb16_stats_t* sb16_stats(void);
+
+/* Print the DSP version, buffer state and mixer statistics over serial. */
+void sb16_dump(void);
@@ -0,0 +1,293 @@
+#include "sched.h"
+#include "exo_abi.h"
+#include "cpu.h"
+#include "gdt.h"
+#include "pit.h"
+#include "pmm.h"
+#include "serial.h"
+#include "string.h"
+#include "trace.h"
+#include "tsc.h"
+
+/* context.s: save EBP EBX ESI EDI on the current stack, store ESP in
+   *save_esp, load new_esp and pop the same four. */
+extern void context_switch(uint32_t* save_esp, uint32_t new_esp);
+extern void context_start(void);
+
+static context_t ctxs[SCHED_MAX_CTX];
+static context_t* current = 0;
+static context_t* rq_head = 0;
+static context_t* rq_tail = 0;
+static context_t* sleepers = 0;       // sorted by wake_ms, earliest first
+static context_t* zombie = 0;         // exited, stack not yet freed
+static uint64_t switch_tsc;           // rdtsc() just before context_switch
+static uint32_t resume_flags;         // EFLAGS a new context starts with
+static uint32_t entry_esp0;           // TSS.esp0 before sched_init: kmain's
+static sched_stats_t stats;
+
+static void rq_push(context_t* c) {
+    c->state = CTX_RUNNABLE;
+    c->ready_tsc = rdtsc();
+    c->next = 0;
+    if (rq_tail) rq_tail->next = c;
+    else rq_head = c;
+    rq_tail = c;
+}
+
+static context_t* rq_pop(void) {
+    context_t* c = rq_head;
+    if (!c) return 0;
+    rq_head = c->next;
+    if (!rq_head) rq_tail = 0;
+    c->next = 0;
+    return c;
+}
+
+/* Equal deadlines keep their arrival order. */
+static void sleep_insert(context_t* c) {
+    context_t** p = &sleepers;
+    while (*p && (int32_t)((*p)->wake_ms - c->wake_ms) <= 0) p = &(*p)->next;
+    c->next = *p;
+    *p = c;
+}
+
+/* Where an entry from ring 3 lands while `c` runs: the top of its own
+   stack, or the shared entry stack for kmain, which has none. */
+static uint32_t kernel_stack_top(const context_t* c) {
+    if (!c->stack) return entry_esp0;
+    return (uint32_t)c->stack + SCHED_STACK_PAGES * PAGE_SIZE;
+}
+
+/* First thing on the new side of every switch, with interrupts off. */
+static void switch_done(void) {
+    uint32_t cycles = (uint32_t)(rdtsc() - switch_tsc);
+    stats.switches++;
+    stats.switch_cycles += cycles;
+    if (cycles > stats.switch_max) stats.switch_max = cycles;
+
+    if (zombie) {
+        free_pages(zombie->stack, SCHED_STACK_PAGES);
+        zombie->stack = 0;
+        zombie->state = CTX_FREE;
+        zombie = 0;
+    }
+}
+
+/* Reached by context_start on a context's first switch-in. */
+void sched_first_run(void) {
+    switch_done();
+    irq_restore(resume_flags);
+}
+
+/*
+ * Run the next context. The caller has already queued `current` (yield),
+ * put it on the sleep list or marked it dead, and holds interrupts off;
+ * `flags` is what it will restore. With nothing runnable the CPU halts
+ * until an IRQ0 tick queues a sleeper, which may be `current` itself.
+ */
+static void schedule(uint32_t flags) {
+    context_t* next;
+    while (!(next = rq_pop())) {
+        stats.idle_halts++;
+        __asm__ volatile ("sti\n\thlt\n\tcli" : : : "memory");
+    }
+
+    next->state = CTX_RUNNING;
+    if (next == current) return;    // woke from its own sleep
+
+    uint64_t wait = rdtsc() - next->ready_tsc;
+    next->wait_cycles += wait;
+    if (wait > next->wait_max) next->wait_max = wait;
+
+    context_t* prev = current;
+    TRACE(CTX_SWITCH, prev->id, next->id);
+    next->switches++;
+    current = next;
+    fpu_switch(&next->fpu);
+    tss_set_kernel_stack(kernel_stack_top(next));
+    resume_flags = flags;
+    switch_tsc = rdtsc();
+    context_switch(&prev->esp, next->esp);
+    switch_done();
+}
+
+void sched_init(void) {
+    memset(ctxs, 0, sizeof(ctxs));
+    rq_head = rq_tail = sleepers = zombie = 0;
+    stats = (sched_stats_t){0};
+    if (!entry_esp0) entry_esp0 = tss_kernel_stack();
+
+    for (uint32_t i = 0; i < SCHED_MAX_CTX; i++) ctxs[i].id = i;
+    current = &ctxs[0];
+    current->state = CTX_RUNNING;
+    current->switches = 1;
+    strncpy(current->name, "kmain", SCHED_NAME_MAX - 1);
+    fpu_switch(&current->fpu);
+}
+
+int32_t sched_spawn(const char* name, sched_entry_t entry, void* arg) {
+    if (!current || !entry || !name) return -EXO_EINVAL;
+
+    context_t* c = 0;
+    for (uint32_t i = 1; i < SCHED_MAX_CTX; i++) {
+        if (ctxs[i].state == CTX_FREE) {
+            c = &ctxs[i];
+            break;
+        }
+    }
+    if (!c) return -EXO_ENOMEM;
+
+    void* stack = alloc_pages(SCHED_STACK_PAGES);
+    if (!stack) return -EXO_ENOMEM;
+
+    // The frame context_switch pops: EDI, ESI = arg, EBX = entry, EBP,
+    // then the return into context_start. 16 bytes of padding above it
+    // keep ESP 16-byte aligned at context_start's calls.
+    uint32_t* sp = (uint32_t*)((uint8_t*)stack + SCHED_STACK_PAGES * PAGE_SIZE);
+    for (int i = 0; i < 4; i++) *--sp = 0;
+    *--sp = (uint32_t)context_start;
+    *--sp = 0;
+    *--sp = (uint32_t)entry;
+    *--sp = (uint32_t)arg;
+    *--sp = 0;
+
+    uint32_t id = c->id;
+    memset(c, 0, sizeof(*c));
+    c->id = id;
+    c->esp = (uint32_t)sp;
+    c->stack = stack;
+    strncpy(c->name, name, SCHED_NAME_MAX - 1);
+
+    uint32_t flags = irq_save();
+    rq_push(c);
+    stats.spawned++;
+    irq_restore(flags);
+    return (int32_t)id;
+}
+
+bool sched_yield(void) {
+    if (!current) return false;
+
+    uint32_t flags = irq_save();
+    if (!rq_head) {
+        irq_restore(flags);
+        return false;
+    }
+    current->yields++;
+    rq_push(current);
+    schedule(flags);
+    irq_restore(flags);
+    return true;
+}
+
+void sched_sleep_ms(uint32_t ms) {
+    if (ms == 0) {
+        sched_yield();
+        return;
+    }
+
+    uint32_t flags = irq_save();
+    current->wake_ms = kernel_get_ticks_ms() + ms;
+    current->state = CTX_SLEEPING;
+    current->sleeps++;
+    sleep_insert(current);
+    schedule(flags);
+    irq_restore(flags);
+}
+
+void sched_exit(void) {
+    uint32_t flags = irq_save();
+    if (!current->stack) {
+        // kmain owns the boot stack and the idle loop; it never exits.
+        serial_print("sched: kmain cannot exit\n");
+        for (;;) __asm__ volatile ("hlt");
+    }
+    current->state = CTX_DEAD;
+    fpu_release(&current->fpu);
+    zombie = current;
+    stats.exited++;
+    schedule(flags);
+    __builtin_unreachable();
+}
+
+void sched_tick(uint32_t now_ms) {
+    if (!sleepers) return;
+
+    uint32_t flags = irq_save();
+    while (sleepers && (int32_t)(now_ms - sleepers->wake_ms) >= 0) {
+        context_t* c = sleepers;
+        sleepers = c->next;
+        rq_push(c);
+        stats.wakeups++;
+    }
+    irq_restore(flags);
+}
+
+context_t* sched_current(void) {
+    return current;
+}
+
+const context_t* sched_context(uint32_t id) {
+    if (id >= SCHED_MAX_CTX || ctxs[id].state == CTX_FREE) return 0;
+    return &ctxs[id];
+}
+
+const sched_stats_t* sched_stats(void) {
+    return &stats;
+}
+
+static const char* state_name(ctx_state_t s) {
+    switch (s) {
+    case CTX_RUNNABLE: return "ready";
+    case CTX_RUNNING:  return "run";
+    case CTX_SLEEPING: return "sleep";
+    case CTX_DEAD:     return "dead";
+    default:           return "free";
+    }
+}
+
+void sched_dump(void) {
+    serial_print("sched: switches=");
+    serial_print_u32(stats.switches);
+    if (stats.switches) {
+        serial_print(" avg=");
+        serial_print_u32((uint32_t)(stats.switch_cycles / stats.switches));
+        serial_print("cyc max=");
+        serial_print_u32(stats.switch_max);
+        serial_print("cyc");
+    }
+    serial_print(" spawned=");
+    serial_print_u32(stats.spawned);
+    serial_print(" exited=");
+    serial_print_u32(stats.exited);
+    serial_print(" wakeups=");
+    serial_print_u32(stats.wakeups);
+    serial_print(" idle_halts=");
+    serial_print_u32(stats.idle_halts);
+    serial_print("\n");
+
+    for (uint32_t i = 0; i < SCHED_MAX_CTX; i++) {
+        const context_t* c = &ctxs[i];
+        if (c->state == CTX_FREE) continue;
+        serial_print("  #");
+        serial_print_u32(c->id);
+        serial_print(" ");
+        serial_print(c->name);
+        serial_print(" ");
+        serial_print(state_name(c->state));
+        serial_print(" switches=");
+        serial_print_u32(c->switches);
+        serial_print(" yields=");
+        serial_print_u32(c->yields);
+        serial_print(" sleeps=");
+        serial_print_u32(c->sleeps);
+        if (c->switches) {
+            serial_print(" wait avg=");
+            serial_print_u32(tsc_cycles_to_us(c->wait_cycles / c->switches));
+            serial_print("us max=");
+            serial_print_u32(tsc_cycles_to_us(c->wait_max));
+            serial_print("us");
+        }
+        serial_print("\n");
+    }
+}
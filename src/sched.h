@@ -0,0 +1,107 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "fpu.h"
+
+/*
+ * sched.h — Cooperative scheduler for LibOS contexts (docs/sched.md).
+ *
+ * A context is a kernel stack plus the callee-saved registers that
+ * context_switch (context.s) leaves on it.  Contexts run until they yield,
+ * sleep or exit.  Nothing is preempted, so contexts never need locks
+ * against each other, only against IRQ handlers.
+ *
+ * The run queue is a FIFO threaded through the contexts: push at the tail
+ * and pick from the head are both O(1).  Sleepers wait on a list sorted by
+ * wakeup deadline, so the timer tick only ever looks at its head, and a
+ * sleeping context costs no CPU until its deadline.
+ *
+ * Contexts run on the BSP only.  sched_init() turns kernel_main into
+ * context 0 ("kmain").
+ *
+ * A spawned context can drop to ring 3 with sched_enter_user().  Each
+ * switch points TSS.esp0 at the top of the incoming context's stack, so
+ * its int 0x80 calls and IRQs land there and it can yield from ring 3.
+ */
+
+#define SCHED_MAX_CTX     16
+#define SCHED_STACK_PAGES 4          // 16 KiB kernel stack per context
+#define SCHED_NAME_MAX    12
+
+typedef void (*sched_entry_t)(void* arg);
+
+typedef enum {
+    CTX_FREE = 0,
+    CTX_RUNNABLE,
+    CTX_RUNNING,
+    CTX_SLEEPING,
+    CTX_DEAD,                     // exited; stack freed by the next context
+} ctx_state_t;
+
+typedef struct context {
+    uint32_t esp;                 // saved by context_switch
+    struct context* next;         // run queue or sleep list link
+    ctx_state_t state;
+    uint32_t id;
+    uint32_t wake_ms;             // deadline while sleeping
+    void* stack;                  // alloc_pages() base; NULL for kmain
+    uint64_t ready_tsc;           // when it last became runnable
+    uint32_t switches;            // times switched in
+    uint32_t yields;
+    uint32_t sleeps;
+    uint64_t wait_cycles;         // runnable -> running, summed
+    uint64_t wait_max;
+    char name[SCHED_NAME_MAX];
+    fpu_state_t fpu;              // loaded lazily on first use (fpu.h)
+} context_t;
+
+typedef struct {
+    uint32_t switches;
+    uint64_t switch_cycles;       // inside context_switch, summed
+    uint32_t switch_max;
+    uint32_t spawned;
+    uint32_t exited;
+    uint32_t wakeups;             // sleepers moved to the run queue
+    uint32_t idle_halts;          // HLTs with nothing runnable
+} sched_stats_t;
+
+/* Make the caller context 0. Call once, after pmm_init(). */
+void sched_init(void);
+
+/* Start entry(arg) on a new stack. It is queued behind the runnable
+   contexts and runs once they yield. Returning from entry exits the
+   context. Returns its id, -EXO_EINVAL or -EXO_ENOMEM. */
+int32_t sched_spawn(const char* name, sched_entry_t entry, void* arg);
+
+/* Let every other runnable context run once. Returns false at once, with
+   no switch, when nothing else is runnable. */
+bool sched_yield(void);
+
+/* Block for at least `ms` milliseconds. Needs the timer (sched_tick);
+   with nothing else runnable the CPU halts until the deadline. */
+void sched_sleep_ms(uint32_t ms);
+
+/* End the calling context. Its stack is freed by the next one to run. */
+void sched_exit(void) __attribute__((noreturn));
+
+/* Drop the calling context to ring 3 at `eip` with stack `esp`, user
+   segments loaded and interrupts on (context.s). Anything left on its
+   kernel stack is abandoned: ring-3 entries start again at the top. It
+   leaves through exo_exit. Spawned contexts only; kmain has no stack of
+   its own to come back to. */
+void sched_enter_user(uint32_t eip, uint32_t esp) __attribute__((noreturn));
+
+/* Timer tick: move sleepers whose deadline is <= now_ms to the run
+   queue. Called from IRQ0. */
+void sched_tick(uint32_t now_ms);
+
+/* The running context, or NULL before sched_init(). */
+context_t* sched_current(void);
+
+/* Context `id`, or NULL if the slot is free or out of range. */
+const context_t* sched_context(uint32_t id);
+
+const sched_stats_t* sched_stats(void);
+
+/* Print every context's state, switches, sleeps and wait time over serial. */
+void sched_dump(void);
@@ -1,16 +1,39 @@
 #include "serial.h"
 #include "io.h"
+#include "cpu.h"
+#include "defer.h"
+#include "ring.h"
 
 #define COM1 0x3F8
 
+#define SERIAL_TX_BUFFER_SIZE 1024   // must be a power of 2
+
+RING_DEFINE(serial_tx_ring, char, SERIAL_TX_BUFFER_SIZE)
+static serial_tx_ring_t tx_ring;
+static volatile uint8_t tx_drain_posted = 0;
+static const serial_sink_t* sink = 0;
+
 static int serial_tx_empty(void) {
     return inb(COM1 + 5) & 0x40;
 }
 
 void serial_flush(void) {
+    if (sink) {
+        sink->flush();
+        return;
+    }
     while (!serial_tx_empty()) {}
 }
 
+void serial_set_sink(const serial_sink_t* s) {
+    serial_flush();
+    sink = s;
+}
+
+const char* serial_sink_name(void) {
+    return sink ? sink->name : "COM1";
+}
+
 
 void serial_init(void) {
     outb(COM1 + 1, 0x00);   // Disable all interrupts
@@ -72,12 +95,37 @@ static int serial_can_tx(void) {
 }
 
 void serial_putc(char c) {
+    if (sink) {
+        sink->write(&c, 1);
+        return;
+    }
     while (!serial_can_tx()) {}
     outb(COM1, (uint8_t)c);
 }
 
+void serial_write(const char* buf, uint32_t len) {
+    if (sink) {
+        sink->write(buf, len);
+        return;
+    }
+    for (uint32_t i = 0; i < len; i++) {
+        serial_putc(buf[i]);
+    }
+}
+
 void serial_print(const char* s) {
-    while (*s) serial_putc(*s++);
+    uint32_t len = 0;
+    while (s[len]) len++;
+    serial_write(s, len);
+}
+
+int serial_try_getc(void) {
+    if (sink) {
+        int c = sink->getc();
+        if (c >= 0) return c;
+    }
+    if (!(inb(COM1 + 5) & 0x01)) return -1;   // LSR: data ready
+    return inb(COM1);
 }
 
 void serial_print_u32(uint32_t val) {
@@ -88,3 +136,41 @@ void serial_print_u32(uint32_t val) {
     while (val > 0) { *--p = '0' + (val % 10); val /= 10; }
     serial_print(p);
 }
+
+/* Bottom half: push everything queued by serial_print_async out of the UART.
+   Runs with interrupts enabled, so the busy-wait no longer delays IRQs. */
+static void serial_tx_bh(uint32_t unused) {
+    (void)unused;
+
+    tx_drain_posted = 0;
+    cpu_barrier();
+
+    char chunk[32];
+    uint32_t n;
+    while ((n = serial_tx_ring_pop_n(&tx_ring, chunk, sizeof(chunk))) != 0) {
+        serial_write(chunk, n);
+    }
+}
+
+/* Top half: copy into the TX ring and return immediately. Bytes that do not
+   fit are dropped and counted rather than stalling the caller. */
+void serial_print_async(const char* s) {
+    uint32_t len = 0;
+    while (s[len]) len++;
+
+    // Callers in task and IRQ context share the producer side: IF=0 makes
+    // them one producer as far as the ring is concerned.
+    uint32_t flags = irq_save();
+
+    serial_tx_ring_push_n(&tx_ring, s, len);
+
+    if (!tx_drain_posted) {
+        tx_drain_posted = defer_post(serial_tx_bh, 0) ? 1 : 0;
+    }
+
+    irq_restore(flags);
+}
+
+uint32_t serial_async_dropped(void) {
+    return tx_ring.overflows;
+}
@@ -9,3 +9,33 @@ void serial_flush(void);
 void serial_print_hex(uint32_t num);
 void serial_print_hex64(uint64_t num);
 void serial_print_dec(uint32_t num);
+
+/* Raw bytes, NULs included (binary dumps). */
+void serial_write(const char* buf, uint32_t len);
+
+/* Polled receive: the next byte from the sink or COM1, or -1 if none is
+   waiting. */
+int serial_try_getc(void);
+
+/*
+ * Output sink.  Everything above goes to COM1 unless a faster sink (the
+ * virtio console) is installed; input is taken from the sink first, then
+ * from COM1, so the console works from either side.
+ */
+typedef struct {
+    const char* name;
+    void (*write)(const char* buf, uint32_t len);
+    void (*flush)(void);                  // push out anything buffered
+    int  (*getc)(void);                   // next input byte, or -1
+} serial_sink_t;
+
+/* Route output through `sink`, or back to COM1 when NULL. */
+void serial_set_sink(const serial_sink_t* sink);
+
+/* "COM1" or the installed sink's name. */
+const char* serial_sink_name(void);
+
+/* Non-blocking variant for IRQ top halves: queues the string and lets a
+   deferred bottom half drain it. Not ordered with respect to serial_print. */
+void serial_print_async(const char* s);
+uint32_t serial_async_dropped(void);
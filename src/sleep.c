@@ -1,11 +1,20 @@
 #include <stdint.h>
 #include "pit.h"
 #include "sleep.h"
+#include "defer.h"
+#include "sched.h"
 
 void kernel_sleep_ms(uint32_t ms) {
+    // Once contexts exist, sleep on the scheduler's queue so they run.
+    if (sched_current()) {
+        sched_sleep_ms(ms);
+        return;
+    }
+
     uint32_t start = kernel_get_ticks_ms();
 
     while ((kernel_get_ticks_ms() - start) < ms) {
+        defer_run();
         __asm__ volatile ("hlt");
     }
 }
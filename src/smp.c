@@ -0,0 +1,158 @@
+#include "smp.h"
+#include "acpi.h"
+#include "lapic.h"
+#include "gdt.h"
+#include "idt.h"
+#include "jobs.h"
+#include "pmm.h"
+#include "serial.h"
+#include "string.h"
+#include "tsc.h"
+#include "vmm.h"
+
+#define AP_TRAMPOLINE    0x8000       // must match ap_boot.s
+#define AP_STACK_PAGES   4            // 16 KiB, as boot.s gives the BSP
+#define AP_START_TIMEOUT_US 100000
+
+extern uint8_t ap_trampoline_start[], ap_trampoline_end[];
+extern uint8_t ap_param_stack[], ap_param_entry[], ap_param_cpu[];
+extern void ipi_wake_stub(void);
+
+/* A parameter slot in the copy of the trampoline at AP_TRAMPOLINE. */
+#define AP_PARAM(sym) \
+    (*(volatile uint32_t*)(AP_TRAMPOLINE + ((sym) - ap_trampoline_start)))
+
+percpu_t percpu[MAX_CPUS];
+static volatile uint32_t cpus_online = 1;
+static uint8_t saved_low[256];        // what the trampoline overwrote
+
+static void delay_us(uint32_t us) {
+    uint64_t end = rdtsc() + (uint64_t)tsc_khz() * us / 1000;
+    while (rdtsc() < end) cpu_pause();
+}
+
+static bool wait_online(percpu_t* c, uint32_t us) {
+    uint64_t end = rdtsc() + (uint64_t)tsc_khz() * us / 1000;
+    while (!c->online) {
+        if (rdtsc() >= end) return false;
+        cpu_pause();
+    }
+    return true;
+}
+
+/* APs halt between jobs; the wake IPI (or a stray interrupt) restarts
+   the search. CLI ... STI; HLT closes the window where an IPI could land
+   after the check and before the halt. */
+static void ap_idle(void) {
+    for (;;) {
+        vmm_sync();
+        if (jobs_run_one()) continue;
+        __asm__ volatile ("cli");
+        if (jobs_pending() == 0) {
+            __asm__ volatile ("sti\n\thlt" : : : "memory");
+        } else {
+            __asm__ volatile ("sti");
+        }
+    }
+}
+
+/* First C code on an AP, called by the trampoline in flat protected mode
+   with interrupts off. */
+void ap_main(uint32_t cpu) {
+    gdt_init_ap(cpu);
+    idt_install();
+    vmm_init_ap();
+    cpu_enable_sse();
+    lapic_init();
+
+    __atomic_store_n(&percpu[cpu].online, true, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&cpus_online, 1, __ATOMIC_RELEASE);
+    ap_idle();
+}
+
+/* INIT, wait 10 ms, then up to two STARTUPs 200 us apart (Intel MP spec
+   B.4). The AP reports in by setting its `online` flag. */
+static bool start_ap(uint32_t cpu, uint8_t apic_id) {
+    uint8_t* stack = alloc_pages(AP_STACK_PAGES);
+    if (!stack) return false;
+
+    percpu_t* c = &percpu[cpu];
+    c->apic_id = apic_id;
+    c->stack_top = (uint32_t)stack + AP_STACK_PAGES * PAGE_SIZE;
+    AP_PARAM(ap_param_stack) = c->stack_top;
+    AP_PARAM(ap_param_entry) = (uint32_t)ap_main;
+    AP_PARAM(ap_param_cpu) = cpu;
+    cpu_barrier();
+
+    lapic_send_init(apic_id);
+    delay_us(10000);
+    for (int i = 0; i < 2 && !c->online; i++) {
+        lapic_send_startup(apic_id, AP_TRAMPOLINE >> 12);
+        wait_online(c, 200);
+    }
+    if (wait_online(c, AP_START_TIMEOUT_US)) return true;
+
+    free_pages(stack, AP_STACK_PAGES);
+    return false;
+}
+
+uint32_t smp_init(void) {
+    percpu[0].online = true;
+    if (!lapic_init()) return 1;
+    percpu[0].apic_id = lapic_id();
+    if (!acpi_init() || acpi_cpu_count() < 2 || tsc_khz() == 0) return 1;
+
+    idt_set_gate(IPI_WAKE_VECTOR, (uint32_t)ipi_wake_stub);
+
+    uint32_t size = (uint32_t)(ap_trampoline_end - ap_trampoline_start);
+    if (size > sizeof(saved_low)) return 1;
+    memcpy(saved_low, (void*)AP_TRAMPOLINE, size);
+    memcpy((void*)AP_TRAMPOLINE, ap_trampoline_start, size);
+
+    uint32_t next = 1;
+    for (uint32_t i = 0; i < acpi_cpu_count() && next < MAX_CPUS; i++) {
+        uint8_t id = acpi_cpu_apic_id(i);
+        if (id == percpu[0].apic_id) continue;
+        if (start_ap(next, id)) {
+            next++;
+        } else {
+            serial_print("smp: APIC ");
+            serial_print_u32(id);
+            serial_print(" did not start\n");
+        }
+    }
+
+    // Every AP is on the kernel GDT and its own stack by now.
+    memcpy((void*)AP_TRAMPOLINE, saved_low, size);
+    return cpus_online;
+}
+
+uint32_t smp_cpu_count(void) {
+    return __atomic_load_n(&cpus_online, __ATOMIC_ACQUIRE);
+}
+
+void smp_wake_all(void) {
+    if (smp_cpu_count() > 1) lapic_send_ipi_others(IPI_WAKE_VECTOR);
+}
+
+void smp_dump(void) {
+    serial_print("cpus: ");
+    serial_print_u32(smp_cpu_count());
+    serial_print(" online\n");
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        const percpu_t* c = &percpu[cpu];
+        if (!c->online) continue;
+        serial_print("  cpu");
+        serial_print_u32(cpu);
+        serial_print(": apic=");
+        serial_print_u32(c->apic_id);
+        serial_print(" ipis=");
+        serial_print_u32(c->ipis);
+        serial_print(" jobs=");
+        serial_print_u32(c->jobs_run);
+        serial_print(" stolen=");
+        serial_print_u32(c->jobs_stolen);
+        serial_print("\n");
+    }
+    jobs_dump();
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "cpu.h"
+
+/*
+ * smp.h — Application processor start-up and per-CPU data.
+ *
+ * Each CPU owns one percpu_t.  GS holds a GDT segment based at that
+ * block, so this_cpu() and cpu_id() are a single GS-relative load and need
+ * no lookup by APIC ID.  The BSP's block is installed by gdt_init(); the
+ * APs install theirs first thing in ap_main().
+ *
+ * Started APs run only jobs (jobs.h) and halt in between, waking on
+ * IPI_WAKE_VECTOR.  Device IRQs, the timer and all other kernel state
+ * stay on the BSP.
+ */
+
+typedef struct percpu {
+    struct percpu* self;          // %gs:0, for this_cpu()
+    uint32_t id;                  // %gs:PERCPU_ID_OFFSET, for cpu_id()
+    uint8_t  apic_id;
+    volatile bool online;
+    uint32_t stack_top;           // AP stack (the BSP keeps boot.s's)
+    uint32_t ipis;                // wake IPIs received
+    uint32_t jobs_run;
+    uint32_t jobs_stolen;         // jobs taken from another CPU's queue
+} percpu_t;
+
+_Static_assert(offsetof(percpu_t, id) == PERCPU_ID_OFFSET, "cpu_id() offset");
+
+extern percpu_t percpu[MAX_CPUS];
+
+static inline percpu_t* this_cpu(void) {
+    percpu_t* p;
+    __asm__ volatile ("mov %%gs:0, %0" : "=r"(p));
+    return p;
+}
+
+/* Enable the BSP's local APIC, read the MADT and start every enabled AP
+   with INIT-SIPI-SIPI, one at a time. Needs tsc_calibrate() and
+   idt_init(). Returns the number of CPUs online, BSP included. */
+uint32_t smp_init(void);
+
+/* CPUs online (1 until smp_init() starts others). */
+uint32_t smp_cpu_count(void);
+
+/* Wake every halted AP so it looks for jobs. */
+void smp_wake_all(void);
+
+/* Print each CPU's APIC ID, IPI and job counters over serial. */
+void smp_dump(void);
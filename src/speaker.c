@@ -0,0 +1,235 @@
+#include "speaker.h"
+#include "io.h"
+#include "cpu.h"
+#include "serial.h"
+
+#define PIT_HZ        1193182
+#define PIT_CMD       0x43
+#define PIT_CH2       0x42
+#define SPEAKER_PORT  0x61
+#define SPEAKER_GATE  0x03        // bit 0: channel 2 gate, bit 1: speaker
+
+#define QUEUE_MASK    (EXO_SOUND_QUEUE - 1)
+
+_Static_assert((EXO_SOUND_QUEUE & QUEUE_MASK) == 0, "queue must be a power of 2");
+
+/* DP lumps index a quarter-tone scale from about 175 Hz (divisor 6818):
+   divisor[n] = 6818 / 2^((n - 1) / 24), rounded. */
+const uint16_t speaker_note_divisors[EXO_SOUND_NOTES] = {
+        0,  6818,  6624,  6435,  6252,  6074,  5901,  5733,
+     5570,  5411,  5257,  5108,  4962,  4821,  4684,  4550,
+     4421,  4295,  4173,  4054,  3939,  3826,  3718,  3612,
+     3509,  3409,  3312,  3218,  3126,  3037,  2951,  2867,
+     2785,  2706,  2629,  2554,  2481,  2411,  2342,  2275,
+     2210,  2148,  2086,  2027,  1969,  1913,  1859,  1806,
+     1754,  1704,  1656,  1609,  1563,  1519,  1475,  1433,
+     1393,  1353,  1314,  1277,  1241,  1205,  1171,  1138,
+     1105,  1074,  1043,  1014,   985,   957,   929,   903,
+      877,   852,   828,   804,   782,   759,   738,   717,
+      696,   676,   657,   638,   620,   603,   585,   569,
+      553,   537,   522,   507,   492,   478,   465,   451,
+      439,   426,   414,   402,   391,   380,   369,   358,
+      348,   338,   329,   319,   310,   301,   293,   284,
+      276,   268,   261,   253,   246,   239,   232,   226,
+      219,   213,   207,   201,   195,   190,   184,   179,
+};
+
+typedef struct {
+    uint16_t divisor;         // 0: rest
+    uint8_t  priority;
+    uint32_t dur_ms;
+} tone_t;
+
+typedef struct {
+    tone_t   q[EXO_SOUND_QUEUE];
+    uint32_t head;
+    uint32_t tail;
+    uint32_t start_ms;        // when the head tone started
+} channel_t;
+
+static channel_t channels[EXO_SOUND_CHANNELS];
+static uint32_t clock_ms = 0;
+static uint32_t next_end = 0;     // earliest end of a head tone
+static bool active = false;       // some channel has a tone
+static uint16_t playing = 0;      // divisor on the hardware, 0 = silent
+static speaker_stats_t stats;
+
+/* Wrap-safe `a >= b` on the millisecond clock. */
+static bool reached(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) >= 0;
+}
+
+static void program(uint16_t divisor) {
+    if (divisor == playing) return;
+    uint8_t gate = inb(SPEAKER_PORT);
+    if (divisor == 0) {
+        outb(SPEAKER_PORT, gate & ~SPEAKER_GATE);
+    } else {
+        outb(PIT_CMD, 0xB6);      // channel 2, lobyte/hibyte, mode 3
+        outb(PIT_CH2, divisor & 0xFF);
+        outb(PIT_CH2, (divisor >> 8) & 0xFF);
+        if ((gate & SPEAKER_GATE) != SPEAKER_GATE) {
+            outb(SPEAKER_PORT, gate | SPEAKER_GATE);
+        }
+    }
+    playing = divisor;
+    stats.reprograms++;
+}
+
+/* Pick the winning tone, program it and find the next deadline. */
+static void arbitrate(void) {
+    const tone_t* best = 0;
+    uint32_t best_start = 0;
+    active = false;
+
+    for (uint32_t c = 0; c < EXO_SOUND_CHANNELS; c++) {
+        channel_t* ch = &channels[c];
+        if (ch->head == ch->tail) continue;
+
+        const tone_t* t = &ch->q[ch->head & QUEUE_MASK];
+        uint32_t end = ch->start_ms + t->dur_ms;
+        if (!active || reached(next_end, end)) next_end = end;
+        active = true;
+
+        if (t->divisor == 0) continue;
+        if (!best || t->priority > best->priority
+            || (t->priority == best->priority
+                && (int32_t)(ch->start_ms - best_start) > 0)) {
+            best = t;
+            best_start = ch->start_ms;
+        }
+    }
+    program(best ? best->divisor : 0);
+}
+
+/* Retire every tone that has ended by clock_ms; each successor starts
+   where its predecessor ended. */
+static void advance(void) {
+    for (uint32_t c = 0; c < EXO_SOUND_CHANNELS; c++) {
+        channel_t* ch = &channels[c];
+        while (ch->head != ch->tail) {
+            uint32_t end = ch->start_ms + ch->q[ch->head & QUEUE_MASK].dur_ms;
+            if (!reached(clock_ms, end)) break;
+            ch->head++;
+            ch->start_ms = end;
+            stats.finished++;
+        }
+    }
+}
+
+static int32_t to_divisor(uint32_t freq, uint16_t* out) {
+    if (freq & EXO_SOUND_NOTE(0)) {
+        uint32_t n = freq & ~EXO_SOUND_NOTE(0);
+        if (n >= EXO_SOUND_NOTES) return -EXO_EINVAL;
+        *out = speaker_note_divisors[n];
+        return 0;
+    }
+    if (freq == 0) {
+        *out = 0;
+        return 0;
+    }
+    if (freq < EXO_SOUND_MIN_HZ || freq > EXO_SOUND_MAX_HZ) return -EXO_EINVAL;
+    *out = (uint16_t)((PIT_HZ + freq / 2) / freq);
+    return 0;
+}
+
+void speaker_init(void) {
+    uint32_t flags = irq_save();
+    for (uint32_t c = 0; c < EXO_SOUND_CHANNELS; c++) {
+        channels[c].head = channels[c].tail = 0;
+    }
+    active = false;
+    stats = (speaker_stats_t){0};
+    outb(SPEAKER_PORT, inb(SPEAKER_PORT) & ~SPEAKER_GATE);
+    playing = 0;
+    irq_restore(flags);
+}
+
+int32_t speaker_tone(uint32_t channel, uint32_t priority, uint32_t freq,
+                     uint32_t dur_ms) {
+    uint16_t divisor;
+    if (channel >= EXO_SOUND_CHANNELS || priority > 0xFF || dur_ms == 0) {
+        return -EXO_EINVAL;
+    }
+    int32_t err = to_divisor(freq, &divisor);
+    if (err) return err;
+
+    uint32_t flags = irq_save();
+    advance();                    // the clock may have moved past old tones
+    channel_t* ch = &channels[channel];
+    if (ch->tail - ch->head == EXO_SOUND_QUEUE) {
+        stats.rejected++;
+        irq_restore(flags);
+        return -EXO_EBUSY;
+    }
+    if (ch->head == ch->tail) ch->start_ms = clock_ms;
+    ch->q[ch->tail & QUEUE_MASK] = (tone_t){ divisor, (uint8_t)priority, dur_ms };
+    ch->tail++;
+    stats.tones++;
+    arbitrate();
+    irq_restore(flags);
+    return 0;
+}
+
+int32_t speaker_stop(uint32_t channel) {
+    if (channel >= EXO_SOUND_CHANNELS && channel != EXO_SOUND_ALL) {
+        return -EXO_EINVAL;
+    }
+    uint32_t flags = irq_save();
+    for (uint32_t c = 0; c < EXO_SOUND_CHANNELS; c++) {
+        if (channel == EXO_SOUND_ALL || c == channel) {
+            channels[c].head = channels[c].tail;
+        }
+    }
+    arbitrate();
+    irq_restore(flags);
+    return 0;
+}
+
+void speaker_tick(uint32_t now_ms) {
+    clock_ms = now_ms;
+    if (!active || !reached(now_ms, next_end)) return;
+    advance();
+    arbitrate();
+}
+
+uint16_t speaker_divisor(void) {
+    return playing;
+}
+
+uint32_t speaker_pending(uint32_t channel) {
+    if (channel >= EXO_SOUND_CHANNELS) return 0;
+    return channels[channel].tail - channels[channel].head;
+}
+
+const speaker_stats_t* speaker_stats(void) {
+    return &stats;
+}
+
+void speaker_dump(void) {
+    serial_print("speaker: ");
+    if (playing) {
+        serial_print_u32(PIT_HZ / playing);
+        serial_print(" Hz");
+    } else {
+        serial_print("silent");
+    }
+    serial_print("\n");
+    for (uint32_t c = 0; c < EXO_SOUND_CHANNELS; c++) {
+        if (!speaker_pending(c)) continue;
+        serial_print("  ch");
+        serial_print_u32(c);
+        serial_print(": ");
+        serial_print_u32(speaker_pending(c));
+        serial_print(" queued\n");
+    }
+    serial_print("  tones=");
+    serial_print_u32(stats.tones);
+    serial_print(" finished=");
+    serial_print_u32(stats.finished);
+    serial_print(" rejected=");
+    serial_print_u32(stats.rejected);
+    serial_print(" reprograms=");
+    serial_print_u32(stats.reprograms);
+    serial_print("\n");
+}
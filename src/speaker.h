@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "exo_sound.h"
+
+/*
+ * speaker.h — PC speaker driver: PIT channel 2 in square-wave mode, gated
+ * through port 0x61, fed by the per-channel tone queues of exo_sound.h.
+ *
+ * speaker_tick() runs from IRQ0 with the millisecond clock.  Until the
+ * earliest tone ends it is a single compare; when one ends, the next
+ * tone's start is the old one's end, not the tick that noticed, so queued
+ * sequences do not drift.  The hardware is only reprogrammed when the
+ * winning tone changes.
+ */
+
+/* PIT divisor for each DP lump value; entry 0 is silence. */
+extern const uint16_t speaker_note_divisors[EXO_SOUND_NOTES];
+
+typedef struct {
+    uint32_t tones;           // tones queued
+    uint32_t rejected;        // tones refused: queue full
+    uint32_t finished;        // tones that ran to their end
+    uint32_t reprograms;      // PIT/gate updates
+} speaker_stats_t;
+
+/* Silence the speaker and empty every queue. Call after tsc_calibrate(),
+   which borrows channel 2. */
+void speaker_init(void);
+
+/* Queue a tone. `freq` is Hz, EXO_SOUND_NOTE(n), or 0 for a rest. */
+int32_t speaker_tone(uint32_t channel, uint32_t priority, uint32_t freq,
+                     uint32_t dur_ms);
+
+/* Drop the tones of `channel`, or of every channel with EXO_SOUND_ALL. */
+int32_t speaker_stop(uint32_t channel);
+
+/* Advance the queues to `now_ms`. Called from IRQ0. */
+void speaker_tick(uint32_t now_ms);
+
+/* Divisor the speaker is playing, or 0 when silent. */
+uint16_t speaker_divisor(void);
+
+/* Tones queued on `channel`, including the one playing. */
+uint32_t speaker_pending(uint32_t channel);
+
+const speaker_stats_t* speaker_stats(void);
+
+/* Print the queues and counters over serial. */
+void speaker_dump(void);
@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "cpu.h"
+
+/*
+ * spinlock.h — Ticket spinlocks for data shared between CPUs.
+ *
+ * A locker takes the next ticket with one LOCK XADD and spins until the
+ * owner counter reaches it, so waiters get the lock in arrival order and
+ * nobody starves.  The lock also counts acquisitions and how many of them
+ * had to wait, which `cpus` prints for the locks that matter.
+ *
+ * A lock that an interrupt handler also takes must be held with the
+ * _irqsave variants, or the handler can spin on its own CPU forever.
+ */
+
+typedef struct {
+    volatile uint16_t next;       // next ticket to hand out
+    volatile uint16_t owner;      // ticket now holding the lock
+    uint32_t acquired;
+    uint32_t contended;           // acquisitions that found it held
+    const char* name;
+} spinlock_t;
+
+#define SPINLOCK_INIT(n) { 0, 0, 0, 0, (n) }
+
+static inline void spin_init(spinlock_t* l, const char* name) {
+    l->next = 0;
+    l->owner = 0;
+    l->acquired = 0;
+    l->contended = 0;
+    l->name = name;
+}
+
+static inline void spin_lock(spinlock_t* l) {
+    uint16_t ticket = __atomic_fetch_add(&l->next, 1, __ATOMIC_RELAXED);
+    bool waited = false;
+    while (__atomic_load_n(&l->owner, __ATOMIC_ACQUIRE) != ticket) {
+        waited = true;
+        cpu_pause();
+    }
+    // Counters are only written by the holder.
+    l->acquired++;
+    if (waited) l->contended++;
+}
+
+static inline bool spin_trylock(spinlock_t* l) {
+    uint16_t owner = __atomic_load_n(&l->owner, __ATOMIC_RELAXED);
+    uint16_t expected = owner;
+    if (!__atomic_compare_exchange_n(&l->next, &expected, (uint16_t)(owner + 1),
+                                     false, __ATOMIC_ACQUIRE,
+                                     __ATOMIC_RELAXED)) {
+        return false;
+    }
+    l->acquired++;
+    return true;
+}
+
+static inline void spin_unlock(spinlock_t* l) {
+    __atomic_store_n(&l->owner, (uint16_t)(l->owner + 1), __ATOMIC_RELEASE);
+}
+
+static inline bool spin_is_locked(const spinlock_t* l) {
+    return __atomic_load_n(&l->owner, __ATOMIC_RELAXED) !=
+           __atomic_load_n(&l->next, __ATOMIC_RELAXED);
+}
+
+static inline uint32_t spin_lock_irqsave(spinlock_t* l) {
+    uint32_t flags = irq_save();
+    spin_lock(l);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t* l, uint32_t flags) {
+    spin_unlock(l);
+    irq_restore(flags);
+}
@@ -0,0 +1,99 @@
+#include "submit.h"
+#include "syscall.h"
+#include "cpu.h"
+#include "serial.h"
+
+#define RING_MASK (EXO_RING_ENTRIES - 1)
+
+static exo_ring_t* ring = 0;
+static submit_stats_t stats;
+
+/* Ops that manage the ring itself, or never return, cannot be batched. */
+static bool op_batchable(uint32_t op) {
+    return op != EXO_SYS_RING_SETUP && op != EXO_SYS_SUBMIT
+        && op != EXO_SYS_YIELD && op != EXO_SYS_EXIT;
+}
+
+int32_t submit_register(exo_ring_t* r) {
+    if ((uint32_t)r & 3) return -EXO_EINVAL;
+
+    ring = r;
+    stats = (submit_stats_t){0};
+    return 0;
+}
+
+int32_t submit_process(uint32_t n) {
+    if (!ring) return -EXO_EBADF;
+    stats.doorbells++;
+
+    uint64_t start = rdtsc();
+    uint32_t head = ring->sq_head;
+    uint32_t tail = ring->sq_tail;
+    uint32_t cq_tail = ring->cq_tail;
+    uint32_t done = 0;
+
+    // A corrupt tail from the LibOS cannot make us run more than one lap.
+    uint32_t queued = tail - head;
+    if (queued > EXO_RING_ENTRIES) queued = EXO_RING_ENTRIES;
+    if (n > queued) n = queued;
+    cpu_barrier();   // index before the entries
+
+    while (done < n) {
+        if (cq_tail - ring->cq_head >= EXO_RING_ENTRIES) {
+            stats.cq_full++;
+            break;
+        }
+
+        // Copy first so the LibOS cannot change the entry under us.
+        exo_sqe_t sqe = ring->sq[(head + done) & RING_MASK];
+        int32_t result = op_batchable(sqe.op)
+            ? syscall_dispatch(sqe.op, sqe.args[0], sqe.args[1],
+                               sqe.args[2], sqe.args[3], sqe.args[4])
+            : -EXO_EINVAL;
+        if (result < 0) stats.errors++;
+
+        exo_cqe_t* cqe = &ring->cq[cq_tail & RING_MASK];
+        cqe->user_data = sqe.user_data;
+        cqe->result = result;
+        cq_tail++;
+        done++;
+    }
+
+    cpu_barrier();   // entries before the indices
+    ring->cq_tail = cq_tail;
+    ring->sq_head = head + done;
+
+    stats.requests += done;
+    if (done > stats.max_batch) stats.max_batch = done;
+    stats.cycles += rdtsc() - start;
+    return (int32_t)done;
+}
+
+const submit_stats_t* submit_stats(void) {
+    return &stats;
+}
+
+void submit_dump(void) {
+    serial_print("submit ring: ");
+    if (!ring) {
+        serial_print("not registered\n");
+        return;
+    }
+    serial_print_hex((uint32_t)ring);
+    serial_print("\n  doorbells=");
+    serial_print_u32(stats.doorbells);
+    serial_print(" requests=");
+    serial_print_u32(stats.requests);
+    serial_print(" errors=");
+    serial_print_u32(stats.errors);
+    serial_print(" cq_full=");
+    serial_print_u32(stats.cq_full);
+    serial_print(" max_batch=");
+    serial_print_u32(stats.max_batch);
+    if (stats.requests) {
+        serial_print(" avg=");
+        serial_print_u32((uint32_t)(stats.cycles / stats.requests));
+        serial_print("cyc/req");
+    }
+    serial_print("\n");
+}
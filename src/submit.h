@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+#include "exo_ring.h"
+
+/*
+ * submit.h — Kernel side of the batched syscall ring (exo_ring.h).
+ *
+ * One ring is registered at a time: there is a single LibOS.  When LibOS
+ * contexts exist, the registration and stats move into the context.
+ */
+
+typedef struct {
+    uint32_t doorbells;      // exo_submit calls
+    uint32_t requests;       // SQ entries consumed
+    uint32_t errors;         // completions with a negative result
+    uint32_t cq_full;        // doorbells cut short by a full CQ
+    uint32_t max_batch;      // most entries consumed by one doorbell
+    uint64_t cycles;         // TSC cycles spent processing entries
+} submit_stats_t;
+
+/* Register `ring` (already range-checked by the caller) and reset its
+   stats. The ring must be 4-byte aligned; NULL unregisters. */
+int32_t submit_register(exo_ring_t* ring);
+
+/* Run up to `n` queued requests in order. Returns the number consumed, or
+   -EXO_EBADF if no ring is registered. */
+int32_t submit_process(uint32_t n);
+
+const submit_stats_t* submit_stats(void);
+
+/* Print the ring stats over serial. */
+void submit_dump(void);
@@ -0,0 +1,370 @@
+#include "syscall.h"
+#include "cpu.h"
+#include "gdt.h"
+#include "idt.h"
+#include "pit.h"
+#include "ps2.h"
+#include "ps2_mouse.h"
+#include "serial.h"
+#include "vdata.h"
+#include "submit.h"
+#include "wad.h"
+#include "ramfs.h"
+#include "speaker.h"
+#include "mixer.h"
+#include "sb16.h"
+#include "sched.h"
+#include "vmm.h"
+#include "trace.h"
+#include "init.h"
+
+#define MSR_SYSENTER_CS  0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+
+#define CPUID_EDX_SEP (1u << 11)
+
+extern void syscall_int80_stub(void);
+extern void syscall_sysenter_stub(void);
+
+static syscall_stats_t stats[EXO_SYS_COUNT];
+static bool sysenter_enabled = false;
+
+/*
+ * No user address space exists yet (everything outside the demand-zero
+ * window is identity mapped and ring 0 can touch it all), so pointer checks
+ * only reject NULL and ranges that wrap. They are the single place to
+ * tighten once LibOS address spaces land.
+ */
+static bool user_range_ok(uint32_t addr, uint32_t len) {
+    return addr != 0 && addr + len >= addr;
+}
+
+/* Copy a NUL-terminated path into `out` (RAMFS_NAME_MAX bytes). */
+static int32_t copy_user_path(uint32_t addr, char* out) {
+    const char* p = (const char*)addr;
+    for (uint32_t i = 0; i < RAMFS_NAME_MAX; i++) {
+        if (!user_range_ok(addr + i, 1)) return -EXO_EFAULT;
+        out[i] = p[i];
+        if (p[i] == '\0') return 0;
+    }
+    return -EXO_ENAMETOOLONG;
+}
+
+static int32_t sys_get_ticks(uint32_t a1, uint32_t a2, uint32_t a3,
+                             uint32_t a4, uint32_t a5) {
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    return (int32_t)kernel_get_ticks_ms();
+}
+
+static int32_t sys_kbd_poll(uint32_t event_out, uint32_t a2, uint32_t a3,
+                            uint32_t a4, uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    if (!user_range_ok(event_out, sizeof(kbd_event_t))) return -EXO_EFAULT;
+    return exo_kbd_poll((kbd_event_t*)event_out);
+}
+
+static int32_t sys_mouse_poll(uint32_t state_out, uint32_t a2, uint32_t a3,
+                              uint32_t a4, uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    if (!user_range_ok(state_out, sizeof(mouse_state_t))) return -EXO_EFAULT;
+    exo_mouse_poll((mouse_state_t*)state_out);
+    return 0;
+}
+
+static int32_t sys_serial_write(uint32_t buf, uint32_t len, uint32_t a3,
+                                uint32_t a4, uint32_t a5) {
+    (void)a3; (void)a4; (void)a5;
+    if (!user_range_ok(buf, len)) return -EXO_EFAULT;
+
+    const char* p = (const char*)buf;
+    for (uint32_t i = 0; i < len; i++) {
+        serial_putc(p[i]);
+    }
+    return (int32_t)len;
+}
+
+static int32_t sys_vdata(uint32_t a1, uint32_t a2, uint32_t a3, uint32_t a4,
+                         uint32_t a5) {
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    return (int32_t)(uint32_t)vdata_page();
+}
+
+static int32_t sys_ring_setup(uint32_t ring, uint32_t a2, uint32_t a3,
+                              uint32_t a4, uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    if (ring && !user_range_ok(ring, sizeof(exo_ring_t))) return -EXO_EFAULT;
+    return submit_register((exo_ring_t*)ring);
+}
+
+static int32_t sys_submit(uint32_t n, uint32_t a2, uint32_t a3, uint32_t a4,
+                          uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    return submit_process(n);
+}
+
+static int32_t sys_wad_map(uint32_t info_out, uint32_t a2, uint32_t a3,
+                           uint32_t a4, uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    if (!user_range_ok(info_out, sizeof(exo_wad_info_t))) return -EXO_EFAULT;
+
+    const exo_wad_info_t* info = wad_info();
+    if (!info) return -EXO_ENOENT;
+    *(exo_wad_info_t*)info_out = *info;
+    return 0;
+}
+
+static int32_t sys_file_open(uint32_t path, uint32_t mode, uint32_t a3,
+                             uint32_t a4, uint32_t a5) {
+    (void)a3; (void)a4; (void)a5;
+    char name[RAMFS_NAME_MAX];
+    int32_t err = copy_user_path(path, name);
+    return err ? err : ramfs_open(name, mode);
+}
+
+static int32_t sys_file_close(uint32_t fd, uint32_t a2, uint32_t a3,
+                              uint32_t a4, uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    return ramfs_close((int32_t)fd);
+}
+
+static int32_t sys_file_read(uint32_t fd, uint32_t buf, uint32_t count,
+                             uint32_t a4, uint32_t a5) {
+    (void)a4; (void)a5;
+    if (!user_range_ok(buf, count)) return -EXO_EFAULT;
+    return ramfs_read((int32_t)fd, (void*)buf, count);
+}
+
+static int32_t sys_file_write(uint32_t fd, uint32_t buf, uint32_t count,
+                              uint32_t a4, uint32_t a5) {
+    (void)a4; (void)a5;
+    if (!user_range_ok(buf, count)) return -EXO_EFAULT;
+    return ramfs_write((int32_t)fd, (const void*)buf, count);
+}
+
+static int32_t sys_file_seek(uint32_t fd, uint32_t offset, uint32_t whence,
+                             uint32_t a4, uint32_t a5) {
+    (void)a4; (void)a5;
+    return ramfs_seek((int32_t)fd, (int32_t)offset, whence);
+}
+
+static int32_t sys_file_stat(uint32_t path, uint32_t size_out, uint32_t a3,
+                             uint32_t a4, uint32_t a5) {
+    (void)a3; (void)a4; (void)a5;
+    char name[RAMFS_NAME_MAX];
+    int32_t err = copy_user_path(path, name);
+    if (err) return err;
+    if (!user_range_ok(size_out, sizeof(uint32_t))) return -EXO_EFAULT;
+    return ramfs_stat(name, (uint32_t*)size_out);
+}
+
+static int32_t sys_file_remove(uint32_t path, uint32_t a2, uint32_t a3,
+                               uint32_t a4, uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    char name[RAMFS_NAME_MAX];
+    int32_t err = copy_user_path(path, name);
+    return err ? err : ramfs_remove(name);
+}
+
+static int32_t sys_file_rename(uint32_t old_path, uint32_t new_path,
+                               uint32_t a3, uint32_t a4, uint32_t a5) {
+    (void)a3; (void)a4; (void)a5;
+    char old_name[RAMFS_NAME_MAX], new_name[RAMFS_NAME_MAX];
+    int32_t err = copy_user_path(old_path, old_name);
+    if (!err) err = copy_user_path(new_path, new_name);
+    return err ? err : ramfs_rename(old_name, new_name);
+}
+
+/* a3 packs the channel (bits 0-7) and priority (bits 8-15); see
+   exo_sound.h. */
+static int32_t sys_sound_tone(uint32_t freq, uint32_t dur_ms, uint32_t a3,
+                              uint32_t a4, uint32_t a5) {
+    (void)a4; (void)a5;
+    return speaker_tone(a3 & 0xFF, (a3 >> 8) & 0xFF, freq, dur_ms);
+}
+
+static int32_t sys_sound_stop(uint32_t channel, uint32_t a2, uint32_t a3,
+                              uint32_t a4, uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    return speaker_stop(channel);
+}
+
+/* Both PCM calls pack the volume (bits 0-7) and separation (bits 8-15)
+   into one argument, a5 here and a2 in sys_pcm_update; see exo_sound.h. */
+static int32_t sys_pcm_play(uint32_t channel, uint32_t data, uint32_t len,
+                            uint32_t rate, uint32_t a5) {
+    if (!sb16_present()) return -EXO_ENODEV;
+    if (!user_range_ok(data, len)) return -EXO_EFAULT;
+    return mixer_play(channel, (const uint8_t*)data, len, rate, a5 & 0xFF,
+                      (a5 >> 8) & 0xFF);
+}
+
+static int32_t sys_pcm_update(uint32_t channel, uint32_t a2, uint32_t a3,
+                              uint32_t a4, uint32_t a5) {
+    (void)a3; (void)a4; (void)a5;
+    if (!sb16_present()) return -EXO_ENODEV;
+    return mixer_update(channel, a2 & 0xFF, (a2 >> 8) & 0xFF);
+}
+
+static int32_t sys_pcm_stop(uint32_t channel, uint32_t a2, uint32_t a3,
+                            uint32_t a4, uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    if (!sb16_present()) return -EXO_ENODEV;
+    return mixer_stop(channel);
+}
+
+/* a1 = 0 yields; a1 > 0 sleeps that long in milliseconds. The caller's
+   state stays on its own stack while others run. int 0x80 from a spawned
+   context lands on that context's stack (TSS.esp0, sched.c); SYSENTER and
+   ring-3 calls while kmain runs use the shared entry stack, which cannot
+   be switched away from. */
+static int32_t sys_yield(uint32_t ms, uint32_t a2, uint32_t a3,
+                         uint32_t a4, uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    uint32_t esp;
+    __asm__ volatile ("mov %%esp, %0" : "=r"(esp));
+    if (!sched_current() || tss_on_entry_stack(esp)) return -EXO_EBUSY;
+
+    if (ms) sched_sleep_ms(ms);
+    else sched_yield();
+    return 0;
+}
+
+/* a1 = exit code, unused for now. Ends the calling context as if its entry
+   had returned; its pages and files are not reclaimed yet. Same stack rule
+   as sys_yield, and kmain never exits. */
+static int32_t sys_exit(uint32_t code, uint32_t a2, uint32_t a3,
+                        uint32_t a4, uint32_t a5) {
+    (void)code; (void)a2; (void)a3; (void)a4; (void)a5;
+    uint32_t esp;
+    __asm__ volatile ("mov %%esp, %0" : "=r"(esp));
+    context_t* c = sched_current();
+    if (!c || !c->stack || tss_on_entry_stack(esp)) return -EXO_EBUSY;
+
+    sched_exit();
+}
+
+/* Demand-zero memory: a1 = size in bytes, a2 = where to store the base. */
+static int32_t sys_mem_reserve(uint32_t size, uint32_t base_out, uint32_t a3,
+                               uint32_t a4, uint32_t a5) {
+    (void)a3; (void)a4; (void)a5;
+    if (!user_range_ok(base_out, sizeof(uint32_t))) return -EXO_EFAULT;
+    return vmm_reserve(size, (uint32_t*)base_out);
+}
+
+static int32_t sys_mem_release(uint32_t base, uint32_t a2, uint32_t a3,
+                               uint32_t a4, uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    return vmm_release(base);
+}
+
+/* a1 = EXO_TRACE_* kind, a2 = frame number or mark value, a3 = second
+   mark value. Records only if that tracepoint is enabled; 0 either way.
+   The first frame end is also the boot timeline's last milestone. */
+static int32_t sys_trace(uint32_t kind, uint32_t a2, uint32_t a3,
+                         uint32_t a4, uint32_t a5) {
+    (void)a4; (void)a5;
+    switch (kind) {
+    case EXO_TRACE_FRAME_BEGIN: TRACE(FRAME_BEGIN, 0, a2); return 0;
+    case EXO_TRACE_FRAME_END:
+        TRACE(FRAME_END, 0, a2);
+        init_mark(INIT_MARK_FIRST_FRAME);
+        return 0;
+    case EXO_TRACE_MARK:        TRACE(MARK, a2, a3);       return 0;
+    default:                    return -EXO_EINVAL;
+    }
+}
+
+/* Unimplemented entries stay NULL and fail with -EXO_ENOSYS. */
+static const syscall_fn_t syscall_table[EXO_SYS_COUNT] = {
+    [EXO_SYS_GET_TICKS]    = sys_get_ticks,
+    [EXO_SYS_KBD_POLL]     = sys_kbd_poll,
+    [EXO_SYS_MOUSE_POLL]   = sys_mouse_poll,
+    [EXO_SYS_SERIAL_WRITE] = sys_serial_write,
+    [EXO_SYS_FILE_OPEN]    = sys_file_open,
+    [EXO_SYS_FILE_CLOSE]   = sys_file_close,
+    [EXO_SYS_FILE_READ]    = sys_file_read,
+    [EXO_SYS_FILE_WRITE]   = sys_file_write,
+    [EXO_SYS_FILE_SEEK]    = sys_file_seek,
+    [EXO_SYS_FILE_STAT]    = sys_file_stat,
+    [EXO_SYS_FILE_REMOVE]  = sys_file_remove,
+    [EXO_SYS_FILE_RENAME]  = sys_file_rename,
+    [EXO_SYS_SOUND_TONE]   = sys_sound_tone,
+    [EXO_SYS_SOUND_STOP]   = sys_sound_stop,
+    [EXO_SYS_YIELD]        = sys_yield,
+    [EXO_SYS_EXIT]         = sys_exit,
+    [EXO_SYS_VDATA]        = sys_vdata,
+    [EXO_SYS_RING_SETUP]   = sys_ring_setup,
+    [EXO_SYS_SUBMIT]       = sys_submit,
+    [EXO_SYS_WAD_MAP]      = sys_wad_map,
+    [EXO_SYS_PCM_PLAY]     = sys_pcm_play,
+    [EXO_SYS_PCM_UPDATE]   = sys_pcm_update,
+    [EXO_SYS_PCM_STOP]     = sys_pcm_stop,
+    [EXO_SYS_MEM_RESERVE]  = sys_mem_reserve,
+    [EXO_SYS_MEM_RELEASE]  = sys_mem_release,
+    [EXO_SYS_TRACE]        = sys_trace,
+};
+
+int32_t syscall_dispatch(uint32_t num, uint32_t a1, uint32_t a2, uint32_t a3,
+                         uint32_t a4, uint32_t a5) {
+    if (num >= EXO_SYS_COUNT || !syscall_table[num]) {
+        return -EXO_ENOSYS;
+    }
+
+    TRACE(SYSCALL_ENTER, num, a1);
+    uint64_t start = rdtsc();
+    int32_t ret = syscall_table[num](a1, a2, a3, a4, a5);
+    stats[num].cycles += rdtsc() - start;
+    stats[num].calls++;
+    TRACE(SYSCALL_EXIT, num, (uint32_t)ret);
+    return ret;
+}
+
+const syscall_stats_t* syscall_stats(uint32_t num) {
+    return num < EXO_SYS_COUNT ? &stats[num] : 0;
+}
+
+bool syscall_has_sysenter(void) {
+    return sysenter_enabled;
+}
+
+static bool cpu_has_sep(void) {
+    uint32_t a, b, c, d;
+    cpuid(1, &a, &b, &c, &d);
+    if (!(d & CPUID_EDX_SEP)) return false;
+
+    // Original Pentium Pro (family 6, model < 3, stepping < 3) sets SEP
+    // without implementing SYSENTER.
+    uint32_t family = (a >> 8) & 0xF;
+    uint32_t model = (a >> 4) & 0xF;
+    uint32_t stepping = a & 0xF;
+    return !(family == 6 && model < 3 && stepping < 3);
+}
+
+void syscall_init(void) {
+    idt_set_gate_flags(0x80, (uint32_t)syscall_int80_stub, IDT_GATE_TRAP_USER);
+
+    if (cpu_has_sep()) {
+        // SYSENTER loads CS from the MSR and SS = CS + 8, and switches to the
+        // same ring-0 stack int 0x80 gets from the TSS.
+        wrmsr(MSR_SYSENTER_CS, GDT_KERNEL_CS);
+        wrmsr(MSR_SYSENTER_ESP, tss_kernel_stack());
+        wrmsr(MSR_SYSENTER_EIP, (uint32_t)syscall_sysenter_stub);
+        sysenter_enabled = true;
+    }
+}
+
+void syscall_dump(void) {
+    serial_print("syscalls:");
+    serial_print(sysenter_enabled ? " int80+sysenter\n" : " int80\n");
+    for (uint32_t i = 0; i < EXO_SYS_COUNT; i++) {
+        if (stats[i].calls == 0) continue;
+        serial_print("  #");
+        serial_print_u32(i);
+        serial_print(" calls=");
+        serial_print_u32(stats[i].calls);
+        serial_print(" avg=");
+        serial_print_u32((uint32_t)(stats[i].cycles / stats[i].calls));
+        serial_print("cyc\n");
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "exo_abi.h"
+
+/*
+ * syscall.h — Kernel side of the LibOS system call interface.
+ *
+ * Both entry stubs (int 0x80 and SYSENTER, in isr.s) collect the register
+ * arguments and call syscall_dispatch(), which bounds-checks the number,
+ * looks the handler up in a function-pointer table and accounts the call.
+ */
+
+typedef int32_t (*syscall_fn_t)(uint32_t a1, uint32_t a2, uint32_t a3,
+                                uint32_t a4, uint32_t a5);
+
+typedef struct {
+    uint32_t calls;
+    uint64_t cycles;     // TSC cycles spent in the handler
+} syscall_stats_t;
+
+/* Install the DPL3 int 0x80 trap gate and, if CPUID reports SEP, program
+   the SYSENTER MSRs. Call after gdt_init() and idt_init(). */
+void syscall_init(void);
+
+/* True once the SYSENTER MSRs have been programmed. */
+bool syscall_has_sysenter(void);
+
+/* Run syscall `num`. Unknown or unimplemented numbers return -EXO_ENOSYS. */
+int32_t syscall_dispatch(uint32_t num, uint32_t a1, uint32_t a2, uint32_t a3,
+                         uint32_t a4, uint32_t a5);
+
+/* Per-syscall counters; NULL for an out-of-range number. */
+const syscall_stats_t* syscall_stats(uint32_t num);
+
+/* Print every syscall that has been called, with count and avg cycles. */
+void syscall_dump(void);
@@ -0,0 +1,124 @@
+#include "trace.h"
+#include "cpu.h"
+#include "ctype.h"
+#include "pmm.h"
+#include "sched.h"
+#include "serial.h"
+#include "tsc.h"
+
+#define RING_PAGES (TRACE_RING_RECORDS * sizeof(trace_rec_t) / PAGE_SIZE)
+
+#define TRACE_DESC(ev, ph, name, a, b) { #ev, ph, name, a, b },
+static const trace_event_t events[TRACE_EVENT_COUNT] = {
+    TRACE_EVENTS(TRACE_DESC)
+};
+#undef TRACE_DESC
+
+volatile uint32_t trace_mask = 0;
+static trace_rec_t* ring = 0;          // allocated once, kept
+static volatile uint32_t head = 0;     // records ever appended
+static trace_stats_t stats;
+
+void trace_record(uint32_t event, uint32_t a, uint32_t b) {
+    uint32_t slot = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+    trace_rec_t* r = &ring[slot & (TRACE_RING_RECORDS - 1)];
+    uint32_t cpu = cpu_id();
+    const context_t* ctx = cpu == 0 ? sched_current() : 0;
+
+    r->tsc = rdtsc();
+    r->event = (uint8_t)event;
+    r->where = (uint8_t)((cpu & 0xF) | (ctx ? ctx->id : 0) << 4);
+    r->a = (uint16_t)a;
+    r->b = b;
+}
+
+bool trace_start(uint32_t mask) {
+    if (!ring) ring = alloc_pages(RING_PAGES);
+    if (!ring) return false;
+
+    trace_mask = 0;
+    head = 0;
+    trace_mask = mask & TRACE_ALL;
+    return true;
+}
+
+void trace_enable(uint32_t event, bool on) {
+    if (!ring || event >= TRACE_EVENT_COUNT) return;
+    if (on) __atomic_or_fetch(&trace_mask, 1u << event, __ATOMIC_RELAXED);
+    else __atomic_and_fetch(&trace_mask, ~(1u << event), __ATOMIC_RELAXED);
+}
+
+void trace_stop(void) {
+    trace_mask = 0;
+}
+
+int32_t trace_find(const char* id, uint32_t len) {
+    for (uint32_t e = 0; e < TRACE_EVENT_COUNT; e++) {
+        const char* name = events[e].id;
+        uint32_t i = 0;
+        while (i < len && name[i] && tolower(name[i]) == tolower(id[i])) i++;
+        if (i == len && name[i] == '\0') return (int32_t)e;
+    }
+    return -1;
+}
+
+const trace_event_t* trace_event(uint32_t event) {
+    return event < TRACE_EVENT_COUNT ? &events[event] : 0;
+}
+
+const trace_stats_t* trace_stats(void) {
+    uint32_t n = head;
+    stats.records = n;
+    stats.overwritten = n > TRACE_RING_RECORDS ? n - TRACE_RING_RECORDS : 0;
+    return &stats;
+}
+
+uint32_t trace_read(trace_rec_t* out, uint32_t max) {
+    uint32_t end = head;
+    uint32_t n = end < TRACE_RING_RECORDS ? end : TRACE_RING_RECORDS;
+    if (n > max) n = max;
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = ring[(end - n + i) & (TRACE_RING_RECORDS - 1)];
+    }
+    return n;
+}
+
+static void print_arg(const char* name) {
+    serial_print(" ");
+    serial_print(*name ? name : "-");
+}
+
+void trace_dump(void) {
+    trace_stop();
+    const trace_stats_t* s = trace_stats();
+    uint32_t n = s->records - s->overwritten;
+
+    serial_print("trace: begin records=");
+    serial_print_u32(n);
+    serial_print(" overwritten=");
+    serial_print_u32(s->overwritten);
+    serial_print(" khz=");
+    serial_print_u32(tsc_khz());
+    serial_print("\n");
+    for (uint32_t e = 0; e < TRACE_EVENT_COUNT; e++) {
+        char ph[3] = { ' ', events[e].ph, '\0' };
+        serial_print("trace: event ");
+        serial_print_u32(e);
+        serial_print(ph);
+        print_arg(events[e].name);
+        print_arg(events[e].a);
+        print_arg(events[e].b);
+        serial_print("\n");
+    }
+
+    // The records themselves, oldest first, exactly n * 16 bytes.
+    serial_print("trace: data ");
+    serial_print_u32(n * sizeof(trace_rec_t));
+    serial_print("\n");
+    uint32_t first = s->records - n;
+    for (uint32_t i = 0; i < n; i++) {
+        serial_write((const char*)&ring[(first + i) & (TRACE_RING_RECORDS - 1)],
+                     sizeof(trace_rec_t));
+    }
+    serial_print("\ntrace: end\n");
+}
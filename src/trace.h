@@ -0,0 +1,105 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * trace.h — Static tracepoints into a binary ring buffer (docs/debugging.md).
+ *
+ * Every event is declared once in TRACE_EVENTS with its Chrome trace phase
+ * and the names of its two arguments, a 16-bit `a` and a 32-bit `b`.  The
+ * phases are B/E (a span that nests on its thread), b/e (an async span
+ * that may overlap others, such as a LibOS frame) and i (an instant).
+ * A tracepoint in code is
+ *
+ *     TRACE(IRQ_ENTER, irq, latency);
+ *
+ * which costs one load, test and not-taken branch while that event is
+ * disabled.  When enabled it appends a 16-byte record (TSC, event, CPU and
+ * context, a, b) to a ring shared by all CPUs; the oldest records are
+ * overwritten.  Each context is its own thread in the timeline, so spans
+ * left open across a context switch still nest.
+ *
+ * trace_dump() writes a text header naming every event, then the records
+ * as raw bytes, oldest first.  tools/trace_chrome.py turns a captured log
+ * into Chrome / Perfetto JSON.
+ */
+
+/*    event          ph   name             a           b */
+#define TRACE_EVENTS(X) \
+    X(IRQ_ENTER,     'B', "irq",           "irq",      "latency_cyc") \
+    X(IRQ_EXIT,      'E', "irq",           "irq",      "") \
+    X(SCANCODE,      'i', "scancode",      "code",     "") \
+    X(SYSCALL_ENTER, 'B', "syscall",       "num",      "a1") \
+    X(SYSCALL_EXIT,  'E', "syscall",       "num",      "ret") \
+    X(FB_FILL_BEGIN, 'B', "fb_fill_rect",  "w",        "h") \
+    X(FB_FILL_END,   'E', "fb_fill_rect",  "",         "") \
+    X(CTX_SWITCH,    'i', "switch",        "from",     "to") \
+    X(PAGE_FAULT,    'i', "page_fault",    "err",      "addr") \
+    X(FRAME_BEGIN,   'b', "frame",         "",         "frame") \
+    X(FRAME_END,     'e', "frame",         "",         "frame") \
+    X(MARK,          'i', "mark",          "a",        "b")
+
+#define TRACE_ENUM(ev, ph, name, a, b) TRACE_##ev,
+enum { TRACE_EVENTS(TRACE_ENUM) TRACE_EVENT_COUNT };
+#undef TRACE_ENUM
+
+_Static_assert(TRACE_EVENT_COUNT <= 32, "trace_mask has one bit per event");
+
+#define TRACE_RING_RECORDS 16384     // 256 KiB, a power of two
+#define TRACE_ALL          ((1u << TRACE_EVENT_COUNT) - 1)
+
+typedef struct {
+    uint64_t tsc;
+    uint8_t  event;
+    uint8_t  where;           // CPU in bits 0-3, context id (BSP) in 4-7
+    uint16_t a;
+    uint32_t b;
+} __attribute__((packed)) trace_rec_t;
+
+_Static_assert(sizeof(trace_rec_t) == 16, "trace record layout");
+
+typedef struct {
+    const char* id;           // "IRQ_ENTER"
+    char        ph;
+    const char* name;
+    const char* a;            // argument names; "" = unused
+    const char* b;
+} trace_event_t;
+
+typedef struct {
+    uint32_t records;         // appended since trace_start()
+    uint32_t overwritten;     // lost to the ring wrapping
+} trace_stats_t;
+
+/* Bit TRACE_<ev> set = that tracepoint records. */
+extern volatile uint32_t trace_mask;
+
+void trace_record(uint32_t event, uint32_t a, uint32_t b);
+
+#define TRACE(ev, a, b) do { \
+    if (__builtin_expect(trace_mask & (1u << TRACE_##ev), 0)) \
+        trace_record(TRACE_##ev, (a), (b)); \
+} while (0)
+
+/* Empty the ring and enable the events in `mask`. Allocates the ring on
+   first use; returns false if it cannot. */
+bool trace_start(uint32_t mask);
+
+/* Enable or disable one event without touching the ring. */
+void trace_enable(uint32_t event, bool on);
+
+void trace_stop(void);
+
+/* Event whose id (as in TRACE_EVENTS) is the `len` bytes at `id`, compared
+   case-insensitively, or -1. */
+int32_t trace_find(const char* id, uint32_t len);
+
+const trace_event_t* trace_event(uint32_t event);
+const trace_stats_t* trace_stats(void);
+
+/* The newest `max` records (or all, if fewer), oldest first, copied into
+   `out`. Returns the count. */
+uint32_t trace_read(trace_rec_t* out, uint32_t max);
+
+/* Stop tracing and write the header and the raw records to serial. */
+void trace_dump(void);
@@ -0,0 +1,38 @@
+#include "tsc.h"
+#include "cpu.h"
+#include "io.h"
+
+#define PIT_HZ          1193182
+#define CALIBRATE_MS    10
+#define CALIBRATE_COUNT (PIT_HZ * CALIBRATE_MS / 1000)
+
+static uint32_t khz = 0;
+
+uint32_t tsc_calibrate(void) {
+    // Gate channel 2 on but keep the speaker output disconnected.
+    outb(0x61, (inb(0x61) & ~0x02) | 0x01);
+
+    // Channel 2, lobyte/hibyte, mode 0 (interrupt on terminal count):
+    // OUT2 goes high once CALIBRATE_COUNT PIT clocks have elapsed.
+    outb(0x43, 0xB0);
+    outb(0x42, CALIBRATE_COUNT & 0xFF);
+    outb(0x42, (CALIBRATE_COUNT >> 8) & 0xFF);
+
+    uint64_t start = rdtsc();
+    while (!(inb(0x61) & 0x20)) {
+        ;
+    }
+    uint64_t end = rdtsc();
+
+    khz = (uint32_t)((end - start) / CALIBRATE_MS);
+    return khz;
+}
+
+uint32_t tsc_khz(void) {
+    return khz;
+}
+
+uint32_t tsc_cycles_to_us(uint64_t cycles) {
+    if (khz == 0) return 0;
+    return (uint32_t)(cycles * 1000 / khz);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * tsc.h — Time-stamp counter calibration.
+ *
+ * Measures the TSC rate against PIT channel 2 once at boot so cycle counts
+ * from rdtsc() can be turned into wall-clock units.
+ */
+
+/* Calibrate against a 10 ms PIT channel 2 one-shot. Must run before the
+   PC speaker owns channel 2. Returns the TSC rate in kHz. */
+uint32_t tsc_calibrate(void);
+
+/* Calibrated rate in kHz (cycles per millisecond), 0 before calibration. */
+uint32_t tsc_khz(void);
+
+/* Convert a cycle count to microseconds (0 before calibration). */
+uint32_t tsc_cycles_to_us(uint64_t cycles);
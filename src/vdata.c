@@ -0,0 +1,50 @@
+#include "vdata.h"
+#include "cpu.h"
+
+#define PAGE_SIZE 4096
+
+_Static_assert(sizeof(exo_vdata_t) <= PAGE_SIZE, "vdata must fit one page");
+
+// Padded to a full page so nothing else shares it once it is mapped.
+static union {
+    exo_vdata_t data;
+    uint8_t page[PAGE_SIZE];
+} vdata __attribute__((aligned(PAGE_SIZE)));
+
+static inline void write_begin(void) {
+    vdata.data.seq++;
+    cpu_barrier();
+}
+
+static inline void write_end(void) {
+    cpu_barrier();
+    vdata.data.seq++;
+}
+
+void vdata_init(uint32_t tick_hz, uint32_t tsc_khz) {
+    uint32_t flags = irq_save();
+    write_begin();
+    vdata.data.version = EXO_VDATA_VERSION;
+    vdata.data.tick_hz = tick_hz;
+    vdata.data.tsc_khz = tsc_khz;
+    write_end();
+    irq_restore(flags);
+}
+
+void vdata_tick(uint32_t ticks, uint32_t ms, uint64_t tsc) {
+    write_begin();
+    vdata.data.ticks = ticks;
+    vdata.data.ms = ms;
+    vdata.data.tick_tsc = tsc;
+    write_end();
+}
+
+void vdata_set_kbd_modifiers(uint8_t mods) {
+    write_begin();
+    vdata.data.kbd_modifiers = mods;
+    write_end();
+}
+
+const exo_vdata_t* vdata_page(void) {
+    return &vdata.data;
+}
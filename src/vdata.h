@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+#include "exo_vdata.h"
+
+/*
+ * vdata.h — Kernel side of the shared read-only data page (exo_vdata.h).
+ *
+ * The page is a page-aligned, page-sized object in .bss, so it can be
+ * mapped read-only into a LibOS address space on its own.  All writers run
+ * with interrupts off (the IRQ0 and IRQ1 top halves, or under irq_save), so
+ * there is only ever one writer at a time.
+ */
+
+/* Fill in the clock parameters. Call once pit_init() and tsc_calibrate()
+   have run. */
+void vdata_init(uint32_t tick_hz, uint32_t tsc_khz);
+
+/* IRQ0: publish the new tick count, its millisecond value and the TSC. */
+void vdata_tick(uint32_t ticks, uint32_t ms, uint64_t tsc);
+
+/* IRQ1: publish the keyboard modifier mask after it changes. */
+void vdata_set_kbd_modifiers(uint8_t mods);
+
+/* The page itself (kernel view). */
+const exo_vdata_t* vdata_page(void);
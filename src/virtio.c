@@ -0,0 +1,120 @@
+#include "virtio.h"
+#include "io.h"
+#include "cpu.h"
+#include "pmm.h"
+#include "string.h"
+
+uint32_t virtio_begin(uint16_t iobase, uint32_t wanted) {
+    outb(iobase + VIRTIO_REG_STATUS, 0);
+    outb(iobase + VIRTIO_REG_STATUS, VIRTIO_STATUS_ACK);
+    outb(iobase + VIRTIO_REG_STATUS, VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER);
+
+    uint32_t offered = inl(iobase + VIRTIO_REG_DEVICE_FEATURES);
+    outl(iobase + VIRTIO_REG_GUEST_FEATURES, offered & wanted);
+    return offered;
+}
+
+void virtio_finish(uint16_t iobase) {
+    outb(iobase + VIRTIO_REG_STATUS, VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER
+         | VIRTIO_STATUS_DRIVER_OK);
+}
+
+void virtio_fail(uint16_t iobase) {
+    outb(iobase + VIRTIO_REG_STATUS, VIRTIO_STATUS_FAILED);
+}
+
+/* Legacy layout: descriptors, then the avail ring, then the used ring on
+   the next page boundary (spec §2.4.2). */
+static uint32_t used_offset(uint16_t size) {
+    uint32_t bytes = 16u * size + 6 + 2u * size;
+    return (bytes + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+}
+
+bool virtq_init(virtq_t* q, uint16_t iobase, uint16_t index) {
+    outw(iobase + VIRTIO_REG_QUEUE_SELECT, index);
+    uint16_t size = inw(iobase + VIRTIO_REG_QUEUE_SIZE);
+    if (size == 0 || (size & (size - 1))) return false;
+
+    uint32_t bytes = used_offset(size) + 6 + 8u * size;
+    uint32_t pages = (bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+    uint8_t* mem = alloc_pages(pages);
+    if (!mem) return false;
+    memset(mem, 0, pages * PAGE_SIZE);
+
+    *q = (virtq_t){0};
+    q->iobase = iobase;
+    q->index = index;
+    q->size = size;
+    q->pages = pages;
+    q->desc = (virtq_desc_t*)mem;
+    q->avail = (virtq_avail_t*)(mem + 16u * size);
+    q->used = (virtq_used_t*)(mem + used_offset(size));
+
+    // Completions are polled, so ask the device not to interrupt.
+    q->avail->flags = VIRTQ_AVAIL_F_NO_INTERRUPT;
+
+    for (uint16_t i = 0; i < size; i++) {
+        q->desc[i].next = (uint16_t)(i + 1);
+    }
+    q->free_head = 0;
+    q->num_free = size;
+
+    outl(iobase + VIRTIO_REG_QUEUE_PFN, (uint32_t)mem / PAGE_SIZE);
+    return true;
+}
+
+int32_t virtq_add(virtq_t* q, const virtq_buf_t* bufs, uint16_t n) {
+    if (n == 0 || n > q->num_free) return -1;
+
+    uint16_t head = q->free_head;
+    uint16_t id = head;
+    for (uint16_t i = 0; i < n; i++) {
+        virtq_desc_t* d = &q->desc[id];
+        d->addr = (uint32_t)bufs[i].addr;
+        d->len = bufs[i].len;
+        d->flags = (uint16_t)((bufs[i].device_writes ? VIRTQ_DESC_F_WRITE : 0)
+                              | (i + 1 < n ? VIRTQ_DESC_F_NEXT : 0));
+        if (i + 1 < n) id = d->next;
+    }
+    q->free_head = q->desc[id].next;
+    q->num_free -= n;
+
+    q->avail->ring[q->avail_idx & (q->size - 1)] = head;
+    q->avail_idx++;
+    cpu_barrier();   // ring entry before the index
+    q->avail->idx = q->avail_idx;
+    q->chains++;
+    return head;
+}
+
+void virtq_kick(virtq_t* q) {
+    if (q->kicked_idx == q->avail_idx) return;
+    q->kicked_idx = q->avail_idx;
+    cpu_barrier();   // avail index before the notify
+    outw(q->iobase + VIRTIO_REG_QUEUE_NOTIFY, q->index);
+    q->notifies++;
+}
+
+bool virtq_pop(virtq_t* q, uint16_t* id_out, uint32_t* len_out) {
+    if (q->last_used == q->used->idx) return false;
+    cpu_barrier();   // index before the entry
+
+    const virtq_used_elem_t* e = &q->used->ring[q->last_used & (q->size - 1)];
+    uint16_t head = (uint16_t)e->id;
+    if (len_out) *len_out = e->len;
+    q->last_used++;
+
+    // Return the chain to the free list.
+    uint16_t id = head;
+    uint16_t n = 1;
+    while (q->desc[id].flags & VIRTQ_DESC_F_NEXT) {
+        id = q->desc[id].next;
+        n++;
+    }
+    q->desc[id].next = q->free_head;
+    q->free_head = head;
+    q->num_free += n;
+
+    if (id_out) *id_out = head;
+    return true;
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "pci.h"
+
+/*
+ * virtio.h — Virtio legacy PCI transport and split virtqueues (virtio 1.0
+ * spec §4.1.4.8 and §2.4).
+ *
+ * Devices are driven through the legacy I/O-port register block in BAR0,
+ * which QEMU's default "transitional" virtio-pci devices expose.  Modern-
+ * only devices (device ID 0x1040 + type) are reported but not driven: the
+ * modern transport needs MMIO capability parsing and 64-bit BARs above the
+ * identity-mapped range.
+ *
+ * Rings live in physically contiguous pages from the page allocator and
+ * memory is identity mapped, so descriptor addresses are plain pointers.
+ */
+
+#define VIRTIO_VENDOR            0x1AF4
+
+/* Legacy register block (offsets from BAR0, no MSI-X). */
+#define VIRTIO_REG_DEVICE_FEATURES 0x00   // 32-bit, read-only
+#define VIRTIO_REG_GUEST_FEATURES  0x04   // 32-bit
+#define VIRTIO_REG_QUEUE_PFN       0x08   // 32-bit, ring address >> 12
+#define VIRTIO_REG_QUEUE_SIZE      0x0C   // 16-bit, read-only
+#define VIRTIO_REG_QUEUE_SELECT    0x0E   // 16-bit
+#define VIRTIO_REG_QUEUE_NOTIFY    0x10   // 16-bit
+#define VIRTIO_REG_STATUS          0x12   // 8-bit
+#define VIRTIO_REG_ISR             0x13   // 8-bit, read clears
+#define VIRTIO_REG_CONFIG          0x14   // device-specific config
+
+#define VIRTIO_STATUS_ACK        1
+#define VIRTIO_STATUS_DRIVER     2
+#define VIRTIO_STATUS_DRIVER_OK  4
+#define VIRTIO_STATUS_FAILED     128
+
+#define VIRTQ_DESC_F_NEXT        1
+#define VIRTQ_DESC_F_WRITE       2        // device writes this buffer
+#define VIRTQ_AVAIL_F_NO_INTERRUPT 1
+
+typedef struct {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} virtq_desc_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+} virtq_avail_t;
+
+typedef struct {
+    uint32_t id;                          // head of the completed chain
+    uint32_t len;                         // bytes the device wrote
+} virtq_used_elem_t;
+
+typedef struct {
+    uint16_t flags;
+    volatile uint16_t idx;
+    virtq_used_elem_t ring[];
+} virtq_used_t;
+
+/* One buffer of a descriptor chain. */
+typedef struct {
+    void*    addr;
+    uint32_t len;
+    bool     device_writes;
+} virtq_buf_t;
+
+typedef struct {
+    uint16_t iobase;
+    uint16_t index;                       // queue number on the device
+    uint16_t size;                        // entries (power of 2)
+    uint16_t num_free;
+    uint16_t free_head;                   // free descriptors, chained by next
+    uint16_t last_used;                   // next used entry to consume
+    uint16_t avail_idx;                   // shadow of avail->idx
+    uint16_t kicked_idx;                  // avail_idx at the last notify
+    uint32_t pages;
+    virtq_desc_t*  desc;
+    virtq_avail_t* avail;
+    virtq_used_t*  used;
+    uint32_t notifies;
+    uint32_t chains;                      // chains made available
+} virtq_t;
+
+/* Reset the device, acknowledge it (ACK | DRIVER) and accept the feature
+   bits in `wanted` that it offers. Returns everything the device offers. */
+uint32_t virtio_begin(uint16_t iobase, uint32_t wanted);
+
+/* Queues are set up: set DRIVER_OK. */
+void virtio_finish(uint16_t iobase);
+
+/* Mark the device FAILED. */
+void virtio_fail(uint16_t iobase);
+
+/* Allocate and register queue `index`. Returns false if the device has
+   no such queue or the rings cannot be allocated. */
+bool virtq_init(virtq_t* q, uint16_t iobase, uint16_t index);
+
+/* Chain `n` buffers and make the chain available. The device is not told
+   until virtq_kick(), so several chains can be batched behind one notify.
+   Returns the head descriptor id, or -1 if too few descriptors are free. */
+int32_t virtq_add(virtq_t* q, const virtq_buf_t* bufs, uint16_t n);
+
+/* Notify the device of chains added since the last kick, if any. */
+void virtq_kick(virtq_t* q);
+
+/* Take one completed chain and free its descriptors. Returns false if the
+   device has not completed anything new. */
+bool virtq_pop(virtq_t* q, uint16_t* id_out, uint32_t* len_out);
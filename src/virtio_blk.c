@@ -0,0 +1,223 @@
+#include "virtio_blk.h"
+#include "virtio.h"
+#include "pci.h"
+#include "io.h"
+#include "cpu.h"
+#include "serial.h"
+#include "exo_abi.h"
+
+#define VIRTIO_BLK_F_RO     (1u << 5)
+
+#define VIRTIO_BLK_T_IN     0
+#define VIRTIO_BLK_T_OUT    1
+
+#define SECTORS_PER_BLOCK   (BLOCK_SIZE / 512)
+#define MAX_SEGS            32    // data descriptors per request
+#define MAX_INFLIGHT        16    // requests per batch before waiting
+#define POLL_LIMIT          100000000u
+
+typedef struct {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t sector;
+} virtio_blk_req_t;
+
+typedef struct {
+    virtio_blk_req_t hdr;
+    volatile uint8_t status;
+    bool busy;
+    uint16_t head;                // descriptor chain while busy
+} req_slot_t;
+
+static virtq_t vq;
+static blkdev_t dev;
+static bool present = false;
+static uint64_t capacity = 0;     // 512-byte sectors
+static req_slot_t slots[MAX_INFLIGHT];
+static uint32_t inflight = 0;
+static virtio_blk_stats_t stats;
+
+/* Wait for one completion and retire its slot. Returns false on timeout. */
+static bool reap_one(int32_t* err) {
+    uint16_t head;
+    uint32_t spins = 0;
+    while (!virtq_pop(&vq, &head, 0)) {
+        if (++spins == POLL_LIMIT) return false;
+        __asm__ volatile ("pause");
+    }
+
+    for (uint32_t i = 0; i < MAX_INFLIGHT; i++) {
+        if (!slots[i].busy || slots[i].head != head) continue;
+        if (slots[i].status != 0) {
+            stats.errors++;
+            *err = -EXO_EIO;
+        }
+        slots[i].busy = false;
+        inflight--;
+        break;
+    }
+    return true;
+}
+
+static req_slot_t* free_slot(void) {
+    for (uint32_t i = 0; i < MAX_INFLIGHT; i++) {
+        if (!slots[i].busy) return &slots[i];
+    }
+    return 0;
+}
+
+/* Queue one request for `n` consecutive blocks, waiting for earlier ones to
+   finish if the slots or the ring are full. */
+static bool queue_run(bool write, const blk_seg_t* segs, uint32_t n,
+                      int32_t* err) {
+    virtq_buf_t bufs[MAX_SEGS + 2];
+    req_slot_t* s;
+    while (!(s = free_slot()) || vq.num_free < n + 2) {
+        virtq_kick(&vq);
+        if (!reap_one(err)) return false;
+    }
+
+    s->hdr.type = write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+    s->hdr.reserved = 0;
+    s->hdr.sector = (uint64_t)segs[0].block * SECTORS_PER_BLOCK;
+    s->status = 0xFF;
+
+    bufs[0] = (virtq_buf_t){ &s->hdr, sizeof(s->hdr), false };
+    for (uint32_t i = 0; i < n; i++) {
+        bufs[1 + i] = (virtq_buf_t){ segs[i].buf, BLOCK_SIZE, !write };
+    }
+    bufs[1 + n] = (virtq_buf_t){ (void*)&s->status, 1, true };
+
+    s->head = (uint16_t)virtq_add(&vq, bufs, (uint16_t)(n + 2));
+    s->busy = true;
+    inflight++;
+    stats.requests++;
+    return true;
+}
+
+static int32_t vblk_submit(blkdev_t* d, bool write, const blk_seg_t* segs,
+                           uint32_t n) {
+    if (write && d->read_only) return -EXO_EROFS;
+    for (uint32_t i = 0; i < n; i++) {
+        if (segs[i].block >= d->blocks) return -EXO_EINVAL;
+    }
+
+    uint64_t start = rdtsc();
+    uint32_t notifies = vq.notifies;
+    int32_t err = 0;
+    bool ok = true;
+    stats.submits++;
+
+    // Merge runs of consecutive blocks into one request each. A chain
+    // (header + data + status) must also fit in the ring.
+    uint32_t max_run = vq.size - 2u < MAX_SEGS ? vq.size - 2u : MAX_SEGS;
+    for (uint32_t i = 0; i < n && ok;) {
+        uint32_t run = 1;
+        while (i + run < n && run < max_run
+               && segs[i + run].block == segs[i].block + run) {
+            run++;
+        }
+        ok = queue_run(write, &segs[i], run, &err);
+        i += run;
+    }
+
+    virtq_kick(&vq);
+    while (ok && inflight) ok = reap_one(&err);
+
+    if (!ok) {
+        // The device stopped answering; its ring state is unknown now.
+        serial_print("virtio-blk: request timed out, device disabled\n");
+        virtio_fail(vq.iobase);
+        present = false;
+        d->blocks = 0;
+        err = -EXO_EIO;
+    }
+
+    if (write) stats.blocks_written += n;
+    else stats.blocks_read += n;
+    stats.notifies += vq.notifies - notifies;
+    stats.cycles += rdtsc() - start;
+    return err;
+}
+
+bool virtio_blk_init(void) {
+    const pci_device_t* p = pci_find(VIRTIO_VENDOR, VIRTIO_BLK_DEVICE_LEGACY);
+    if (!p) {
+        if (pci_find(VIRTIO_VENDOR, VIRTIO_BLK_DEVICE_MODERN)) {
+            serial_print("virtio-blk: modern-only device, not supported\n");
+        }
+        return false;
+    }
+
+    uint16_t io = pci_bar_io(p, 0);
+    if (!io) return false;
+    pci_enable(p, PCI_CMD_IO | PCI_CMD_BUS_MASTER);
+
+    // No optional features are needed; read-only is only recorded.
+    uint32_t features = virtio_begin(io, 0);
+    if (!virtq_init(&vq, io, 0) || vq.size < 3) {
+        virtio_fail(io);
+        return false;
+    }
+    virtio_finish(io);
+
+    capacity = inl(io + VIRTIO_REG_CONFIG)
+             | (uint64_t)inl(io + VIRTIO_REG_CONFIG + 4) << 32;
+    uint64_t blocks = capacity / SECTORS_PER_BLOCK;
+
+    dev = (blkdev_t){
+        .name = "virtio-blk",
+        .blocks = blocks > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)blocks,
+        .read_only = (features & VIRTIO_BLK_F_RO) != 0,
+        .submit = vblk_submit,
+        .ctx = 0,
+    };
+    for (uint32_t i = 0; i < MAX_INFLIGHT; i++) {
+        slots[i].busy = false;
+    }
+    inflight = 0;
+    stats = (virtio_blk_stats_t){0};
+    present = true;
+    return true;
+}
+
+blkdev_t* virtio_blk_dev(void) {
+    return present ? &dev : 0;
+}
+
+const virtio_blk_stats_t* virtio_blk_stats(void) {
+    return &stats;
+}
+
+void virtio_blk_dump(void) {
+    serial_print("virtio-blk: ");
+    if (!present) {
+        serial_print("not present\n");
+        return;
+    }
+    serial_print_u32(dev.blocks);
+    serial_print(" blocks (");
+    serial_print_u32((uint32_t)(capacity / 2048));
+    serial_print(" MiB)");
+    if (dev.read_only) serial_print(" read-only");
+    serial_print(", queue ");
+    serial_print_u32(vq.size);
+    serial_print("\n  submits=");
+    serial_print_u32(stats.submits);
+    serial_print(" requests=");
+    serial_print_u32(stats.requests);
+    serial_print(" notifies=");
+    serial_print_u32(stats.notifies);
+    serial_print(" read=");
+    serial_print_u32(stats.blocks_read);
+    serial_print(" written=");
+    serial_print_u32(stats.blocks_written);
+    serial_print(" errors=");
+    serial_print_u32(stats.errors);
+    if (stats.submits) {
+        serial_print(" avg=");
+        serial_print_u32((uint32_t)(stats.cycles / stats.submits));
+        serial_print("cyc/submit");
+    }
+    serial_print("\n");
+}
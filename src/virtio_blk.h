@@ -0,0 +1,41 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "blkdev.h"
+
+/*
+ * virtio_blk.h — Virtio block device (legacy transport, see virtio.h).
+ *
+ * QEMU: -drive file=disk.img,format=raw,if=virtio
+ *
+ * Each run of consecutive blocks becomes one request: a header, one data
+ * descriptor per block and a status byte.  All the requests of a
+ * blkdev submit are made available before a single queue notify, and
+ * completions are polled, so a 200 KB save costs one VM exit, not one
+ * per sector.
+ */
+
+#define VIRTIO_BLK_DEVICE_LEGACY 0x1001
+#define VIRTIO_BLK_DEVICE_MODERN 0x1042
+
+typedef struct {
+    uint32_t submits;             // blkdev submit calls
+    uint32_t requests;            // virtio-blk requests issued
+    uint32_t blocks_read;
+    uint32_t blocks_written;
+    uint32_t notifies;            // queue notifies (VM exits)
+    uint32_t errors;
+    uint64_t cycles;              // TSC cycles inside submit
+} virtio_blk_stats_t;
+
+/* Find and initialise the first legacy virtio-blk PCI function. Call after
+   pci_enumerate() and pmm_init(). Returns false if there is none. */
+bool virtio_blk_init(void);
+
+/* The device, or NULL if virtio_blk_init() failed. */
+blkdev_t* virtio_blk_dev(void);
+
+const virtio_blk_stats_t* virtio_blk_stats(void);
+
+/* Print capacity and counters over serial. */
+void virtio_blk_dump(void);
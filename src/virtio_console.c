@@ -0,0 +1,203 @@
+#include "virtio_console.h"
+#include "virtio.h"
+#include "pci.h"
+#include "cpu.h"
+#include "string.h"
+
+#define RX_QUEUE    0             // port 0 receiveq
+#define TX_QUEUE    1             // port 0 transmitq
+#define POLL_LIMIT  10000000u
+
+static virtq_t rxq;
+static virtq_t txq;
+static bool present = false;
+
+static char tx_bufs[VCON_TX_BUFS][VCON_TX_BUF_SIZE];
+static int32_t tx_head[VCON_TX_BUFS];     // chain in flight, or -1
+static uint32_t tx_cur = 0;               // buffer being filled
+static uint32_t tx_fill = 0;
+
+static char rx_bufs[VCON_RX_BUFS][VCON_RX_BUF_SIZE];
+static int32_t rx_head[VCON_RX_BUFS];
+static int32_t rx_cur = -1;               // buffer being consumed
+static uint32_t rx_pos = 0;
+static uint32_t rx_len = 0;
+
+static virtio_console_stats_t stats;
+
+static void vcon_write(const char* buf, uint32_t len);
+static void vcon_flush(void);
+static int vcon_getc(void);
+
+static const serial_sink_t sink = {
+    .name = "virtio-console",
+    .write = vcon_write,
+    .flush = vcon_flush,
+    .getc = vcon_getc,
+};
+
+/* Retire TX buffers the device has finished with. */
+static void tx_reap(void) {
+    uint16_t head;
+    while (virtq_pop(&txq, &head, 0)) {
+        for (uint32_t i = 0; i < VCON_TX_BUFS; i++) {
+            if (tx_head[i] == head) tx_head[i] = -1;
+        }
+    }
+}
+
+/* The device stopped taking output (e.g. its chardev went away): go back
+   to COM1 rather than hang every print. */
+static void give_up(void) {
+    present = false;
+    virtio_fail(txq.iobase);
+    serial_set_sink(0);
+    serial_print("virtio-console: device stalled, logging to COM1\n");
+}
+
+/* Wait until buffer `i` is free. Returns false on timeout. */
+static bool tx_wait(uint32_t i) {
+    for (uint32_t spins = 0; tx_head[i] >= 0; spins++) {
+        if (spins == POLL_LIMIT) return false;
+        __asm__ volatile ("pause");
+        tx_reap();
+    }
+    return true;
+}
+
+/* Hand the current buffer to the device and move to the next one. */
+static bool tx_submit(void) {
+    if (tx_fill == 0) return true;
+
+    virtq_buf_t b = { tx_bufs[tx_cur], tx_fill, false };
+    tx_head[tx_cur] = virtq_add(&txq, &b, 1);
+    virtq_kick(&txq);
+    stats.bytes += tx_fill;
+    stats.buffers++;
+    stats.notifies = txq.notifies;
+
+    tx_cur = (tx_cur + 1) % VCON_TX_BUFS;
+    tx_fill = 0;
+    tx_reap();
+    if (tx_head[tx_cur] >= 0) {
+        stats.stalls++;
+        return tx_wait(tx_cur);
+    }
+    return true;
+}
+
+static void vcon_write(const char* buf, uint32_t len) {
+    if (!present) return;
+    // Exception and IRQ paths print too; keep the buffers consistent.
+    uint32_t flags = irq_save();
+    bool ok = true;
+    for (uint32_t i = 0; i < len && ok; i++) {
+        tx_bufs[tx_cur][tx_fill++] = buf[i];
+        if (buf[i] == '\n' || tx_fill == VCON_TX_BUF_SIZE) ok = tx_submit();
+    }
+    irq_restore(flags);
+    if (!ok) give_up();
+}
+
+static void vcon_flush(void) {
+    if (!present) return;
+    uint32_t flags = irq_save();
+    bool ok = tx_submit();
+    for (uint32_t i = 0; i < VCON_TX_BUFS && ok; i++) {
+        ok = tx_wait(i);
+    }
+    irq_restore(flags);
+    if (!ok) give_up();
+}
+
+static void rx_post(int32_t i) {
+    virtq_buf_t b = { rx_bufs[i], VCON_RX_BUF_SIZE, true };
+    rx_head[i] = virtq_add(&rxq, &b, 1);
+}
+
+static int vcon_getc(void) {
+    if (!present) return -1;
+    while (rx_pos == rx_len) {
+        if (rx_cur >= 0) {
+            rx_post(rx_cur);
+            virtq_kick(&rxq);
+            rx_cur = -1;
+        }
+
+        uint16_t head;
+        uint32_t len;
+        if (!virtq_pop(&rxq, &head, &len)) return -1;
+        for (int32_t i = 0; i < VCON_RX_BUFS; i++) {
+            if (rx_head[i] == head) rx_cur = i;
+        }
+        if (rx_cur < 0) return -1;
+        rx_pos = 0;
+        rx_len = len > VCON_RX_BUF_SIZE ? VCON_RX_BUF_SIZE : len;
+        stats.rx_bytes += rx_len;
+    }
+    return (uint8_t)rx_bufs[rx_cur][rx_pos++];
+}
+
+bool virtio_console_init(void) {
+    const pci_device_t* p = pci_find(VIRTIO_VENDOR, VIRTIO_CONSOLE_DEVICE_LEGACY);
+    if (!p) {
+        if (pci_find(VIRTIO_VENDOR, VIRTIO_CONSOLE_DEVICE_MODERN)) {
+            serial_print("virtio-console: modern-only device, not supported\n");
+        }
+        return false;
+    }
+
+    uint16_t io = pci_bar_io(p, 0);
+    if (!io) return false;
+    pci_enable(p, PCI_CMD_IO | PCI_CMD_BUS_MASTER);
+
+    // No MULTIPORT: port 0 only, on queues 0 and 1.
+    virtio_begin(io, 0);
+    if (!virtq_init(&rxq, io, RX_QUEUE) || !virtq_init(&txq, io, TX_QUEUE)
+        || rxq.size < VCON_RX_BUFS || txq.size < VCON_TX_BUFS) {
+        virtio_fail(io);
+        return false;
+    }
+
+    for (int32_t i = 0; i < VCON_TX_BUFS; i++) {
+        tx_head[i] = -1;
+    }
+    for (int32_t i = 0; i < VCON_RX_BUFS; i++) {
+        rx_post(i);
+    }
+    tx_cur = tx_fill = 0;
+    rx_cur = -1;
+    rx_pos = rx_len = 0;
+    stats = (virtio_console_stats_t){0};
+
+    virtio_finish(io);
+    virtq_kick(&rxq);
+    present = true;
+    return true;
+}
+
+const serial_sink_t* virtio_console_sink(void) {
+    return present ? &sink : 0;
+}
+
+const virtio_console_stats_t* virtio_console_stats(void) {
+    return &stats;
+}
+
+void virtio_console_dump(void) {
+    serial_print("output: ");
+    serial_print(serial_sink_name());
+    serial_print("\n");
+    if (!present) return;
+    serial_print("  buffers=");
+    serial_print_u32(stats.buffers);
+    serial_print(" bytes=");
+    serial_print_u32((uint32_t)stats.bytes);
+    serial_print(" notifies=");
+    serial_print_u32(stats.notifies);
+    serial_print(" stalls=");
+    serial_print_u32(stats.stalls);
+    serial_print(" rx=");
+    serial_print_u32(stats.rx_bytes);
+    serial_print("\n");
+}
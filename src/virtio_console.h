@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "serial.h"
+
+/*
+ * virtio_console.h — Virtio console (legacy transport, see virtio.h) as a
+ * serial sink.
+ *
+ * QEMU: -device virtio-serial-pci -device virtconsole,chardev=vcon
+ *       -chardev file,id=vcon,path=vcon.log
+ *
+ * Output is copied into one of VCON_TX_BUFS buffers.  A buffer goes to the
+ * device when a line ends or it fills, without waiting for the device to
+ * finish with it; the CPU only stalls when every buffer is still in
+ * flight.  So a log line costs a memcpy and one queue notify, instead of
+ * one UART poll and port write per byte.
+ */
+
+#define VIRTIO_CONSOLE_DEVICE_LEGACY 0x1003
+#define VIRTIO_CONSOLE_DEVICE_MODERN 0x1043
+
+#define VCON_TX_BUFS     16
+#define VCON_TX_BUF_SIZE 1024
+#define VCON_RX_BUFS     4
+#define VCON_RX_BUF_SIZE 64
+
+typedef struct {
+    uint64_t bytes;               // bytes handed to the device
+    uint32_t buffers;             // TX buffers submitted
+    uint32_t notifies;
+    uint32_t stalls;              // waits for a free TX buffer
+    uint32_t rx_bytes;
+} virtio_console_stats_t;
+
+/* Find and initialise the first legacy virtio console. Call after
+   pci_enumerate() and pmm_init(). Returns false if there is none. */
+bool virtio_console_init(void);
+
+/* The sink to pass to serial_set_sink(), or NULL without a device. */
+const serial_sink_t* virtio_console_sink(void);
+
+const virtio_console_stats_t* virtio_console_stats(void);
+
+/* Print the counters over serial. */
+void virtio_console_dump(void);
@@ -0,0 +1,420 @@
+#include "vmm.h"
+#include "exo_abi.h"
+#include "cpu.h"
+#include "idt.h"
+#include "pmm.h"
+#include "serial.h"
+#include "spinlock.h"
+#include "string.h"
+#include "trace.h"
+
+#define PDE_COUNT        1024
+#define PTE_COUNT        1024
+#define LARGE_PAGE       0x400000u
+
+#define PG_PRESENT       (1u << 0)
+#define PG_WRITE         (1u << 1)
+#define PG_USER          (1u << 2)
+#define PG_LARGE         (1u << 7)         // PDE maps 4 MiB (CR4.PSE)
+#define PG_BORROWED      (1u << 9)         // available bits: not ours to free
+#define PG_COW           (1u << 10)        // borrowed, copy on first write
+#define PG_FRAME         0xFFFFF000u
+
+#define PF_ERR_PRESENT   (1u << 0)         // protection fault, not a miss
+#define PF_ERR_WRITE     (1u << 1)
+
+#define CPUID_EDX_PSE    (1u << 3)
+#define CR0_WP           (1u << 16)        // ring 0 obeys read-only PTEs
+#define CR0_PG           (1u << 31)
+#define CR4_PSE          (1u << 4)
+#define VECTOR_PF        14
+
+#define WINDOW_FIRST_PDE (VMM_WINDOW_BASE / LARGE_PAGE)
+#define WINDOW_PDES      (VMM_WINDOW_SIZE / LARGE_PAGE)
+
+extern void pf_stub(void);
+
+static uint32_t page_dir[PDE_COUNT] __attribute__((aligned(PAGE_SIZE)));
+static bool enabled = false;
+static volatile uint32_t tlb_gen = 0;     // bumped when pages are unmapped
+static uint32_t cpu_gen[MAX_CPUS];       // tlb_gen each CPU last flushed at
+static vmm_region_t regions[VMM_MAX_REGIONS];
+static vmm_stats_t stats;
+
+// Page tables, regions and stats. AP jobs fault in the window too, so two
+// CPUs may try to fill the same PTE at once.
+static spinlock_t lock = SPINLOCK_INIT("vmm");
+
+static inline void invlpg(uint32_t addr) {
+    __asm__ volatile ("invlpg (%0)" : : "r"(addr) : "memory");
+}
+
+static void paging_on(void) {
+    uint32_t cr0, cr4;
+    __asm__ volatile ("mov %%cr4, %0" : "=r"(cr4));
+    __asm__ volatile ("mov %0, %%cr4" : : "r"(cr4 | CR4_PSE));
+    __asm__ volatile ("mov %0, %%cr3" : : "r"((uint32_t)page_dir) : "memory");
+    __asm__ volatile ("mov %%cr0, %0" : "=r"(cr0));
+    __asm__ volatile ("mov %0, %%cr0" : : "r"(cr0 | CR0_PG | CR0_WP) : "memory");
+}
+
+bool vmm_init(void) {
+    uint32_t a, b, c, d;
+    cpuid(1, &a, &b, &c, &d);
+    if (!(d & CPUID_EDX_PSE)) return false;
+
+    for (uint32_t i = 0; i < PDE_COUNT; i++) {
+        page_dir[i] = (i * LARGE_PAGE) | PG_LARGE | PG_WRITE | PG_PRESENT;
+    }
+    for (uint32_t i = 0; i < WINDOW_PDES; i++) {
+        page_dir[WINDOW_FIRST_PDE + i] = 0;
+    }
+
+    // RAM the window hides is no longer reachable: keep the PMM off it.
+    pmm_reserve((uint64_t)VMM_WINDOW_BASE,
+                (uint64_t)VMM_WINDOW_BASE + VMM_WINDOW_SIZE);
+
+    memset(regions, 0, sizeof(regions));
+    stats = (vmm_stats_t){0};
+    idt_set_gate(VECTOR_PF, (uint32_t)pf_stub);
+    paging_on();
+    enabled = true;
+    return true;
+}
+
+void vmm_init_ap(void) {
+    if (!enabled) return;
+    paging_on();
+    cpu_gen[cpu_id()] = tlb_gen;
+}
+
+bool vmm_enabled(void) {
+    return enabled;
+}
+
+void vmm_sync(void) {
+    uint32_t cpu = cpu_id();
+    uint32_t gen = __atomic_load_n(&tlb_gen, __ATOMIC_ACQUIRE);
+    if (cpu_gen[cpu] == gen) return;
+    __asm__ volatile ("mov %%cr3, %%eax\n\tmov %%eax, %%cr3" : : : "eax", "memory");
+    cpu_gen[cpu] = gen;
+}
+
+static vmm_region_t* find_region(uint32_t addr) {
+    for (uint32_t i = 0; i < VMM_MAX_REGIONS; i++) {
+        vmm_region_t* r = &regions[i];
+        if (r->size && addr >= r->base && addr - r->base < r->size) return r;
+    }
+    return 0;
+}
+
+static bool overlaps(uint32_t base, uint32_t size) {
+    for (uint32_t i = 0; i < VMM_MAX_REGIONS; i++) {
+        const vmm_region_t* r = &regions[i];
+        if (r->size && r->base < base + size && base < r->base + r->size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Lowest window address with `size` free bytes after it, or 0. */
+static uint32_t find_space(uint32_t size) {
+    uint32_t base = VMM_WINDOW_BASE;
+    for (;;) {
+        if (size > VMM_WINDOW_BASE + VMM_WINDOW_SIZE - base) return 0;
+        if (!overlaps(base, size)) return base;
+        for (uint32_t i = 0; i < VMM_MAX_REGIONS; i++) {
+            const vmm_region_t* r = &regions[i];
+            if (r->size && r->base < base + size && base < r->base + r->size) {
+                base = r->base + r->size;
+            }
+        }
+    }
+}
+
+int32_t vmm_reserve(uint32_t size, uint32_t* base_out) {
+    if (!enabled) return -EXO_ENODEV;
+    if (size == 0 || size > VMM_WINDOW_SIZE || !base_out) return -EXO_EINVAL;
+    size = (size + PAGE_SIZE - 1) & PG_FRAME;
+
+    uint32_t flags = spin_lock_irqsave(&lock);
+    vmm_region_t* slot = 0;
+    for (uint32_t i = 0; i < VMM_MAX_REGIONS && !slot; i++) {
+        if (regions[i].size == 0) slot = &regions[i];
+    }
+    uint32_t base = slot ? find_space(size) : 0;
+    if (!base) {
+        spin_unlock_irqrestore(&lock, flags);
+        return -EXO_ENOMEM;
+    }
+
+    *slot = (vmm_region_t){ .base = base, .size = size };
+    stats.reserved_pages += size / PAGE_SIZE;
+    spin_unlock_irqrestore(&lock, flags);
+
+    *base_out = base;
+    return 0;
+}
+
+int32_t vmm_reserve_at(uint32_t base, uint32_t size) {
+    if (!enabled) return -EXO_ENODEV;
+    if (size == 0 || (base | size) & (PAGE_SIZE - 1)) return -EXO_EINVAL;
+    if (base < VMM_WINDOW_BASE || size > VMM_WINDOW_SIZE ||
+        base - VMM_WINDOW_BASE > VMM_WINDOW_SIZE - size) {
+        return -EXO_EINVAL;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&lock);
+    vmm_region_t* slot = 0;
+    for (uint32_t i = 0; i < VMM_MAX_REGIONS && !slot; i++) {
+        if (regions[i].size == 0) slot = &regions[i];
+    }
+    int32_t err = !slot ? -EXO_ENOMEM : overlaps(base, size) ? -EXO_EBUSY : 0;
+    if (err == 0) {
+        *slot = (vmm_region_t){ .base = base, .size = size };
+        stats.reserved_pages += size / PAGE_SIZE;
+    }
+    spin_unlock_irqrestore(&lock, flags);
+    return err;
+}
+
+static uint32_t* pte_of(uint32_t addr) {
+    uint32_t pde = page_dir[addr / LARGE_PAGE];
+    if (!(pde & PG_PRESENT)) return 0;
+    uint32_t* table = (uint32_t*)(pde & PG_FRAME);
+    return &table[(addr / PAGE_SIZE) % PTE_COUNT];
+}
+
+int32_t vmm_release(uint32_t base) {
+    uint32_t flags = spin_lock_irqsave(&lock);
+    vmm_region_t* r = find_region(base);
+    if (!r || r->base != base) {
+        spin_unlock_irqrestore(&lock, flags);
+        return -EXO_EINVAL;
+    }
+
+    for (uint32_t addr = r->base; addr < r->base + r->size; addr += PAGE_SIZE) {
+        uint32_t* pte = pte_of(addr);
+        if (!pte || !(*pte & PG_PRESENT)) continue;
+        if (!(*pte & PG_BORROWED)) free_page((void*)(*pte & PG_FRAME));
+        *pte = 0;
+        invlpg(addr);
+    }
+    stats.reserved_pages -= r->size / PAGE_SIZE;
+    stats.resident_pages -= r->resident;
+    stats.borrowed_pages -= r->borrowed;
+    *r = (vmm_region_t){0};
+    // The other CPUs flush before their next job or idle pass (vmm_sync).
+    __atomic_add_fetch(&tlb_gen, 1, __ATOMIC_RELEASE);
+    spin_unlock_irqrestore(&lock, flags);
+    return 0;
+}
+
+/* PTE for `addr`, allocating its page table if needed. Tables come from
+   the PMM's clean pool when the idle loop has filled it. */
+static uint32_t* pte_alloc(uint32_t addr) {
+    uint32_t* pde = &page_dir[addr / LARGE_PAGE];
+    if (!(*pde & PG_PRESENT)) {
+        void* table = alloc_zeroed_page();
+        if (!table) return 0;
+        *pde = (uint32_t)table | PG_USER | PG_WRITE | PG_PRESENT;
+        stats.tables++;
+    }
+    return pte_of(addr);
+}
+
+int32_t vmm_map(uint32_t va, uint32_t pa, uint32_t flags) {
+    if ((va | pa) & (PAGE_SIZE - 1)) return -EXO_EINVAL;
+
+    uint32_t irq = spin_lock_irqsave(&lock);
+    vmm_region_t* r = find_region(va);
+    uint32_t* pte = r ? pte_alloc(va) : 0;
+    int32_t err = !r ? -EXO_EINVAL : !pte ? -EXO_ENOMEM
+                : (*pte & PG_PRESENT) ? -EXO_EINVAL : 0;
+    if (err) {
+        spin_unlock_irqrestore(&lock, irq);
+        return err;
+    }
+
+    uint32_t entry = pa | PG_USER | PG_PRESENT;
+    if (flags & VMM_MAP_COW) {
+        entry |= PG_COW | PG_BORROWED;
+    } else {
+        if (flags & VMM_MAP_WRITE) entry |= PG_WRITE;
+        if (flags & VMM_MAP_BORROW) entry |= PG_BORROWED;
+    }
+    *pte = entry;
+    if (entry & PG_BORROWED) {
+        r->borrowed++;
+        stats.borrowed_pages++;
+    } else {
+        r->resident++;
+        stats.resident_pages++;
+    }
+    spin_unlock_irqrestore(&lock, irq);
+    return 0;
+}
+
+uint32_t vmm_translate(uint32_t va) {
+    if (!enabled) return 0;
+    uint32_t pde = page_dir[va / LARGE_PAGE];
+    if (!(pde & PG_PRESENT)) return 0;
+    if (pde & PG_LARGE) return (pde & ~(LARGE_PAGE - 1)) | (va & (LARGE_PAGE - 1));
+
+    // Window PTEs change under the lock (faults, COW breaks, release).
+    uint32_t flags = spin_lock_irqsave(&lock);
+    uint32_t pte = *pte_of(va);
+    spin_unlock_irqrestore(&lock, flags);
+    if (!(pte & PG_PRESENT)) return 0;
+    return (pte & PG_FRAME) | (va & (PAGE_SIZE - 1));
+}
+
+/* Map a zeroed page at `addr`. */
+static bool zero_fill(vmm_region_t* r, uint32_t addr) {
+    uint32_t* pte = pte_alloc(addr);
+    if (!pte) return false;
+    void* page = alloc_zeroed_page();
+    if (!page) return false;
+    *pte = (uint32_t)page | PG_USER | PG_WRITE | PG_PRESENT;
+
+    r->resident++;
+    stats.resident_pages++;
+    stats.zero_fills++;
+    return true;
+}
+
+/* First write to a copy-on-write page: give the region its own copy.
+   Runs under the lock, so only the first CPU to write copies the page.
+   Other CPUs may still hold a read-only TLB entry for the module page;
+   they flush at their next vmm_sync(), and a write through the stale
+   entry faults and is retried against the new PTE. */
+static bool cow_break(vmm_region_t* r, uint32_t* pte, uint32_t addr) {
+    void* page = alloc_page();
+    if (!page) return false;
+    memcpy(page, (const void*)(*pte & PG_FRAME), PAGE_SIZE);
+    *pte = (uint32_t)page | PG_USER | PG_WRITE | PG_PRESENT;
+    invlpg(addr);
+    __atomic_add_fetch(&tlb_gen, 1, __ATOMIC_RELEASE);
+
+    r->borrowed--;
+    r->resident++;
+    stats.borrowed_pages--;
+    stats.resident_pages++;
+    stats.cow_breaks++;
+    return true;
+}
+
+static void fatal_fault(uint32_t addr, uint32_t err, uint32_t eip,
+                        const char* why) {
+    serial_print("\n#PF: ");
+    serial_print(why);
+    serial_print(" addr=0x");
+    serial_print_hex(addr);
+    serial_print(" err=0x");
+    serial_print_hex(err);
+    serial_print(" eip=0x");
+    serial_print_hex(eip);
+    serial_print(" cpu=");
+    serial_print_u32(cpu_id());
+    serial_print("\n");
+    serial_flush();
+    for (;;) __asm__ volatile ("cli\n\thlt");
+}
+
+/* Called by pf_stub with interrupts off. */
+void page_fault_handler(uint32_t addr, uint32_t err, uint32_t eip) {
+    uint64_t start = rdtsc();
+    TRACE(PAGE_FAULT, err, addr);
+    spin_lock(&lock);
+    stats.faults++;
+
+    vmm_region_t* r = find_region(addr);
+    if (!r) fatal_fault(addr, err, eip, "outside any region");
+
+    // The PTE is read only now that we hold the lock: another CPU may have
+    // filled it since this one missed.
+    uint32_t page = addr & PG_FRAME;
+    uint32_t* pte = pte_of(page);
+    bool ok;
+    if (pte && (*pte & PG_PRESENT) &&
+        (!(err & PF_ERR_WRITE) || (*pte & PG_WRITE))) {
+        // Stale TLB entry, or another CPU got here first: the PTE already
+        // allows this access.
+        invlpg(page);
+        ok = true;
+    } else if (err & PF_ERR_PRESENT) {
+        if (!(err & PF_ERR_WRITE) || !(*pte & PG_COW)) {
+            fatal_fault(addr, err, eip, "protection");
+        }
+        ok = cow_break(r, pte, page);
+    } else {
+        ok = zero_fill(r, page);
+    }
+    if (!ok) {
+        stats.oom++;
+        fatal_fault(addr, err, eip, "out of memory");
+    }
+
+    uint32_t cycles = (uint32_t)(rdtsc() - start);
+    stats.fault_cycles += cycles;
+    if (cycles > stats.fault_max) stats.fault_max = cycles;
+    spin_unlock(&lock);
+}
+
+const vmm_region_t* vmm_region(uint32_t addr) {
+    return find_region(addr);
+}
+
+const vmm_stats_t* vmm_stats(void) {
+    return &stats;
+}
+
+void vmm_dump(void) {
+    if (!enabled) {
+        serial_print("vmm: paging off\n");
+        return;
+    }
+    serial_print("vmm: window 0x");
+    serial_print_hex(VMM_WINDOW_BASE);
+    serial_print("-0x");
+    serial_print_hex(VMM_WINDOW_BASE + VMM_WINDOW_SIZE);
+    serial_print(", reserved=");
+    serial_print_u32(stats.reserved_pages * (PAGE_SIZE / 1024));
+    serial_print("K resident=");
+    serial_print_u32(stats.resident_pages * (PAGE_SIZE / 1024));
+    serial_print("K tables=");
+    serial_print_u32(stats.tables);
+    serial_print("\n");
+
+    for (uint32_t i = 0; i < VMM_MAX_REGIONS; i++) {
+        const vmm_region_t* r = &regions[i];
+        if (!r->size) continue;
+        serial_print("  0x");
+        serial_print_hex(r->base);
+        serial_print(" ");
+        serial_print_u32(r->size / 1024);
+        serial_print("K, ");
+        serial_print_u32(r->resident * (PAGE_SIZE / 1024));
+        serial_print("K resident, ");
+        serial_print_u32(r->borrowed * (PAGE_SIZE / 1024));
+        serial_print("K borrowed\n");
+    }
+
+    serial_print("  faults=");
+    serial_print_u32(stats.faults);
+    serial_print(" zero_fills=");
+    serial_print_u32(stats.zero_fills);
+    serial_print(" cow_breaks=");
+    serial_print_u32(stats.cow_breaks);
+    serial_print(" oom=");
+    serial_print_u32(stats.oom);
+    if (stats.faults) {
+        serial_print(" avg=");
+        serial_print_u32((uint32_t)(stats.fault_cycles / stats.faults));
+        serial_print("cyc max=");
+        serial_print_u32(stats.fault_max);
+        serial_print("cyc");
+    }
+    serial_print("\n");
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * vmm.h — Paging and demand-zero regions (docs/memory.md §7).
+ *
+ * vmm_init() turns paging on with one page directory shared by every CPU.
+ * All of the 4 GiB address space is identity mapped with 4 MiB pages,
+ * except VMM_WINDOW.  So the kernel, the modules, the framebuffer and all
+ * MMIO keep the addresses they had without paging.
+ *
+ * The window holds demand-zero regions.  vmm_reserve() only hands out
+ * address space, and every page of a new region is not present.  The first
+ * touch of a page raises #PF, and the handler maps a freshly zeroed page
+ * there.  A 6 MiB Doom zone therefore costs nothing until it is used, and
+ * resident memory is the memory actually touched.
+ *
+ * vmm_map() also places given physical pages in a region.  A *borrowed*
+ * page belongs to someone else (an ELF module, elf.h) and is never freed
+ * by vmm_release().  A copy-on-write page is borrowed and read-only until
+ * the first write, which copies it into a private page.  CR0.WP is set, so
+ * ring 0 honours read-only pages too.
+ *
+ * A fault anywhere else is a kernel bug: the handler prints CR2, the error
+ * code and EIP, then halts.
+ *
+ * Faults can come from any CPU, since AP jobs use the window too.  The
+ * handler and every function below that changes a PTE or a region hold
+ * one spinlock.
+ */
+
+#define VMM_WINDOW_BASE  0x60000000u      // below every PCI hole
+#define VMM_WINDOW_SIZE  0x20000000u      // 512 MiB
+#define VMM_MAX_REGIONS  16
+
+/* vmm_map() flags */
+#define VMM_MAP_WRITE    (1u << 0)
+#define VMM_MAP_BORROW   (1u << 1)        // not ours: never freed
+#define VMM_MAP_COW      (1u << 2)        // borrowed, copied on first write
+
+typedef struct {
+    uint32_t base;
+    uint32_t size;            // bytes, a multiple of PAGE_SIZE; 0 = free slot
+    uint32_t resident;        // private pages present
+    uint32_t borrowed;        // borrowed pages present
+} vmm_region_t;
+
+typedef struct {
+    uint32_t faults;          // #PF taken
+    uint32_t zero_fills;      // pages mapped on first touch
+    uint32_t oom;             // faults that found no free page
+    uint64_t fault_cycles;    // handler time, summed
+    uint32_t fault_max;
+    uint32_t reserved_pages;  // address space handed out
+    uint32_t resident_pages;  // of which present and private
+    uint32_t borrowed_pages;  // of which present and borrowed
+    uint32_t cow_breaks;      // borrowed pages copied on write
+    uint32_t tables;          // window page tables allocated
+} vmm_stats_t;
+
+/* Build the page directory, install the #PF gate and enable paging on
+   this CPU. Needs pmm_init() and idt_init(). Returns false (paging stays
+   off) if the CPU lacks 4 MiB pages. */
+bool vmm_init(void);
+
+/* Turn on paging with the same directory on an AP. */
+void vmm_init_ap(void);
+
+bool vmm_enabled(void);
+
+/* Called by the APs before they run a job, and by the BSP's idle loop:
+   reload CR3 if a release or a copy-on-write break changed a mapping
+   since this CPU last looked. */
+void vmm_sync(void);
+
+/* Reserve `size` bytes (rounded up to whole pages) of demand-zero memory
+   in the window. Writes the base to *base_out. Returns 0, -EXO_EINVAL,
+   -EXO_ENOMEM (no room in the window or no free slot) or -EXO_ENODEV
+   (no paging). */
+int32_t vmm_reserve(uint32_t size, uint32_t* base_out);
+
+/* Reserve exactly [base, base + size), both page-aligned. Returns 0,
+   -EXO_EINVAL (outside the window or misaligned), -EXO_EBUSY (overlaps a
+   region), -EXO_ENOMEM (no free slot) or -EXO_ENODEV. */
+int32_t vmm_reserve_at(uint32_t base, uint32_t size);
+
+/* Map physical page `pa` at `va`, which must lie in a region and not be
+   present yet. Without VMM_MAP_BORROW or VMM_MAP_COW the region owns the
+   page and frees it on release. Returns 0, -EXO_EINVAL or -EXO_ENOMEM
+   (no page table). Takes the vmm lock, like the fault handler, so it is
+   safe against faults on other CPUs; do not call it with the lock held. */
+int32_t vmm_map(uint32_t va, uint32_t pa, uint32_t flags);
+
+/* Physical address `va` maps to, or 0 if it is not present. Reads window
+   PTEs under the vmm lock, so it may be called from IRQ context (the
+   profiler does) but not from inside the fault path. */
+uint32_t vmm_translate(uint32_t va);
+
+/* Free every private page of the region at `base` and forget it.
+   Returns 0 or -EXO_EINVAL. */
+int32_t vmm_release(uint32_t base);
+
+/* The region containing `addr`, or NULL. */
+const vmm_region_t* vmm_region(uint32_t addr);
+
+const vmm_stats_t* vmm_stats(void);
+
+/* Print each region's reserved and resident size and the fault counters
+   over serial. */
+void vmm_dump(void);
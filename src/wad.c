@@ -0,0 +1,142 @@
+#include "wad.h"
+#include "memory.h"
+#include "serial.h"
+#include "string.h"
+#include "cpu.h"
+#include "tsc.h"
+
+static exo_wad_info_t wad;
+static bool wad_valid = false;
+
+static exo_wad_slot_t* slots = 0;
+static uint32_t slot_capacity = 0;
+static uint32_t max_probe = 0;
+static uint64_t build_cycles = 0;
+
+static bool wad_header_ok(const exo_wad_header_t* h, uint32_t size) {
+    if (size < sizeof(*h)) return false;
+    if (memcmp(h->id, "IWAD", 4) != 0 && memcmp(h->id, "PWAD", 4) != 0) {
+        return false;
+    }
+    if (h->numlumps < 0 || h->infotableofs < (int32_t)sizeof(*h)) return false;
+
+    uint64_t dir_end = (uint64_t)h->infotableofs
+                     + (uint64_t)h->numlumps * sizeof(exo_wad_lump_t);
+    return dir_end <= size;
+}
+
+static bool wad_lumps_ok(const exo_wad_lump_t* dir, uint32_t n, uint32_t size) {
+    for (uint32_t i = 0; i < n; i++) {
+        if (dir[i].filepos < 0 || dir[i].size < 0) return false;
+        if ((uint64_t)dir[i].filepos + (uint64_t)dir[i].size > size) return false;
+    }
+    return true;
+}
+
+static void index_insert(const uint32_t key[2], int32_t lump) {
+    uint32_t mask = wad.index_mask;
+    uint32_t probe = 1;
+    for (uint32_t i = exo_wad_hash(key);; i++, probe++) {
+        exo_wad_slot_t* s = &slots[i & mask];
+        // An existing entry is overwritten: later lumps shadow earlier ones.
+        if (s->lump < 0 || (s->key[0] == key[0] && s->key[1] == key[1])) {
+            s->key[0] = key[0];
+            s->key[1] = key[1];
+            s->lump = lump;
+            break;
+        }
+    }
+    if (probe > max_probe) max_probe = probe;
+}
+
+bool wad_init(const void* base, uint32_t size) {
+    const exo_wad_header_t* h = (const exo_wad_header_t*)base;
+    wad_valid = false;
+
+    if (!base || !wad_header_ok(h, size)) return false;
+
+    uint32_t n = (uint32_t)h->numlumps;
+    const exo_wad_lump_t* dir =
+        (const exo_wad_lump_t*)((const uint8_t*)base + h->infotableofs);
+    if (!wad_lumps_ok(dir, n, size)) return false;
+
+    uint64_t start = rdtsc();
+
+    // At most half full, so probe sequences stay short and always end.
+    uint32_t nslots = 16;
+    while (nslots < 2 * n) nslots <<= 1;
+    if (nslots > slot_capacity) {
+        slots = kmalloc(nslots * sizeof(exo_wad_slot_t));
+        slot_capacity = nslots;
+    }
+    for (uint32_t i = 0; i < nslots; i++) {
+        slots[i].lump = -1;
+    }
+
+    wad.base = (uint32_t)base;
+    wad.size = size;
+    wad.numlumps = n;
+    wad.directory = (uint32_t)dir;
+    wad.index = (uint32_t)slots;
+    wad.index_mask = nslots - 1;
+    max_probe = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        char name[9];
+        uint32_t key[2];
+        memcpy(name, dir[i].name, 8);
+        name[8] = '\0';
+        exo_wad_key(name, key);
+        index_insert(key, (int32_t)i);
+    }
+
+    build_cycles = rdtsc() - start;
+    wad_valid = true;
+    return true;
+}
+
+const exo_wad_info_t* wad_info(void) {
+    return wad_valid ? &wad : 0;
+}
+
+int32_t wad_find(const char* name) {
+    return wad_valid ? exo_wad_find(&wad, name) : -1;
+}
+
+const void* wad_lump_data(int32_t lump, uint32_t* size_out) {
+    if (!wad_valid || lump < 0 || (uint32_t)lump >= wad.numlumps) return 0;
+
+    const exo_wad_lump_t* l = &((const exo_wad_lump_t*)wad.directory)[lump];
+    if (size_out) *size_out = (uint32_t)l->size;
+    return (const uint8_t*)wad.base + l->filepos;
+}
+
+uint32_t wad_max_probe(void) {
+    return max_probe;
+}
+
+void wad_dump(void) {
+    if (!wad_valid) {
+        serial_print("WAD: none\n");
+        return;
+    }
+    const exo_wad_header_t* h = (const exo_wad_header_t*)wad.base;
+    serial_print("WAD: ");
+    serial_putc(h->id[0]);
+    serial_putc(h->id[1]);
+    serial_putc(h->id[2]);
+    serial_putc(h->id[3]);
+    serial_print(" ");
+    serial_print_u32(wad.numlumps);
+    serial_print(" lumps, ");
+    serial_print_u32(wad.size);
+    serial_print(" bytes at 0x");
+    serial_print_hex(wad.base);
+    serial_print("\n  index: ");
+    serial_print_u32(wad.index_mask + 1);
+    serial_print(" slots, max probe ");
+    serial_print_u32(max_probe);
+    serial_print(", built in ");
+    serial_print_u32(tsc_cycles_to_us(build_cycles));
+    serial_print(" us\n");
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "exo_wad.h"
+
+/*
+ * wad.h — Kernel side of the in-place WAD index (exo_wad.h).
+ *
+ * The WAD stays where GRUB loaded it. Only the index (12 bytes per slot,
+ * at least two slots per lump) is allocated, from the bump allocator.
+ */
+
+/* Validate the WAD at [base, base + size) and build its lump index.
+   Returns false, leaving no WAD registered, if the header, directory or
+   any lump lies outside the image. */
+bool wad_init(const void* base, uint32_t size);
+
+/* The registered WAD, or NULL. */
+const exo_wad_info_t* wad_info(void);
+
+/* Lump number for `name` (case-insensitive, last one wins), or -1. */
+int32_t wad_find(const char* name);
+
+/* Data of lump `lump` in place, or NULL if out of range. */
+const void* wad_lump_data(int32_t lump, uint32_t* size_out);
+
+/* Longest probe sequence in the index (1 = every name in its home slot). */
+uint32_t wad_max_probe(void);
+
+/* Print header, lump count and index statistics over serial. */
+void wad_dump(void);
@@ -0,0 +1,270 @@
+/*
+ * test_bcache_k.c — Kernel-side CUnit tests for the block cache and RAM
+ * disk persistence.
+ *
+ * The cache runs over a RAM-backed blkdev that records every submit, so
+ * the tests can check batching and read-ahead without a virtio disk.
+ */
+
+#include "kunit.h"
+#include "bcache.h"
+#include "ramfs.h"
+#include "pmm.h"
+#include "string.h"
+
+#define RAMDEV_BLOCKS 256
+
+static uint8_t* ramdev_data;
+static uint32_t ramdev_reads;       // read submits
+static uint32_t ramdev_writes;      // write submits
+static uint32_t last_n;             // segments in the last submit
+static uint32_t last_first;         // block of its first segment
+static uint32_t last_sorted;        // 1 if its segments were ascending
+
+static int32_t ramdev_submit(blkdev_t* dev, bool write, const blk_seg_t* segs,
+                             uint32_t n)
+{
+    (void)dev;
+    if (write) ramdev_writes++;
+    else ramdev_reads++;
+    last_n = n;
+    last_first = n ? segs[0].block : 0;
+    last_sorted = 1;
+    for (uint32_t i = 0; i < n; i++) {
+        uint8_t* blk = ramdev_data + segs[i].block * BLOCK_SIZE;
+        if (write) memcpy(blk, segs[i].buf, BLOCK_SIZE);
+        else memcpy(segs[i].buf, blk, BLOCK_SIZE);
+        if (i && segs[i].block <= segs[i - 1].block) last_sorted = 0;
+    }
+    return 0;
+}
+
+static blkdev_t ramdev = {
+    .name = "ramdev",
+    .blocks = RAMDEV_BLOCKS,
+    .submit = ramdev_submit,
+};
+
+/* Fresh cache over a device whose block b is filled with byte b. */
+static void setup(void)
+{
+    if (!ramdev_data) ramdev_data = alloc_pages(RAMDEV_BLOCKS);
+    for (uint32_t b = 0; b < RAMDEV_BLOCKS; b++) {
+        memset(ramdev_data + b * BLOCK_SIZE, (int)b, BLOCK_SIZE);
+    }
+    ramdev_reads = ramdev_writes = 0;
+    bcache_init(&ramdev);
+}
+
+static void test_miss_reads_ahead_in_one_submit(void)
+{
+    static uint8_t buf[2 * BLOCK_SIZE];
+    setup();
+
+    CU_ASSERT_EQUAL(bcache_read(10, buf, sizeof(buf)), (int32_t)sizeof(buf));
+    CU_ASSERT_EQUAL(buf[0], 10);
+    CU_ASSERT_EQUAL(buf[BLOCK_SIZE], 11);
+    CU_ASSERT_EQUAL(ramdev_reads, 1U);
+    CU_ASSERT_EQUAL(last_first, 10U);
+    CU_ASSERT_EQUAL(last_n, 2U + BCACHE_READAHEAD);
+    CU_ASSERT_EQUAL(bcache_stats()->readahead, (uint32_t)BCACHE_READAHEAD);
+
+    // The next block was read ahead: no device access.
+    CU_ASSERT_EQUAL(bcache_read(12, buf, 100), 100);
+    CU_ASSERT_EQUAL(buf[99], 12);
+    CU_ASSERT_EQUAL(ramdev_reads, 1U);
+    CU_ASSERT_EQUAL(bcache_stats()->readahead_hits, 1U);
+}
+
+static void test_read_ahead_stops_at_cached_block(void)
+{
+    static uint8_t buf[BLOCK_SIZE];
+    setup();
+
+    bcache_read(23, buf, 1);
+    bcache_read(20, buf, 1);
+    CU_ASSERT_EQUAL(ramdev_reads, 2U);
+    CU_ASSERT_EQUAL(last_first, 20U);
+    CU_ASSERT_EQUAL(last_n, 3U);          // 20..22, then 23 is cached
+}
+
+static void test_writes_are_deferred_and_flushed_sorted(void)
+{
+    static uint8_t buf[2 * BLOCK_SIZE];
+    setup();
+
+    memset(buf, 0xAB, sizeof(buf));
+    CU_ASSERT_EQUAL(bcache_write(30, buf, BLOCK_SIZE), BLOCK_SIZE);
+    CU_ASSERT_EQUAL(bcache_write(5, buf, BLOCK_SIZE + 10), BLOCK_SIZE + 10);
+    CU_ASSERT_EQUAL(bcache_dirty(), 3U);
+    CU_ASSERT_EQUAL(ramdev_writes, 0U);
+    CU_ASSERT_EQUAL(ramdev_reads, 0U);    // no read before overwrite
+    CU_ASSERT_EQUAL(ramdev_data[30 * BLOCK_SIZE], 30);
+
+    CU_ASSERT_EQUAL(bcache_flush(), 0);
+    CU_ASSERT_EQUAL(ramdev_writes, 1U);
+    CU_ASSERT_EQUAL(last_n, 3U);
+    CU_ASSERT_EQUAL(last_first, 5U);
+    CU_ASSERT_EQUAL(last_sorted, 1U);
+    CU_ASSERT_EQUAL(bcache_dirty(), 0U);
+    CU_ASSERT_EQUAL(ramdev_data[30 * BLOCK_SIZE], 0xAB);
+    CU_ASSERT_EQUAL(ramdev_data[6 * BLOCK_SIZE + 9], 0xAB);
+    CU_ASSERT_EQUAL(ramdev_data[6 * BLOCK_SIZE + 10], 0);  // tail zeroed
+
+    // Nothing dirty: no device access.
+    CU_ASSERT_EQUAL(bcache_flush(), 0);
+    CU_ASSERT_EQUAL(ramdev_writes, 1U);
+}
+
+static void test_dirty_eviction_flushes_everything(void)
+{
+    static uint8_t buf[BLOCK_SIZE];
+    setup();
+
+    memset(buf, 0x5A, sizeof(buf));
+    for (uint32_t b = 0; b < BCACHE_BUFFERS; b++) {
+        bcache_write(b, buf, BLOCK_SIZE);
+    }
+    CU_ASSERT_EQUAL(ramdev_writes, 0U);
+
+    bcache_write(200, buf, BLOCK_SIZE);
+    CU_ASSERT_EQUAL(ramdev_writes, 1U);
+    CU_ASSERT_EQUAL(last_n, (uint32_t)BCACHE_BUFFERS);
+    CU_ASSERT_EQUAL(bcache_stats()->evictions, 1U);
+    CU_ASSERT_EQUAL(bcache_dirty(), 1U);
+    CU_ASSERT_EQUAL(ramdev_data[0], 0x5A);
+
+    // Block 0 was the least recently used, so it is the one that went.
+    CU_ASSERT_EQUAL(bcache_read(0, buf, 1), 1);
+    CU_ASSERT_EQUAL(ramdev_reads, 1U);
+    CU_ASSERT_EQUAL(buf[0], 0x5A);
+}
+
+static void test_range_and_device_errors(void)
+{
+    static uint8_t buf[BLOCK_SIZE];
+    setup();
+
+    CU_ASSERT_EQUAL(bcache_read(RAMDEV_BLOCKS, buf, 1), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(bcache_read(RAMDEV_BLOCKS - 1, buf, BLOCK_SIZE + 1), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(bcache_write(RAMDEV_BLOCKS, buf, 1), -EXO_EINVAL);
+
+    ramdev.read_only = true;
+    CU_ASSERT_EQUAL(bcache_write(0, buf, 1), -EXO_EROFS);
+    ramdev.read_only = false;
+
+    bcache_init(0);
+    CU_ASSERT_PTR_NULL(bcache_dev());
+    CU_ASSERT_EQUAL(bcache_read(0, buf, 1), -EXO_ENODEV);
+    CU_ASSERT_EQUAL(ramfs_save(), -EXO_ENODEV);
+}
+
+static void test_ramfs_save_load_round_trip(void)
+{
+    static uint8_t save[200 * 1024];
+    static uint8_t back[200 * 1024];
+    setup();
+    ramfs_init();
+
+    CU_ASSERT_EQUAL(ramfs_load(), -EXO_ENOENT);   // blank disk
+
+    for (uint32_t i = 0; i < sizeof(save); i++) save[i] = (uint8_t)(i * 7 + i / 251);
+    CU_ASSERT_EQUAL(ramfs_seed("doomsav0.dsg", save, sizeof(save)), (int32_t)sizeof(save));
+    CU_ASSERT_EQUAL(ramfs_seed("default.cfg", "key_up 72\n", 10), 10);
+    CU_ASSERT_EQUAL(ramfs_seed("empty", "", 0), 0);
+    CU_ASSERT_TRUE(ramfs_dirty());
+
+    CU_ASSERT_EQUAL(ramfs_save(), 3);
+    CU_ASSERT_FALSE(ramfs_dirty());
+    CU_ASSERT_EQUAL(ramdev_writes, 2U);           // data batch, then block 0
+    CU_ASSERT_EQUAL(ramfs_sync(), 0);
+    CU_ASSERT_EQUAL(ramdev_writes, 2U);           // clean: nothing to do
+
+    // Forget the files and the cache, then read everything back.
+    ramfs_init();
+    bcache_init(&ramdev);
+    ramdev_reads = 0;
+    CU_ASSERT_EQUAL(ramfs_load(), 3);
+    CU_ASSERT_FALSE(ramfs_dirty());
+    CU_ASSERT(ramdev_reads <= 4U);                // 51 blocks in 32-block runs
+
+    uint32_t size = 0;
+    CU_ASSERT_EQUAL(ramfs_stat("doomsav0.dsg", &size), 0);
+    CU_ASSERT_EQUAL(size, (uint32_t)sizeof(save));
+    CU_ASSERT_EQUAL(ramfs_stat("empty", &size), 0);
+    CU_ASSERT_EQUAL(size, 0U);
+
+    int32_t fd = ramfs_open("doomsav0.dsg", EXO_O_READ);
+    CU_ASSERT_EQUAL(ramfs_read(fd, back, sizeof(back)), (int32_t)sizeof(back));
+    CU_ASSERT_EQUAL(memcmp(save, back, sizeof(save)), 0);
+    ramfs_close(fd);
+
+    fd = ramfs_open("default.cfg", EXO_O_READ);
+    CU_ASSERT_EQUAL(ramfs_read(fd, back, sizeof(back)), 10);
+    CU_ASSERT_EQUAL(memcmp(back, "key_up 72\n", 10), 0);
+    ramfs_close(fd);
+
+    // A rename marks the filesystem for the next sync.
+    CU_ASSERT_EQUAL(ramfs_rename("default.cfg", "old.cfg"), 0);
+    CU_ASSERT_TRUE(ramfs_dirty());
+    CU_ASSERT_EQUAL(ramfs_sync(), 0);
+    CU_ASSERT_FALSE(ramfs_dirty());
+
+    ramfs_init();
+    bcache_init(0);
+}
+
+static void test_ramfs_save_keeps_the_old_copy(void)
+{
+    static uint8_t a[3 * BLOCK_SIZE];
+    static uint8_t back[3 * BLOCK_SIZE];
+    setup();
+    ramdev.blocks = 8;            // room for the directory and two copies
+    ramfs_init();
+
+    memset(a, 0xA1, sizeof(a));
+    CU_ASSERT_EQUAL(ramfs_seed("f", a, sizeof(a)), (int32_t)sizeof(a));
+    CU_ASSERT_EQUAL(ramfs_save(), 1);
+    CU_ASSERT_EQUAL(ramdev_data[1 * BLOCK_SIZE], 0xA1);     // blocks 1-3
+
+    // The next save goes after the live copy and leaves it alone.
+    memset(a, 0xB2, sizeof(a));
+    CU_ASSERT_EQUAL(ramfs_seed("f", a, sizeof(a)), (int32_t)sizeof(a));
+    CU_ASSERT_EQUAL(ramfs_save(), 1);
+    CU_ASSERT_EQUAL(ramdev_data[1 * BLOCK_SIZE], 0xA1);
+    CU_ASSERT_EQUAL(ramdev_data[4 * BLOCK_SIZE], 0xB2);     // blocks 4-6
+
+    // Four blocks fit neither after the live copy nor before it.
+    uint32_t writes = ramdev_writes;
+    CU_ASSERT_EQUAL(ramfs_seed("g", a, BLOCK_SIZE), BLOCK_SIZE);
+    CU_ASSERT_EQUAL(ramfs_save(), -EXO_ENOSPC);
+    CU_ASSERT_EQUAL(ramdev_writes, writes);
+    CU_ASSERT_EQUAL(ramfs_remove("g"), 0);
+
+    // Three do fit in the gap at block 1, which is free again.
+    CU_ASSERT_EQUAL(ramfs_save(), 1);
+    CU_ASSERT_EQUAL(ramdev_data[1 * BLOCK_SIZE], 0xB2);
+
+    ramfs_init();
+    bcache_init(&ramdev);
+    CU_ASSERT_EQUAL(ramfs_load(), 1);
+    int32_t fd = ramfs_open("f", EXO_O_READ);
+    CU_ASSERT_EQUAL(ramfs_read(fd, back, sizeof(back)), (int32_t)sizeof(back));
+    CU_ASSERT_EQUAL(memcmp(a, back, sizeof(a)), 0);
+    ramfs_close(fd);
+
+    ramdev.blocks = RAMDEV_BLOCKS;
+    ramfs_init();
+    bcache_init(0);
+}
+
+void suite_bcache_tests(CU_pSuite s)
+{
+    CU_add_test(s, "miss_reads_ahead_in_one_submit",   test_miss_reads_ahead_in_one_submit);
+    CU_add_test(s, "read_ahead_stops_at_cached_block", test_read_ahead_stops_at_cached_block);
+    CU_add_test(s, "writes_deferred_flushed_sorted",   test_writes_are_deferred_and_flushed_sorted);
+    CU_add_test(s, "dirty_eviction_flushes_everything", test_dirty_eviction_flushes_everything);
+    CU_add_test(s, "range_and_device_errors",          test_range_and_device_errors);
+    CU_add_test(s, "ramfs_save_load_round_trip",       test_ramfs_save_load_round_trip);
+    CU_add_test(s, "ramfs_save_keeps_the_old_copy",    test_ramfs_save_keeps_the_old_copy);
+}
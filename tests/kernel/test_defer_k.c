@@ -0,0 +1,104 @@
+/*
+ * test_defer_k.c — Kernel-side CUnit tests for src/defer.c.
+ *
+ * Tests run before interrupts are enabled, so defer_run() is the only
+ * consumer and every drain is deterministic.
+ */
+
+#include "kunit.h"
+#include "defer.h"
+
+static uint32_t seen[DEFER_QUEUE_SIZE + 8];
+static unsigned seen_count;
+
+static void record(uint32_t arg)
+{
+    if (seen_count < sizeof(seen) / sizeof(seen[0]))
+        seen[seen_count] = arg;
+    seen_count++;
+}
+
+static void repost_once(uint32_t arg)
+{
+    record(arg);
+    if (arg == 1)
+        defer_post(record, 2);
+}
+
+static void reset(void)
+{
+    defer_run();
+    seen_count = 0;
+}
+
+static void test_runs_in_fifo_order(void)
+{
+    reset();
+    CU_ASSERT_TRUE(defer_post(record, 10));
+    CU_ASSERT_TRUE(defer_post(record, 20));
+    CU_ASSERT_TRUE(defer_post(record, 30));
+    CU_ASSERT_EQUAL(defer_pending(), 3U);
+
+    defer_run();
+
+    CU_ASSERT_EQUAL(seen_count, 3U);
+    CU_ASSERT_EQUAL(seen[0], 10U);
+    CU_ASSERT_EQUAL(seen[1], 20U);
+    CU_ASSERT_EQUAL(seen[2], 30U);
+    CU_ASSERT_EQUAL(defer_pending(), 0U);
+}
+
+static void test_work_posted_by_work_runs_same_drain(void)
+{
+    reset();
+    defer_post(repost_once, 1);
+
+    defer_run();
+
+    CU_ASSERT_EQUAL(seen_count, 2U);
+    CU_ASSERT_EQUAL(seen[0], 1U);
+    CU_ASSERT_EQUAL(seen[1], 2U);
+}
+
+static void test_overflow_is_counted(void)
+{
+    uint32_t dropped_before;
+    unsigned i;
+
+    reset();
+    dropped_before = defer_dropped();
+
+    for (i = 0; i < DEFER_QUEUE_SIZE; i++)
+        CU_ASSERT_TRUE(defer_post(record, i));
+    CU_ASSERT_FALSE(defer_post(record, 999));
+
+    CU_ASSERT_EQUAL(defer_dropped(), dropped_before + 1);
+    CU_ASSERT_EQUAL(defer_high_watermark(), (uint32_t)DEFER_QUEUE_SIZE);
+
+    defer_run();
+    CU_ASSERT_EQUAL(seen_count, (unsigned)DEFER_QUEUE_SIZE);
+    CU_ASSERT_EQUAL(seen[DEFER_QUEUE_SIZE - 1], (uint32_t)(DEFER_QUEUE_SIZE - 1));
+}
+
+static void test_wraps_around(void)
+{
+    unsigned round, i;
+
+    reset();
+    for (round = 0; round < 3; round++) {
+        for (i = 0; i < DEFER_QUEUE_SIZE - 1; i++)
+            defer_post(record, i);
+        defer_run();
+    }
+
+    CU_ASSERT_EQUAL(seen_count, 3U * (DEFER_QUEUE_SIZE - 1));
+    CU_ASSERT_EQUAL(defer_pending(), 0U);
+}
+
+void suite_defer_tests(CU_pSuite s)
+{
+    CU_add_test(s, "runs_in_fifo_order",             test_runs_in_fifo_order);
+    CU_add_test(s, "work_posted_by_work_runs_same_drain", test_work_posted_by_work_runs_same_drain);
+    CU_add_test(s, "overflow_is_counted",            test_overflow_is_counted);
+    CU_add_test(s, "wraps_around",                   test_wraps_around);
+}
@@ -0,0 +1,154 @@
+/*
+ * test_elf_k.c — Kernel-side CUnit tests for the in-place ELF loader.
+ *
+ * Each test builds a small executable in a page-aligned buffer, which
+ * stands in for a multiboot module: a header page, one read-only text page
+ * and a writable data segment of one full page, 16 bytes of a second page
+ * and .bss. The image is linked at ELF_TEST_BASE, inside the vmm window.
+ */
+
+#include "kunit.h"
+#include "elf.h"
+#include "exo_abi.h"
+#include "vmm.h"
+#include "pmm.h"
+#include "string.h"
+
+#define ELF_TEST_BASE  0x70000000u
+#define TEXT_VA        (ELF_TEST_BASE + 0x1000)
+#define DATA_VA        (ELF_TEST_BASE + 0x2000)
+#define DATA_FILESZ    0x1010u
+#define DATA_MEMSZ     0x3000u
+
+static uint8_t image[4 * PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+
+static void build_image(void)
+{
+    memset(image, 0, sizeof(image));
+    elf32_ehdr_t *eh = (elf32_ehdr_t *)image;
+    memcpy(eh->ident, "\x7F" "ELF\x01\x01\x01", 7);
+    eh->type = 2;
+    eh->machine = 3;
+    eh->version = 1;
+    eh->entry = TEXT_VA;
+    eh->phoff = sizeof(*eh);
+    eh->ehsize = sizeof(*eh);
+    eh->phentsize = sizeof(elf32_phdr_t);
+    eh->phnum = 2;
+
+    elf32_phdr_t *ph = (elf32_phdr_t *)(image + eh->phoff);
+    ph[0] = (elf32_phdr_t){ ELF_PT_LOAD, 0x1000, TEXT_VA, TEXT_VA,
+                            PAGE_SIZE, PAGE_SIZE, 5, PAGE_SIZE };
+    ph[1] = (elf32_phdr_t){ ELF_PT_LOAD, 0x2000, DATA_VA, DATA_VA,
+                            DATA_FILESZ, DATA_MEMSZ, 6, PAGE_SIZE };
+
+    memset(image + 0x1000, 0x90, PAGE_SIZE);            // text: NOPs
+    for (uint32_t i = 0; i < DATA_FILESZ; i++) {
+        image[0x2000 + i] = (uint8_t)(i + 1);
+    }
+}
+
+static void test_text_is_mapped_in_place(void)
+{
+    if (!vmm_enabled()) return;
+    build_image();
+    uint32_t free_before = pmm_stats()->free_pages;
+    uint32_t tables = vmm_stats()->tables;
+    elf_image_t img;
+
+    CU_ASSERT_EQUAL(elf_load(image, sizeof(image), &img), 0);
+    CU_ASSERT_EQUAL(img.entry, TEXT_VA);
+    CU_ASSERT_EQUAL(img.base, ELF_TEST_BASE + 0x1000);
+    CU_ASSERT_EQUAL(img.segments, 2U);
+    CU_ASSERT_EQUAL(img.mapped_bytes, (uint32_t)PAGE_SIZE);
+    CU_ASSERT_EQUAL(img.cow_bytes, (uint32_t)PAGE_SIZE);
+    CU_ASSERT_EQUAL(img.copied_bytes, DATA_FILESZ - PAGE_SIZE);
+    CU_ASSERT_EQUAL(img.zero_bytes, DATA_MEMSZ - DATA_FILESZ);
+
+    // The text page is the module's own page, not a copy.
+    CU_ASSERT_EQUAL(vmm_translate(TEXT_VA), (uint32_t)image + 0x1000);
+    CU_ASSERT_EQUAL(*(volatile uint32_t *)TEXT_VA, 0x90909090U);
+
+    // Only the edge page was allocated; release gives it back and leaves
+    // the module alone.
+    uint32_t new_tables = vmm_stats()->tables - tables;
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, free_before - 1 - new_tables);
+    CU_ASSERT_EQUAL(vmm_release(img.base), 0);
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, free_before - new_tables);
+    CU_ASSERT_EQUAL(image[0x1000], 0x90);
+}
+
+static void test_data_is_copy_on_write(void)
+{
+    if (!vmm_enabled()) return;
+    build_image();
+    elf_image_t img;
+    CU_ASSERT_EQUAL(elf_load(image, sizeof(image), &img), 0);
+    uint32_t breaks = vmm_stats()->cow_breaks;
+
+    // Reads share the module page.
+    volatile uint8_t *data = (volatile uint8_t *)DATA_VA;
+    CU_ASSERT_EQUAL(vmm_translate(DATA_VA), (uint32_t)image + 0x2000);
+    CU_ASSERT_EQUAL(data[5], 6);
+    CU_ASSERT_EQUAL(vmm_stats()->cow_breaks, breaks);
+
+    // The first write copies it; the module keeps the original.
+    data[5] = 0xEE;
+    CU_ASSERT_EQUAL(vmm_stats()->cow_breaks, breaks + 1);
+    CU_ASSERT_NOT_EQUAL(vmm_translate(DATA_VA), (uint32_t)image + 0x2000);
+    CU_ASSERT_EQUAL(data[5], 0xEE);
+    CU_ASSERT_EQUAL(data[6], 7);
+    CU_ASSERT_EQUAL(image[0x2005], 6);
+
+    // Edge page: 16 file bytes then zeroes. Last page: .bss on demand.
+    CU_ASSERT_EQUAL(data[PAGE_SIZE + 15], (uint8_t)(PAGE_SIZE + 16));
+    CU_ASSERT_EQUAL(data[PAGE_SIZE + 16], 0);
+    CU_ASSERT_EQUAL(vmm_translate(DATA_VA + 2 * PAGE_SIZE), 0U);
+    CU_ASSERT_EQUAL(data[2 * PAGE_SIZE + 100], 0);
+    CU_ASSERT_NOT_EQUAL(vmm_translate(DATA_VA + 2 * PAGE_SIZE), 0U);
+
+    CU_ASSERT_EQUAL(vmm_release(img.base), 0);
+}
+
+static void test_bad_images_are_rejected(void)
+{
+    if (!vmm_enabled()) return;
+    elf_image_t img;
+    elf32_ehdr_t *eh = (elf32_ehdr_t *)image;
+    elf32_phdr_t *ph = (elf32_phdr_t *)(image + sizeof(*eh));
+
+    build_image();
+    image[1] = 'X';
+    CU_ASSERT_EQUAL(elf_load(image, sizeof(image), &img), -EXO_EINVAL);
+
+    build_image();
+    CU_ASSERT_EQUAL(elf_load(image, 0x2800, &img), -EXO_EINVAL);  // data past EOF
+
+    build_image();
+    eh->entry = 0x100000;
+    CU_ASSERT_EQUAL(elf_load(image, sizeof(image), &img), -EXO_EINVAL);
+
+    build_image();
+    ph[0].vaddr = ph[0].paddr = 0x00400000;                  // below the window
+    eh->entry = 0x00400000;
+    CU_ASSERT_EQUAL(elf_load(image, sizeof(image), &img), -EXO_EINVAL);
+
+    build_image();
+    ph[1].vaddr = TEXT_VA + 0x800;                           // shares a page
+    CU_ASSERT_EQUAL(elf_load(image, sizeof(image), &img), -EXO_EINVAL);
+    CU_ASSERT_PTR_NULL(vmm_region(TEXT_VA));
+
+    // The same image twice: its addresses are taken.
+    build_image();
+    CU_ASSERT_EQUAL(elf_load(image, sizeof(image), &img), 0);
+    elf_image_t again;
+    CU_ASSERT_EQUAL(elf_load(image, sizeof(image), &again), -EXO_EBUSY);
+    CU_ASSERT_EQUAL(vmm_release(img.base), 0);
+}
+
+void suite_elf_tests(CU_pSuite s)
+{
+    CU_add_test(s, "text_is_mapped_in_place",  test_text_is_mapped_in_place);
+    CU_add_test(s, "data_is_copy_on_write",    test_data_is_copy_on_write);
+    CU_add_test(s, "bad_images_are_rejected",  test_bad_images_are_rejected);
+}
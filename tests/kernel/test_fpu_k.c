@@ -0,0 +1,111 @@
+/*
+ * test_fpu_k.c — Kernel-side CUnit tests for lazy FPU/SSE switching.
+ *
+ * kernel_main has installed the IDT (interrupts stay off); the suite turns
+ * lazy switching on for the rest of the run so #NM reaches fpu_nm_handler.
+ * Contexts mark their SSE state with a value in XMM0, which the kernel
+ * itself never touches outside kernel_fpu_begin()/end().
+ */
+
+#include "kunit.h"
+#include "fpu.h"
+#include "sched.h"
+
+static void xmm0_set(uint32_t v)
+{
+    __asm__ volatile ("movd %0, %%xmm0" : : "r"(v));
+}
+
+static uint32_t xmm0_get(void)
+{
+    uint32_t v;
+    __asm__ volatile ("movd %%xmm0, %0" : "=r"(v));
+    return v;
+}
+
+static void drain(void)
+{
+    while (sched_yield()) {}
+}
+
+int suite_fpu_init(void)
+{
+    fpu_enable_lazy();
+    return 0;
+}
+
+typedef struct {
+    uint32_t mark;
+    uint32_t seen;
+} mark_t;
+
+/* Set XMM0, let others run, read it back. */
+static void keep_mark(void* arg)
+{
+    mark_t* m = arg;
+    xmm0_set(m->mark);
+    sched_yield();
+    m->seen = xmm0_get();
+}
+
+static void test_sse_state_follows_context(void)
+{
+    if (!fpu_has_sse()) return;
+    fpu_stats_t before = *fpu_stats();
+    mark_t a = { 0x1111AAAA, 0 }, b = { 0x2222BBBB, 0 };
+
+    sched_spawn("a", keep_mark, &a);
+    sched_spawn("b", keep_mark, &b);
+    drain();
+    CU_ASSERT_EQUAL(a.seen, a.mark);
+    CU_ASSERT_EQUAL(b.seen, b.mark);
+
+    // a: clean, b: save a + clean, a: save b + restore, b: restore.
+    const fpu_stats_t* s = fpu_stats();
+    CU_ASSERT_EQUAL(s->nm_traps - before.nm_traps, 4U);
+    CU_ASSERT_EQUAL(s->first_uses - before.first_uses, 2U);
+    CU_ASSERT_EQUAL(s->lazy_saves - before.lazy_saves, 2U);
+    CU_ASSERT_EQUAL(s->lazy_restores - before.lazy_restores, 2U);
+}
+
+static void yield_only(void* arg)
+{
+    (void)arg;
+    for (int i = 0; i < 5; i++) sched_yield();
+}
+
+static void test_integer_context_never_traps(void)
+{
+    if (!fpu_has_sse()) return;
+    uint32_t traps = fpu_stats()->nm_traps;
+
+    sched_spawn("int", yield_only, 0);
+    drain();
+    CU_ASSERT_EQUAL(fpu_stats()->nm_traps, traps);
+}
+
+static void test_kernel_section_preserves_owner(void)
+{
+    if (!fpu_has_sse()) return;
+    mark_t a = { 0x3333CCCC, 0 };
+    uint32_t saves = fpu_stats()->kernel_saves;
+
+    sched_spawn("a", keep_mark, &a);
+    CU_ASSERT_TRUE(sched_yield());       // a now owns XMM0
+
+    uint32_t flags = kernel_fpu_begin();
+    xmm0_set(0xDEADBEEF);
+    CU_ASSERT_EQUAL(xmm0_get(), 0xDEADBEEFU);
+    kernel_fpu_end(flags);
+    CU_ASSERT_EQUAL(fpu_stats()->kernel_saves, saves + 1);
+
+    drain();
+    CU_ASSERT_EQUAL(a.seen, a.mark);
+}
+
+void suite_fpu_tests(CU_pSuite s)
+{
+    CU_add_test(s, "sse_state_follows_context",    test_sse_state_follows_context);
+    CU_add_test(s, "integer_context_never_traps",  test_integer_context_never_traps);
+    CU_add_test(s, "kernel_section_preserves_owner", test_kernel_section_preserves_owner);
+}
@@ -0,0 +1,134 @@
+/*
+ * test_init_k.c — Kernel-side CUnit tests for boot stages and the boot
+ * timeline.
+ *
+ * Each test hands init_begin() a table of its own; kernel_main has already
+ * run its early stages, and nothing looks at its table again.
+ */
+
+#include "kunit.h"
+#include "init.h"
+
+static char order[8];
+static uint32_t order_len;
+
+static bool run_a(void) { order[order_len++] = 'a'; return true; }
+static bool run_b(void) { order[order_len++] = 'b'; return true; }
+static bool run_c(void) { order[order_len++] = 'c'; return true; }
+static bool absent(void) { order[order_len++] = 'x'; return false; }
+
+static void reset(const init_stage_t* stages, uint32_t count)
+{
+    for (uint32_t i = 0; i < sizeof(order); i++) order[i] = 0;
+    order_len = 0;
+    init_begin(stages, count);
+}
+
+static void test_dependencies_reorder_table(void)
+{
+    // b needs c, which comes after it in the table.
+    static const init_stage_t t[] = {
+        { "a", run_a, 0, 0 },
+        { "b", run_b, INIT_BIT(2), 0 },
+        { "c", run_c, 0, 0 },
+    };
+    reset(t, 3);
+    CU_ASSERT_TRUE(init_run_early());
+    CU_ASSERT_STRING_EQUAL(order, "acb");
+    CU_ASSERT_EQUAL(init_record(1)->order, 2U);
+    CU_ASSERT_EQUAL(init_record(1)->state, INIT_DONE);
+    CU_ASSERT(init_record(1)->start_tsc >= init_record(2)->end_tsc);
+}
+
+static void test_absent_stage_skips_dependents(void)
+{
+    static const init_stage_t t[] = {
+        { "dev",  absent, 0, 0 },
+        { "use",  run_a,  INIT_BIT(0), 0 },
+        { "more", run_b,  INIT_BIT(1), 0 },
+        { "free", run_c,  0, 0 },
+    };
+    reset(t, 4);
+    CU_ASSERT_TRUE(init_run_early());
+    CU_ASSERT_STRING_EQUAL(order, "xc");
+    CU_ASSERT_EQUAL(init_record(0)->state, INIT_ABSENT);
+    CU_ASSERT_EQUAL(init_record(1)->state, INIT_SKIPPED);
+    CU_ASSERT_EQUAL(init_record(2)->state, INIT_SKIPPED);
+    CU_ASSERT_EQUAL(init_record(3)->state, INIT_DONE);
+}
+
+static void test_late_stages_run_one_at_a_time(void)
+{
+    static const init_stage_t t[] = {
+        { "late1", run_a, 0, INIT_LATE },
+        { "early", run_b, 0, 0 },
+        { "late2", run_c, INIT_BIT(0), INIT_LATE },
+    };
+    reset(t, 3);
+    CU_ASSERT_TRUE(init_run_early());
+    CU_ASSERT_STRING_EQUAL(order, "b");
+    CU_ASSERT_EQUAL(init_record(0)->state, INIT_PENDING);
+
+    CU_ASSERT_TRUE(init_run_late());
+    CU_ASSERT_STRING_EQUAL(order, "ba");
+    CU_ASSERT_TRUE(init_run_late());
+    CU_ASSERT_STRING_EQUAL(order, "bac");
+    CU_ASSERT_FALSE(init_run_late());
+    CU_ASSERT_NOT_EQUAL(init_mark_tsc(INIT_MARK_LATE_DONE), 0);
+}
+
+static void test_absent_late_stage_skips_only_dependents(void)
+{
+    // As at boot: a report needs an absent device, the timeline needs nothing.
+    static const init_stage_t t[] = {
+        { "dev",    absent, 0, INIT_LATE },
+        { "report", run_a,  INIT_BIT(0), INIT_LATE },
+        { "final",  run_b,  0, INIT_LATE },
+    };
+    reset(t, 3);
+    CU_ASSERT_TRUE(init_run_early());
+    CU_ASSERT_TRUE(init_run_late());
+    CU_ASSERT_TRUE(init_run_late());
+    CU_ASSERT_TRUE(init_run_late());
+    CU_ASSERT_FALSE(init_run_late());
+    CU_ASSERT_STRING_EQUAL(order, "xb");
+    CU_ASSERT_EQUAL(init_record(0)->state, INIT_ABSENT);
+    CU_ASSERT_EQUAL(init_record(1)->state, INIT_SKIPPED);
+    CU_ASSERT_EQUAL(init_record(2)->state, INIT_DONE);
+    CU_ASSERT_EQUAL(init_record(2)->order, 2U);
+}
+
+static void test_unrunnable_early_stage_reported(void)
+{
+    // Early needing late, and a two-stage cycle.
+    static const init_stage_t t[] = {
+        { "late",  run_a, 0, INIT_LATE },
+        { "early", run_b, INIT_BIT(0), 0 },
+        { "x",     run_c, INIT_BIT(3), 0 },
+        { "y",     run_c, INIT_BIT(2), 0 },
+    };
+    reset(t, 4);
+    CU_ASSERT_FALSE(init_run_early());
+    CU_ASSERT_EQUAL(order_len, 0U);
+}
+
+static void test_marks_keep_first_time(void)
+{
+    CU_ASSERT_NOT_EQUAL(init_mark_tsc(INIT_MARK_ENTRY), 0);
+    init_mark(INIT_MARK_FIRST_FRAME);
+    uint64_t first = init_mark_tsc(INIT_MARK_FIRST_FRAME);
+    CU_ASSERT_NOT_EQUAL(first, 0);
+    init_mark(INIT_MARK_FIRST_FRAME);
+    CU_ASSERT_EQUAL(init_mark_tsc(INIT_MARK_FIRST_FRAME), first);
+    CU_ASSERT_EQUAL(init_mark_tsc(INIT_MARK_COUNT), 0);
+}
+
+void suite_init_tests(CU_pSuite s)
+{
+    CU_add_test(s, "dependencies_reorder_table",   test_dependencies_reorder_table);
+    CU_add_test(s, "absent_stage_skips_dependents", test_absent_stage_skips_dependents);
+    CU_add_test(s, "late_stages_run_one_at_a_time", test_late_stages_run_one_at_a_time);
+    CU_add_test(s, "absent_late_stage_skips_only_dependents", test_absent_late_stage_skips_only_dependents);
+    CU_add_test(s, "unrunnable_early_stage_reported", test_unrunnable_early_stage_reported);
+    CU_add_test(s, "marks_keep_first_time",         test_marks_keep_first_time);
+}
@@ -0,0 +1,106 @@
+/*
+ * test_irqmon_k.c — Kernel-side CUnit tests for src/irqmon.c.
+ *
+ * Drives the IRQ0 tick analysis with synthetic TSC timestamps against a
+ * 1000-cycle period, so the results do not depend on the host CPU speed.
+ */
+
+#include "kunit.h"
+#include "irqmon.h"
+#include "defer.h"
+#include "cpu.h"
+
+#define PERIOD 1000U
+
+static void feed(const uint64_t *ts, unsigned n)
+{
+    unsigned i;
+    for (i = 0; i < n; i++)
+        irqmon_tick(ts[i]);
+}
+
+static void test_on_time_ticks(void)
+{
+    static const uint64_t ts[] = { 5000, 6000, 7010, 8000, 9005 };
+
+    irqmon_init(PERIOD);
+    feed(ts, 5);
+
+    CU_ASSERT_EQUAL(irqmon_tick_stats()->ticks, 5U);
+    CU_ASSERT_EQUAL(irqmon_tick_stats()->late_ticks, 0U);
+    CU_ASSERT_EQUAL(irqmon_lost_ticks(), 0U);
+}
+
+static void test_late_but_latched_tick_is_not_lost(void)
+{
+    /* Third tick serviced 600 cycles late; the PIC held the edge. */
+    static const uint64_t ts[] = { 5000, 6000, 7600, 8000, 9000 };
+
+    irqmon_init(PERIOD);
+    feed(ts, 5);
+
+    CU_ASSERT_EQUAL(irqmon_tick_stats()->late_ticks, 1U);
+    CU_ASSERT_EQUAL(irqmon_lost_ticks(), 0U);
+    CU_ASSERT_EQUAL(irqmon_tick_stats()->lateness.max, 600U);
+}
+
+static void test_missed_ticks_are_counted(void)
+{
+    /* Edges at 7000 and 8000 are swallowed; 8000's is serviced at 8500. */
+    static const uint64_t ts[] = { 5000, 6000, 8500, 9000, 10000 };
+
+    irqmon_init(PERIOD);
+    feed(ts, 5);
+
+    CU_ASSERT_EQUAL(irqmon_lost_ticks(), 1U);
+    CU_ASSERT_EQUAL(irqmon_tick_stats()->last_lost_count, 1U);
+    CU_ASSERT_EQUAL(irqmon_tick_stats()->last_lost_at, 3U);
+    CU_ASSERT_EQUAL(irqmon_tick_stats()->last_lost_gap, 2500U);
+    /* Back on schedule afterwards. */
+    CU_ASSERT_EQUAL(irqmon_tick_stats()->late_ticks, 1U);
+
+    defer_run();   /* flush the loss report */
+}
+
+static void test_slow_clock_estimate_does_not_drift(void)
+{
+    /* Real period is 1% longer than the calibrated one for 500 ticks. */
+    uint64_t t = 0;
+    unsigned i;
+
+    irqmon_init(PERIOD);
+    for (i = 0; i < 500; i++) {
+        irqmon_tick(t);
+        t += PERIOD + PERIOD / 100;
+    }
+
+    CU_ASSERT_EQUAL(irqmon_lost_ticks(), 0U);
+    CU_ASSERT_EQUAL(irqmon_tick_stats()->late_ticks, 0U);
+}
+
+static void test_culprit_is_longest_handler(void)
+{
+    irqmon_init(PERIOD);
+    irqmon_tick(5000);
+
+    irqmon_enter(1, rdtsc());
+    irqmon_exit(1);
+
+    irqmon_tick(7500);
+
+    CU_ASSERT_EQUAL(irqmon_lost_ticks(), 1U);
+    CU_ASSERT_EQUAL(irqmon_tick_stats()->last_culprit_irq, 1U);
+    CU_ASSERT_EQUAL(irqmon_line_stats(1)->count, 1U);
+    CU_ASSERT_EQUAL(irqmon_line_stats(1)->duration.count, 1U);
+
+    defer_run();
+}
+
+void suite_irqmon_tests(CU_pSuite s)
+{
+    CU_add_test(s, "on_time_ticks",                  test_on_time_ticks);
+    CU_add_test(s, "late_but_latched_tick_is_not_lost", test_late_but_latched_tick_is_not_lost);
+    CU_add_test(s, "missed_ticks_are_counted",       test_missed_ticks_are_counted);
+    CU_add_test(s, "slow_clock_estimate_does_not_drift", test_slow_clock_estimate_does_not_drift);
+    CU_add_test(s, "culprit_is_longest_handler",     test_culprit_is_longest_handler);
+}
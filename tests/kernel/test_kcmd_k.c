@@ -0,0 +1,44 @@
+/*
+ * test_kcmd_k.c — Kernel-side CUnit tests for the serial command console.
+ *
+ * Only kcmd_execute() is exercised; the commands print to serial, which is
+ * harmless in the test log.
+ */
+
+#include "kunit.h"
+#include "kcmd.h"
+
+static void test_known_commands_run(void)
+{
+    CU_ASSERT_TRUE(kcmd_execute("help"));
+    CU_ASSERT_TRUE(kcmd_execute("kbdlat"));
+}
+
+static void test_blanks_are_trimmed(void)
+{
+    CU_ASSERT_TRUE(kcmd_execute("  help \r"));
+    CU_ASSERT_TRUE(kcmd_execute(""));
+}
+
+static void test_unknown_and_prefix_rejected(void)
+{
+    CU_ASSERT_FALSE(kcmd_execute("nope"));
+    CU_ASSERT_FALSE(kcmd_execute("hel"));
+    CU_ASSERT_FALSE(kcmd_execute("helpme"));
+}
+
+static void test_arguments_follow_the_name(void)
+{
+    CU_ASSERT_TRUE(kcmd_execute("help  extra words "));
+    CU_ASSERT_STRING_EQUAL(kcmd_args(), "extra words");
+    CU_ASSERT_TRUE(kcmd_execute("help"));
+    CU_ASSERT_STRING_EQUAL(kcmd_args(), "");
+}
+
+void suite_kcmd_tests(CU_pSuite s)
+{
+    CU_add_test(s, "known_commands_run",          test_known_commands_run);
+    CU_add_test(s, "blanks_are_trimmed",          test_blanks_are_trimmed);
+    CU_add_test(s, "unknown_and_prefix_rejected", test_unknown_and_prefix_rejected);
+    CU_add_test(s, "arguments_follow_the_name",   test_arguments_follow_the_name);
+}
@@ -0,0 +1,137 @@
+/*
+ * test_mixer_k.c — Kernel-side CUnit tests for the PCM software mixer.
+ *
+ * No sound card is needed: each test renders blocks into a local buffer
+ * and checks the samples. The SSE2 path is compared against the scalar
+ * one whenever the CPU has SSE2.
+ */
+
+#include "kunit.h"
+#include "mixer.h"
+#include "syscall.h"
+
+static int16_t out[MIXER_MAX_FRAMES * 2] __attribute__((aligned(16)));
+
+static void test_saturating_add_paths_agree(void)
+{
+    static int16_t a[64] __attribute__((aligned(16)));
+    static int16_t b[64] __attribute__((aligned(16)));
+    static int16_t src[64] __attribute__((aligned(16)));
+    static const int16_t edge[] = { 0, 1, -1, 1000, -1000, 20000, -20000,
+                                    32767, -32768, 16384, -16385 };
+
+    mixer_init();
+    for (uint32_t i = 0; i < 64; i++) {
+        a[i] = b[i] = edge[i % 11];
+        src[i] = edge[(i * 7 + 3) % 11];
+    }
+    mixer_add_saturate(a, src, 64, false);
+    mixer_add_saturate(b, src, 64, true);
+    for (uint32_t i = 0; i < 64; i++) {
+        int32_t want = edge[i % 11] + edge[(i * 7 + 3) % 11];
+        if (want > 32767) want = 32767;
+        if (want < -32768) want = -32768;
+        CU_ASSERT_EQUAL(a[i], want);
+        CU_ASSERT_EQUAL(b[i], want);
+    }
+}
+
+static void test_resample_doubles_11025(void)
+{
+    static const uint8_t pcm[4] = { 128, 192, 64, 128 };   // 0, +64, -64, 0
+
+    mixer_init();
+    CU_ASSERT_EQUAL(mixer_play(0, pcm, 4, 11025, EXO_PCM_MAX_VOL, 0), 0);
+    mixer_render(out, 8);
+
+    // Two output frames per input sample, the odd ones interpolated.
+    // sep 0: the whole (vol 127 -> gain 254) goes left, nothing right.
+    int32_t l[8];
+    for (uint32_t i = 0; i < 8; i++) {
+        l[i] = out[2 * i];
+        CU_ASSERT_EQUAL(out[2 * i + 1], 0);
+    }
+    CU_ASSERT_EQUAL(l[0], 0);
+    CU_ASSERT_EQUAL(l[2], (64 << 8) * 254 >> 8);
+    CU_ASSERT_EQUAL(l[1], (32 << 8) * 254 >> 8);
+    CU_ASSERT_EQUAL(l[4], -64 * 256 * 254 / 256);
+    CU_ASSERT_EQUAL(l[6], 0);
+    CU_ASSERT_EQUAL(l[7], 0);
+
+    // All four samples were consumed in eight frames.
+    CU_ASSERT_EQUAL(mixer_active(), 0U);
+    CU_ASSERT_EQUAL(mixer_stats()->finished, 1U);
+}
+
+static void test_pan_and_volume(void)
+{
+    static uint8_t pcm[64];
+    for (uint32_t i = 0; i < 64; i++) pcm[i] = 255;
+
+    mixer_init();
+    mixer_play(0, pcm, 64, MIXER_RATE, EXO_PCM_MAX_VOL, 254);
+    mixer_render(out, 8);
+    // Hard right: Doom's curve leaves a sliver (gain 2) on the left.
+    CU_ASSERT_EQUAL(out[0], (127 << 8) * 2 >> 8);
+    CU_ASSERT_EQUAL(out[1], (127 << 8) * 254 >> 8);
+
+    // Centre at vol 64: each side is 64 - 64 * 128^2 / 65536 = 48, doubled.
+    CU_ASSERT_EQUAL(mixer_update(0, 64, EXO_PCM_SEP_CENTER), 1);
+    mixer_render(out, 8);
+    CU_ASSERT_EQUAL(out[0], (127 << 8) * 96 >> 8);
+    CU_ASSERT_EQUAL(out[1], (127 << 8) * 96 >> 8);
+}
+
+static void test_voices_mix_and_clip(void)
+{
+    static uint8_t loud[64];
+    for (uint32_t i = 0; i < 64; i++) loud[i] = 255;
+
+    mixer_init();
+    for (uint32_t ch = 0; ch < EXO_PCM_CHANNELS; ch++) {
+        CU_ASSERT_EQUAL(mixer_play(ch, loud, 64, MIXER_RATE,
+                                   EXO_PCM_MAX_VOL, 0), 0);
+    }
+    CU_ASSERT_EQUAL(mixer_active(), (1u << EXO_PCM_CHANNELS) - 1);
+    mixer_render(out, 16);
+    CU_ASSERT_EQUAL(out[0], 32767);
+    CU_ASSERT_EQUAL(out[1], 0);
+
+    CU_ASSERT_EQUAL(mixer_stop(3), 0);
+    CU_ASSERT_EQUAL(mixer_active() & (1u << 3), 0U);
+    CU_ASSERT_EQUAL(mixer_update(3, 10, 10), 0);
+    CU_ASSERT_EQUAL(mixer_stop(EXO_SOUND_ALL), 0);
+    mixer_render(out, 16);
+    CU_ASSERT_EQUAL(out[0], 0);
+    CU_ASSERT_EQUAL(mixer_stats()->renders, 2U);
+    CU_ASSERT_EQUAL(mixer_stats()->frames, 32U);
+}
+
+static void test_limits(void)
+{
+    static const uint8_t pcm[8];
+
+    mixer_init();
+    CU_ASSERT_EQUAL(mixer_play(EXO_PCM_CHANNELS, pcm, 8, 11025, 0, 0), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(mixer_play(0, 0, 8, 11025, 0, 0), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(mixer_play(0, pcm, 0, 11025, 0, 0), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(mixer_play(0, pcm, 8, MIXER_MAX_RATE + 1, 0, 0), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(mixer_play(0, pcm, 8, 11025, 128, 0), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(mixer_play(0, pcm, 8, 11025, 0, 255), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(mixer_stop(EXO_PCM_CHANNELS), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(mixer_update(EXO_PCM_CHANNELS, 0, 0), -EXO_EINVAL);
+
+    // No SB16 under test: the syscalls refuse before touching the mixer.
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_PCM_PLAY, 0, (uint32_t)pcm, 8,
+                                     11025, 127), -EXO_ENODEV);
+    CU_ASSERT_EQUAL(mixer_stats()->started, 0U);
+}
+
+void suite_mixer_tests(CU_pSuite s)
+{
+    CU_add_test(s, "saturating_add_paths_agree", test_saturating_add_paths_agree);
+    CU_add_test(s, "resample_doubles_11025",     test_resample_doubles_11025);
+    CU_add_test(s, "pan_and_volume",             test_pan_and_volume);
+    CU_add_test(s, "voices_mix_and_clip",        test_voices_mix_and_clip);
+    CU_add_test(s, "limits",                     test_limits);
+}
@@ -0,0 +1,157 @@
+/*
+ * test_mouse_k.c — Kernel-side CUnit tests for the PS/2 mouse decoder.
+ *
+ * Feeds raw packet bytes through ps2_mouse_process_byte() and checks the
+ * accumulated state returned by exo_mouse_poll().  No device I/O happens.
+ */
+
+#include "kunit.h"
+#include "ps2_mouse.h"
+
+#define B0          0x08    /* byte 0 with only the always-1 bit set */
+#define X_SIGN      0x10
+#define Y_SIGN      0x20
+#define X_OVERFLOW  0x40
+
+static void feed(const uint8_t *bytes, unsigned n)
+{
+    unsigned i;
+    for (i = 0; i < n; i++)
+        ps2_mouse_process_byte(bytes[i]);
+}
+
+static void reset(uint8_t packet_size)
+{
+    mouse_state_t st;
+    ps2_mouse_set_packet_size(packet_size);
+    exo_mouse_poll(&st);
+}
+
+static void test_single_packet(void)
+{
+    static const uint8_t pkt[] = { B0 | MOUSE_BUTTON_LEFT, 5, 3 };
+    mouse_state_t st;
+    uint32_t before = ps2_mouse_packets();
+
+    reset(3);
+    feed(pkt, 3);
+
+    CU_ASSERT_EQUAL(ps2_mouse_packets(), before + 1);
+    CU_ASSERT_EQUAL(exo_mouse_poll(&st), 1);
+    CU_ASSERT_EQUAL(st.dx, 5);
+    CU_ASSERT_EQUAL(st.dy, 3);
+    CU_ASSERT_EQUAL(st.buttons, MOUSE_BUTTON_LEFT);
+
+    /* Motion is consumed by the poll; buttons persist. */
+    exo_mouse_poll(&st);
+    CU_ASSERT_EQUAL(st.dx, 0);
+    CU_ASSERT_EQUAL(st.dy, 0);
+    CU_ASSERT_EQUAL(st.buttons, MOUSE_BUTTON_LEFT);
+}
+
+static void test_negative_deltas_accumulate(void)
+{
+    /* -1 in X, -2 in Y, twice, then +10 X: net dx 8, dy -4. */
+    static const uint8_t pkts[] = {
+        B0 | X_SIGN | Y_SIGN, 0xFF, 0xFE,
+        B0 | X_SIGN | Y_SIGN, 0xFF, 0xFE,
+        B0,                   10,   0,
+    };
+    mouse_state_t st;
+
+    reset(3);
+    feed(pkts, sizeof(pkts));
+    exo_mouse_poll(&st);
+
+    CU_ASSERT_EQUAL(st.dx, 8);
+    CU_ASSERT_EQUAL(st.dy, -4);
+    CU_ASSERT_EQUAL(st.buttons, 0);
+}
+
+static void test_resync_on_bad_first_byte(void)
+{
+    /* Two stray bytes without bit 3 (the tail of a lost packet), then a
+       good packet. */
+    static const uint8_t bytes[] = { 0x04, 0x02, B0, 7, 1 };
+    mouse_state_t st;
+    uint32_t before = ps2_mouse_resyncs();
+
+    reset(3);
+    feed(bytes, sizeof(bytes));
+    exo_mouse_poll(&st);
+
+    CU_ASSERT_EQUAL(ps2_mouse_resyncs(), before + 2);
+    CU_ASSERT_EQUAL(st.dx, 7);
+    CU_ASSERT_EQUAL(st.dy, 1);
+}
+
+static void test_overflow_drops_motion(void)
+{
+    static const uint8_t pkt[] = { B0 | X_OVERFLOW | MOUSE_BUTTON_RIGHT, 0x80, 0x80 };
+    mouse_state_t st;
+
+    reset(3);
+    feed(pkt, 3);
+    exo_mouse_poll(&st);
+
+    CU_ASSERT_EQUAL(st.dx, 0);
+    CU_ASSERT_EQUAL(st.dy, 0);
+    CU_ASSERT_EQUAL(st.buttons, MOUSE_BUTTON_RIGHT);
+}
+
+static void test_wheel_packets(void)
+{
+    /* Wheel +1, then -2; a 4th byte outside -8..7 forces a resync. */
+    static const uint8_t pkts[] = {
+        B0 | MOUSE_BUTTON_MIDDLE, 1, 0, 0x01,
+        B0,                       0, 1, 0xFE,
+        B0,                       9, 9, 0x40,
+    };
+    mouse_state_t st;
+    uint32_t before = ps2_mouse_resyncs();
+
+    reset(4);
+    feed(pkts, sizeof(pkts));
+    exo_mouse_poll(&st);
+
+    CU_ASSERT_EQUAL(st.wheel, -1);
+    CU_ASSERT_EQUAL(st.dx, 1);
+    CU_ASSERT_EQUAL(st.dy, 1);
+    CU_ASSERT_EQUAL(ps2_mouse_resyncs(), before + 1);
+
+    reset(3);
+}
+
+static void test_large_motion_is_not_lost(void)
+{
+    static const uint8_t pkt[] = { B0, 255, 0 };
+    mouse_state_t st;
+    unsigned i;
+
+    reset(3);
+    for (i = 0; i < 200; i++)       /* 51000 counts: more than an int16_t */
+        feed(pkt, 3);
+
+    exo_mouse_poll(&st);
+    CU_ASSERT_EQUAL(st.dx, 32767);
+    exo_mouse_poll(&st);
+    CU_ASSERT_EQUAL(st.dx, 51000 - 32767);
+}
+
+static void test_invalid_arguments(void)
+{
+    CU_ASSERT_EQUAL(exo_mouse_poll(NULL), 0);
+    CU_ASSERT_FALSE(ps2_mouse_set_packet_size(5));
+    CU_ASSERT_FALSE(mouse_set_sample_rate(150));
+}
+
+void suite_mouse_tests(CU_pSuite s)
+{
+    CU_add_test(s, "single_packet",               test_single_packet);
+    CU_add_test(s, "negative_deltas_accumulate",  test_negative_deltas_accumulate);
+    CU_add_test(s, "resync_on_bad_first_byte",    test_resync_on_bad_first_byte);
+    CU_add_test(s, "overflow_drops_motion",       test_overflow_drops_motion);
+    CU_add_test(s, "wheel_packets",               test_wheel_packets);
+    CU_add_test(s, "large_motion_is_not_lost",    test_large_motion_is_not_lost);
+    CU_add_test(s, "invalid_arguments",           test_invalid_arguments);
+}
@@ -0,0 +1,201 @@
+/*
+ * test_pmm_k.c — Kernel-side CUnit tests for the physical page allocator.
+ *
+ * Runs against the real bitmap built by pmm_init() from the multiboot
+ * memory map, so every test gives back what it takes.
+ */
+
+#include "kunit.h"
+#include "pmm.h"
+#include "memory.h"
+#include "string.h"
+
+extern char _load_start;
+
+static int page_is_reserved(uint32_t addr)
+{
+    return addr < 0x100000
+        || (addr >= (uint32_t)&_load_start && addr < memory_base_address());
+}
+
+static void test_single_page_round_trip(void)
+{
+    uint32_t before = pmm_stats()->free_pages;
+    uint32_t page = (uint32_t)alloc_page();
+
+    CU_ASSERT_NOT_EQUAL(page, 0U);
+    CU_ASSERT_EQUAL(page & (PAGE_SIZE - 1), 0U);
+    CU_ASSERT_FALSE(page_is_reserved(page));
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, before - 1);
+
+    free_page((void *)page);
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, before);
+}
+
+static void test_contiguous_run_is_exclusive(void)
+{
+    uint32_t run = (uint32_t)alloc_pages(8);
+    uint32_t single = (uint32_t)alloc_page();
+
+    CU_ASSERT_NOT_EQUAL(run, 0U);
+    CU_ASSERT_FALSE(page_is_reserved(run));
+    CU_ASSERT_FALSE(page_is_reserved(run + 7 * PAGE_SIZE));
+    CU_ASSERT_TRUE(single < run || single >= run + 8 * PAGE_SIZE);
+
+    free_page((void *)single);
+    free_pages((void *)run, 8);
+}
+
+static void test_freed_pages_are_reused(void)
+{
+    void *a = alloc_pages(2);
+    void *b;
+
+    free_pages(a, 2);
+    b = alloc_pages(2);
+    CU_ASSERT_TRUE(a == b);
+    free_pages(b, 2);
+}
+
+static void test_double_free_is_detected(void)
+{
+    void *page = alloc_page();
+    uint32_t doubles = pmm_stats()->double_frees;
+    uint32_t free_before;
+
+    free_page(page);
+    free_before = pmm_stats()->free_pages;
+    free_page(page);
+    CU_ASSERT_EQUAL(pmm_stats()->double_frees, doubles + 1);
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, free_before);
+}
+
+static void test_kmalloc_draws_from_pmm(void)
+{
+    uint32_t before = pmm_stats()->free_pages;
+    void *p = kmalloc(3 * PAGE_SIZE - 100);
+
+    CU_ASSERT_TRUE(pmm_ready());
+    CU_ASSERT_PTR_NOT_NULL(p);
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, before - 3);
+    free_pages(p, 3);
+}
+
+static void test_impossible_request_fails(void)
+{
+    uint32_t failed = pmm_stats()->failed;
+
+    CU_ASSERT_PTR_NULL(alloc_pages(pmm_stats()->total_pages + 1));
+    CU_ASSERT_PTR_NULL(alloc_pages(0));
+    CU_ASSERT_EQUAL(pmm_stats()->failed, failed + 1);
+}
+
+static int page_is_zero(const void *page)
+{
+    const uint32_t *w = page;
+    for (uint32_t i = 0; i < PAGE_SIZE / 4; i++) {
+        if (w[i]) return 0;
+    }
+    return 1;
+}
+
+/* Hand every clean page back to the bitmap. */
+static void drain_clean_pool(void)
+{
+    while (pmm_stats()->clean_pages) free_page(alloc_zeroed_page());
+}
+
+static void test_zeroed_page_without_pool(void)
+{
+    drain_clean_pool();
+    uint8_t *dirty = alloc_page();
+    memset(dirty, 0xAB, PAGE_SIZE);
+    free_page(dirty);
+
+    uint32_t misses = pmm_stats()->zero_misses;
+    uint8_t *page = alloc_zeroed_page();
+    CU_ASSERT_EQUAL(page, dirty);       // lowest free page again
+    CU_ASSERT_TRUE(page_is_zero(page));
+    CU_ASSERT_EQUAL(pmm_stats()->zero_misses, misses + 1);
+    free_page(page);
+}
+
+static void test_prezeroed_pages_are_free_and_clean(void)
+{
+    drain_clean_pool();
+    uint8_t *dirty = alloc_page();
+    memset(dirty, 0xCD, PAGE_SIZE);
+    free_page(dirty);
+
+    uint32_t free_before = pmm_stats()->free_pages;
+    uint32_t hits = pmm_stats()->zero_hits;
+    CU_ASSERT_TRUE(pmm_prezero(4));
+    CU_ASSERT_EQUAL(pmm_stats()->clean_pages, 4U);
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, free_before);
+
+    // The pool is a stack: the dirty page went in first, so comes out last.
+    void *pages[4];
+    for (int i = 0; i < 4; i++) {
+        pages[i] = alloc_zeroed_page();
+        CU_ASSERT_TRUE(page_is_zero(pages[i]));
+    }
+    CU_ASSERT_EQUAL(pages[3], dirty);
+    CU_ASSERT_EQUAL(pmm_stats()->zero_hits, hits + 4);
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, free_before - 4);
+    for (int i = 0; i < 4; i++) free_page(pages[i]);
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, free_before);
+}
+
+static void test_prezero_stops_when_full(void)
+{
+    drain_clean_pool();
+    while (pmm_prezero(64)) {}
+    CU_ASSERT_EQUAL(pmm_stats()->clean_pages, (uint32_t)PMM_CLEAN_MAX);
+    CU_ASSERT_FALSE(pmm_prezero(1));
+    drain_clean_pool();
+}
+
+static void test_runs_use_the_clean_pool(void)
+{
+    static void *held[64];
+    static uint32_t held_n[64];
+    uint32_t n = 0;
+
+    drain_clean_pool();
+    // Take every free page, largest runs first.
+    for (uint32_t size = pmm_stats()->free_pages; size; size /= 2) {
+        void *p;
+        while (n < 64 && (p = alloc_pages(size))) {
+            held[n] = p;
+            held_n[n++] = size;
+        }
+    }
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, 0U);
+    CU_ASSERT_TRUE(n > 0 && held_n[0] >= 4);
+
+    // Four pages free, all of them in the pool: the bitmap has none left,
+    // yet a four-page run is still there to be had.
+    uint8_t *run = held[0];
+    free_pages(run, 4);
+    CU_ASSERT_TRUE(pmm_prezero(4));
+    CU_ASSERT_EQUAL(pmm_stats()->clean_pages, 4U);
+    CU_ASSERT_EQUAL(alloc_pages(4), run);
+    CU_ASSERT_EQUAL(pmm_stats()->clean_pages, 0U);
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, 0U);
+
+    for (uint32_t i = 0; i < n; i++) free_pages(held[i], held_n[i]);
+}
+
+void suite_pmm_tests(CU_pSuite s)
+{
+    CU_add_test(s, "single_page_round_trip",     test_single_page_round_trip);
+    CU_add_test(s, "contiguous_run_is_exclusive", test_contiguous_run_is_exclusive);
+    CU_add_test(s, "freed_pages_are_reused",     test_freed_pages_are_reused);
+    CU_add_test(s, "double_free_is_detected",    test_double_free_is_detected);
+    CU_add_test(s, "kmalloc_draws_from_pmm",     test_kmalloc_draws_from_pmm);
+    CU_add_test(s, "impossible_request_fails",   test_impossible_request_fails);
+    CU_add_test(s, "zeroed_page_without_pool",   test_zeroed_page_without_pool);
+    CU_add_test(s, "prezeroed_pages_are_free_and_clean", test_prezeroed_pages_are_free_and_clean);
+    CU_add_test(s, "prezero_stops_when_full",    test_prezero_stops_when_full);
+    CU_add_test(s, "runs_use_the_clean_pool",    test_runs_use_the_clean_pool);
+}
@@ -0,0 +1,115 @@
+/*
+ * test_prof_k.c — Kernel-side CUnit tests for the sampling profiler.
+ *
+ * The PIT is stopped while tests run, so the tests call prof_tick() with
+ * frames they build themselves. The frame-pointer chain lives in a local
+ * array, laid out the way `push %ebp; mov %esp, %ebp` leaves it.
+ */
+
+#include "kunit.h"
+#include "prof.h"
+#include "vmm.h"
+#include "pmm.h"
+
+typedef struct {
+    irq_frame_t frame;
+    uint32_t stack[8];
+} fake_t;
+
+/* EIP 0x101000, called from 0x101111, called from 0x102222. */
+static void fake_init(fake_t *f)
+{
+    f->frame = (irq_frame_t){0};
+    f->frame.eip = 0x00101000;
+    f->frame.esp = (uint32_t)f->stack - 12;     // EIP, CS, EFLAGS below
+    f->frame.ebp = (uint32_t)&f->stack[0];
+    f->stack[0] = (uint32_t)&f->stack[4];       // saved EBP
+    f->stack[1] = 0x00101111;                   // return address
+    f->stack[4] = 0;                            // outermost frame
+    f->stack[5] = 0x00102222;
+}
+
+static void test_records_eip_and_callers(void)
+{
+    fake_t f;
+    fake_init(&f);
+    CU_ASSERT_TRUE(prof_start(1));
+    prof_tick(&f.frame);
+    prof_stop();
+
+    uint32_t n;
+    const prof_sample_t *s = prof_samples(&n);
+    CU_ASSERT_EQUAL(n, 1U);
+    CU_ASSERT_EQUAL(s[0].depth, 3U);
+    CU_ASSERT_EQUAL(s[0].pc[0], 0x00101000U);
+    CU_ASSERT_EQUAL(s[0].pc[1], 0x00101111U);
+    CU_ASSERT_EQUAL(s[0].pc[2], 0x00102222U);
+}
+
+static void test_samples_every_nth_tick(void)
+{
+    fake_t f;
+    fake_init(&f);
+    CU_ASSERT_TRUE(prof_start(4));
+    for (int i = 0; i < 10; i++) prof_tick(&f.frame);
+    CU_ASSERT_EQUAL(prof_stats()->samples, 2U);
+
+    prof_stop();
+    for (int i = 0; i < 10; i++) prof_tick(&f.frame);
+    CU_ASSERT_EQUAL(prof_stats()->samples, 2U);
+    CU_ASSERT_FALSE(prof_running());
+}
+
+static void test_bad_frame_pointer_ends_walk(void)
+{
+    fake_t f;
+    uint32_t n;
+    const prof_sample_t *s;
+    CU_ASSERT_TRUE(prof_start(1));
+
+    fake_init(&f);
+    f.frame.ebp = 0xFEE00000;                   // local APIC MMIO
+    prof_tick(&f.frame);
+
+    fake_init(&f);
+    f.frame.ebp = (uint32_t)f.stack - 64;       // below the stack pointer
+    prof_tick(&f.frame);
+
+    fake_init(&f);
+    f.frame.ebp = VMM_WINDOW_BASE + VMM_WINDOW_SIZE - PAGE_SIZE;  // unmapped
+    f.frame.esp = f.frame.ebp - 64;
+    prof_tick(&f.frame);
+
+    fake_init(&f);
+    f.stack[0] += 2 * PROF_MAX_FRAME;           // implausibly large frame
+    prof_tick(&f.frame);
+    prof_stop();
+
+    s = prof_samples(&n);
+    CU_ASSERT_EQUAL(n, 4U);
+    CU_ASSERT_EQUAL(s[0].depth, 1U);
+    CU_ASSERT_EQUAL(s[1].depth, 1U);
+    CU_ASSERT_EQUAL(s[2].depth, 1U);
+    CU_ASSERT_EQUAL(s[3].depth, 2U);
+}
+
+static void test_full_buffer_counts_drops(void)
+{
+    fake_t f;
+    fake_init(&f);
+    CU_ASSERT_TRUE(prof_start(1));
+    for (uint32_t i = 0; i < PROF_MAX_SAMPLES + 3; i++) prof_tick(&f.frame);
+    prof_stop();
+
+    CU_ASSERT_EQUAL(prof_stats()->samples, (uint32_t)PROF_MAX_SAMPLES);
+    CU_ASSERT_EQUAL(prof_stats()->dropped, 3U);
+    CU_ASSERT_FALSE(prof_start(0));
+}
+
+void suite_prof_tests(CU_pSuite s)
+{
+    CU_add_test(s, "records_eip_and_callers",   test_records_eip_and_callers);
+    CU_add_test(s, "samples_every_nth_tick",    test_samples_every_nth_tick);
+    CU_add_test(s, "bad_frame_pointer_ends_walk", test_bad_frame_pointer_ends_walk);
+    CU_add_test(s, "full_buffer_counts_drops",  test_full_buffer_counts_drops);
+}
@@ -0,0 +1,265 @@
+/*
+ * test_ps2_k.c — Kernel-side CUnit tests for the PS/2 keyboard decoder.
+ *
+ * Feeds raw Set 1 / Set 2 scancode bytes through ps2_process_scancode() and
+ * checks the event queue and the key-state snapshot.
+ */
+
+#include "kunit.h"
+#include "ps2.h"
+
+#define SC_W        0x11
+#define SC_A        0x1E
+#define SC_LSHIFT   0x2A
+#define SC_BREAK    0x80
+
+static void drain(void)
+{
+    kbd_event_t ev;
+    while (kbd_dequeue(&ev))
+        ;
+}
+
+int suite_ps2_init(void)
+{
+    ps2_set_verbose(false);
+    drain();
+    return 0;
+}
+
+int suite_ps2_cleanup(void)
+{
+    drain();
+    ps2_set_verbose(true);
+    return 0;
+}
+
+static void test_make_break_events(void)
+{
+    kbd_event_t ev;
+
+    drain();
+    ps2_process_scancode(SC_W);
+    ps2_process_scancode(SC_W | SC_BREAK);
+
+    CU_ASSERT_EQUAL(kbd_dequeue(&ev), 1);
+    CU_ASSERT_EQUAL(ev.key, KEY_W);
+    CU_ASSERT_EQUAL(ev.pressed, 1);
+    CU_ASSERT_EQUAL(kbd_dequeue(&ev), 1);
+    CU_ASSERT_EQUAL(ev.key, KEY_W);
+    CU_ASSERT_EQUAL(ev.pressed, 0);
+    CU_ASSERT_EQUAL(kbd_dequeue(&ev), 0);
+}
+
+static void test_state_tracks_held_keys(void)
+{
+    kbd_state_t st;
+
+    drain();
+    ps2_process_scancode(SC_W);
+    ps2_process_scancode(SC_A);
+    ps2_process_scancode(SC_LSHIFT);
+
+    CU_ASSERT_EQUAL(exo_kbd_state(&st), 1);
+    CU_ASSERT_TRUE(kbd_state_key_down(&st, KEY_W));
+    CU_ASSERT_TRUE(kbd_state_key_down(&st, KEY_A));
+    CU_ASSERT_TRUE(kbd_state_key_down(&st, KEY_SHIFT_LEFT));
+    CU_ASSERT_FALSE(kbd_state_key_down(&st, KEY_D));
+    CU_ASSERT_NOT_EQUAL(st.modifiers, 0);
+
+    ps2_process_scancode(SC_W | SC_BREAK);
+    ps2_process_scancode(SC_LSHIFT | SC_BREAK);
+    exo_kbd_state(&st);
+    CU_ASSERT_FALSE(kbd_state_key_down(&st, KEY_W));
+    CU_ASSERT_TRUE(kbd_state_key_down(&st, KEY_A));
+    CU_ASSERT_EQUAL(st.modifiers, 0);
+
+    ps2_process_scancode(SC_A | SC_BREAK);
+    drain();
+}
+
+static void test_state_independent_of_queue(void)
+{
+    kbd_state_t st;
+
+    /* Consuming the events must not change what is held. */
+    ps2_process_scancode(SC_W);
+    drain();
+    exo_kbd_state(&st);
+    CU_ASSERT_TRUE(kbd_state_key_down(&st, KEY_W));
+
+    ps2_process_scancode(SC_W | SC_BREAK);
+    drain();
+}
+
+static void test_full_queue_counts_drops(void)
+{
+    kbd_state_t st;
+    uint32_t before = kbd_dropped_events();
+    unsigned queued = 0, i;
+    kbd_event_t ev;
+
+    drain();
+    for (i = 0; i < 70; i++)
+        ps2_process_scancode(SC_A);
+
+    while (kbd_dequeue(&ev))
+        queued++;
+
+    CU_ASSERT_EQUAL(queued + (kbd_dropped_events() - before), 70U);
+    CU_ASSERT(kbd_dropped_events() > before);
+    exo_kbd_state(&st);
+    CU_ASSERT_EQUAL(st.dropped, kbd_dropped_events());
+
+    ps2_process_scancode(SC_A | SC_BREAK);
+    drain();
+}
+
+/* Feed a byte sequence and expect exactly the listed (key, pressed) events. */
+static void expect_events(const uint8_t *bytes, unsigned n,
+                          const uint8_t *keys, const uint8_t *pressed,
+                          unsigned n_events)
+{
+    kbd_event_t ev;
+    unsigned i;
+
+    drain();
+    for (i = 0; i < n; i++)
+        ps2_process_scancode(bytes[i]);
+
+    for (i = 0; i < n_events; i++) {
+        CU_ASSERT_EQUAL(kbd_dequeue(&ev), 1);
+        CU_ASSERT_EQUAL(ev.key, keys[i]);
+        CU_ASSERT_EQUAL(ev.pressed, pressed[i]);
+    }
+    CU_ASSERT_EQUAL(kbd_dequeue(&ev), 0);
+}
+
+static void test_set1_digits_and_fkeys(void)
+{
+    static const uint8_t bytes[]   = { 0x02, 0x82, 0x0B, 0x8B, 0x44, 0xC4, 0x58, 0xD8 };
+    static const uint8_t keys[]    = { KEY_1, KEY_1, KEY_0, KEY_0,
+                                       KEY_F10, KEY_F10, KEY_F12, KEY_F12 };
+    static const uint8_t pressed[] = { 1, 0, 1, 0, 1, 0, 1, 0 };
+
+    expect_events(bytes, 8, keys, pressed, 8);
+}
+
+static void test_set1_extended_make_break(void)
+{
+    /* Right Ctrl, then keypad Enter vs main Enter. */
+    static const uint8_t bytes[]   = { 0xE0, 0x1D, 0xE0, 0x9D, 0xE0, 0x1C, 0x1C };
+    static const uint8_t keys[]    = { KEY_CTRL_RIGHT, KEY_CTRL_RIGHT,
+                                       KEY_KP_ENTER, KEY_ENTER };
+    static const uint8_t pressed[] = { 1, 0, 1, 1 };
+    kbd_state_t st;
+
+    ps2_process_scancode(0xE0);
+    ps2_process_scancode(0x1D);
+    CU_ASSERT_TRUE(ps2_ctrl_active());
+    exo_kbd_state(&st);
+    CU_ASSERT_EQUAL(st.modifiers, MOD_RCTRL);
+    ps2_process_scancode(0xE0);
+    ps2_process_scancode(0x9D);
+    CU_ASSERT_FALSE(ps2_ctrl_active());
+
+    expect_events(bytes, 7, keys, pressed, 4);
+    ps2_process_scancode(0xE0);
+    ps2_process_scancode(0x9C);
+    ps2_process_scancode(0x9C);
+    drain();
+}
+
+static void test_set1_print_screen_and_pause(void)
+{
+    /* Print Screen make + break; the 0xE0 0x2A / 0xE0 0xAA fake shifts
+       must not show up as Shift. */
+    static const uint8_t prtsc[]    = { 0xE0, 0x2A, 0xE0, 0x37, 0xE0, 0xB7, 0xE0, 0xAA };
+    static const uint8_t prtsc_k[]  = { KEY_PRINT_SCREEN, KEY_PRINT_SCREEN };
+    static const uint8_t prtsc_p[]  = { 1, 0 };
+    static const uint8_t pause[]    = { 0xE1, 0x1D, 0x45, 0xE1, 0x9D, 0xC5 };
+    static const uint8_t pause_k[]  = { KEY_PAUSE, KEY_PAUSE };
+    static const uint8_t pause_p[]  = { 1, 0 };
+
+    expect_events(prtsc, 8, prtsc_k, prtsc_p, 2);
+    CU_ASSERT_FALSE(ps2_shift_active());
+    expect_events(pause, 6, pause_k, pause_p, 2);
+
+    /* The decoder is back in sync afterwards. */
+    ps2_process_scancode(SC_W);
+    ps2_process_scancode(SC_W | SC_BREAK);
+    drain();
+}
+
+static void test_set2_decoding(void)
+{
+    /* W make/break, F7 (0x83), right Alt (E0 11 / E0 F0 11), up arrow. */
+    static const uint8_t bytes[]   = { 0x1D, 0xF0, 0x1D, 0x83, 0xF0, 0x83,
+                                       0xE0, 0x11, 0xE0, 0xF0, 0x11,
+                                       0xE0, 0x75, 0xE0, 0xF0, 0x75, 0xFA };
+    static const uint8_t keys[]    = { KEY_W, KEY_W, KEY_F7, KEY_F7,
+                                       KEY_ALT_RIGHT, KEY_ALT_RIGHT, KEY_UP, KEY_UP };
+    static const uint8_t pressed[] = { 1, 0, 1, 0, 1, 0, 1, 0 };
+    static const uint8_t pause[]   = { 0xE1, 0x14, 0x77, 0xE1, 0xF0, 0x14, 0xF0, 0x77 };
+    static const uint8_t pause_k[] = { KEY_PAUSE, KEY_PAUSE };
+    static const uint8_t pause_p[] = { 1, 0 };
+
+    CU_ASSERT_FALSE(ps2_set_scancode_set(3));
+    CU_ASSERT_TRUE(ps2_set_scancode_set(2));
+    CU_ASSERT_EQUAL(ps2_get_scancode_set(), 2);
+
+    expect_events(bytes, sizeof(bytes), keys, pressed, 8);
+    expect_events(pause, sizeof(pause), pause_k, pause_p, 2);
+
+    ps2_set_scancode_set(1);
+}
+
+static void test_latency_histograms(void)
+{
+    const kbd_latency_stats_t *lat = kbd_latency_stats();
+    uint32_t depth_before, residency_before;
+    kbd_event_t ev;
+
+    drain();
+    kbd_latency_reset();
+    CU_ASSERT_EQUAL(lat->depth.count, 0U);
+    CU_ASSERT_EQUAL(lat->residency.count, 0U);
+
+    ps2_process_scancode(SC_W);
+    ps2_process_scancode(SC_W | SC_BREAK);
+    depth_before = lat->depth.count;
+    residency_before = lat->residency.count;
+    CU_ASSERT_EQUAL(depth_before, 2U);
+    CU_ASSERT_EQUAL(lat->depth.max, 1U);    /* second event saw one queued */
+    CU_ASSERT_EQUAL(residency_before, 0U);
+
+    CU_ASSERT_EQUAL(kbd_dequeue(&ev), 1);
+    CU_ASSERT_NOT_EQUAL(ev.tsc, 0);
+    CU_ASSERT_EQUAL(kbd_dequeue(&ev), 1);
+    CU_ASSERT_EQUAL(lat->residency.count, 2U);
+    CU_ASSERT(lat->residency.max > 0);
+
+    /* Empty polls are not samples. */
+    CU_ASSERT_EQUAL(kbd_dequeue(&ev), 0);
+    CU_ASSERT_EQUAL(lat->residency.count, 2U);
+}
+
+static void test_null_args(void)
+{
+    CU_ASSERT_EQUAL(exo_kbd_state(NULL), 0);
+    CU_ASSERT_EQUAL(exo_kbd_poll(NULL), 0);
+}
+
+void suite_ps2_tests(CU_pSuite s)
+{
+    CU_add_test(s, "make_break_events",          test_make_break_events);
+    CU_add_test(s, "state_tracks_held_keys",     test_state_tracks_held_keys);
+    CU_add_test(s, "state_independent_of_queue", test_state_independent_of_queue);
+    CU_add_test(s, "full_queue_counts_drops",    test_full_queue_counts_drops);
+    CU_add_test(s, "set1_digits_and_fkeys",      test_set1_digits_and_fkeys);
+    CU_add_test(s, "set1_extended_make_break",   test_set1_extended_make_break);
+    CU_add_test(s, "set1_print_screen_and_pause", test_set1_print_screen_and_pause);
+    CU_add_test(s, "set2_decoding",              test_set2_decoding);
+    CU_add_test(s, "latency_histograms",         test_latency_histograms);
+    CU_add_test(s, "null_args",                  test_null_args);
+}
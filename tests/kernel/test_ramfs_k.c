@@ -0,0 +1,240 @@
+/*
+ * test_ramfs_k.c — Kernel-side CUnit tests for the RAM disk.
+ *
+ * Each test starts from an empty filesystem (ramfs_init) and checks the
+ * page allocator gets every extent back.
+ */
+
+#include "kunit.h"
+#include "ramfs.h"
+#include "pmm.h"
+#include "syscall.h"
+#include "string.h"
+
+static uint8_t buf[4096];
+
+static void test_open_modes(void)
+{
+    int32_t fd;
+
+    ramfs_init();
+    CU_ASSERT_EQUAL(ramfs_open("missing.cfg", EXO_O_READ), -EXO_ENOENT);
+    CU_ASSERT_EQUAL(ramfs_open("missing.cfg", EXO_O_RDWR), -EXO_ENOENT);
+    CU_ASSERT_EQUAL(ramfs_open("", EXO_O_WRITE), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(ramfs_open("a_name_that_is_far_too_long_for_it", EXO_O_WRITE),
+                    -EXO_ENAMETOOLONG);
+    CU_ASSERT_EQUAL(ramfs_open("x", 3), -EXO_EINVAL);
+
+    fd = ramfs_open("default.cfg", EXO_O_WRITE);
+    CU_ASSERT_TRUE(fd >= 0);
+    CU_ASSERT_EQUAL(ramfs_read(fd, buf, 1), -EXO_EBADF);
+    CU_ASSERT_EQUAL(ramfs_close(fd), 0);
+    CU_ASSERT_EQUAL(ramfs_close(fd), -EXO_EBADF);
+
+    fd = ramfs_open("default.cfg", EXO_O_READ);
+    CU_ASSERT_EQUAL(ramfs_write(fd, "x", 1), -EXO_EBADF);
+    ramfs_close(fd);
+}
+
+static void test_write_read_seek(void)
+{
+    int32_t fd;
+
+    ramfs_init();
+    fd = ramfs_open("doomsav0.dsg", EXO_O_WRITE);
+    CU_ASSERT_EQUAL(ramfs_write(fd, "hello world", 11), 11);
+    ramfs_close(fd);
+
+    fd = ramfs_open("doomsav0.dsg", EXO_O_RDWR);
+    CU_ASSERT_EQUAL(ramfs_seek(fd, 6, EXO_SEEK_SET), 6);
+    CU_ASSERT_EQUAL(ramfs_read(fd, buf, 100), 5);
+    CU_ASSERT_EQUAL(memcmp(buf, "world", 5), 0);
+    CU_ASSERT_EQUAL(ramfs_read(fd, buf, 100), 0);
+
+    CU_ASSERT_EQUAL(ramfs_seek(fd, -5, EXO_SEEK_END), 6);
+    CU_ASSERT_EQUAL(ramfs_write(fd, "W", 1), 1);
+    CU_ASSERT_EQUAL(ramfs_seek(fd, -7, EXO_SEEK_CUR), 0);
+    CU_ASSERT_EQUAL(ramfs_read(fd, buf, 11), 11);
+    CU_ASSERT_EQUAL(memcmp(buf, "hello World", 11), 0);
+    CU_ASSERT_EQUAL(ramfs_seek(fd, -1, EXO_SEEK_SET), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(ramfs_seek(fd, 0, 7), -EXO_EINVAL);
+    ramfs_close(fd);
+}
+
+static void test_write_past_eof_zero_fills(void)
+{
+    uint32_t size = 0;
+    int32_t fd;
+
+    ramfs_init();
+    fd = ramfs_open("gap", EXO_O_WRITE);
+    ramfs_write(fd, "ab", 2);
+    ramfs_seek(fd, 10, EXO_SEEK_SET);
+    ramfs_write(fd, "z", 1);
+    ramfs_close(fd);
+
+    CU_ASSERT_EQUAL(ramfs_stat("gap", &size), 0);
+    CU_ASSERT_EQUAL(size, 11U);
+    fd = ramfs_open("gap", EXO_O_READ);
+    memset(buf, 0xAA, 11);
+    ramfs_read(fd, buf, 11);
+    CU_ASSERT_EQUAL(buf[2], 0);
+    CU_ASSERT_EQUAL(buf[9], 0);
+    CU_ASSERT_EQUAL(buf[10], 'z');
+    ramfs_close(fd);
+}
+
+static void test_extent_grows_geometrically(void)
+{
+    uint32_t free_before;
+    uint32_t i, size = 0;
+    int32_t fd;
+    int ok = 1;
+
+    ramfs_init();
+    free_before = pmm_stats()->free_pages;
+    /* A 200 KB save game written 512 bytes at a time. */
+    fd = ramfs_open("doomsav1.dsg", EXO_O_WRITE);
+    for (i = 0; i < 400; i++) {
+        memset(buf, (int)(i & 0xFF), 512);
+        if (ramfs_write(fd, buf, 512) != 512)
+            ok = 0;
+    }
+    ramfs_close(fd);
+    CU_ASSERT_TRUE(ok);
+    CU_ASSERT_EQUAL(ramfs_stat("doomsav1.dsg", &size), 0);
+    CU_ASSERT_EQUAL(size, 400U * 512U);
+
+    /* 1 -> 2 -> 4 -> ... -> 64 pages: six moves, not four hundred. */
+    CU_ASSERT_TRUE(ramfs_stats()->grows <= 7);
+    CU_ASSERT_TRUE(ramfs_stats()->bytes_moved < 2 * size);
+
+    fd = ramfs_open("doomsav1.dsg", EXO_O_READ);
+    ramfs_seek(fd, 399 * 512, EXO_SEEK_SET);
+    ramfs_read(fd, buf, 512);
+    CU_ASSERT_EQUAL(buf[0], 399 & 0xFF);
+    CU_ASSERT_EQUAL(buf[511], 399 & 0xFF);
+    ramfs_close(fd);
+
+    CU_ASSERT_EQUAL(ramfs_remove("doomsav1.dsg"), 0);
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, free_before);
+}
+
+static void test_remove_keeps_open_file_readable(void)
+{
+    uint32_t free_before;
+    uint32_t size = 0;
+    int32_t fd;
+
+    ramfs_init();
+    free_before = pmm_stats()->free_pages;
+    ramfs_seed("old.dsg", "data", 4);
+    fd = ramfs_open("old.dsg", EXO_O_READ);
+    CU_ASSERT_EQUAL(ramfs_remove("old.dsg"), 0);
+    CU_ASSERT_EQUAL(ramfs_stat("old.dsg", &size), -EXO_ENOENT);
+    CU_ASSERT_EQUAL(ramfs_remove("old.dsg"), -EXO_ENOENT);
+
+    CU_ASSERT_EQUAL(ramfs_read(fd, buf, 4), 4);
+    CU_ASSERT_EQUAL(memcmp(buf, "data", 4), 0);
+    CU_ASSERT_NOT_EQUAL(pmm_stats()->free_pages, free_before);
+    ramfs_close(fd);
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, free_before);
+}
+
+static void test_rename_replaces_target(void)
+{
+    uint32_t free_before;
+    uint32_t size = 0;
+
+    ramfs_init();
+    free_before = pmm_stats()->free_pages;
+    ramfs_seed("doomsav0.dsg", "old save", 8);
+    ramfs_seed("doomsav0.tmp", "new save!", 9);
+
+    CU_ASSERT_EQUAL(ramfs_rename("doomsav0.tmp", "doomsav0.dsg"), 0);
+    CU_ASSERT_EQUAL(ramfs_stat("doomsav0.tmp", &size), -EXO_ENOENT);
+    CU_ASSERT_EQUAL(ramfs_stat("doomsav0.dsg", &size), 0);
+    CU_ASSERT_EQUAL(size, 9U);
+    CU_ASSERT_EQUAL(ramfs_rename("nope", "doomsav0.dsg"), -EXO_ENOENT);
+    CU_ASSERT_EQUAL(ramfs_rename("doomsav0.dsg", "doomsav0.dsg"), 0);
+
+    ramfs_remove("doomsav0.dsg");
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, free_before);
+}
+
+static void test_descriptor_and_file_limits(void)
+{
+    int32_t fds[RAMFS_MAX_FDS];
+    char name[4] = "f00";
+    uint32_t i;
+
+    ramfs_init();
+    ramfs_seed("shared", "x", 1);
+    for (i = 0; i < RAMFS_MAX_FDS; i++)
+        fds[i] = ramfs_open("shared", EXO_O_READ);
+    CU_ASSERT_EQUAL(ramfs_open("shared", EXO_O_READ), -EXO_EMFILE);
+    for (i = 0; i < RAMFS_MAX_FDS; i++)
+        ramfs_close(fds[i]);
+
+    for (i = 1; i < RAMFS_MAX_FILES; i++) {
+        name[1] = (char)('0' + i / 10);
+        name[2] = (char)('0' + i % 10);
+        ramfs_seed(name, "", 0);
+    }
+    CU_ASSERT_EQUAL(ramfs_seed("onemore", "", 0), -EXO_ENOSPC);
+    ramfs_init();
+}
+
+static void test_index_survives_churn(void)
+{
+    uint32_t i, size = 0;
+    int ok = 1;
+
+    ramfs_init();
+    ramfs_seed("keep.cfg", "k", 1);
+    /* Enough removes to force several tombstone compactions. */
+    for (i = 0; i < 200; i++) {
+        ramfs_seed("churn.tmp", "c", 1);
+        if (ramfs_rename("churn.tmp", "churn.dsg") != 0)
+            ok = 0;
+        if (ramfs_remove("churn.dsg") != 0)
+            ok = 0;
+    }
+    CU_ASSERT_TRUE(ok);
+    CU_ASSERT_EQUAL(ramfs_stat("keep.cfg", &size), 0);
+    CU_ASSERT_EQUAL(ramfs_stat("churn.dsg", &size), -EXO_ENOENT);
+    ramfs_init();
+}
+
+static void test_file_syscalls(void)
+{
+    static uint32_t size;
+    int32_t fd;
+
+    ramfs_init();
+    fd = syscall_dispatch(EXO_SYS_FILE_OPEN, (uint32_t)"s.cfg", EXO_O_WRITE, 0, 0, 0);
+    CU_ASSERT_TRUE(fd >= 0);
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_FILE_WRITE, fd, (uint32_t)"abc", 3, 0, 0), 3);
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_FILE_WRITE, fd, 0, 3, 0, 0), -EXO_EFAULT);
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_FILE_SEEK, fd, 1, EXO_SEEK_SET, 0, 0), 1);
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_FILE_CLOSE, fd, 0, 0, 0, 0), 0);
+
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_FILE_STAT, (uint32_t)"s.cfg", (uint32_t)&size, 0, 0, 0), 0);
+    CU_ASSERT_EQUAL(size, 3U);
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_FILE_RENAME, (uint32_t)"s.cfg", (uint32_t)"t.cfg", 0, 0, 0), 0);
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_FILE_REMOVE, (uint32_t)"t.cfg", 0, 0, 0, 0), 0);
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_FILE_OPEN, 0, EXO_O_READ, 0, 0, 0), -EXO_EFAULT);
+}
+
+void suite_ramfs_tests(CU_pSuite s)
+{
+    CU_add_test(s, "open_modes",                  test_open_modes);
+    CU_add_test(s, "write_read_seek",             test_write_read_seek);
+    CU_add_test(s, "write_past_eof_zero_fills",   test_write_past_eof_zero_fills);
+    CU_add_test(s, "extent_grows_geometrically",  test_extent_grows_geometrically);
+    CU_add_test(s, "remove_keeps_open_file_readable", test_remove_keeps_open_file_readable);
+    CU_add_test(s, "rename_replaces_target",      test_rename_replaces_target);
+    CU_add_test(s, "descriptor_and_file_limits",  test_descriptor_and_file_limits);
+    CU_add_test(s, "index_survives_churn",        test_index_survives_churn);
+    CU_add_test(s, "file_syscalls",               test_file_syscalls);
+}
@@ -0,0 +1,143 @@
+/*
+ * test_ring_k.c — Kernel-side CUnit tests for the SPSC ring in src/ring.h.
+ *
+ * Uses a small private ring type so wrap-around is reached in a few
+ * operations; the kbd and serial rings are instantiations of the same code.
+ */
+
+#include "kunit.h"
+#include "ring.h"
+
+#define TEST_RING_SIZE 8
+
+RING_DEFINE(test_ring, uint32_t, TEST_RING_SIZE)
+
+static test_ring_t ring;
+
+static void test_push_pop_fifo(void)
+{
+    uint32_t v = 0;
+
+    test_ring_init(&ring);
+    CU_ASSERT_FALSE(test_ring_pop(&ring, &v));
+
+    v = 1; CU_ASSERT_TRUE(test_ring_push(&ring, &v));
+    v = 2; CU_ASSERT_TRUE(test_ring_push(&ring, &v));
+    v = 3; CU_ASSERT_TRUE(test_ring_push(&ring, &v));
+    CU_ASSERT_EQUAL(test_ring_count(&ring), 3U);
+
+    CU_ASSERT_TRUE(test_ring_pop(&ring, &v));
+    CU_ASSERT_EQUAL(v, 1U);
+    CU_ASSERT_TRUE(test_ring_pop(&ring, &v));
+    CU_ASSERT_EQUAL(v, 2U);
+    CU_ASSERT_TRUE(test_ring_pop(&ring, &v));
+    CU_ASSERT_EQUAL(v, 3U);
+    CU_ASSERT_FALSE(test_ring_pop(&ring, &v));
+    CU_ASSERT_EQUAL(test_ring_count(&ring), 0U);
+}
+
+static void test_full_ring_counts_overflow(void)
+{
+    uint32_t i, v = 0;
+
+    test_ring_init(&ring);
+    for (i = 0; i < TEST_RING_SIZE; i++)
+        CU_ASSERT_TRUE(test_ring_push(&ring, &i));
+
+    v = 99;
+    CU_ASSERT_FALSE(test_ring_push(&ring, &v));
+    CU_ASSERT_EQUAL(ring.overflows, 1U);
+    CU_ASSERT_EQUAL(ring.high_watermark, (uint32_t)TEST_RING_SIZE);
+    CU_ASSERT_EQUAL(test_ring_count(&ring), (uint32_t)TEST_RING_SIZE);
+
+    /* The refused item must not have overwritten the oldest one. */
+    CU_ASSERT_TRUE(test_ring_pop(&ring, &v));
+    CU_ASSERT_EQUAL(v, 0U);
+}
+
+static void test_wraps_around_buffer_end(void)
+{
+    uint32_t round, i, v = 0;
+    uint32_t next_in = 0, next_out = 0;
+    int in_order = 1;
+
+    test_ring_init(&ring);
+    /* Odd-sized batches so head and tail cross the end of items[] at
+       different offsets each round. */
+    for (round = 0; round < 10; round++) {
+        for (i = 0; i < 5; i++) {
+            CU_ASSERT_TRUE(test_ring_push(&ring, &next_in));
+            next_in++;
+        }
+        for (i = 0; i < 5; i++) {
+            CU_ASSERT_TRUE(test_ring_pop(&ring, &v));
+            if (v != next_out++)
+                in_order = 0;
+        }
+    }
+
+    CU_ASSERT_TRUE(in_order);
+    CU_ASSERT_EQUAL(test_ring_count(&ring), 0U);
+    CU_ASSERT_EQUAL(ring.overflows, 0U);
+    CU_ASSERT_EQUAL(ring.high_watermark, 5U);
+}
+
+static void test_wraps_around_counter_overflow(void)
+{
+    uint32_t i, v = 0;
+
+    /* Start the free-running indices just below 2^32. */
+    test_ring_init(&ring);
+    ring.head = 0xFFFFFFFDu;
+    ring.tail = 0xFFFFFFFDu;
+
+    for (i = 0; i < TEST_RING_SIZE; i++)
+        CU_ASSERT_TRUE(test_ring_push(&ring, &i));
+    CU_ASSERT_EQUAL(test_ring_count(&ring), (uint32_t)TEST_RING_SIZE);
+    CU_ASSERT_FALSE(test_ring_push(&ring, &i));
+
+    for (i = 0; i < TEST_RING_SIZE; i++) {
+        CU_ASSERT_TRUE(test_ring_pop(&ring, &v));
+        CU_ASSERT_EQUAL(v, i);
+    }
+    CU_ASSERT_EQUAL(test_ring_count(&ring), 0U);
+}
+
+static void test_batch_push_pop(void)
+{
+    uint32_t in[TEST_RING_SIZE + 3], out[TEST_RING_SIZE + 3];
+    uint32_t i, v = 0;
+
+    for (i = 0; i < TEST_RING_SIZE + 3; i++)
+        in[i] = 100 + i;
+
+    test_ring_init(&ring);
+    /* Offset the indices so the batch copy straddles the end of items[]. */
+    for (i = 0; i < 6; i++) {
+        test_ring_push(&ring, &i);
+        test_ring_pop(&ring, &v);
+    }
+
+    CU_ASSERT_EQUAL(test_ring_push_n(&ring, in, TEST_RING_SIZE + 3),
+                    (uint32_t)TEST_RING_SIZE);
+    CU_ASSERT_EQUAL(ring.overflows, 3U);
+
+    CU_ASSERT_EQUAL(test_ring_pop_n(&ring, out, 3), 3U);
+    CU_ASSERT_EQUAL(out[0], 100U);
+    CU_ASSERT_EQUAL(out[2], 102U);
+
+    CU_ASSERT_EQUAL(test_ring_pop_n(&ring, out, TEST_RING_SIZE + 3),
+                    (uint32_t)TEST_RING_SIZE - 3);
+    CU_ASSERT_EQUAL(out[0], 103U);
+    CU_ASSERT_EQUAL(out[TEST_RING_SIZE - 4], 100U + TEST_RING_SIZE - 1);
+    CU_ASSERT_EQUAL(test_ring_pop_n(&ring, out, 1), 0U);
+}
+
+void suite_ring_tests(CU_pSuite s)
+{
+    CU_add_test(s, "push_pop_fifo",              test_push_pop_fifo);
+    CU_add_test(s, "full_ring_counts_overflow",  test_full_ring_counts_overflow);
+    CU_add_test(s, "wraps_around_buffer_end",    test_wraps_around_buffer_end);
+    CU_add_test(s, "wraps_around_counter_overflow", test_wraps_around_counter_overflow);
+    CU_add_test(s, "batch_push_pop",             test_batch_push_pop);
+}
@@ -8,28 +8,99 @@
  */
 
 #include "kunit.h"
+#include "serial.h"
 
 /* Suite registration functions defined in their respective test files. */
 void suite_smoke_tests (CU_pSuite s);
 void suite_string_tests(CU_pSuite s);
 void suite_ctype_tests (CU_pSuite s);
+void suite_defer_tests (CU_pSuite s);
+void suite_ring_tests  (CU_pSuite s);
+void suite_irqmon_tests(CU_pSuite s);
+void suite_ps2_tests   (CU_pSuite s);
+int  suite_ps2_init    (void);
+int  suite_ps2_cleanup (void);
+void suite_mouse_tests (CU_pSuite s);
+void suite_kcmd_tests  (CU_pSuite s);
+void suite_syscall_tests(CU_pSuite s);
+void suite_vdata_tests (CU_pSuite s);
+void suite_submit_tests(CU_pSuite s);
+void suite_wad_tests   (CU_pSuite s);
+void suite_pmm_tests   (CU_pSuite s);
+void suite_ramfs_tests (CU_pSuite s);
+void suite_bcache_tests(CU_pSuite s);
+void suite_serial_tests(CU_pSuite s);
+void suite_speaker_tests(CU_pSuite s);
+int  suite_speaker_init(void);
+int  suite_speaker_cleanup(void);
+void suite_mixer_tests(CU_pSuite s);
+void suite_smp_tests(CU_pSuite s);
+void suite_sched_tests(CU_pSuite s);
+void suite_fpu_tests(CU_pSuite s);
+int  suite_fpu_init(void);
+void suite_vmm_tests(CU_pSuite s);
+void suite_elf_tests(CU_pSuite s);
+void suite_prof_tests(CU_pSuite s);
+void suite_trace_tests(CU_pSuite s);
+void suite_init_tests(CU_pSuite s);
+
+/* Registered and run in this order. */
+static const struct {
+    const char*       name;
+    CU_InitializeFunc init;
+    CU_CleanupFunc    cleanup;
+    void            (*add)(CU_pSuite s);
+} suites[] = {
+    { "smoke",   NULL,               NULL,                  suite_smoke_tests },
+    { "string",  NULL,               NULL,                  suite_string_tests },
+    { "ctype",   NULL,               NULL,                  suite_ctype_tests },
+    { "defer",   NULL,               NULL,                  suite_defer_tests },
+    { "ring",    NULL,               NULL,                  suite_ring_tests },
+    { "irqmon",  NULL,               NULL,                  suite_irqmon_tests },
+    { "ps2",     suite_ps2_init,     suite_ps2_cleanup,     suite_ps2_tests },
+    { "mouse",   NULL,               NULL,                  suite_mouse_tests },
+    { "kcmd",    NULL,               NULL,                  suite_kcmd_tests },
+    { "syscall", NULL,               NULL,                  suite_syscall_tests },
+    { "vdata",   NULL,               NULL,                  suite_vdata_tests },
+    { "submit",  NULL,               NULL,                  suite_submit_tests },
+    { "wad",     NULL,               NULL,                  suite_wad_tests },
+    { "pmm",     NULL,               NULL,                  suite_pmm_tests },
+    { "ramfs",   NULL,               NULL,                  suite_ramfs_tests },
+    { "bcache",  NULL,               NULL,                  suite_bcache_tests },
+    { "serial",  NULL,               NULL,                  suite_serial_tests },
+    { "speaker", suite_speaker_init, suite_speaker_cleanup, suite_speaker_tests },
+    { "mixer",   NULL,               NULL,                  suite_mixer_tests },
+    { "smp",     NULL,               NULL,                  suite_smp_tests },
+    { "sched",   NULL,               NULL,                  suite_sched_tests },
+    { "fpu",     suite_fpu_init,     NULL,                  suite_fpu_tests },
+    { "vmm",     NULL,               NULL,                  suite_vmm_tests },
+    { "elf",     NULL,               NULL,                  suite_elf_tests },
+    { "prof",    NULL,               NULL,                  suite_prof_tests },
+    { "trace",   NULL,               NULL,                  suite_trace_tests },
+    { "init",    NULL,               NULL,                  suite_init_tests },
+    /* ADD NEW SUITES HERE: declare suite_*_tests above, then list it. */
+};
+
+_Static_assert(sizeof(suites) / sizeof(suites[0]) <= KUNIT_MAX_SUITES,
+               "raise KUNIT_MAX_SUITES in kunit.h");
 
 int run_tests(void)
 {
-    CU_pSuite s;
-
     CU_initialize_registry();
 
-    s = CU_add_suite("smoke",  NULL, NULL);
-    suite_smoke_tests(s);
-
-    s = CU_add_suite("string", NULL, NULL);
-    suite_string_tests(s);
-
-    s = CU_add_suite("ctype",  NULL, NULL);
-    suite_ctype_tests(s);
-
-    /* ADD NEW SUITES HERE: declare suite_*_tests above, then register it. */
+    /* A suite or test past the kunit limits is dropped with CUE_NOMEMORY;
+       fail the run rather than report success for tests that never ran. */
+    for (unsigned i = 0; i < sizeof(suites) / sizeof(suites[0]); i++) {
+        CU_pSuite s = CU_add_suite(suites[i].name, suites[i].init,
+                                   suites[i].cleanup);
+        if (s) suites[i].add(s);
+        if (!s || CU_get_error() != CUE_SUCCESS) {
+            serial_print("kunit: cannot register suite ");
+            serial_print(suites[i].name);
+            serial_print("\n");
+            return 1;
+        }
+    }
 
     CU_run_all_tests();
 
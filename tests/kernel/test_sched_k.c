@@ -0,0 +1,235 @@
+/*
+ * test_sched_k.c — Kernel-side CUnit tests for the cooperative scheduler.
+ *
+ * The tests run as kmain with interrupts off and the PIT stopped, so the
+ * clock reads 0 and time only moves when a test calls sched_tick() itself.
+ * Every test leaves no other context behind.
+ */
+
+#include "kunit.h"
+#include "sched.h"
+#include "syscall.h"
+#include "pmm.h"
+#include "gdt.h"
+#include "vmm.h"
+#include "string.h"
+
+static char trace[32];
+static uint32_t trace_len;
+
+static void trace_add(char c)
+{
+    if (trace_len < sizeof(trace) - 1) trace[trace_len++] = c;
+    trace[trace_len] = '\0';
+}
+
+static void trace_reset(void)
+{
+    trace_len = 0;
+    trace[0] = '\0';
+}
+
+/* Run the other contexts until none is runnable. */
+static void drain(void)
+{
+    while (sched_yield()) {}
+}
+
+static void yield_three_times(void* arg)
+{
+    for (int i = 0; i < 3; i++) {
+        trace_add(*(const char*)arg);
+        sched_yield();
+    }
+}
+
+static void test_yield_round_robin(void)
+{
+    static const char a = 'a', b = 'b';
+    uint32_t free_before = pmm_stats()->free_pages;
+
+    trace_reset();
+    int32_t ia = sched_spawn("a", yield_three_times, (void*)&a);
+    int32_t ib = sched_spawn("b", yield_three_times, (void*)&b);
+    CU_ASSERT_TRUE(ia > 0);
+    CU_ASSERT_TRUE(ib > 0 && ib != ia);
+    CU_ASSERT_EQUAL(sched_context(ia)->state, CTX_RUNNABLE);
+
+    // kmain joins the rotation behind them: a b kmain a b kmain ...
+    CU_ASSERT_TRUE(sched_yield());
+    CU_ASSERT_STRING_EQUAL(trace, "ab");
+    drain();
+    CU_ASSERT_STRING_EQUAL(trace, "ababab");
+
+    // Both exited and the last switch back here freed the final stack.
+    CU_ASSERT_PTR_NULL(sched_context(ia));
+    CU_ASSERT_PTR_NULL(sched_context(ib));
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, free_before);
+    CU_ASSERT_FALSE(sched_yield());
+}
+
+static void sleep_then_trace(void* arg)
+{
+    uint32_t ms = (uint32_t)arg;
+    sched_sleep_ms(ms);
+    trace_add((char)('0' + ms / 10));
+}
+
+static void test_sleepers_wake_by_deadline(void)
+{
+    trace_reset();
+    int32_t i30 = sched_spawn("s30", sleep_then_trace, (void*)30);
+    int32_t i10 = sched_spawn("s10", sleep_then_trace, (void*)10);
+    int32_t i20 = sched_spawn("s20", sleep_then_trace, (void*)20);
+
+    // Each runs up to its sleep; then nothing but kmain is runnable.
+    CU_ASSERT_TRUE(sched_yield());
+    CU_ASSERT_FALSE(sched_yield());
+    CU_ASSERT_EQUAL(sched_context(i10)->state, CTX_SLEEPING);
+    CU_ASSERT_EQUAL(sched_context(i10)->wake_ms, 10U);
+
+    // Asleep means off the run queue: no switch-ins until the deadline.
+    sched_tick(9);
+    CU_ASSERT_FALSE(sched_yield());
+    CU_ASSERT_EQUAL(sched_context(i10)->switches, 1U);
+
+    sched_tick(15);
+    CU_ASSERT_EQUAL(sched_context(i10)->state, CTX_RUNNABLE);
+    CU_ASSERT_EQUAL(sched_context(i20)->state, CTX_SLEEPING);
+    drain();
+    CU_ASSERT_STRING_EQUAL(trace, "1");
+
+    // One tick past both deadlines wakes them earliest first.
+    sched_tick(100);
+    drain();
+    CU_ASSERT_STRING_EQUAL(trace, "123");
+    CU_ASSERT_PTR_NULL(sched_context(i20));
+    CU_ASSERT_PTR_NULL(sched_context(i30));
+}
+
+static void spin_forever_yielding(void* arg)
+{
+    volatile bool* stop = arg;
+    while (!*stop) sched_yield();
+}
+
+static void test_stats_and_limits(void)
+{
+    static volatile bool stop;
+    uint32_t switches = sched_stats()->switches;
+
+    CU_ASSERT_EQUAL(sched_spawn("x", 0, 0), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(sched_spawn(0, spin_forever_yielding, 0), -EXO_EINVAL);
+
+    // Fill every slot but kmain's, then one more.
+    stop = false;
+    int32_t ids[SCHED_MAX_CTX];
+    for (uint32_t i = 1; i < SCHED_MAX_CTX; i++) {
+        ids[i] = sched_spawn("spin", spin_forever_yielding, (void*)&stop);
+        CU_ASSERT_TRUE(ids[i] > 0);
+    }
+    CU_ASSERT_EQUAL(sched_spawn("spin", spin_forever_yielding, (void*)&stop),
+                    -EXO_ENOMEM);
+
+    CU_ASSERT_TRUE(sched_yield());
+    const context_t* c = sched_context(ids[1]);
+    CU_ASSERT_EQUAL(c->switches, 1U);
+    CU_ASSERT_EQUAL(c->yields, 1U);
+    CU_ASSERT_TRUE(c->wait_cycles > 0);
+    CU_ASSERT_TRUE(c->wait_max <= c->wait_cycles);
+    CU_ASSERT_EQUAL(sched_stats()->switches, switches + SCHED_MAX_CTX);
+    CU_ASSERT_TRUE(sched_stats()->switch_max > 0);
+
+    stop = true;
+    drain();
+    for (uint32_t i = 1; i < SCHED_MAX_CTX; i++) {
+        CU_ASSERT_PTR_NULL(sched_context(ids[i]));
+    }
+}
+
+static void trace_once(void* arg)
+{
+    (void)arg;
+    trace_add('y');
+}
+
+static void test_yield_syscall(void)
+{
+    trace_reset();
+    CU_ASSERT_EQUAL(sched_current()->id, 0U);
+    CU_ASSERT_TRUE(sched_spawn("y", trace_once, 0) > 0);
+
+    uint32_t yields = sched_current()->yields;
+    uint32_t calls = syscall_stats(EXO_SYS_YIELD)->calls;
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_YIELD, 0, 0, 0, 0, 0), 0);
+    CU_ASSERT_STRING_EQUAL(trace, "y");
+    CU_ASSERT_EQUAL(sched_current()->yields, yields + 1);
+    CU_ASSERT_EQUAL(syscall_stats(EXO_SYS_YIELD)->calls, calls + 1);
+    drain();
+}
+
+/* Ring-3 code, copied into a user page: yield through int 0x80, push the
+   result where the test can see it, then exit. If exit fails, fault
+   rather than spin where nothing can preempt it. */
+_Static_assert(EXO_SYS_YIELD == 19 && EXO_SYS_EXIT == 20, "ring3_code numbers");
+__asm__ (
+    ".pushsection .text\n"
+    "ring3_code:\n\t"
+    "mov $19, %eax\n\t"
+    "xor %ebx, %ebx\n\t"
+    "int $0x80\n\t"
+    "push %eax\n\t"
+    "mov $20, %eax\n\t"
+    "int $0x80\n\t"
+    "ud2\n"
+    "ring3_code_end:\n"
+    ".popsection\n");
+extern const uint8_t ring3_code[], ring3_code_end[];
+
+static uint32_t user_base;
+
+static void enter_ring3(void* arg)
+{
+    (void)arg;
+    sched_enter_user(user_base, user_base + 2 * PAGE_SIZE);
+}
+
+static void test_yield_from_ring3(void)
+{
+    if (!vmm_enabled()) return;
+
+    CU_ASSERT_EQUAL(vmm_reserve(2 * PAGE_SIZE, &user_base), 0);
+    memcpy((void*)user_base, ring3_code, ring3_code_end - ring3_code);
+    volatile uint32_t* pushed = (uint32_t*)(user_base + 2 * PAGE_SIZE) - 1;
+    *pushed = 0xDEAD;
+
+    uint32_t esp0 = tss_kernel_stack();
+    int32_t id = sched_spawn("ring3", enter_ring3, 0);
+    CU_ASSERT_TRUE(id > 0);
+    const context_t* c = sched_context((uint32_t)id);
+
+    // Down to ring 3, whose int 0x80 lands on the context's own stack, so
+    // the yield switches back here. kmain gets the shared stack back.
+    CU_ASSERT_TRUE(sched_yield());
+    CU_ASSERT_EQUAL(c->yields, 1U);
+    CU_ASSERT_EQUAL(*pushed, 0xDEADu);
+    CU_ASSERT_EQUAL(tss_kernel_stack(), esp0);
+
+    // The yield returns 0 in ring 3, which then exits.
+    CU_ASSERT_TRUE(sched_yield());
+    CU_ASSERT_EQUAL(*pushed, 0U);
+    CU_ASSERT_PTR_NULL(sched_context((uint32_t)id));
+
+    // kmain has no stack of its own to leave from.
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_EXIT, 0, 0, 0, 0, 0), -EXO_EBUSY);
+    CU_ASSERT_EQUAL(vmm_release(user_base), 0);
+}
+
+void suite_sched_tests(CU_pSuite s)
+{
+    CU_add_test(s, "yield_round_robin",        test_yield_round_robin);
+    CU_add_test(s, "sleepers_wake_by_deadline", test_sleepers_wake_by_deadline);
+    CU_add_test(s, "stats_and_limits",         test_stats_and_limits);
+    CU_add_test(s, "yield_syscall",            test_yield_syscall);
+    CU_add_test(s, "yield_from_ring3",         test_yield_from_ring3);
+}
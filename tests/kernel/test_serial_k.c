@@ -0,0 +1,97 @@
+/*
+ * test_serial_k.c — Kernel-side CUnit tests for serial output sinks.
+ *
+ * A capture sink stands in for the virtio console.  It is removed again
+ * before any assertion, since KUnit reports through serial_print too.
+ */
+
+#include "kunit.h"
+#include "serial.h"
+#include "string.h"
+
+static char captured[64];
+static uint32_t captured_len;
+static uint32_t writes;
+static uint32_t flushes;
+static const char* input;
+
+static void capture_write(const char* buf, uint32_t len)
+{
+    writes++;
+    for (uint32_t i = 0; i < len && captured_len < sizeof(captured) - 1; i++) {
+        captured[captured_len++] = buf[i];
+    }
+    captured[captured_len] = '\0';
+}
+
+static void capture_flush(void)
+{
+    flushes++;
+}
+
+static int capture_getc(void)
+{
+    return *input ? (uint8_t)*input++ : -1;
+}
+
+static const serial_sink_t capture = {
+    .name = "capture",
+    .write = capture_write,
+    .flush = capture_flush,
+    .getc = capture_getc,
+};
+
+static void reset_capture(void)
+{
+    captured_len = 0;
+    captured[0] = '\0';
+    writes = flushes = 0;
+    input = "";
+}
+
+static void test_output_goes_to_sink(void)
+{
+    reset_capture();
+    serial_set_sink(&capture);
+    serial_print("abc ");
+    serial_print_u32(42);
+    serial_putc('!');
+    serial_print_hex(0xBEEF);
+    const char* name = serial_sink_name();
+    serial_set_sink(0);
+
+    CU_ASSERT_STRING_EQUAL(captured, "abc 42!0000BEEF");
+    CU_ASSERT_EQUAL(writes, 4U);              // one write per string
+    CU_ASSERT_STRING_EQUAL(name, "capture");
+    CU_ASSERT_STRING_EQUAL(serial_sink_name(), "COM1");
+}
+
+static void test_switching_flushes_the_sink(void)
+{
+    reset_capture();
+    serial_set_sink(&capture);
+    serial_flush();
+    serial_set_sink(0);
+
+    CU_ASSERT_EQUAL(flushes, 2U);             // explicit + on removal
+}
+
+static void test_input_comes_from_sink_first(void)
+{
+    reset_capture();
+    input = "hi";
+    serial_set_sink(&capture);
+    int a = serial_try_getc();
+    int b = serial_try_getc();
+    serial_set_sink(0);
+
+    CU_ASSERT_EQUAL(a, 'h');
+    CU_ASSERT_EQUAL(b, 'i');
+}
+
+void suite_serial_tests(CU_pSuite s)
+{
+    CU_add_test(s, "output_goes_to_sink",      test_output_goes_to_sink);
+    CU_add_test(s, "switching_flushes_the_sink", test_switching_flushes_the_sink);
+    CU_add_test(s, "input_comes_from_sink_first", test_input_comes_from_sink_first);
+}
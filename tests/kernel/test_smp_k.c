@@ -0,0 +1,113 @@
+/*
+ * test_smp_k.c — Kernel-side CUnit tests for per-CPU data, ticket
+ * spinlocks and the parallel job queue.
+ *
+ * The APs are not started under test, so only the BSP runs: parallel
+ * loops still go through the deque (one CPU gets JOBS_PER_CPU chunks),
+ * which checks the splitting and completion logic but not the stealing.
+ */
+
+#include "kunit.h"
+#include "smp.h"
+#include "spinlock.h"
+#include "jobs.h"
+#include "fb.h"
+
+static void test_percpu_through_gs(void)
+{
+    CU_ASSERT_EQUAL(cpu_id(), 0U);
+    CU_ASSERT_EQUAL(this_cpu(), &percpu[0]);
+    CU_ASSERT_EQUAL(this_cpu()->id, 0U);
+    CU_ASSERT_EQUAL(smp_cpu_count(), 1U);
+}
+
+static void test_ticket_lock(void)
+{
+    spinlock_t l = SPINLOCK_INIT("test");
+
+    CU_ASSERT_FALSE(spin_is_locked(&l));
+    spin_lock(&l);
+    CU_ASSERT_TRUE(spin_is_locked(&l));
+    CU_ASSERT_FALSE(spin_trylock(&l));
+    spin_unlock(&l);
+    CU_ASSERT_FALSE(spin_is_locked(&l));
+
+    CU_ASSERT_TRUE(spin_trylock(&l));
+    spin_unlock(&l);
+    uint32_t flags = spin_lock_irqsave(&l);
+    spin_unlock_irqrestore(&l, flags);
+
+    CU_ASSERT_EQUAL(l.acquired, 3U);
+    CU_ASSERT_EQUAL(l.contended, 0U);
+    CU_ASSERT_EQUAL(l.next, 3);
+    CU_ASSERT_EQUAL(l.owner, 3);
+}
+
+static uint8_t visits[1000];
+
+static void count_visits(void* arg, uint32_t begin, uint32_t end)
+{
+    CU_ASSERT_EQUAL(arg, visits);
+    for (uint32_t i = begin; i < end; i++) visits[i]++;
+}
+
+static void test_parallel_for_covers_range(void)
+{
+    jobs_init();
+    uint32_t ran = percpu[0].jobs_run;
+    for (uint32_t i = 0; i < 1000; i++) visits[i] = 0;
+
+    jobs_parallel_for(count_visits, visits, 1000, 10);
+
+    uint32_t once = 0;
+    for (uint32_t i = 0; i < 1000; i++) once += visits[i] == 1;
+    CU_ASSERT_EQUAL(once, 1000U);
+    CU_ASSERT_EQUAL(jobs_stats()->loops, 1U);
+    CU_ASSERT_EQUAL(jobs_stats()->jobs, (uint32_t)JOBS_PER_CPU);
+    CU_ASSERT_EQUAL(percpu[0].jobs_run - ran, (uint32_t)JOBS_PER_CPU);
+    CU_ASSERT_EQUAL(jobs_pending(), 0U);
+    CU_ASSERT_FALSE(jobs_run_one());
+}
+
+static void test_small_loop_runs_inline(void)
+{
+    jobs_init();
+    for (uint32_t i = 0; i < 8; i++) visits[i] = 0;
+
+    jobs_parallel_for(count_visits, visits, 8, 10);
+    jobs_parallel_for(count_visits, visits, 0, 10);
+
+    CU_ASSERT_EQUAL(visits[0], 1);
+    CU_ASSERT_EQUAL(visits[7], 1);
+    CU_ASSERT_EQUAL(jobs_stats()->inline_loops, 1U);
+    CU_ASSERT_EQUAL(jobs_stats()->loops, 0U);
+}
+
+static void test_fb_clear_and_blit(void)
+{
+    static uint32_t pixels[64 * 48];
+    static const uint32_t sprite[8 * 8] = { [0] = 0x00123456, [63] = 0x00ABCDEF };
+    framebuffer_t fb;
+
+    jobs_init();
+    CU_ASSERT_TRUE(fb_init_bgrx8888(&fb, (uintptr_t)pixels, 64 * 4, 64, 48, 32));
+    fb_clear(&fb, 0x11, 0x22, 0x33);
+    CU_ASSERT_EQUAL(pixels[0], 0x00112233U);
+    CU_ASSERT_EQUAL(pixels[64 * 48 - 1], 0x00112233U);
+    CU_ASSERT_EQUAL(jobs_stats()->loops, 1U);         // 48 rows, 2 chunks
+
+    // Clipped to 4 x 8 at the right edge.
+    fb_blit(&fb, 60, 40, sprite, 8 * 4, 8, 8);
+    CU_ASSERT_EQUAL(pixels[40 * 64 + 60], 0x00123456U);
+    CU_ASSERT_EQUAL(pixels[47 * 64 + 63], 0U);         // sprite row 7, col 3
+    CU_ASSERT_EQUAL(pixels[40 * 64 + 59], 0x00112233U);
+}
+
+void suite_smp_tests(CU_pSuite s)
+{
+    CU_add_test(s, "percpu_through_gs",         test_percpu_through_gs);
+    CU_add_test(s, "ticket_lock",               test_ticket_lock);
+    CU_add_test(s, "parallel_for_covers_range", test_parallel_for_covers_range);
+    CU_add_test(s, "small_loop_runs_inline",    test_small_loop_runs_inline);
+    CU_add_test(s, "fb_clear_and_blit",         test_fb_clear_and_blit);
+}
@@ -0,0 +1,186 @@
+/*
+ * test_speaker_k.c — Kernel-side CUnit tests for the PC speaker tone queue.
+ *
+ * The timer is not running under test, so each test drives the queues by
+ * calling speaker_tick() with a synthetic millisecond clock and checks the
+ * divisor on PIT channel 2 at the interesting instants.  The suite cleanup
+ * puts channel 2 and port 0x61 back the way boot left them.
+ */
+
+#include "kunit.h"
+#include "speaker.h"
+#include "syscall.h"
+#include "io.h"
+
+#define DIV(hz) ((uint16_t)((1193182 + (hz) / 2) / (hz)))
+
+#define PIT_CMD      0x43
+#define PIT_CH2      0x42
+#define SPEAKER_PORT 0x61
+
+static uint8_t saved_gates;
+
+int suite_speaker_init(void)
+{
+    saved_gates = inb(SPEAKER_PORT) & 0x03;
+    return 0;
+}
+
+/* Boot leaves channel 2 the way tsc_calibrate() did (mode 0, count
+   expired, OUT2 high) and the gates as speaker_init() set them. The tests
+   switch it to mode 3 and toggle the gates, so re-arm a one-clock mode 0
+   count with the speaker disconnected, let it expire, then restore the
+   gates. */
+int suite_speaker_cleanup(void)
+{
+    speaker_init();
+    outb(SPEAKER_PORT, (inb(SPEAKER_PORT) & ~0x02) | 0x01);
+    outb(PIT_CMD, 0xB0);
+    outb(PIT_CH2, 1);
+    outb(PIT_CH2, 0);
+    while (!(inb(SPEAKER_PORT) & 0x20)) {
+        ;
+    }
+    outb(SPEAKER_PORT, (inb(SPEAKER_PORT) & ~0x03) | saved_gates);
+    return 0;
+}
+
+static void start_at(uint32_t ms)
+{
+    speaker_init();
+    speaker_tick(ms);
+}
+
+static void test_tone_plays_for_its_duration(void)
+{
+    start_at(1000);
+    CU_ASSERT_EQUAL(speaker_divisor(), 0);
+
+    CU_ASSERT_EQUAL(speaker_tone(0, 0, 440, 100), 0);
+    CU_ASSERT_EQUAL(speaker_divisor(), DIV(440));    // starts immediately
+
+    speaker_tick(1099);
+    CU_ASSERT_EQUAL(speaker_divisor(), DIV(440));
+    speaker_tick(1100);
+    CU_ASSERT_EQUAL(speaker_divisor(), 0);
+    CU_ASSERT_EQUAL(speaker_pending(0), 0U);
+}
+
+static void test_queued_tones_do_not_drift(void)
+{
+    start_at(0);
+    speaker_tone(0, 0, 500, 30);
+    speaker_tone(0, 0, 0, 20);                        // rest
+    speaker_tone(0, 0, 1000, 30);
+    CU_ASSERT_EQUAL(speaker_pending(0), 3U);
+
+    // A late tick still starts each tone where the previous one ended.
+    speaker_tick(35);
+    CU_ASSERT_EQUAL(speaker_divisor(), 0);            // in the rest
+    speaker_tick(50);
+    CU_ASSERT_EQUAL(speaker_divisor(), DIV(1000));
+    speaker_tick(79);
+    CU_ASSERT_EQUAL(speaker_divisor(), DIV(1000));
+    speaker_tick(80);
+    CU_ASSERT_EQUAL(speaker_divisor(), 0);
+
+    // Ticks that skip over several tones retire them all at once.
+    speaker_tone(0, 0, 300, 5);
+    speaker_tone(0, 0, 400, 5);
+    speaker_tick(200);
+    CU_ASSERT_EQUAL(speaker_pending(0), 0U);
+    CU_ASSERT_EQUAL(speaker_stats()->finished, 5U);
+}
+
+static void test_priority_preempts_and_resumes(void)
+{
+    start_at(0);
+    speaker_tone(0, 10, 200, 100);                    // long, low priority
+    speaker_tick(10);
+    speaker_tone(1, 50, 800, 20);                     // short, high priority
+    CU_ASSERT_EQUAL(speaker_divisor(), DIV(800));
+
+    // A lower priority tone arriving later does not take over.
+    speaker_tone(2, 5, 1200, 50);
+    CU_ASSERT_EQUAL(speaker_divisor(), DIV(800));
+
+    // When channel 1 ends, channel 0 is still within its 100 ms.
+    speaker_tick(30);
+    CU_ASSERT_EQUAL(speaker_divisor(), DIV(200));
+    speaker_tick(100);
+    CU_ASSERT_EQUAL(speaker_divisor(), 0);            // ch2 ended at 60
+}
+
+static void test_equal_priority_newest_wins(void)
+{
+    start_at(0);
+    speaker_tone(0, 7, 300, 100);
+    speaker_tick(5);
+    speaker_tone(3, 7, 600, 100);
+    CU_ASSERT_EQUAL(speaker_divisor(), DIV(600));
+    speaker_tick(105);
+    CU_ASSERT_EQUAL(speaker_divisor(), 0);
+}
+
+static void test_note_table(void)
+{
+    start_at(0);
+    CU_ASSERT_EQUAL(speaker_note_divisors[0], 0);
+    for (uint32_t n = 2; n < EXO_SOUND_NOTES; n++) {
+        CU_ASSERT(speaker_note_divisors[n] < speaker_note_divisors[n - 1]);
+    }
+    // 24 steps up is one octave: half the divisor.
+    int32_t octave = 2 * speaker_note_divisors[25] - speaker_note_divisors[1];
+    CU_ASSERT(octave >= -2 && octave <= 2);
+
+    CU_ASSERT_EQUAL(speaker_tone(0, 0, EXO_SOUND_NOTE(1), 7), 0);
+    CU_ASSERT_EQUAL(speaker_divisor(), 6818);
+    CU_ASSERT_EQUAL(speaker_tone(0, 0, EXO_SOUND_NOTE(EXO_SOUND_NOTES), 7), -EXO_EINVAL);
+}
+
+static void test_limits_and_stop(void)
+{
+    start_at(0);
+    CU_ASSERT_EQUAL(speaker_tone(EXO_SOUND_CHANNELS, 0, 440, 10), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(speaker_tone(0, 0, 10, 10), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(speaker_tone(0, 0, 30000, 10), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(speaker_tone(0, 0, 440, 0), -EXO_EINVAL);
+
+    for (uint32_t i = 0; i < EXO_SOUND_QUEUE; i++) {
+        CU_ASSERT_EQUAL(speaker_tone(4, 0, 440 + i, 10), 0);
+    }
+    CU_ASSERT_EQUAL(speaker_tone(4, 0, 440, 10), -EXO_EBUSY);
+    CU_ASSERT_EQUAL(speaker_stats()->rejected, 1U);
+
+    speaker_tone(5, 0, 880, 10);
+    CU_ASSERT_EQUAL(speaker_stop(5), 0);
+    CU_ASSERT_EQUAL(speaker_pending(5), 0U);
+    CU_ASSERT_EQUAL(speaker_pending(4), (uint32_t)EXO_SOUND_QUEUE);
+    CU_ASSERT_EQUAL(speaker_stop(EXO_SOUND_ALL), 0);
+    CU_ASSERT_EQUAL(speaker_pending(4), 0U);
+    CU_ASSERT_EQUAL(speaker_divisor(), 0);
+    CU_ASSERT_EQUAL(speaker_stop(EXO_SOUND_CHANNELS), -EXO_EINVAL);
+}
+
+static void test_sound_syscalls(void)
+{
+    start_at(0);
+    // Channel 2, priority 9 packed into a3.
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_SOUND_TONE, 440, 50, 2 | 9 << 8, 0, 0), 0);
+    CU_ASSERT_EQUAL(speaker_pending(2), 1U);
+    CU_ASSERT_EQUAL(speaker_divisor(), DIV(440));
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_SOUND_STOP, EXO_SOUND_ALL, 0, 0, 0, 0), 0);
+    CU_ASSERT_EQUAL(speaker_divisor(), 0);
+    speaker_init();
+}
+
+void suite_speaker_tests(CU_pSuite s)
+{
+    CU_add_test(s, "tone_plays_for_its_duration",  test_tone_plays_for_its_duration);
+    CU_add_test(s, "queued_tones_do_not_drift",    test_queued_tones_do_not_drift);
+    CU_add_test(s, "priority_preempts_and_resumes", test_priority_preempts_and_resumes);
+    CU_add_test(s, "equal_priority_newest_wins",   test_equal_priority_newest_wins);
+    CU_add_test(s, "note_table",                   test_note_table);
+    CU_add_test(s, "limits_and_stop",              test_limits_and_stop);
+    CU_add_test(s, "sound_syscalls",               test_sound_syscalls);
+}
@@ -0,0 +1,131 @@
+/*
+ * test_submit_k.c — Kernel-side CUnit tests for the batched syscall ring.
+ *
+ * Fills the ring with the LibOS helpers from exo_ring.h and rings the
+ * doorbell through syscall_dispatch(), as the entry stubs would.
+ */
+
+#include "kunit.h"
+#include "submit.h"
+#include "syscall.h"
+#include "vdata.h"
+
+static exo_ring_t ring;
+
+static void reset_ring(void)
+{
+    ring.sq_head = ring.sq_tail = 0;
+    ring.cq_head = ring.cq_tail = 0;
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_RING_SETUP, (uint32_t)&ring,
+                                     0, 0, 0, 0), 0);
+}
+
+static void test_submit_without_ring_is_ebadf(void)
+{
+    submit_register(0);
+    CU_ASSERT_EQUAL(submit_process(1), -EXO_EBADF);
+}
+
+static void test_misaligned_ring_is_rejected(void)
+{
+    CU_ASSERT_EQUAL(submit_register((exo_ring_t *)((uint32_t)&ring + 2)),
+                    -EXO_EINVAL);
+}
+
+static void test_requests_complete_in_order(void)
+{
+    exo_cqe_t cqe = { 0, 0 };
+
+    reset_ring();
+    CU_ASSERT_TRUE(exo_ring_queue(&ring, EXO_SYS_VDATA, 0, 0, 0, 10));
+    CU_ASSERT_TRUE(exo_ring_queue(&ring, EXO_SYS_FB_ACQUIRE, 0, 0, 0, 11));
+    CU_ASSERT_TRUE(exo_ring_queue(&ring, EXO_SYS_SERIAL_WRITE, 0, 4, 0, 12));
+    CU_ASSERT_EQUAL(exo_ring_pending(&ring), 3U);
+
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_SUBMIT, 8, 0, 0, 0, 0), 3);
+    CU_ASSERT_EQUAL(exo_ring_pending(&ring), 0U);
+
+    CU_ASSERT_TRUE(exo_ring_reap(&ring, &cqe));
+    CU_ASSERT_EQUAL(cqe.user_data, 10U);
+    CU_ASSERT_EQUAL((uint32_t)cqe.result, (uint32_t)vdata_page());
+    CU_ASSERT_TRUE(exo_ring_reap(&ring, &cqe));
+    CU_ASSERT_EQUAL(cqe.user_data, 11U);
+    CU_ASSERT_EQUAL(cqe.result, -EXO_ENOSYS);
+    CU_ASSERT_TRUE(exo_ring_reap(&ring, &cqe));
+    CU_ASSERT_EQUAL(cqe.user_data, 12U);
+    CU_ASSERT_EQUAL(cqe.result, -EXO_EFAULT);
+    CU_ASSERT_FALSE(exo_ring_reap(&ring, &cqe));
+
+    CU_ASSERT_EQUAL(submit_stats()->doorbells, 1U);
+    CU_ASSERT_EQUAL(submit_stats()->requests, 3U);
+    CU_ASSERT_EQUAL(submit_stats()->errors, 2U);
+    CU_ASSERT_EQUAL(submit_stats()->max_batch, 3U);
+}
+
+static void test_doorbell_count_limits_batch(void)
+{
+    exo_cqe_t cqe = { 0, 0 };
+
+    reset_ring();
+    exo_ring_queue(&ring, EXO_SYS_GET_TICKS, 0, 0, 0, 1);
+    exo_ring_queue(&ring, EXO_SYS_GET_TICKS, 0, 0, 0, 2);
+    exo_ring_queue(&ring, EXO_SYS_GET_TICKS, 0, 0, 0, 3);
+
+    CU_ASSERT_EQUAL(submit_process(2), 2);
+    CU_ASSERT_EQUAL(exo_ring_pending(&ring), 1U);
+    CU_ASSERT_EQUAL(submit_process(2), 1);
+    CU_ASSERT_EQUAL(submit_process(2), 0);
+
+    while (exo_ring_reap(&ring, &cqe))
+        ;
+    CU_ASSERT_EQUAL(cqe.user_data, 3U);
+}
+
+static void test_full_cq_stops_consumption(void)
+{
+    exo_cqe_t cqe = { 0, 0 };
+    uint32_t i;
+
+    reset_ring();
+    for (i = 0; i < EXO_RING_ENTRIES; i++)
+        CU_ASSERT_TRUE(exo_ring_queue(&ring, EXO_SYS_GET_TICKS, 0, 0, 0, i));
+    CU_ASSERT_FALSE(exo_ring_queue(&ring, EXO_SYS_GET_TICKS, 0, 0, 0, 99));
+    CU_ASSERT_EQUAL(submit_process(EXO_RING_ENTRIES), EXO_RING_ENTRIES);
+
+    /* CQ is now full and unreaped: the next request must wait. */
+    CU_ASSERT_TRUE(exo_ring_queue(&ring, EXO_SYS_GET_TICKS, 0, 0, 0, 100));
+    CU_ASSERT_EQUAL(submit_process(1), 0);
+    CU_ASSERT_EQUAL(submit_stats()->cq_full, 1U);
+    CU_ASSERT_EQUAL(exo_ring_pending(&ring), 1U);
+
+    CU_ASSERT_TRUE(exo_ring_reap(&ring, &cqe));
+    CU_ASSERT_EQUAL(cqe.user_data, 0U);
+    CU_ASSERT_EQUAL(submit_process(1), 1);
+}
+
+static void test_ring_ops_cannot_be_batched(void)
+{
+    exo_cqe_t cqe = { 0, 0 };
+
+    reset_ring();
+    exo_ring_queue(&ring, EXO_SYS_SUBMIT, 1, 0, 0, 7);
+    exo_ring_queue(&ring, EXO_SYS_RING_SETUP, 0, 0, 0, 8);
+    CU_ASSERT_EQUAL(submit_process(2), 2);
+
+    CU_ASSERT_TRUE(exo_ring_reap(&ring, &cqe));
+    CU_ASSERT_EQUAL(cqe.result, -EXO_EINVAL);
+    CU_ASSERT_TRUE(exo_ring_reap(&ring, &cqe));
+    CU_ASSERT_EQUAL(cqe.result, -EXO_EINVAL);
+
+    submit_register(0);
+}
+
+void suite_submit_tests(CU_pSuite s)
+{
+    CU_add_test(s, "submit_without_ring_is_ebadf", test_submit_without_ring_is_ebadf);
+    CU_add_test(s, "misaligned_ring_is_rejected",  test_misaligned_ring_is_rejected);
+    CU_add_test(s, "requests_complete_in_order",   test_requests_complete_in_order);
+    CU_add_test(s, "doorbell_count_limits_batch",  test_doorbell_count_limits_batch);
+    CU_add_test(s, "full_cq_stops_consumption",    test_full_cq_stops_consumption);
+    CU_add_test(s, "ring_ops_cannot_be_batched",   test_ring_ops_cannot_be_batched);
+}
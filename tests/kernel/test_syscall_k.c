@@ -0,0 +1,74 @@
+/*
+ * test_syscall_k.c — Kernel-side CUnit tests for the syscall dispatcher.
+ *
+ * Calls syscall_dispatch() directly, i.e. what both entry stubs do after
+ * collecting the registers; the gates themselves need ring 3 to exercise.
+ */
+
+#include "kunit.h"
+#include "syscall.h"
+#include "pit.h"
+#include "ps2.h"
+
+static void test_out_of_range_is_enosys(void)
+{
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_COUNT, 0, 0, 0, 0, 0), -EXO_ENOSYS);
+    CU_ASSERT_EQUAL(syscall_dispatch(0xFFFFFFFFu, 0, 0, 0, 0, 0), -EXO_ENOSYS);
+    CU_ASSERT_PTR_NULL(syscall_stats(EXO_SYS_COUNT));
+}
+
+static void test_unimplemented_is_enosys(void)
+{
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_PAGE_ALLOC, 0, 0, 0, 0, 0), -EXO_ENOSYS);
+    CU_ASSERT_EQUAL(syscall_stats(EXO_SYS_PAGE_ALLOC)->calls, 0U);
+}
+
+static void test_get_ticks_is_counted(void)
+{
+    uint32_t before = syscall_stats(EXO_SYS_GET_TICKS)->calls;
+
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_GET_TICKS, 0, 0, 0, 0, 0),
+                    (int32_t)kernel_get_ticks_ms());
+    CU_ASSERT_EQUAL(syscall_stats(EXO_SYS_GET_TICKS)->calls, before + 1);
+}
+
+static void test_kbd_poll_through_dispatch(void)
+{
+    kbd_event_t ev;
+
+    ps2_set_verbose(false);
+    while (kbd_dequeue(&ev))
+        ;
+
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_KBD_POLL, (uint32_t)&ev, 0, 0, 0, 0), 0);
+    ps2_process_scancode(0x1E);             /* A make */
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_KBD_POLL, (uint32_t)&ev, 0, 0, 0, 0), 1);
+    CU_ASSERT_EQUAL(ev.key, KEY_A);
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_KBD_POLL, 0, 0, 0, 0, 0), -EXO_EFAULT);
+
+    ps2_process_scancode(0x9E);             /* A break */
+    while (kbd_dequeue(&ev))
+        ;
+    ps2_set_verbose(true);
+}
+
+static void test_serial_write_validates_buffer(void)
+{
+    static const char msg[] = "[syscall test]\n";
+
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_SERIAL_WRITE, (uint32_t)msg,
+                                     sizeof(msg) - 1, 0, 0, 0),
+                    (int32_t)(sizeof(msg) - 1));
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_SERIAL_WRITE, 0, 4, 0, 0, 0), -EXO_EFAULT);
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_SERIAL_WRITE, 0xFFFFFFF0u, 0x20, 0, 0, 0),
+                    -EXO_EFAULT);
+}
+
+void suite_syscall_tests(CU_pSuite s)
+{
+    CU_add_test(s, "out_of_range_is_enosys",        test_out_of_range_is_enosys);
+    CU_add_test(s, "unimplemented_is_enosys",       test_unimplemented_is_enosys);
+    CU_add_test(s, "get_ticks_is_counted",          test_get_ticks_is_counted);
+    CU_add_test(s, "kbd_poll_through_dispatch",     test_kbd_poll_through_dispatch);
+    CU_add_test(s, "serial_write_validates_buffer", test_serial_write_validates_buffer);
+}
@@ -0,0 +1,94 @@
+/*
+ * test_trace_k.c — Kernel-side CUnit tests for tracepoints.
+ *
+ * Interrupts are off while tests run, so only the tracepoints the tests
+ * hit themselves add records. Each test restarts the ring and stops it
+ * again, leaving tracing off for the suites after it.
+ */
+
+#include "kunit.h"
+#include "trace.h"
+#include "syscall.h"
+#include "exo_abi.h"
+
+static void test_disabled_event_records_nothing(void)
+{
+    CU_ASSERT_TRUE(trace_start(1u << TRACE_MARK));
+    TRACE(SCANCODE, 0x1E, 0);
+    CU_ASSERT_EQUAL(trace_stats()->records, 0U);
+
+    TRACE(MARK, 0x1234, 0xCAFEF00D);
+    trace_stop();
+    TRACE(MARK, 1, 1);
+    CU_ASSERT_EQUAL(trace_stats()->records, 1U);
+
+    trace_rec_t r;
+    CU_ASSERT_EQUAL(trace_read(&r, 1), 1U);
+    CU_ASSERT_EQUAL(r.event, TRACE_MARK);
+    CU_ASSERT_EQUAL(r.where & 0xF, 0);             // BSP
+    CU_ASSERT_EQUAL(r.a, 0x1234);
+    CU_ASSERT_EQUAL(r.b, 0xCAFEF00DU);
+    CU_ASSERT_NOT_EQUAL(r.tsc, 0);
+}
+
+static void test_enable_one_event(void)
+{
+    CU_ASSERT_TRUE(trace_start(0));
+    trace_enable(TRACE_SCANCODE, true);
+    TRACE(SCANCODE, 0x1E, 0);
+    TRACE(MARK, 0, 0);
+    trace_enable(TRACE_SCANCODE, false);
+    TRACE(SCANCODE, 0x9E, 0);
+    CU_ASSERT_EQUAL(trace_stats()->records, 1U);
+    CU_ASSERT_EQUAL(trace_mask, 0U);
+}
+
+static void test_ring_wraps_and_counts_overwrites(void)
+{
+    CU_ASSERT_TRUE(trace_start(TRACE_ALL));
+    for (uint32_t i = 0; i < TRACE_RING_RECORDS + 3; i++) TRACE(MARK, i, i);
+    trace_stop();
+
+    const trace_stats_t* s = trace_stats();
+    CU_ASSERT_EQUAL(s->records, TRACE_RING_RECORDS + 3U);
+    CU_ASSERT_EQUAL(s->overwritten, 3U);
+
+    trace_rec_t r[2];
+    CU_ASSERT_EQUAL(trace_read(r, 2), 2U);
+    CU_ASSERT_EQUAL(r[0].b, TRACE_RING_RECORDS + 1U);
+    CU_ASSERT_EQUAL(r[1].b, TRACE_RING_RECORDS + 2U);
+    CU_ASSERT(r[0].tsc <= r[1].tsc);
+}
+
+static void test_find_by_id(void)
+{
+    CU_ASSERT_EQUAL(trace_find("irq_enter", 9), TRACE_IRQ_ENTER);
+    CU_ASSERT_EQUAL(trace_find("MARK now", 4), TRACE_MARK);
+    CU_ASSERT_EQUAL(trace_find("IRQ", 3), -1);
+    CU_ASSERT_EQUAL(trace_find("irq_enter_x", 11), -1);
+    CU_ASSERT_EQUAL(trace_event(TRACE_FRAME_BEGIN)->ph, 'b');
+    CU_ASSERT_PTR_NULL(trace_event(TRACE_EVENT_COUNT));
+}
+
+static void test_libos_frame_syscall(void)
+{
+    CU_ASSERT_TRUE(trace_start(1u << TRACE_FRAME_BEGIN));
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_TRACE, EXO_TRACE_FRAME_BEGIN, 42, 0, 0, 0), 0);
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_TRACE, EXO_TRACE_FRAME_END, 42, 0, 0, 0), 0);
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_TRACE, 7, 0, 0, 0, 0), -EXO_EINVAL);
+    trace_stop();
+
+    trace_rec_t r[2];
+    CU_ASSERT_EQUAL(trace_read(r, 2), 1U);
+    CU_ASSERT_EQUAL(r[0].event, TRACE_FRAME_BEGIN);
+    CU_ASSERT_EQUAL(r[0].b, 42U);
+}
+
+void suite_trace_tests(CU_pSuite s)
+{
+    CU_add_test(s, "disabled_event_records_nothing", test_disabled_event_records_nothing);
+    CU_add_test(s, "enable_one_event",               test_enable_one_event);
+    CU_add_test(s, "ring_wraps_and_counts_overwrites", test_ring_wraps_and_counts_overwrites);
+    CU_add_test(s, "find_by_id",                     test_find_by_id);
+    CU_add_test(s, "libos_frame_syscall",            test_libos_frame_syscall);
+}
@@ -0,0 +1,94 @@
+/*
+ * test_vdata_k.c — Kernel-side CUnit tests for the shared data page.
+ *
+ * Reads the page through the LibOS helpers in exo_vdata.h, exactly as a
+ * LibOS would, while driving the kernel-side writers directly.  The PIT is
+ * not running in the test build, so nothing else updates the page.
+ */
+
+#include "kunit.h"
+#include "vdata.h"
+#include "syscall.h"
+#include "ps2.h"
+#include "cpu.h"
+
+static void test_page_is_aligned_and_reachable(void)
+{
+    const exo_vdata_t *vd = vdata_page();
+
+    CU_ASSERT_EQUAL((uint32_t)vd & 0xFFF, 0U);
+    CU_ASSERT_EQUAL((uint32_t)syscall_dispatch(EXO_SYS_VDATA, 0, 0, 0, 0, 0),
+                    (uint32_t)vd);
+}
+
+static void test_tick_updates_clock_and_seq(void)
+{
+    const exo_vdata_t *vd = vdata_page();
+    uint32_t seq;
+
+    vdata_init(1000, 0);
+    CU_ASSERT_EQUAL(vd->version, (uint32_t)EXO_VDATA_VERSION);
+    CU_ASSERT_EQUAL(vd->tick_hz, 1000U);
+
+    seq = vd->seq;
+    CU_ASSERT_EQUAL(seq & 1, 0U);
+    vdata_tick(42, 42, 0);
+    CU_ASSERT_EQUAL(vd->seq, seq + 2);
+    CU_ASSERT_EQUAL(exo_vdata_ms(vd), 42U);
+
+    /* Uncalibrated TSC: nanoseconds fall back to tick resolution. */
+    CU_ASSERT_TRUE(exo_vdata_ns(vd) == 42000000ULL);
+}
+
+static void test_reader_retries_across_update(void)
+{
+    const exo_vdata_t *vd = vdata_page();
+    uint32_t seq;
+
+    seq = exo_vdata_begin(vd);
+    CU_ASSERT_FALSE(exo_vdata_retry(vd, seq));
+    vdata_tick(43, 43, 0);
+    CU_ASSERT_TRUE(exo_vdata_retry(vd, seq));
+}
+
+static void test_ns_interpolation_is_capped(void)
+{
+    const exo_vdata_t *vd = vdata_page();
+    uint64_t ns;
+
+    /* A 1 MHz "TSC" makes the real cycles since this tick look like
+       seconds; the helper must not run past the next tick. */
+    vdata_init(1000, 1000);
+    vdata_tick(100, 100, rdtsc());
+    ns = exo_vdata_ns(vd);
+    CU_ASSERT_TRUE(ns >= 100000000ULL);
+    CU_ASSERT_TRUE(ns <= 101000000ULL);
+
+    vdata_init(1000, 0);
+}
+
+static void test_modifiers_follow_keyboard(void)
+{
+    const exo_vdata_t *vd = vdata_page();
+    kbd_event_t ev;
+
+    ps2_set_verbose(false);
+    ps2_process_scancode(0x2A);             /* left shift make */
+    CU_ASSERT_EQUAL(exo_vdata_kbd_modifiers(vd), ps2_get_modifier_state());
+    CU_ASSERT_TRUE(exo_vdata_kbd_modifiers(vd) & MOD_LSHIFT);
+
+    ps2_process_scancode(0xAA);             /* left shift break */
+    CU_ASSERT_EQUAL(exo_vdata_kbd_modifiers(vd), 0);
+
+    while (kbd_dequeue(&ev))
+        ;
+}
+
+void suite_vdata_tests(CU_pSuite s)
+{
+    CU_add_test(s, "page_is_aligned_and_reachable", test_page_is_aligned_and_reachable);
+    CU_add_test(s, "tick_updates_clock_and_seq",    test_tick_updates_clock_and_seq);
+    CU_add_test(s, "reader_retries_across_update",  test_reader_retries_across_update);
+    CU_add_test(s, "ns_interpolation_is_capped",    test_ns_interpolation_is_capped);
+    CU_add_test(s, "modifiers_follow_keyboard",     test_modifiers_follow_keyboard);
+}
@@ -0,0 +1,123 @@
+/*
+ * test_vmm_k.c — Kernel-side CUnit tests for paging and demand-zero regions.
+ *
+ * kernel_main enables paging before the tests run, so these touch real
+ * window pages and take real #PFs. The tests skip themselves on a CPU
+ * without 4 MiB pages. Every test releases what it reserves.
+ */
+
+#include "kunit.h"
+#include "vmm.h"
+#include "pmm.h"
+#include "syscall.h"
+
+static void test_reserve_is_lazy(void)
+{
+    if (!vmm_enabled()) return;
+    uint32_t free_before = pmm_stats()->free_pages;
+    uint32_t faults = vmm_stats()->faults;
+    uint32_t base = 0;
+
+    CU_ASSERT_EQUAL(vmm_reserve(6 * 1024 * 1024, &base), 0);
+    CU_ASSERT_TRUE(base >= VMM_WINDOW_BASE);
+    CU_ASSERT_EQUAL(base % PAGE_SIZE, 0U);
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, free_before);
+    CU_ASSERT_EQUAL(vmm_stats()->faults, faults);
+
+    const vmm_region_t* r = vmm_region(base + 5 * 1024 * 1024);
+    CU_ASSERT_PTR_NOT_NULL(r);
+    if (r) CU_ASSERT_EQUAL(r->resident, 0U);
+    CU_ASSERT_EQUAL(vmm_release(base), 0);
+}
+
+static void test_first_touch_maps_zero_page(void)
+{
+    if (!vmm_enabled()) return;
+    uint32_t base = 0;
+    CU_ASSERT_EQUAL(vmm_reserve(4 * PAGE_SIZE, &base), 0);
+    uint32_t faults = vmm_stats()->faults;
+
+    volatile uint32_t* p = (volatile uint32_t*)(base + PAGE_SIZE);
+    CU_ASSERT_EQUAL(p[0], 0U);
+    CU_ASSERT_EQUAL(p[PAGE_SIZE / 4 - 1], 0U);
+    CU_ASSERT_EQUAL(vmm_stats()->faults, faults + 1);
+
+    // Same page again: present now, no fault.
+    p[10] = 0xC0FFEE;
+    CU_ASSERT_EQUAL(p[10], 0xC0FFEEU);
+    CU_ASSERT_EQUAL(vmm_stats()->faults, faults + 1);
+
+    // A write to a fresh page faults once too.
+    ((volatile uint32_t*)(base + 3 * PAGE_SIZE))[0] = 1;
+    CU_ASSERT_EQUAL(vmm_stats()->faults, faults + 2);
+    CU_ASSERT_EQUAL(vmm_region(base)->resident, 2U);
+    CU_ASSERT_EQUAL(vmm_release(base), 0);
+}
+
+static void test_release_frees_pages(void)
+{
+    if (!vmm_enabled()) return;
+    uint32_t base = 0;
+    CU_ASSERT_EQUAL(vmm_reserve(8 * PAGE_SIZE, &base), 0);
+    uint32_t free_before = pmm_stats()->free_pages;
+    uint32_t tables = vmm_stats()->tables;
+
+    for (uint32_t i = 0; i < 8; i++) {
+        ((volatile uint8_t*)base)[i * PAGE_SIZE] = (uint8_t)i;
+    }
+    uint32_t new_tables = vmm_stats()->tables - tables;
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, free_before - 8 - new_tables);
+
+    CU_ASSERT_EQUAL(vmm_release(base), 0);
+    CU_ASSERT_EQUAL(pmm_stats()->free_pages, free_before - new_tables);
+    CU_ASSERT_PTR_NULL(vmm_region(base));
+
+    // The same address space comes back, and it reads zero again.
+    uint32_t again = 0;
+    CU_ASSERT_EQUAL(vmm_reserve(8 * PAGE_SIZE, &again), 0);
+    CU_ASSERT_EQUAL(again, base);
+    CU_ASSERT_EQUAL(((volatile uint8_t*)again)[7 * PAGE_SIZE], 0);
+    CU_ASSERT_EQUAL(vmm_release(again), 0);
+}
+
+static void test_limits(void)
+{
+    if (!vmm_enabled()) return;
+    uint32_t base = 0;
+    CU_ASSERT_EQUAL(vmm_reserve(0, &base), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(vmm_reserve(VMM_WINDOW_SIZE + PAGE_SIZE, &base), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(vmm_release(VMM_WINDOW_BASE), -EXO_EINVAL);
+
+    // Two regions never overlap, and the window runs out.
+    uint32_t a = 0, b = 0;
+    CU_ASSERT_EQUAL(vmm_reserve(VMM_WINDOW_SIZE / 2, &a), 0);
+    CU_ASSERT_EQUAL(vmm_reserve(VMM_WINDOW_SIZE / 2, &b), 0);
+    CU_ASSERT_EQUAL(b, a + VMM_WINDOW_SIZE / 2);
+    CU_ASSERT_EQUAL(vmm_reserve(PAGE_SIZE, &base), -EXO_ENOMEM);
+    CU_ASSERT_EQUAL(vmm_release(a + PAGE_SIZE), -EXO_EINVAL);
+    CU_ASSERT_EQUAL(vmm_release(a), 0);
+    CU_ASSERT_EQUAL(vmm_release(b), 0);
+}
+
+static void test_mem_syscalls(void)
+{
+    if (!vmm_enabled()) return;
+    uint32_t base = 0;
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_MEM_RESERVE, 3 * PAGE_SIZE,
+                                     (uint32_t)&base, 0, 0, 0), 0);
+    CU_ASSERT_PTR_NOT_NULL(vmm_region(base));
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_MEM_RESERVE, PAGE_SIZE, 0,
+                                     0, 0, 0), -EXO_EFAULT);
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_MEM_RELEASE, base, 0, 0, 0, 0), 0);
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_MEM_RELEASE, base, 0, 0, 0, 0),
+                    -EXO_EINVAL);
+}
+
+void suite_vmm_tests(CU_pSuite s)
+{
+    CU_add_test(s, "reserve_is_lazy",            test_reserve_is_lazy);
+    CU_add_test(s, "first_touch_maps_zero_page", test_first_touch_maps_zero_page);
+    CU_add_test(s, "release_frees_pages",        test_release_frees_pages);
+    CU_add_test(s, "limits",                     test_limits);
+    CU_add_test(s, "mem_syscalls",               test_mem_syscalls);
+}
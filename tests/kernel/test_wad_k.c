@@ -0,0 +1,160 @@
+/*
+ * test_wad_k.c — Kernel-side CUnit tests for the WAD lump index.
+ *
+ * Builds small WAD images in a static buffer: a 12-byte header, the lump
+ * data, then the directory, the same layout as freedoom2.wad.
+ */
+
+#include "kunit.h"
+#include "wad.h"
+#include "syscall.h"
+#include "string.h"
+
+#define MANY_LUMPS 300
+
+static uint8_t image[16384] __attribute__((aligned(4)));
+
+/* Lay out `n` lumps named names[i], each 4 bytes holding i. */
+static uint32_t build_wad(const char *id, const char *const *names, uint32_t n)
+{
+    exo_wad_header_t *h = (exo_wad_header_t *)image;
+    exo_wad_lump_t *dir;
+    uint32_t i, pos = sizeof(*h);
+
+    memset(image, 0, sizeof(image));
+    memcpy(h->id, id, 4);
+    h->numlumps = (int32_t)n;
+
+    for (i = 0; i < n; i++) {
+        memcpy(image + pos, &i, 4);
+        pos += 4;
+    }
+    h->infotableofs = (int32_t)pos;
+    dir = (exo_wad_lump_t *)(image + pos);
+    for (i = 0; i < n; i++) {
+        dir[i].filepos = (int32_t)(sizeof(*h) + 4 * i);
+        dir[i].size = 4;
+        strncpy(dir[i].name, names[i], 8);
+    }
+    return pos + n * sizeof(exo_wad_lump_t);
+}
+
+static const char *const basic[] = {
+    "PLAYPAL", "COLORMAP", "E1M1", "THINGS", "LINEDEFS", "E1M2", "THINGS",
+    "S_START", "TROOA1", "S_END",
+};
+#define NBASIC (sizeof(basic) / sizeof(basic[0]))
+
+static void test_rejects_malformed_images(void)
+{
+    exo_wad_header_t *h = (exo_wad_header_t *)image;
+    exo_wad_lump_t *dir;
+    uint32_t size;
+
+    size = build_wad("JWAD", basic, NBASIC);
+    CU_ASSERT_FALSE(wad_init(image, size));
+    CU_ASSERT_PTR_NULL(wad_info());
+
+    size = build_wad("IWAD", basic, NBASIC);
+    CU_ASSERT_FALSE(wad_init(image, size - 1));     /* directory truncated */
+
+    h->numlumps = -1;
+    CU_ASSERT_FALSE(wad_init(image, size));
+
+    size = build_wad("PWAD", basic, NBASIC);
+    dir = (exo_wad_lump_t *)(image + h->infotableofs);
+    dir[3].size = (int32_t)size;                    /* runs off the end */
+    CU_ASSERT_FALSE(wad_init(image, size));
+    CU_ASSERT_EQUAL(wad_find("PLAYPAL"), -1);
+}
+
+static void test_find_is_case_insensitive(void)
+{
+    uint32_t size = build_wad("IWAD", basic, NBASIC);
+
+    CU_ASSERT_TRUE(wad_init(image, size));
+    CU_ASSERT_EQUAL(wad_info()->numlumps, (uint32_t)NBASIC);
+    CU_ASSERT_EQUAL(wad_find("PLAYPAL"), 0);
+    CU_ASSERT_EQUAL(wad_find("colormap"), 1);   /* 8 chars, no NUL */
+    CU_ASSERT_EQUAL(wad_find("TrooA1"), 8);
+    CU_ASSERT_EQUAL(wad_find("E1M3"), -1);
+    CU_ASSERT_EQUAL(wad_find("PLAYPALX"), -1);
+}
+
+static void test_duplicate_name_resolves_to_last(void)
+{
+    uint32_t size = build_wad("IWAD", basic, NBASIC);
+
+    CU_ASSERT_TRUE(wad_init(image, size));
+    CU_ASSERT_EQUAL(wad_find("THINGS"), 6);
+}
+
+static void test_lump_data_is_in_place(void)
+{
+    uint32_t size = build_wad("IWAD", basic, NBASIC);
+    uint32_t lump_size = 0;
+    const uint32_t *data;
+
+    CU_ASSERT_TRUE(wad_init(image, size));
+    data = wad_lump_data(wad_find("E1M2"), &lump_size);
+    CU_ASSERT_TRUE((const uint8_t *)data == image + sizeof(exo_wad_header_t) + 4 * 5);
+    CU_ASSERT_EQUAL(lump_size, 4U);
+    CU_ASSERT_EQUAL(*data, 5U);
+    CU_ASSERT_PTR_NULL(wad_lump_data(-1, &lump_size));
+    CU_ASSERT_PTR_NULL(wad_lump_data((int32_t)NBASIC, &lump_size));
+}
+
+static void test_many_lumps_short_probes(void)
+{
+    static char storage[MANY_LUMPS][9];
+    static const char *names[MANY_LUMPS];
+    uint32_t i, size;
+    int all_found = 1;
+
+    for (i = 0; i < MANY_LUMPS; i++) {
+        storage[i][0] = 'L';
+        storage[i][1] = (char)('0' + i / 100);
+        storage[i][2] = (char)('0' + i / 10 % 10);
+        storage[i][3] = (char)('0' + i % 10);
+        storage[i][4] = '\0';
+        names[i] = storage[i];
+    }
+    size = build_wad("IWAD", names, MANY_LUMPS);
+
+    CU_ASSERT_TRUE(wad_init(image, size));
+    CU_ASSERT_TRUE(wad_info()->index_mask + 1 >= 2 * MANY_LUMPS);
+    for (i = 0; i < MANY_LUMPS; i++)
+        if (wad_find(names[i]) != (int32_t)i)
+            all_found = 0;
+    CU_ASSERT_TRUE(all_found);
+    CU_ASSERT_TRUE(wad_max_probe() <= 8);
+}
+
+static void test_map_through_dispatch(void)
+{
+    static exo_wad_info_t info;
+    uint32_t size = build_wad("IWAD", basic, NBASIC);
+
+    CU_ASSERT_TRUE(wad_init(image, size));
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_WAD_MAP, (uint32_t)&info,
+                                     0, 0, 0, 0), 0);
+    CU_ASSERT_EQUAL(info.base, (uint32_t)image);
+    CU_ASSERT_EQUAL(info.size, size);
+    CU_ASSERT_EQUAL(exo_wad_find(&info, "e1m1"), 2);
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_WAD_MAP, 0, 0, 0, 0, 0),
+                    -EXO_EFAULT);
+
+    CU_ASSERT_FALSE(wad_init(image, 0));
+    CU_ASSERT_EQUAL(syscall_dispatch(EXO_SYS_WAD_MAP, (uint32_t)&info,
+                                     0, 0, 0, 0), -EXO_ENOENT);
+}
+
+void suite_wad_tests(CU_pSuite s)
+{
+    CU_add_test(s, "rejects_malformed_images",      test_rejects_malformed_images);
+    CU_add_test(s, "find_is_case_insensitive",      test_find_is_case_insensitive);
+    CU_add_test(s, "duplicate_name_resolves_to_last", test_duplicate_name_resolves_to_last);
+    CU_add_test(s, "lump_data_is_in_place",         test_lump_data_is_in_place);
+    CU_add_test(s, "many_lumps_short_probes",       test_many_lumps_short_probes);
+    CU_add_test(s, "map_through_dispatch",          test_map_through_dispatch);
+}
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""Fold ExoDoom profiler samples into flamegraph stacks.
+
+Reads a serial log containing the output of the `prof` console command
+(src/prof.c), symbolizes each address against the unstripped kernel ELF
+and prints one folded stack per line, outermost caller first:
+
+    kernel_main;sched_yield;schedule 412
+
+Pipe that into flamegraph.pl, or pass --flat for a per-function table of
+samples where the function was running (self) or on the stack (total).
+
+    tools/prof_fold.py serial.log > exodoom.folded
+    flamegraph.pl exodoom.folded > exodoom.svg
+    tools/prof_fold.py --flat serial.log
+
+Only the last begin/end block in the log is used.
+"""
+
+import argparse
+import bisect
+import collections
+import shutil
+import subprocess
+import sys
+
+
+def load_symbols(elf, nm):
+    """Sorted (address, name) pairs of the text symbols in `elf`."""
+    out = subprocess.run([nm, "-n", "--defined-only", elf],
+                         check=True, capture_output=True, text=True).stdout
+    syms = []
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) == 3 and parts[1] in "tTwW":
+            syms.append((int(parts[0], 16), parts[2]))
+    return syms
+
+
+def symbolizer(syms):
+    addrs = [a for a, _ in syms]
+
+    def lookup(pc):
+        i = bisect.bisect_right(addrs, pc) - 1
+        return syms[i][1] if i >= 0 else "0x%08x" % pc
+    return lookup
+
+
+def read_block(lines):
+    """(count, [pc, ...]) runs from the last prof: begin ... end block."""
+    block, current = None, None
+    for line in lines:
+        line = line.strip()
+        if not line.startswith("prof: "):
+            continue
+        body = line[len("prof: "):]
+        if body.startswith("begin"):
+            current = []
+        elif body == "end":
+            if current is not None:
+                block = current
+            current = None
+        elif current is not None:
+            fields = body.split()
+            current.append((int(fields[0]), [int(f, 16) for f in fields[1:]]))
+    if block is None:
+        sys.exit("prof_fold: no complete 'prof: begin' ... 'prof: end' block")
+    return block
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("log", nargs="?", help="serial log (default: stdin)")
+    ap.add_argument("--elf", default="build/exodoom",
+                    help="unstripped kernel (default: build/exodoom)")
+    ap.add_argument("--nm", default=shutil.which("i686-elf-nm") or "nm",
+                    help="nm to use (default: i686-elf-nm, else nm)")
+    ap.add_argument("--flat", action="store_true",
+                    help="print self/total samples per function instead")
+    args = ap.parse_args()
+
+    with (open(args.log, errors="replace") if args.log else sys.stdin) as f:
+        block = read_block(f)
+    lookup = symbolizer(load_symbols(args.elf, args.nm))
+
+    folded = collections.Counter()
+    for count, pcs in block:
+        # pcs[0] is where the CPU was; the rest are return addresses, which
+        # point just past the call, so look up the byte before them.
+        names = [lookup(pcs[0])] + [lookup(pc - 1) for pc in pcs[1:]]
+        folded[";".join(reversed(names))] += count
+
+    if not args.flat:
+        for stack, count in folded.most_common():
+            print(stack, count)
+        return
+
+    total = sum(folded.values())
+    self_n, incl = collections.Counter(), collections.Counter()
+    for stack, count in folded.items():
+        frames = stack.split(";")
+        self_n[frames[-1]] += count
+        for name in set(frames):
+            incl[name] += count
+    print("%7s %6s %7s %6s  function" % ("self", "%", "total", "%"))
+    for name in sorted(incl, key=lambda n: (-self_n[n], -incl[n], n)):
+        print("%7d %5.1f%% %7d %5.1f%%  %s" % (
+            self_n[name], 100.0 * self_n[name] / total, incl[name],
+            100.0 * incl[name] / total, name))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""Convert an ExoDoom trace dump into Chrome trace JSON.
+
+Reads a serial log containing the output of the `trace` console command
+(src/trace.c) and writes a JSON object that chrome://tracing and
+ui.perfetto.dev open directly:
+
+    tools/trace_chrome.py serial.log > exodoom.json
+
+Each CPU is a process and each scheduler context a thread on it, so IRQs
+show up on top of whatever context they interrupted.  Timestamps are in
+microseconds from the first record, using the TSC rate printed in the
+dump header.  Only the last begin/end block in the log is used.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+RECORD = struct.Struct("<QBBHI")        # trace_rec_t: tsc, event, where, a, b
+
+
+def read_block(log):
+    """(header, events, records) from the last trace: begin ... end block."""
+    start = log.rfind(b"trace: begin ")
+    if start < 0:
+        sys.exit("no 'trace: begin' block in the log")
+    header, events = {}, {}
+    pos = start
+    while True:
+        nl = log.find(b"\n", pos)
+        if nl < 0:
+            sys.exit("trace block is truncated")
+        line = log[pos:nl].decode("ascii", "replace").strip()
+        pos = nl + 1
+        if line.startswith("trace: begin "):
+            header = dict(kv.split("=") for kv in line.split()[2:])
+        elif line.startswith("trace: event "):
+            _, _, num, ph, name, a, b = line.split()
+            events[int(num)] = (ph, name, None if a == "-" else a,
+                                None if b == "-" else b)
+        elif line.startswith("trace: data "):
+            size = int(line.split()[2])
+            break
+    data = log[pos:pos + size]
+    if len(data) != size or not log[pos + size:].startswith(b"\ntrace: end"):
+        sys.exit("trace data is truncated")
+    return header, events, [RECORD.unpack_from(data, off)
+                            for off in range(0, size, RECORD.size)]
+
+
+def convert(header, events, records):
+    khz = int(header.get("khz", "0")) or 1000      # unknown rate: ts = cycles
+    first = records[0][0] if records else 0
+    out = []
+    for tsc, event, where, a, b in records:
+        ph, name, a_name, b_name = events.get(event, ("i", "event%d" % event,
+                                                      "a", "b"))
+        ev = {
+            "name": name,
+            "ph": ph,
+            "ts": (tsc - first) * 1000.0 / khz,
+            "pid": where & 0xF,
+            "tid": where >> 4,
+            "args": {},
+        }
+        if a_name:
+            ev["args"][a_name] = a
+        if b_name:
+            ev["args"][b_name] = b
+        if ph in "be":
+            ev["cat"] = "libos"
+            ev["id"] = b
+        elif ph == "i":
+            ev["s"] = "t"
+        out.append(ev)
+    for cpu in sorted({r[2] & 0xF for r in records}):
+        out.append({"name": "process_name", "ph": "M", "pid": cpu,
+                    "args": {"name": "CPU %d" % cpu}})
+    return {"traceEvents": out, "displayTimeUnit": "ns",
+            "otherData": {"overwritten": header.get("overwritten", "0")}}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("log", nargs="?", default="-",
+                    help="serial log (default: stdin)")
+    args = ap.parse_args()
+
+    if args.log == "-":
+        log = sys.stdin.buffer.read()
+    else:
+        with open(args.log, "rb") as f:
+            log = f.read()
+    json.dump(convert(*read_block(log)), sys.stdout)
+    sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()